@@ -0,0 +1,39 @@
+#!/bin/bash
+# Measures how data parallel training scales on this machine: trains an epoch in a single
+# process, then in N local processes all-reducing over loopback, and compares their combined
+# training throughput against N times the single process', e.g.:
+#   bazel build -c opt //src:main
+#   benchmark/data_parallel_scaling.sh bazel-bin/src/main 4 --layer_sizes=784,256,10 \
+#     --train_data_file_path=train.csv --test_data_file_path=test.csv --num_threads=2
+# NOTE: the remaining arguments are passed to every process. The N processes share this
+# machine's cores, so size --num_threads for N of them. Ports from $PORT (29500) are used.
+set -euo pipefail
+
+main=$1
+n=$2
+shift 2
+port=${PORT:-29500}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+throughput() { grep -o '[0-9.e+]* samples/s' "$1" | tail -1 | cut -d' ' -f1; }
+
+"$main" --num_epochs=1 --out_model_checkpoint_file_path="$out/single.pb" "$@" > "$out/single.log" 2>&1
+single=$(throughput "$out/single.log")
+
+peers=$(seq -s, -f "127.0.0.1:%g" "$port" $((port + n - 1)))
+pids=()
+for ((rank = 0; rank < n; rank++)); do
+  "$main" --num_epochs=1 --num_shards="$n" --shard_index="$rank" --peers="$peers" \
+    --out_model_checkpoint_file_path="$out/rank$rank.pb" "$@" > "$out/rank$rank.log" 2>&1 &
+  pids+=($!)
+done
+for pid in "${pids[@]}"; do wait "$pid"; done
+combined=$(for ((rank = 0; rank < n; rank++)); do throughput "$out/rank$rank.log"; done \
+  | awk '{ sum += $1 } END { print sum }')
+
+awk -v n="$n" -v single="$single" -v combined="$combined" 'BEGIN {
+  printf "1 process : %.0f samples/s\n", single
+  printf "%d processes: %.0f samples/s combined, %.2fx speedup\n", n, combined, combined / single
+  printf "Scaling efficiency: %.1f%%\n", 100 * combined / (n * single)
+}'
@@ -0,0 +1,78 @@
+// Compares a full forward pass through NeuralNetwork::Infer, which allocates a fresh matrix
+// per layer, against InferenceEngine::Infer, which reuses the preallocated buffers of its
+// workspace, and QuantizedInferenceEngine::Infer, on int8 weights, on a 784-512-512-10 model
+// for single sample requests and batches of 32.
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/common/matrix.h"
+#include "src/neural_network/inference_engine.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/quantization.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+constexpr int32_t kNumRepetitions = 3;
+
+template <typename T>
+NeuralNetwork<T> BenchmarkModel() {
+  return NeuralNetwork<T>::Random(
+      {784, 512, 512, 10}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+}
+
+template <typename T>
+void BM_NeuralNetworkInfer(benchmark::State& state) {
+  const NeuralNetwork<T> neural_network = BenchmarkModel<T>();
+  const Matrix<T> input = Matrix<T>::Random(state.range(0), 784);
+  for (auto _ : state) {
+    Matrix<T> output = neural_network.Infer(input);
+    benchmark::DoNotOptimize(output.MutableData());
+  }
+}
+
+template <typename T>
+void BM_InferenceEngineInfer(benchmark::State& state) {
+  const InferenceEngine<T> engine = InferenceEngine<T>::FromNeuralNetwork(BenchmarkModel<T>());
+  typename InferenceEngine<T>::Workspace workspace = engine.NewWorkspace(state.range(0));
+  const Matrix<T> input = Matrix<T>::Random(state.range(0), 784);
+  std::vector<T> output(state.range(0) * engine.OutputSize());
+  for (auto _ : state) {
+    engine.Infer(input.Elements().data(), state.range(0), &workspace, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+
+void BM_QuantizedInferenceEngineInfer(benchmark::State& state) {
+  const NeuralNetwork<float> neural_network = BenchmarkModel<float>();
+  const QuantizedInferenceEngine engine = *QuantizedInferenceEngine::FromCheckpoint(
+      *QuantizeCheckpoint(neural_network.ToCheckpoint(), Matrix<float>::Random(32, 784)));
+  QuantizedInferenceEngine::Workspace workspace = engine.NewWorkspace(state.range(0));
+  const Matrix<float> input = Matrix<float>::Random(state.range(0), 784);
+  std::vector<float> output(state.range(0) * engine.OutputSize());
+  for (auto _ : state) {
+    engine.Infer(input.Elements().data(), state.range(0), &workspace, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+
+void BM_NeuralNetworkInferDouble(benchmark::State& state) { BM_NeuralNetworkInfer<double>(state); }
+void BM_InferenceEngineInferDouble(benchmark::State& state) { BM_InferenceEngineInfer<double>(state); }
+void BM_NeuralNetworkInferFloat(benchmark::State& state) { BM_NeuralNetworkInfer<float>(state); }
+void BM_InferenceEngineInferFloat(benchmark::State& state) { BM_InferenceEngineInfer<float>(state); }
+
+void InferenceArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark
+    ->Repetitions(kNumRepetitions)
+    ->DisplayAggregatesOnly(true)
+    ->Arg(1)
+    ->Arg(32);
+}
+
+BENCHMARK(BM_NeuralNetworkInferDouble)->Apply(InferenceArgs);
+BENCHMARK(BM_InferenceEngineInferDouble)->Apply(InferenceArgs);
+BENCHMARK(BM_NeuralNetworkInferFloat)->Apply(InferenceArgs);
+BENCHMARK(BM_InferenceEngineInferFloat)->Apply(InferenceArgs);
+BENCHMARK(BM_QuantizedInferenceEngineInfer)->Apply(InferenceArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+// Compares the Matrix GEMM kernels of each instruction set supported by the host CPU,
+// using the same shapes as benchmark/matrix.cc plus the training shapes of a 784-512-512-10
+// model with a partition of 32 samples, in both float and double precision. Also compares
+// the fused momentum update against the separate passes it replaces, and times the fused
+// Adam update, over the same model's layer shapes.
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "src/common/kernels.h"
+
+constexpr int32_t kNumRepetitions = 3;
+
+template <typename T>
+void BM_Gemm(benchmark::State& state, SimdIsa isa) {
+  const MatrixKernels<T>* kernels = GetMatrixKernelsForIsa<T>(isa);
+  if (kernels == nullptr) {
+    state.SkipWithError("ISA not supported by this CPU.");
+    return;
+  }
+  const int32_t m = state.range(0);
+  const int32_t k = state.range(1);
+  const int32_t n = state.range(2);
+  std::vector<T> a(m * k, 0.5);
+  std::vector<T> b(k * n, 0.25);
+  std::vector<T> c(m * n);
+  for (auto _ : state) {
+    kernels->gemm(/*trans_a=*/false, /*trans_b=*/false, m, n, k, a.data(), b.data(), c.data(), /*accumulate=*/false);
+    benchmark::DoNotOptimize(c.data());
+  }
+  state.counters["flops"] = benchmark::Counter(
+      2.0 * m * n * k, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_GemmDouble(benchmark::State& state, SimdIsa isa) { BM_Gemm<double>(state, isa); }
+void BM_GemmFloat(benchmark::State& state, SimdIsa isa) { BM_Gemm<float>(state, isa); }
+
+void GemmArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark
+    ->Repetitions(kNumRepetitions)
+    ->DisplayAggregatesOnly(true)
+    ->Args({32, 32, 32})
+    ->Args({256, 256, 256})
+    ->Args({512, 512, 512})
+    ->Args({32, 784, 512})
+    ->Args({32, 512, 512})
+    ->Args({1, 784, 512});
+}
+
+template <typename T>
+void BM_MomentumUpdate(benchmark::State& state, bool fused) {
+  const MatrixKernels<T>& kernels = GetMatrixKernels<T>();
+  const int64_t count = state.range(0) * state.range(1);
+  std::vector<T> g(count, 0.5);
+  std::vector<T> v(count, 0.25);
+  std::vector<T> w(count, 1.0);
+  const UpdateStep<T> step = { .learn_rate = 0.01, .beta1 = 0.9, .l2 = 0, .decay = 0.999 };
+  for (auto _ : state) {
+    if (fused) {
+      kernels.momentum_update(step, g.data(), v.data(), w.data(), count);
+    } else {
+      kernels.scale(v.data(), 0.9, v.data(), count);
+      kernels.axpy(g.data(), -0.01, v.data(), count);
+      kernels.scale(w.data(), 0.999, w.data(), count);
+      kernels.add(w.data(), v.data(), w.data(), count);
+    }
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.SetBytesProcessed(state.iterations() * count * sizeof(T) * 3);
+}
+
+// NOTE: streams one more moment than the momentum update, so it's expected to take ~4/3 as
+// long once memory bound.
+template <typename T>
+void BM_AdamUpdate(benchmark::State& state) {
+  const MatrixKernels<T>& kernels = GetMatrixKernels<T>();
+  const int64_t count = state.range(0) * state.range(1);
+  std::vector<T> g(count, 0.5);
+  std::vector<T> m(count, 0.25);
+  std::vector<T> v(count, 0.125);
+  std::vector<T> w(count, 1.0);
+  const UpdateStep<T> step = {
+    .learn_rate = 0.001, .beta1 = 0.9, .beta2 = 0.999, .epsilon = 1e-8, .l2 = 0, .decay = 0.999,
+  };
+  for (auto _ : state) {
+    kernels.adam_update(step, g.data(), m.data(), v.data(), w.data(), count);
+    benchmark::DoNotOptimize(w.data());
+  }
+  state.SetBytesProcessed(state.iterations() * count * sizeof(T) * 4);
+}
+
+void BM_MomentumUpdateDouble(benchmark::State& state, bool fused) {
+  BM_MomentumUpdate<double>(state, fused);
+}
+void BM_MomentumUpdateFloat(benchmark::State& state, bool fused) {
+  BM_MomentumUpdate<float>(state, fused);
+}
+
+void BM_AdamUpdateDouble(benchmark::State& state) { BM_AdamUpdate<double>(state); }
+void BM_AdamUpdateFloat(benchmark::State& state) { BM_AdamUpdate<float>(state); }
+
+void MomentumUpdateArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark
+    ->Repetitions(kNumRepetitions)
+    ->DisplayAggregatesOnly(true)
+    ->Args({784, 512})
+    ->Args({512, 512})
+    ->Args({512, 10});
+}
+
+BENCHMARK_CAPTURE(BM_GemmDouble, generic, SimdIsa::GENERIC)->Apply(GemmArgs);
+BENCHMARK_CAPTURE(BM_GemmDouble, avx2, SimdIsa::AVX2)->Apply(GemmArgs);
+BENCHMARK_CAPTURE(BM_GemmDouble, avx512, SimdIsa::AVX512)->Apply(GemmArgs);
+BENCHMARK_CAPTURE(BM_GemmFloat, generic, SimdIsa::GENERIC)->Apply(GemmArgs);
+BENCHMARK_CAPTURE(BM_GemmFloat, avx2, SimdIsa::AVX2)->Apply(GemmArgs);
+BENCHMARK_CAPTURE(BM_GemmFloat, avx512, SimdIsa::AVX512)->Apply(GemmArgs);
+
+BENCHMARK_CAPTURE(BM_MomentumUpdateDouble, unfused, false)->Apply(MomentumUpdateArgs);
+BENCHMARK_CAPTURE(BM_MomentumUpdateDouble, fused, true)->Apply(MomentumUpdateArgs);
+BENCHMARK_CAPTURE(BM_MomentumUpdateFloat, unfused, false)->Apply(MomentumUpdateArgs);
+BENCHMARK_CAPTURE(BM_MomentumUpdateFloat, fused, true)->Apply(MomentumUpdateArgs);
+BENCHMARK(BM_AdamUpdateDouble)->Apply(MomentumUpdateArgs);
+BENCHMARK(BM_AdamUpdateFloat)->Apply(MomentumUpdateArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+// Compares a single layer's forward pass (weighted input + bias + activation) with the
+// activation dispatched through std::function over a separately computed, materialized
+// weighted input, against Layer::Infer where bias add and activation are fused into the
+// GEMM epilogue. Shapes are the hidden layers of a 784-512-512-10 model, for a partition
+// of 32 samples and for single sample inference, plus a narrow, wide batch layer.
+//
+// Results show that on the 784-512-512-10 shapes the GEMM dominates and both are within
+// noise, while on the narrow layer (where the GEMM is cheap next to the activation pass)
+// the fused path is ~3x faster, skipping the extra weighted input copy and memory passes.
+// The fused layer is also measured in float precision.
+
+#include <cstdint>
+#include <functional>
+
+#include "benchmark/benchmark.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/neural_network/activation.h"
+#include "src/neural_network/layer.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+constexpr int32_t kNumRepetitions = 3;
+
+template <typename T>
+std::function<Matrix<T>(const Matrix<T>&)> UnfusedActivation(protos::Activation activation) {
+  return DispatchActivation(activation, [](auto activation) {
+    return std::function<Matrix<T>(const Matrix<T>&)>([](const Matrix<T>& w_input) {
+      Matrix<T> activated = w_input;
+      for (int32_t r = 0; r < activated.RowCount(); r++) {
+        decltype(activation)::Apply(
+            activated.MutableData() + (int64_t) r * activated.ColCount(), activated.ColCount());
+      }
+      return activated;
+    });
+  });
+}
+
+template <typename T>
+void BM_LayerUnfused(benchmark::State& state, protos::Activation activation) {
+  const Matrix<T> input = Matrix<T>::Random(state.range(0), state.range(1));
+  const Matrix<T> weights = Matrix<T>::Random(state.range(1), state.range(2));
+  const Matrix<T> biases = Matrix<T>::Random(1, state.range(2));
+  for (auto _ : state) {
+    Matrix<T> w_input = input * weights;
+    for (int32_t r = 0; r < w_input.RowCount(); r++) {
+      T* row = w_input.MutableData() + (int64_t) r * w_input.ColCount();
+      GetMatrixKernels<T>().add(row, biases.Elements().data(), row, w_input.ColCount());
+    }
+    Matrix<T> activated = UnfusedActivation<T>(activation)(w_input);
+    benchmark::DoNotOptimize(activated.MutableData());
+  }
+}
+
+template <typename T>
+void BM_LayerFused(benchmark::State& state, protos::Activation activation) {
+  const Matrix<T> input = Matrix<T>::Random(state.range(0), state.range(1));
+  const Layer<T> layer(
+      Matrix<T>::Random(state.range(1), state.range(2)), Matrix<T>::Random(1, state.range(2)),
+      activation);
+  for (auto _ : state) {
+    Matrix<T> activated = layer.Infer(input);
+    benchmark::DoNotOptimize(activated.MutableData());
+  }
+}
+
+void BM_LayerUnfusedDouble(benchmark::State& state, protos::Activation activation) {
+  BM_LayerUnfused<double>(state, activation);
+}
+void BM_LayerFusedDouble(benchmark::State& state, protos::Activation activation) {
+  BM_LayerFused<double>(state, activation);
+}
+void BM_LayerFusedFloat(benchmark::State& state, protos::Activation activation) {
+  BM_LayerFused<float>(state, activation);
+}
+
+void LayerArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark
+    ->Repetitions(kNumRepetitions)
+    ->DisplayAggregatesOnly(true)
+    ->Args({32, 784, 512})
+    ->Args({32, 512, 512})
+    ->Args({1, 784, 512})
+    ->Args({256, 32, 512});
+}
+
+BENCHMARK_CAPTURE(BM_LayerUnfusedDouble, sigmoid, protos::Activation::SIGMOID)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedDouble, sigmoid, protos::Activation::SIGMOID)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedFloat, sigmoid, protos::Activation::SIGMOID)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerUnfusedDouble, tanh, protos::Activation::TANH)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedDouble, tanh, protos::Activation::TANH)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedFloat, tanh, protos::Activation::TANH)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerUnfusedDouble, relu, protos::Activation::RELU)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedDouble, relu, protos::Activation::RELU)->Apply(LayerArgs);
+BENCHMARK_CAPTURE(BM_LayerFusedFloat, relu, protos::Activation::RELU)->Apply(LayerArgs);
+
+BENCHMARK_MAIN();
@@ -117,7 +117,7 @@ BENCHMARK(BM_NaiveMultiply)
   ->DisplayAggregatesOnly(true)
   ->Args({32, 32})
   ->Args({256, 256})
-  ->Args({512, 512});
+  ->Args({512, 512})
   ->Args({256, 512})
   ->Args({512, 256});
 
@@ -134,7 +134,7 @@ BENCHMARK(BM_CacheMultiply)
   ->DisplayAggregatesOnly(true)
   ->Args({32, 32})
   ->Args({256, 256})
-  ->Args({512, 512});
+  ->Args({512, 512})
   ->Args({256, 512})
   ->Args({512, 256});
 
@@ -151,7 +151,7 @@ BENCHMARK(BM_TiledMultiply)
   ->DisplayAggregatesOnly(true)
   ->Args({32, 32})
   ->Args({256, 256})
-  ->Args({512, 512});
+  ->Args({512, 512})
   ->Args({256, 512})
   ->Args({512, 256});
 
@@ -0,0 +1,75 @@
+#include "src/common/arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "absl/log/check.h"
+
+// NOTE: blocks are cache line aligned, which covers any alignment the arena is asked for.
+static constexpr size_t kBlockAlignment = 64;
+static constexpr size_t kMinBlockSize = 64 * 1024;
+
+Arena::Arena(size_t initial_size, std::pmr::memory_resource* upstream) :
+  upstream_(upstream),
+  blocks_(),
+  offset_(0),
+  bytes_used_(0) {
+    DCHECK(upstream_ != nullptr);
+    if (initial_size > 0) { AddBlock(initial_size); }
+  }
+
+Arena::~Arena() { FreeBlocks(); }
+
+void Arena::Reset() {
+  if (blocks_.size() > 1) {
+    // NOTE: the last cycle didn't fit in one block, coalesce so the next one will.
+    const size_t capacity = Capacity();
+    FreeBlocks();
+    AddBlock(capacity);
+  }
+  offset_ = 0;
+  bytes_used_ = 0;
+}
+
+size_t Arena::BytesUsed() const { return bytes_used_; }
+
+size_t Arena::Capacity() const {
+  size_t capacity = 0;
+  for (const Block& block : blocks_) { capacity += block.size; }
+  return capacity;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+  DCHECK(alignment <= kBlockAlignment);
+  size_t aligned_offset = (offset_ + alignment - 1) & ~(alignment - 1);
+  if (blocks_.empty() || aligned_offset + bytes > blocks_.back().size) {
+    AddBlock(bytes);
+    aligned_offset = 0;
+  }
+  bytes_used_ += (aligned_offset - offset_) + bytes;
+  offset_ = aligned_offset + bytes;
+  return blocks_.back().data + aligned_offset;
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+// NOTE: blocks at least double in size, so an unknown workload settles in a few cycles.
+void Arena::AddBlock(size_t min_size) {
+  const size_t size = std::max({min_size, kMinBlockSize, 2 * (blocks_.empty() ? 0 : blocks_.back().size)});
+  blocks_.push_back(Block {
+    .data = static_cast<std::byte*>(upstream_->allocate(size, kBlockAlignment)),
+    .size = size,
+  });
+  offset_ = 0;
+}
+
+void Arena::FreeBlocks() {
+  for (const Block& block : blocks_) {
+    upstream_->deallocate(block.data, block.size, kBlockAlignment);
+  }
+  blocks_.clear();
+}
@@ -0,0 +1,51 @@
+#ifndef SRC_COMMON_ARENA_H_
+#define SRC_COMMON_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for short-lived scratch memory, e.g. everything a training worker
+// allocates for one partition. Individual deallocations are no-ops, everything is released
+// at once by Reset(), and memory is retained across resets. When a cycle overflows the
+// current block, Reset() replaces it with a single block large enough for the whole cycle,
+// so a workload that repeats the same allocations stops touching the upstream resource.
+// NOTE: not thread safe, each thread should use its own arena.
+class Arena : public std::pmr::memory_resource {
+ public:
+  explicit Arena(
+      size_t initial_size = 0,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+  ~Arena() override;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // NOTE: invalidates everything allocated from the arena.
+  void Reset();
+  // Bytes handed out since the last reset, including alignment padding.
+  size_t BytesUsed() const;
+  // Bytes owned by the arena, across all of its blocks.
+  size_t Capacity() const;
+
+ private:
+  struct Block {
+    std::byte* data;
+    size_t size;
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  void AddBlock(size_t min_size);
+  void FreeBlocks();
+
+  std::pmr::memory_resource* upstream_;
+  // NOTE: allocations are bumped out of the last block, earlier blocks are full.
+  std::vector<Block> blocks_;
+  size_t offset_;
+  size_t bytes_used_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "src/common/arena.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "src/common/matrix.h"
+
+// NOTE: counts the blocks the arena asks for.
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  int32_t allocations = 0;
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    allocations++;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST(ArenaTest, AllocationsAreAligned) {
+  Arena arena;
+  void* small = arena.allocate(3, 1);
+  EXPECT_NE(small, nullptr);
+  void* p = arena.allocate(64, 64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 64, uintptr_t{0});
+  EXPECT_EQ(arena.BytesUsed(), size_t{128});
+}
+
+TEST(ArenaTest, ResetCoalescesIntoOneBlock) {
+  CountingResource upstream;
+  Arena arena(/*initial_size=*/1024, &upstream);
+  for (int32_t i = 0; i < 64; i++) {
+    void* p = arena.allocate(4096, 8);
+    EXPECT_NE(p, nullptr);
+  }
+  EXPECT_GT(upstream.allocations, 2);
+  EXPECT_GE(arena.Capacity(), arena.BytesUsed());
+
+  arena.Reset();
+  EXPECT_EQ(arena.BytesUsed(), size_t{0});
+  const int32_t allocations = upstream.allocations;
+  for (int32_t cycle = 0; cycle < 3; cycle++) {
+    for (int32_t i = 0; i < 64; i++) {
+      void* p = arena.allocate(4096, 8);
+      EXPECT_NE(p, nullptr);
+    }
+    arena.Reset();
+  }
+  EXPECT_EQ(upstream.allocations, allocations);
+}
+
+TEST(ArenaTest, MatrixResultsUseSameResource) {
+  Arena arena;
+  Matrix<double> a(2, 2, &arena);
+  Matrix<double> b(2, 2, &arena);
+  EXPECT_EQ((a * b).Resource(), &arena);
+  EXPECT_EQ(a.MultTranspose(b).ColumnSums().Resource(), &arena);
+
+  // NOTE: moves keep the arena, copies don't.
+  Matrix<double> moved;
+  moved = a + b;
+  EXPECT_EQ(moved.Resource(), &arena);
+  Matrix<double> copied = moved;
+  EXPECT_EQ(copied.Resource(), std::pmr::get_default_resource());
+}
@@ -0,0 +1,173 @@
+#include "src/common/kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+#include "src/common/kernels_internal.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+struct CpuFeatures {
+  bool avx2 = false;
+  bool avx512 = false;
+  bool avx512_vnni = false;
+};
+
+CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features;
+#if defined(__x86_64__) || defined(_M_X64)
+  uint32_t regs[4] = {};  // NOTE: eax, ebx, ecx, edx
+  auto cpuid = [&regs](uint32_t leaf, uint32_t sub_leaf) {
+#if defined(_MSC_VER)
+    __cpuidex(reinterpret_cast<int*>(regs), leaf, sub_leaf);
+#else
+    __cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+  };
+  cpuid(0, 0);
+  if (regs[0] < 7) { return features; }
+
+  cpuid(1, 0);
+  const bool fma = regs[2] & (1u << 12);
+  const bool osxsave = regs[2] & (1u << 27);
+  if (!osxsave) { return features; }
+  // NOTE: the OS must also save the wider register state on context switches.
+#if defined(_MSC_VER)
+  const uint64_t xcr0 = _xgetbv(0);
+#else
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  const uint64_t xcr0 = ((uint64_t) xcr0_hi << 32) | xcr0_lo;
+#endif
+  const bool os_avx = (xcr0 & 0x6) == 0x6;
+  const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+  cpuid(7, 0);
+  features.avx2 = os_avx && fma && (regs[1] & (1u << 5));
+  features.avx512 = features.avx2 && os_avx512 && (regs[1] & (1u << 16));
+  features.avx512_vnni = features.avx512 && (regs[2] & (1u << 11));
+#endif
+  return features;
+}
+
+template <typename T>
+const MatrixKernels<T>* SelectMatrixKernels() {
+  for (SimdIsa isa : {SimdIsa::AVX512, SimdIsa::AVX2}) {
+    const MatrixKernels<T>* kernels = GetMatrixKernelsForIsa<T>(isa);
+    if (kernels != nullptr) { return kernels; }
+  }
+  return GenericMatrixKernels<T>();
+}
+
+const Int8Kernels* SelectInt8Kernels() {
+  for (SimdIsa isa : {SimdIsa::AVX512_VNNI, SimdIsa::AVX2}) {
+    const Int8Kernels* kernels = GetInt8KernelsForIsa(isa);
+    if (kernels != nullptr) { return kernels; }
+  }
+  return GenericInt8Kernels();
+}
+
+const CpuFeatures& GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+struct AlignedFree {
+  void operator()(std::byte* ptr) const { ::operator delete[](ptr, std::align_val_t(64)); }
+};
+
+}  // namespace
+
+void* GemmWorkspaceBytes(int64_t size) {
+  thread_local std::unique_ptr<std::byte[], AlignedFree> workspace;
+  thread_local int64_t workspace_size = 0;
+  if (workspace_size < size) {
+    workspace.reset(new (std::align_val_t(64)) std::byte[size]);
+    workspace_size = size;
+  }
+  return workspace.get();
+}
+
+template <typename T>
+const MatrixKernels<T>& GetMatrixKernels() {
+  static const MatrixKernels<T>* kernels = SelectMatrixKernels<T>();
+  return *kernels;
+}
+
+template <typename T>
+const MatrixKernels<T>* GetMatrixKernelsForIsa(SimdIsa isa) {
+  const CpuFeatures& features = GetCpuFeatures();
+  switch (isa) {
+    case SimdIsa::GENERIC: { return GenericMatrixKernels<T>(); }
+    case SimdIsa::AVX2: { return features.avx2 ? Avx2MatrixKernels<T>() : nullptr; }
+    case SimdIsa::AVX512: { return features.avx512 ? Avx512MatrixKernels<T>() : nullptr; }
+    case SimdIsa::AVX512_VNNI: { return nullptr; }
+    default: { CHECK(false); return nullptr; }
+  }
+}
+
+template const MatrixKernels<float>& GetMatrixKernels<float>();
+template const MatrixKernels<double>& GetMatrixKernels<double>();
+template const MatrixKernels<float>* GetMatrixKernelsForIsa<float>(SimdIsa isa);
+template const MatrixKernels<double>* GetMatrixKernelsForIsa<double>(SimdIsa isa);
+
+const Int8Kernels& GetInt8Kernels() {
+  static const Int8Kernels* kernels = SelectInt8Kernels();
+  return *kernels;
+}
+
+const Int8Kernels* GetInt8KernelsForIsa(SimdIsa isa) {
+  const CpuFeatures& features = GetCpuFeatures();
+  switch (isa) {
+    case SimdIsa::GENERIC: { return GenericInt8Kernels(); }
+    case SimdIsa::AVX2: { return features.avx2 ? Avx2Int8Kernels() : nullptr; }
+    case SimdIsa::AVX512: { return nullptr; }
+    case SimdIsa::AVX512_VNNI: { return features.avx512_vnni ? Avx512VnniInt8Kernels() : nullptr; }
+    default: { CHECK(false); return nullptr; }
+  }
+}
+
+int64_t Int8PackedWeightsSize(int32_t k, int32_t n) {
+  const int32_t padded_n = (n + kInt8Nr - 1) / kInt8Nr * kInt8Nr;
+  return Int8PanelsSize(k, n) + padded_n * sizeof(int32_t);
+}
+
+void PackInt8Weights(int32_t k, int32_t n, const int8_t* b, int8_t* b_packed) {
+  const int32_t groups = Int8GroupCount(k);
+  int8_t* out = b_packed;
+  for (int32_t jr = 0; jr < n; jr += kInt8Nr) {
+    for (int32_t g = 0; g < groups; g++) {
+      for (int32_t j = jr; j < jr + kInt8Nr; j++) {
+        for (int32_t p = g * 4; p < g * 4 + 4; p++) {
+          *out++ = (p < k && j < n) ? b[(int64_t) p * n + j] : 0;
+        }
+      }
+    }
+  }
+  int32_t* column_sums = reinterpret_cast<int32_t*>(b_packed + Int8PanelsSize(k, n));
+  for (int32_t j = 0; j < (n + kInt8Nr - 1) / kInt8Nr * kInt8Nr; j++) {
+    column_sums[j] = 0;
+    for (int32_t p = 0; j < n && p < k; p++) { column_sums[j] += b[(int64_t) p * n + j]; }
+  }
+}
+
+absl::string_view SimdIsaToString(SimdIsa isa) {
+  switch (isa) {
+    case SimdIsa::GENERIC: { return "GENERIC"; }
+    case SimdIsa::AVX2: { return "AVX2"; }
+    case SimdIsa::AVX512: { return "AVX512"; }
+    case SimdIsa::AVX512_VNNI: { return "AVX512_VNNI"; }
+    default: { CHECK(false); return ""; }
+  }
+}
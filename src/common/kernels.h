@@ -0,0 +1,120 @@
+#ifndef SRC_COMMON_KERNELS_H_
+#define SRC_COMMON_KERNELS_H_
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+enum class SimdIsa {
+  GENERIC,
+  AVX2,
+  AVX512,
+  // NOTE: AVX-512 with VNNI, only adds int8 kernels; float / double use the AVX512 ones.
+  AVX512_VNNI,
+};
+
+// Runs on each finished block of a GEMM's output while it is still in cache, e.g. to add
+// biases and activate. The block is rows x cols elements starting at column col of c, with
+// consecutive rows ldc elements apart.
+template <typename T>
+struct GemmEpilogue {
+  void (*fn)(const void* context, T* c, int32_t rows, int32_t cols, int64_t ldc, int32_t col);
+  const void* context;
+};
+
+// Scalars of one optimizer step, shared by every weight of a layer, see the update kernels.
+// Each kernel only reads the ones its update rule uses.
+template <typename T>
+struct UpdateStep {
+  T learn_rate;
+  // NOTE: the momentum of SGD / Nesterov, the first moment decay of Adam.
+  T beta1;
+  // NOTE: the squared gradient decay of RMSProp / Adam.
+  T beta2;
+  T epsilon;
+  // NOTE: L2 regularization coupled with the gradients, 0 disabling it.
+  T l2;
+  // NOTE: decoupled weight decay, 1 disabling it.
+  T decay;
+};
+
+// Raw, row-major kernels behind Matrix<T>, for T = float or double. Each instruction set
+// provides its own tables, and the best one supported by the host CPU is selected once at
+// startup. Float kernels process twice the elements per instruction.
+// NOTE: outputs may alias inputs for the element-wise kernels.
+template <typename T>
+struct MatrixKernels {
+  SimdIsa isa;
+  // c (m x n) = op(a) (m x k) * op(b) (k x n), or c += op(a) * op(b) if accumulate is set.
+  // op(x) is x^T when the matching trans flag is set, read directly from its stored
+  // layout, so a is stored as k x m and / or b as n x k.
+  void (*gemm)(
+      bool trans_a, bool trans_b, int32_t m, int32_t n, int32_t k,
+      const T* a, const T* b, T* c, bool accumulate);
+  // c (m x n) = a (m x k) * b (k x n), calling epilogue on every block of c once it's final.
+  void (*gemm_epilogue)(
+      int32_t m, int32_t n, int32_t k, const T* a, const T* b, T* c,
+      const GemmEpilogue<T>& epilogue);
+  void (*add)(const T* a, const T* b, T* out, int64_t count);
+  void (*sub)(const T* a, const T* b, T* out, int64_t count);
+  void (*mul)(const T* a, const T* b, T* out, int64_t count);
+  void (*scale)(const T* a, T scalar, T* out, int64_t count);
+  // y += alpha * x
+  void (*axpy)(const T* x, T alpha, T* y, int64_t count);
+  // Fused optimizer steps, each a single pass over the gradients g, the optimizer's moments
+  // and the weights w. Gradients are taken as g + step.l2 * w, and w is scaled by step.decay
+  // before it's stepped, see UpdateStep.
+  // v = beta1 * v - learn_rate * g, w += v: SGD with momentum.
+  void (*momentum_update)(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count);
+  // v = beta1 * v - learn_rate * g, w += beta1 * v - learn_rate * g: Nesterov momentum, with
+  // the gradient at the look-ahead weights folded into the step, see:
+  // https://proceedings.mlr.press/v28/sutskever13.pdf
+  void (*nesterov_update)(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count);
+  // s = beta2 * s + (1 - beta2) * g^2, w -= learn_rate * g / (sqrt(s) + epsilon): RMSProp.
+  void (*rmsprop_update)(const UpdateStep<T>& step, const T* g, T* s, T* w, int64_t count);
+  // m = beta1 * m + (1 - beta1) * g, v = beta2 * v + (1 - beta2) * g^2,
+  // w -= learn_rate * m / (sqrt(v) + epsilon): Adam, bias correction being left to the
+  // caller's learn_rate and epsilon.
+  void (*adam_update)(const UpdateStep<T>& step, const T* g, T* m, T* v, T* w, int64_t count);
+  // out = e^a
+  void (*exp)(const T* a, T* out, int64_t count);
+  // out = 1 / (1 + e^-a)
+  void (*sigmoid)(const T* a, T* out, int64_t count);
+  // out = tanh(a)
+  void (*tanh)(const T* a, T* out, int64_t count);
+  // out *= a * (1 - a), the sigmoid derivative given its activated output a.
+  void (*sigmoid_deriv_mul)(const T* a, T* out, int64_t count);
+  // out *= 1 - a^2, the tanh derivative given its activated output a.
+  void (*tanh_deriv_mul)(const T* a, T* out, int64_t count);
+};
+
+// Int8 kernels behind quantized inference, selected the same way as MatrixKernels.
+// NOTE: int8 values are in [-127, 127], -128 is never produced or accepted.
+struct Int8Kernels {
+  SimdIsa isa;
+  // c (m x n) = a (m x k) * b (k x n), exactly, in int32. a is row-major with rows lda
+  // bytes apart, lda being at least k rounded up to a multiple of 4 (the padding's values
+  // don't matter). b is packed by PackInt8Weights.
+  void (*gemm)(
+      int32_t m, int32_t n, int32_t k, const int8_t* a, int64_t lda,
+      const int8_t* b_packed, int32_t* c);
+};
+
+// NOTE: defined for T = float and double.
+template <typename T>
+const MatrixKernels<T>& GetMatrixKernels();
+// NOTE: returns nullptr if the instruction set is not supported by the host CPU, or has no
+// float / double kernels of its own (AVX512_VNNI).
+template <typename T>
+const MatrixKernels<T>* GetMatrixKernelsForIsa(SimdIsa isa);
+const Int8Kernels& GetInt8Kernels();
+// NOTE: returns nullptr if the instruction set is not supported by the host CPU.
+const Int8Kernels* GetInt8KernelsForIsa(SimdIsa isa);
+
+// Packs a row-major k x n int8 matrix into b_packed, of Int8PackedWeightsSize(k, n) bytes,
+// the layout Int8Kernels::gemm streams its right hand side from. Done once per model.
+int64_t Int8PackedWeightsSize(int32_t k, int32_t n);
+void PackInt8Weights(int32_t k, int32_t n, const int8_t* b, int8_t* b_packed);
+absl::string_view SimdIsaToString(SimdIsa isa);
+
+#endif
@@ -0,0 +1,213 @@
+// AVX2 + FMA kernels, compiled with -mavx2 -mfma (/arch:AVX2), only ever called once
+// the host CPU has been checked for support.
+
+#include <cstdint>
+
+#include "src/common/kernels.h"
+#include "src/common/kernels_internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Double {
+  using Scalar = double;
+  using Vec = __m256d;
+  static constexpr int32_t kLanes = 4;
+
+  static Vec Zero() { return _mm256_setzero_pd(); }
+  static Vec Set1(double x) { return _mm256_set1_pd(x); }
+  static Vec Load(const double* x) { return _mm256_loadu_pd(x); }
+  static void Store(double* x, Vec v) { _mm256_storeu_pd(x, v); }
+  static __m256i PartialMask(int64_t count) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), _mm256_setr_epi64x(0, 1, 2, 3));
+  }
+  static Vec LoadPartial(const double* x, int64_t count) {
+    return _mm256_maskload_pd(x, PartialMask(count));
+  }
+  static void StorePartial(double* x, int64_t count, Vec v) {
+    _mm256_maskstore_pd(x, PartialMask(count), v);
+  }
+  static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+  static Vec Sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+  static Vec Min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+  static Vec FMAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+  static Vec FNMAdd(Vec a, Vec b, Vec c) { return _mm256_fnmadd_pd(a, b, c); }
+  static Vec Round(Vec x) { return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  // NOTE: 2^n, built directly from the exponent bits.
+  static Vec Pow2(Vec n) {
+    const __m256i n_i64 = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    return _mm256_castsi256_pd(
+        _mm256_slli_epi64(_mm256_add_epi64(n_i64, _mm256_set1_epi64x(1023)), 52));
+  }
+  static double ReduceAdd(Vec v) {
+    const __m128d sum_2 = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum_2, _mm_unpackhi_pd(sum_2, sum_2)));
+  }
+};
+
+struct Avx2Float {
+  using Scalar = float;
+  using Vec = __m256;
+  static constexpr int32_t kLanes = 8;
+
+  static Vec Zero() { return _mm256_setzero_ps(); }
+  static Vec Set1(float x) { return _mm256_set1_ps(x); }
+  static Vec Load(const float* x) { return _mm256_loadu_ps(x); }
+  static void Store(float* x, Vec v) { _mm256_storeu_ps(x, v); }
+  static __m256i PartialMask(int64_t count) {
+    return _mm256_cmpgt_epi32(
+        _mm256_set1_epi32((int32_t) count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  }
+  static Vec LoadPartial(const float* x, int64_t count) {
+    return _mm256_maskload_ps(x, PartialMask(count));
+  }
+  static void StorePartial(float* x, int64_t count, Vec v) {
+    _mm256_maskstore_ps(x, PartialMask(count), v);
+  }
+  static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+  static Vec Sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+  static Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+  static Vec FMAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+  static Vec FNMAdd(Vec a, Vec b, Vec c) { return _mm256_fnmadd_ps(a, b, c); }
+  static Vec Round(Vec x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  // NOTE: 2^n, built directly from the exponent bits.
+  static Vec Pow2(Vec n) {
+    return _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+  }
+  static float ReduceAdd(Vec v) {
+    __m128 sum_4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum_4 = _mm_add_ps(sum_4, _mm_movehl_ps(sum_4, sum_4));
+    return _mm_cvtss_f32(_mm_add_ss(sum_4, _mm_movehdup_ps(sum_4)));
+  }
+};
+
+// NOTE: a 4 x 2-vector register tile, 4x8 for double and 4x16 for float.
+template <typename V>
+struct Avx2Kernel : VecKernels<V> {
+  using Scalar = typename V::Scalar;
+  using Vec = typename V::Vec;
+  static constexpr int32_t kMr = 4;
+  static constexpr int32_t kNr = 2 * V::kLanes;
+
+  static void MicroKernel(
+      int32_t kc, const Scalar* a, const Scalar* b, Scalar* c, int32_t ldc) {
+    Vec c00 = V::Zero(), c01 = V::Zero();
+    Vec c10 = V::Zero(), c11 = V::Zero();
+    Vec c20 = V::Zero(), c21 = V::Zero();
+    Vec c30 = V::Zero(), c31 = V::Zero();
+    for (int32_t p = 0; p < kc; p++) {
+      const Vec b0 = V::Load(b);
+      const Vec b1 = V::Load(b + V::kLanes);
+      Vec a_i = V::Set1(a[0]);
+      c00 = V::FMAdd(a_i, b0, c00);
+      c01 = V::FMAdd(a_i, b1, c01);
+      a_i = V::Set1(a[1]);
+      c10 = V::FMAdd(a_i, b0, c10);
+      c11 = V::FMAdd(a_i, b1, c11);
+      a_i = V::Set1(a[2]);
+      c20 = V::FMAdd(a_i, b0, c20);
+      c21 = V::FMAdd(a_i, b1, c21);
+      a_i = V::Set1(a[3]);
+      c30 = V::FMAdd(a_i, b0, c30);
+      c31 = V::FMAdd(a_i, b1, c31);
+      a += kMr;
+      b += kNr;
+    }
+    StoreRow(c + 0 * ldc, c00, c01);
+    StoreRow(c + 1 * ldc, c10, c11);
+    StoreRow(c + 2 * ldc, c20, c21);
+    StoreRow(c + 3 * ldc, c30, c31);
+  }
+
+  static void StoreRow(Scalar* c, Vec lo, Vec hi) {
+    V::Store(c, V::Add(V::Load(c), lo));
+    V::Store(c + V::kLanes, V::Add(V::Load(c + V::kLanes), hi));
+  }
+};
+
+// NOTE: maddubs multiplies unsigned by signed bytes into saturating int16 pairs, which
+// (255 * 127) * 2 would overflow. Instead |a| is multiplied by b with a's sign, both at
+// most 127 in magnitude, so pairs stay within 2 * 127^2 and the result is exact. A 4 x
+// 2-vector register tile, 4 rows x 16 columns.
+struct Avx2Int8Kernel {
+  static constexpr int32_t kMr = 4;
+
+  template <int32_t kRows>
+  static void MicroKernel(
+      int32_t groups, const int8_t* a, int64_t lda, const int8_t* b_panel,
+      const int32_t* column_sums, int32_t* c, int64_t ldc, int32_t nr) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc_lo[kRows];
+    __m256i acc_hi[kRows];
+    for (int32_t i = 0; i < kRows; i++) {
+      acc_lo[i] = _mm256_setzero_si256();
+      acc_hi[i] = _mm256_setzero_si256();
+    }
+    for (int32_t g = 0; g < groups; g++) {
+      const __m256i b_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_panel));
+      const __m256i b_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_panel + 32));
+      for (int32_t i = 0; i < kRows; i++) {
+        const __m256i a_i = _mm256_set1_epi32(LoadInt8Group(a + i * lda + g * 4));
+        const __m256i a_abs = _mm256_abs_epi8(a_i);
+        acc_lo[i] = _mm256_add_epi32(acc_lo[i], _mm256_madd_epi16(
+              _mm256_maddubs_epi16(a_abs, _mm256_sign_epi8(b_lo, a_i)), ones));
+        acc_hi[i] = _mm256_add_epi32(acc_hi[i], _mm256_madd_epi16(
+              _mm256_maddubs_epi16(a_abs, _mm256_sign_epi8(b_hi, a_i)), ones));
+      }
+      b_panel += kInt8Nr * 4;
+    }
+    for (int32_t i = 0; i < kRows; i++) {
+      int32_t* c_row = c + i * ldc;
+      if (nr == kInt8Nr) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c_row), acc_lo[i]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c_row + 8), acc_hi[i]);
+      } else {
+        // NOTE: edge panel, only keep the columns that fit.
+        int32_t tile[kInt8Nr];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(tile), acc_lo[i]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(tile + 8), acc_hi[i]);
+        for (int32_t j = 0; j < nr; j++) { c_row[j] = tile[j]; }
+      }
+    }
+  }
+};
+
+constexpr Int8Kernels kAvx2Int8Kernels = {
+  .isa = SimdIsa::AVX2,
+  .gemm = Int8Gemm<Avx2Int8Kernel>,
+};
+
+constexpr MatrixKernels<float> kAvx2FloatKernels =
+  MakeMatrixKernels<Avx2Kernel<Avx2Float>>(SimdIsa::AVX2);
+constexpr MatrixKernels<double> kAvx2DoubleKernels =
+  MakeMatrixKernels<Avx2Kernel<Avx2Double>>(SimdIsa::AVX2);
+
+}  // namespace
+
+template <>
+const MatrixKernels<float>* Avx2MatrixKernels<float>() { return &kAvx2FloatKernels; }
+template <>
+const MatrixKernels<double>* Avx2MatrixKernels<double>() { return &kAvx2DoubleKernels; }
+const Int8Kernels* Avx2Int8Kernels() { return &kAvx2Int8Kernels; }
+
+#else
+
+template <>
+const MatrixKernels<float>* Avx2MatrixKernels<float>() { return nullptr; }
+template <>
+const MatrixKernels<double>* Avx2MatrixKernels<double>() { return nullptr; }
+const Int8Kernels* Avx2Int8Kernels() { return nullptr; }
+
+#endif
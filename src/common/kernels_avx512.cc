@@ -0,0 +1,165 @@
+// AVX-512F kernels, compiled with -mavx512f (/arch:AVX512), only ever called once the
+// host CPU has been checked for support.
+
+#include <cstdint>
+
+#include "src/common/kernels.h"
+#include "src/common/kernels_internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+// NOTE: partial loads / stores are masked, so tails never touch memory past the end.
+struct Avx512Double {
+  using Scalar = double;
+  using Vec = __m512d;
+  static constexpr int32_t kLanes = 8;
+
+  static Vec Zero() { return _mm512_setzero_pd(); }
+  static Vec Set1(double x) { return _mm512_set1_pd(x); }
+  static Vec Load(const double* x) { return _mm512_loadu_pd(x); }
+  static void Store(double* x, Vec v) { _mm512_storeu_pd(x, v); }
+  static __mmask8 TailMask(int64_t count) { return (__mmask8) ((1u << count) - 1); }
+  static Vec LoadPartial(const double* x, int64_t count) {
+    return _mm512_maskz_loadu_pd(TailMask(count), x);
+  }
+  static void StorePartial(double* x, int64_t count, Vec v) {
+    _mm512_mask_storeu_pd(x, TailMask(count), v);
+  }
+  static Vec Add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+  static Vec Sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+  static Vec Min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+  static Vec FMAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+  static Vec FNMAdd(Vec a, Vec b, Vec c) { return _mm512_fnmadd_pd(a, b, c); }
+  static Vec Round(Vec x) {
+    return _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static Vec Pow2(Vec n) { return _mm512_scalef_pd(Set1(1.0), n); }
+  static double ReduceAdd(Vec v) { return _mm512_reduce_add_pd(v); }
+};
+
+struct Avx512Float {
+  using Scalar = float;
+  using Vec = __m512;
+  static constexpr int32_t kLanes = 16;
+
+  static Vec Zero() { return _mm512_setzero_ps(); }
+  static Vec Set1(float x) { return _mm512_set1_ps(x); }
+  static Vec Load(const float* x) { return _mm512_loadu_ps(x); }
+  static void Store(float* x, Vec v) { _mm512_storeu_ps(x, v); }
+  static __mmask16 TailMask(int64_t count) { return (__mmask16) ((1u << count) - 1); }
+  static Vec LoadPartial(const float* x, int64_t count) {
+    return _mm512_maskz_loadu_ps(TailMask(count), x);
+  }
+  static void StorePartial(float* x, int64_t count, Vec v) {
+    _mm512_mask_storeu_ps(x, TailMask(count), v);
+  }
+  static Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+  static Vec Sqrt(Vec a) { return _mm512_sqrt_ps(a); }
+  static Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+  static Vec FMAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+  static Vec FNMAdd(Vec a, Vec b, Vec c) { return _mm512_fnmadd_ps(a, b, c); }
+  static Vec Round(Vec x) {
+    return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  static Vec Pow2(Vec n) { return _mm512_scalef_ps(Set1(1.0f), n); }
+  static float ReduceAdd(Vec v) { return _mm512_reduce_add_ps(v); }
+};
+
+// NOTE: an 8 x 2-vector register tile, 8x16 for double and 8x32 for float.
+template <typename V>
+struct Avx512Kernel : VecKernels<V> {
+  using Scalar = typename V::Scalar;
+  using Vec = typename V::Vec;
+  static constexpr int32_t kMr = 8;
+  static constexpr int32_t kNr = 2 * V::kLanes;
+
+  static void MicroKernel(
+      int32_t kc, const Scalar* a, const Scalar* b, Scalar* c, int32_t ldc) {
+    // NOTE: accumulators are spelled out so that they are kept in registers.
+    Vec c00 = V::Zero(), c01 = V::Zero();
+    Vec c10 = V::Zero(), c11 = V::Zero();
+    Vec c20 = V::Zero(), c21 = V::Zero();
+    Vec c30 = V::Zero(), c31 = V::Zero();
+    Vec c40 = V::Zero(), c41 = V::Zero();
+    Vec c50 = V::Zero(), c51 = V::Zero();
+    Vec c60 = V::Zero(), c61 = V::Zero();
+    Vec c70 = V::Zero(), c71 = V::Zero();
+    for (int32_t p = 0; p < kc; p++) {
+      const Vec b0 = V::Load(b);
+      const Vec b1 = V::Load(b + V::kLanes);
+      Vec a_i;
+      a_i = V::Set1(a[0]);
+      c00 = V::FMAdd(a_i, b0, c00);
+      c01 = V::FMAdd(a_i, b1, c01);
+      a_i = V::Set1(a[1]);
+      c10 = V::FMAdd(a_i, b0, c10);
+      c11 = V::FMAdd(a_i, b1, c11);
+      a_i = V::Set1(a[2]);
+      c20 = V::FMAdd(a_i, b0, c20);
+      c21 = V::FMAdd(a_i, b1, c21);
+      a_i = V::Set1(a[3]);
+      c30 = V::FMAdd(a_i, b0, c30);
+      c31 = V::FMAdd(a_i, b1, c31);
+      a_i = V::Set1(a[4]);
+      c40 = V::FMAdd(a_i, b0, c40);
+      c41 = V::FMAdd(a_i, b1, c41);
+      a_i = V::Set1(a[5]);
+      c50 = V::FMAdd(a_i, b0, c50);
+      c51 = V::FMAdd(a_i, b1, c51);
+      a_i = V::Set1(a[6]);
+      c60 = V::FMAdd(a_i, b0, c60);
+      c61 = V::FMAdd(a_i, b1, c61);
+      a_i = V::Set1(a[7]);
+      c70 = V::FMAdd(a_i, b0, c70);
+      c71 = V::FMAdd(a_i, b1, c71);
+      a += kMr;
+      b += kNr;
+    }
+    StoreRow(c + 0 * ldc, c00, c01);
+    StoreRow(c + 1 * ldc, c10, c11);
+    StoreRow(c + 2 * ldc, c20, c21);
+    StoreRow(c + 3 * ldc, c30, c31);
+    StoreRow(c + 4 * ldc, c40, c41);
+    StoreRow(c + 5 * ldc, c50, c51);
+    StoreRow(c + 6 * ldc, c60, c61);
+    StoreRow(c + 7 * ldc, c70, c71);
+  }
+
+  static void StoreRow(Scalar* c, Vec lo, Vec hi) {
+    V::Store(c, V::Add(V::Load(c), lo));
+    V::Store(c + V::kLanes, V::Add(V::Load(c + V::kLanes), hi));
+  }
+};
+
+constexpr MatrixKernels<float> kAvx512FloatKernels =
+  MakeMatrixKernels<Avx512Kernel<Avx512Float>>(SimdIsa::AVX512);
+constexpr MatrixKernels<double> kAvx512DoubleKernels =
+  MakeMatrixKernels<Avx512Kernel<Avx512Double>>(SimdIsa::AVX512);
+
+}  // namespace
+
+template <>
+const MatrixKernels<float>* Avx512MatrixKernels<float>() { return &kAvx512FloatKernels; }
+template <>
+const MatrixKernels<double>* Avx512MatrixKernels<double>() { return &kAvx512DoubleKernels; }
+
+#else
+
+template <>
+const MatrixKernels<float>* Avx512MatrixKernels<float>() { return nullptr; }
+template <>
+const MatrixKernels<double>* Avx512MatrixKernels<double>() { return nullptr; }
+
+#endif
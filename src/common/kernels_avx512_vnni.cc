@@ -0,0 +1,58 @@
+// AVX-512 VNNI int8 kernels, compiled with -mavx512f -mavx512vnni (/arch:AVX512), only
+// ever called once the host CPU has been checked for support.
+
+#include <cstdint>
+
+#include "src/common/kernels.h"
+#include "src/common/kernels_internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+// NOTE: vpdpbusd multiplies unsigned by signed bytes, summing each 4 products straight into
+// int32 lanes without saturating. a is made unsigned by adding 128 (flipping its sign bit),
+// which adds 128 * the column sum of b to every output, subtracted once at the end. An
+// 8 x 1-vector register tile, 8 rows x 16 columns.
+struct Avx512VnniInt8Kernel {
+  static constexpr int32_t kMr = 8;
+
+  template <int32_t kRows>
+  static void MicroKernel(
+      int32_t groups, const int8_t* a, int64_t lda, const int8_t* b_panel,
+      const int32_t* column_sums, int32_t* c, int64_t ldc, int32_t nr) {
+    __m512i acc[kRows];
+    for (int32_t i = 0; i < kRows; i++) { acc[i] = _mm512_setzero_si512(); }
+    for (int32_t g = 0; g < groups; g++) {
+      const __m512i b = _mm512_loadu_si512(b_panel);
+      for (int32_t i = 0; i < kRows; i++) {
+        const __m512i a_i =
+          _mm512_set1_epi32(LoadInt8Group(a + i * lda + g * 4) ^ (int32_t) 0x80808080);
+        acc[i] = _mm512_dpbusd_epi32(acc[i], a_i, b);
+      }
+      b_panel += kInt8Nr * 4;
+    }
+    const __m512i offset = _mm512_slli_epi32(_mm512_loadu_si512(column_sums), 7);
+    const __mmask16 mask = (__mmask16) ((1u << nr) - 1);
+    for (int32_t i = 0; i < kRows; i++) {
+      _mm512_mask_storeu_epi32(c + i * ldc, mask, _mm512_sub_epi32(acc[i], offset));
+    }
+  }
+};
+
+constexpr Int8Kernels kAvx512VnniInt8Kernels = {
+  .isa = SimdIsa::AVX512_VNNI,
+  .gemm = Int8Gemm<Avx512VnniInt8Kernel>,
+};
+
+}  // namespace
+
+const Int8Kernels* Avx512VnniInt8Kernels() { return &kAvx512VnniInt8Kernels; }
+
+#else
+
+const Int8Kernels* Avx512VnniInt8Kernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,152 @@
+// Portable kernels, always available. On x86-64 the compiler auto-vectorizes these to
+// the SSE2 baseline.
+
+#include <cmath>
+#include <cstdint>
+
+#include "src/common/kernels.h"
+#include "src/common/kernels_internal.h"
+
+namespace {
+
+template <typename T>
+struct GenericKernel {
+  using Scalar = T;
+  static constexpr int32_t kMr = 4;
+  static constexpr int32_t kNr = 4;
+
+  static void MicroKernel(int32_t kc, const T* a, const T* b, T* c, int32_t ldc) {
+    T acc[kMr][kNr] = {};
+    for (int32_t p = 0; p < kc; p++) {
+      for (int32_t i = 0; i < kMr; i++) {
+        for (int32_t j = 0; j < kNr; j++) { acc[i][j] += a[i] * b[j]; }
+      }
+      a += kMr;
+      b += kNr;
+    }
+    for (int32_t i = 0; i < kMr; i++) {
+      for (int32_t j = 0; j < kNr; j++) { c[i * ldc + j] += acc[i][j]; }
+    }
+  }
+
+  static void Axpy(const T* x, T alpha, T* y, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { y[i] += alpha * x[i]; }
+  }
+
+  static T Dot(const T* x, const T* y, int64_t count) {
+    T sum = 0;
+    for (int64_t i = 0; i < count; i++) { sum += x[i] * y[i]; }
+    return sum;
+  }
+
+  static void Add(const T* a, const T* b, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = a[i] + b[i]; }
+  }
+
+  static void Sub(const T* a, const T* b, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = a[i] - b[i]; }
+  }
+
+  static void Mul(const T* a, const T* b, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = a[i] * b[i]; }
+  }
+
+  static void Scale(const T* a, T scalar, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = a[i] * scalar; }
+  }
+
+  static void MomentumUpdate(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+      v[i] = step.beta1 * v[i] - step.learn_rate * (g[i] + step.l2 * w[i]);
+      w[i] = step.decay * w[i] + v[i];
+    }
+  }
+
+  static void NesterovUpdate(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+      const T gradient_step = -step.learn_rate * (g[i] + step.l2 * w[i]);
+      v[i] = step.beta1 * v[i] + gradient_step;
+      w[i] = step.decay * w[i] + step.beta1 * v[i] + gradient_step;
+    }
+  }
+
+  static void RmsPropUpdate(const UpdateStep<T>& step, const T* g, T* s, T* w, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+      const T gradient = g[i] + step.l2 * w[i];
+      s[i] = step.beta2 * s[i] + (1 - step.beta2) * gradient * gradient;
+      w[i] = step.decay * w[i] - step.learn_rate * gradient / (std::sqrt(s[i]) + step.epsilon);
+    }
+  }
+
+  static void AdamUpdate(
+      const UpdateStep<T>& step, const T* g, T* m, T* v, T* w, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+      const T gradient = g[i] + step.l2 * w[i];
+      m[i] = step.beta1 * m[i] + (1 - step.beta1) * gradient;
+      v[i] = step.beta2 * v[i] + (1 - step.beta2) * gradient * gradient;
+      w[i] = step.decay * w[i] - step.learn_rate * m[i] / (std::sqrt(v[i]) + step.epsilon);
+    }
+  }
+
+  static void Exp(const T* a, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = std::exp(a[i]); }
+  }
+
+  static void Sigmoid(const T* a, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = 1 / (1 + std::exp(-a[i])); }
+  }
+
+  static void TanH(const T* a, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] = std::tanh(a[i]); }
+  }
+
+  static void SigmoidDerivMul(const T* a, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] *= a[i] * (1 - a[i]); }
+  }
+
+  static void TanHDerivMul(const T* a, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { out[i] *= 1 - a[i] * a[i]; }
+  }
+};
+
+struct GenericInt8Kernel {
+  static constexpr int32_t kMr = 4;
+
+  template <int32_t kRows>
+  static void MicroKernel(
+      int32_t groups, const int8_t* a, int64_t lda, const int8_t* b_panel,
+      const int32_t* column_sums, int32_t* c, int64_t ldc, int32_t nr) {
+    int32_t acc[kRows][kInt8Nr] = {};
+    for (int32_t g = 0; g < groups; g++) {
+      for (int32_t i = 0; i < kRows; i++) {
+        const int8_t* a_group = a + i * lda + g * 4;
+        for (int32_t j = 0; j < kInt8Nr; j++) {
+          for (int32_t t = 0; t < 4; t++) { acc[i][j] += a_group[t] * b_panel[j * 4 + t]; }
+        }
+      }
+      b_panel += kInt8Nr * 4;
+    }
+    for (int32_t i = 0; i < kRows; i++) {
+      for (int32_t j = 0; j < nr; j++) { c[i * ldc + j] = acc[i][j]; }
+    }
+  }
+};
+
+constexpr Int8Kernels kGenericInt8Kernels = {
+  .isa = SimdIsa::GENERIC,
+  .gemm = Int8Gemm<GenericInt8Kernel>,
+};
+
+constexpr MatrixKernels<float> kGenericFloatKernels =
+  MakeMatrixKernels<GenericKernel<float>>(SimdIsa::GENERIC);
+constexpr MatrixKernels<double> kGenericDoubleKernels =
+  MakeMatrixKernels<GenericKernel<double>>(SimdIsa::GENERIC);
+
+}  // namespace
+
+template <>
+const MatrixKernels<float>* GenericMatrixKernels<float>() { return &kGenericFloatKernels; }
+template <>
+const MatrixKernels<double>* GenericMatrixKernels<double>() { return &kGenericDoubleKernels; }
+
+const Int8Kernels* GenericInt8Kernels() { return &kGenericInt8Kernels; }
@@ -0,0 +1,530 @@
+#ifndef SRC_COMMON_KERNELS_INTERNAL_H_
+#define SRC_COMMON_KERNELS_INTERNAL_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "src/common/kernels.h"
+
+// NOTE: this header is shared by the per-ISA kernel translation units, which are compiled
+// with different target flags. Everything here must have internal linkage (static, or
+// templates instantiated with a TU-local kernel type) so the linker can never hand an
+// AVX-512 copy of a helper to a caller running on a baseline CPU. For the same reason the
+// ISA translation units avoid std templates entirely.
+
+// NOTE: specialized for float and double by each ISA translation unit.
+template <typename T> const MatrixKernels<T>* GenericMatrixKernels();
+template <typename T> const MatrixKernels<T>* Avx2MatrixKernels();
+template <typename T> const MatrixKernels<T>* Avx512MatrixKernels();
+template <> const MatrixKernels<float>* GenericMatrixKernels<float>();
+template <> const MatrixKernels<double>* GenericMatrixKernels<double>();
+template <> const MatrixKernels<float>* Avx2MatrixKernels<float>();
+template <> const MatrixKernels<double>* Avx2MatrixKernels<double>();
+template <> const MatrixKernels<float>* Avx512MatrixKernels<float>();
+template <> const MatrixKernels<double>* Avx512MatrixKernels<double>();
+const Int8Kernels* GenericInt8Kernels();
+const Int8Kernels* Avx2Int8Kernels();
+const Int8Kernels* Avx512VnniInt8Kernels();
+
+// Thread local, 64 byte aligned scratch space for packed GEMM panels, valid until the
+// next call on the same thread. Defined in kernels.cc.
+void* GemmWorkspaceBytes(int64_t size);
+
+template <typename T>
+static T* GemmWorkspace(int64_t count) {
+  return static_cast<T*>(GemmWorkspaceBytes(count * sizeof(T)));
+}
+
+// Cache blocking, see: https://www.cs.utexas.edu/~flame/pubs/GotoTOMS_revision.pdf
+// kc x nr panels of B stay in L1, mc x kc blocks of A in L2, kc x nc blocks of B in L3.
+constexpr int32_t kGemmKc = 256;
+constexpr int32_t kGemmMc = 96;
+constexpr int32_t kGemmNc = 2048;
+
+static inline int32_t KernelMin(int32_t a, int32_t b) { return a < b ? a : b; }
+
+// e^x is computed as 2^n * e^r, with n = round(x / ln(2)) and |r| <= ln(2) / 2, where e^r
+// is a Taylor polynomial, to within an ulp or so. ln(2) is split in two so that
+// r = x - n * ln(2) stays exact, see Cephes exp.
+template <typename T> struct ExpConstants;
+
+template <>
+struct ExpConstants<double> {
+  static constexpr double kMin = -708.0;
+  static constexpr double kMax = 709.0;
+  static constexpr double kLog2E = 1.4426950408889634;
+  static constexpr double kLn2Hi = 6.93145751953125e-1;
+  static constexpr double kLn2Lo = 1.42860682030941723212e-6;
+  static constexpr double kPoly[] = {
+    1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0,
+    1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0, 1.0, 1.0,
+  };
+};
+
+template <>
+struct ExpConstants<float> {
+  static constexpr float kMin = -87.0f;
+  static constexpr float kMax = 88.0f;
+  static constexpr float kLog2E = 1.44269504f;
+  static constexpr float kLn2Hi = 0.693359375f;
+  static constexpr float kLn2Lo = -2.12194440e-4f;
+  static constexpr float kPoly[] = {
+    1.0f / 5040.0f, 1.0f / 720.0f, 1.0f / 120.0f, 1.0f / 24.0f, 1.0f / 6.0f, 1.0f / 2.0f,
+    1.0f, 1.0f,
+  };
+};
+
+// Element-wise kernels shared by the SIMD translation units, written once against V, a
+// TU-local wrapper around one instruction set's vector type for float or double:
+//   Scalar, Vec, kLanes
+//   Zero(), Set1(x), Load(x), Store(x, v)
+//   LoadPartial(x, count), StorePartial(x, count, v): the first count < kLanes lanes only.
+//   Add, Sub, Mul, Div, Min, Max, FMAdd(a, b, c) = a * b + c, FNMAdd(a, b, c) = c - a * b
+//   Sqrt, Round(v): to the nearest integer, Pow2(n): 2^n for integral n, ReduceAdd(v)
+template <typename V>
+struct VecKernels {
+  using T = typename V::Scalar;
+  using Vec = typename V::Vec;
+
+  template <typename Op>
+  static inline void Map(const T* a, T* out, int64_t count, Op op) {
+    int64_t i = 0;
+    for (; i + V::kLanes <= count; i += V::kLanes) { V::Store(out + i, op(V::Load(a + i))); }
+    if (i < count) {
+      V::StorePartial(out + i, count - i, op(V::LoadPartial(a + i, count - i)));
+    }
+  }
+
+  template <typename Op>
+  static inline void Zip(const T* a, const T* b, T* out, int64_t count, Op op) {
+    int64_t i = 0;
+    for (; i + V::kLanes <= count; i += V::kLanes) {
+      V::Store(out + i, op(V::Load(a + i), V::Load(b + i)));
+    }
+    if (i < count) {
+      V::StorePartial(out + i, count - i, op(
+            V::LoadPartial(a + i, count - i), V::LoadPartial(b + i, count - i)));
+    }
+  }
+
+  static inline Vec ExpV(Vec x) {
+    using C = ExpConstants<T>;
+    x = V::Min(V::Max(x, V::Set1(C::kMin)), V::Set1(C::kMax));
+    const Vec n = V::Round(V::Mul(x, V::Set1(C::kLog2E)));
+    Vec r = V::FNMAdd(n, V::Set1(C::kLn2Hi), x);
+    r = V::FNMAdd(n, V::Set1(C::kLn2Lo), r);
+    Vec poly = V::Set1(C::kPoly[0]);
+    for (int32_t i = 1; i < sizeof(C::kPoly) / sizeof(C::kPoly[0]); i++) {
+      poly = V::FMAdd(poly, r, V::Set1(C::kPoly[i]));
+    }
+    return V::Mul(poly, V::Pow2(n));
+  }
+
+  static inline Vec SigmoidV(Vec x) {
+    const Vec one = V::Set1(1);
+    return V::Div(one, V::Add(one, ExpV(V::Sub(V::Zero(), x))));
+  }
+
+  static void Add(const T* a, const T* b, T* out, int64_t count) {
+    Zip(a, b, out, count, [](Vec a, Vec b) { return V::Add(a, b); });
+  }
+
+  static void Sub(const T* a, const T* b, T* out, int64_t count) {
+    Zip(a, b, out, count, [](Vec a, Vec b) { return V::Sub(a, b); });
+  }
+
+  static void Mul(const T* a, const T* b, T* out, int64_t count) {
+    Zip(a, b, out, count, [](Vec a, Vec b) { return V::Mul(a, b); });
+  }
+
+  static void Scale(const T* a, T scalar, T* out, int64_t count) {
+    const Vec scalar_v = V::Set1(scalar);
+    Map(a, out, count, [scalar_v](Vec a) { return V::Mul(a, scalar_v); });
+  }
+
+  static void Axpy(const T* x, T alpha, T* y, int64_t count) {
+    const Vec alpha_v = V::Set1(alpha);
+    Zip(x, y, y, count, [alpha_v](Vec x, Vec y) { return V::FMAdd(alpha_v, x, y); });
+  }
+
+  // NOTE: op(g, &m, &w) steps one vector of weights w and their moments m in place.
+  template <typename Op>
+  static inline void StepMap(const T* g, T* m, T* w, int64_t count, Op op) {
+    int64_t i = 0;
+    for (; i + V::kLanes <= count; i += V::kLanes) {
+      Vec m_i = V::Load(m + i);
+      Vec w_i = V::Load(w + i);
+      op(V::Load(g + i), &m_i, &w_i);
+      V::Store(m + i, m_i);
+      V::Store(w + i, w_i);
+    }
+    if (i < count) {
+      const int64_t rest = count - i;
+      Vec m_i = V::LoadPartial(m + i, rest);
+      Vec w_i = V::LoadPartial(w + i, rest);
+      op(V::LoadPartial(g + i, rest), &m_i, &w_i);
+      V::StorePartial(m + i, rest, m_i);
+      V::StorePartial(w + i, rest, w_i);
+    }
+  }
+
+  // NOTE: op(g, &m, &v, &w) steps one vector of weights w and their moments m, v in place.
+  template <typename Op>
+  static inline void StepZip(const T* g, T* m, T* v, T* w, int64_t count, Op op) {
+    int64_t i = 0;
+    for (; i + V::kLanes <= count; i += V::kLanes) {
+      Vec m_i = V::Load(m + i);
+      Vec v_i = V::Load(v + i);
+      Vec w_i = V::Load(w + i);
+      op(V::Load(g + i), &m_i, &v_i, &w_i);
+      V::Store(m + i, m_i);
+      V::Store(v + i, v_i);
+      V::Store(w + i, w_i);
+    }
+    if (i < count) {
+      const int64_t rest = count - i;
+      Vec m_i = V::LoadPartial(m + i, rest);
+      Vec v_i = V::LoadPartial(v + i, rest);
+      Vec w_i = V::LoadPartial(w + i, rest);
+      op(V::LoadPartial(g + i, rest), &m_i, &v_i, &w_i);
+      V::StorePartial(m + i, rest, m_i);
+      V::StorePartial(v + i, rest, v_i);
+      V::StorePartial(w + i, rest, w_i);
+    }
+  }
+
+  static void MomentumUpdate(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count) {
+    const Vec beta1 = V::Set1(step.beta1);
+    const Vec neg_learn_rate = V::Set1(-step.learn_rate);
+    const Vec l2 = V::Set1(step.l2);
+    const Vec decay = V::Set1(step.decay);
+    StepMap(g, v, w, count, [=](Vec g, Vec* v, Vec* w) {
+      g = V::FMAdd(l2, *w, g);
+      *v = V::FMAdd(neg_learn_rate, g, V::Mul(beta1, *v));
+      *w = V::FMAdd(decay, *w, *v);
+    });
+  }
+
+  static void NesterovUpdate(const UpdateStep<T>& step, const T* g, T* v, T* w, int64_t count) {
+    const Vec beta1 = V::Set1(step.beta1);
+    const Vec neg_learn_rate = V::Set1(-step.learn_rate);
+    const Vec l2 = V::Set1(step.l2);
+    const Vec decay = V::Set1(step.decay);
+    StepMap(g, v, w, count, [=](Vec g, Vec* v, Vec* w) {
+      g = V::FMAdd(l2, *w, g);
+      const Vec gradient_step = V::Mul(neg_learn_rate, g);
+      *v = V::FMAdd(beta1, *v, gradient_step);
+      *w = V::FMAdd(decay, *w, V::FMAdd(beta1, *v, gradient_step));
+    });
+  }
+
+  static void RmsPropUpdate(const UpdateStep<T>& step, const T* g, T* s, T* w, int64_t count) {
+    const Vec beta2 = V::Set1(step.beta2);
+    const Vec one_minus_beta2 = V::Set1(1 - step.beta2);
+    const Vec learn_rate = V::Set1(step.learn_rate);
+    const Vec epsilon = V::Set1(step.epsilon);
+    const Vec l2 = V::Set1(step.l2);
+    const Vec decay = V::Set1(step.decay);
+    StepMap(g, s, w, count, [=](Vec g, Vec* s, Vec* w) {
+      g = V::FMAdd(l2, *w, g);
+      *s = V::FMAdd(one_minus_beta2, V::Mul(g, g), V::Mul(beta2, *s));
+      *w = V::FNMAdd(learn_rate, V::Div(g, V::Add(V::Sqrt(*s), epsilon)), V::Mul(decay, *w));
+    });
+  }
+
+  static void AdamUpdate(
+      const UpdateStep<T>& step, const T* g, T* m, T* v, T* w, int64_t count) {
+    const Vec beta1 = V::Set1(step.beta1);
+    const Vec one_minus_beta1 = V::Set1(1 - step.beta1);
+    const Vec beta2 = V::Set1(step.beta2);
+    const Vec one_minus_beta2 = V::Set1(1 - step.beta2);
+    const Vec learn_rate = V::Set1(step.learn_rate);
+    const Vec epsilon = V::Set1(step.epsilon);
+    const Vec l2 = V::Set1(step.l2);
+    const Vec decay = V::Set1(step.decay);
+    StepZip(g, m, v, w, count, [=](Vec g, Vec* m, Vec* v, Vec* w) {
+      g = V::FMAdd(l2, *w, g);
+      *m = V::FMAdd(one_minus_beta1, g, V::Mul(beta1, *m));
+      *v = V::FMAdd(one_minus_beta2, V::Mul(g, g), V::Mul(beta2, *v));
+      *w = V::FNMAdd(learn_rate, V::Div(*m, V::Add(V::Sqrt(*v), epsilon)), V::Mul(decay, *w));
+    });
+  }
+
+  static T Dot(const T* x, const T* y, int64_t count) {
+    Vec sum0 = V::Zero();
+    Vec sum1 = V::Zero();
+    int64_t i = 0;
+    for (; i + 2 * V::kLanes <= count; i += 2 * V::kLanes) {
+      sum0 = V::FMAdd(V::Load(x + i), V::Load(y + i), sum0);
+      sum1 = V::FMAdd(V::Load(x + i + V::kLanes), V::Load(y + i + V::kLanes), sum1);
+    }
+    for (; i + V::kLanes <= count; i += V::kLanes) {
+      sum0 = V::FMAdd(V::Load(x + i), V::Load(y + i), sum0);
+    }
+    if (i < count) {
+      sum1 = V::FMAdd(V::LoadPartial(x + i, count - i), V::LoadPartial(y + i, count - i), sum1);
+    }
+    return V::ReduceAdd(V::Add(sum0, sum1));
+  }
+
+  static void Exp(const T* a, T* out, int64_t count) {
+    Map(a, out, count, [](Vec a) { return ExpV(a); });
+  }
+
+  static void Sigmoid(const T* a, T* out, int64_t count) {
+    Map(a, out, count, [](Vec a) { return SigmoidV(a); });
+  }
+
+  // NOTE: tanh(x) = 2 * sigmoid(2x) - 1
+  static void TanH(const T* a, T* out, int64_t count) {
+    Map(a, out, count, [](Vec a) {
+      const Vec two = V::Set1(2);
+      return V::Sub(V::Mul(two, SigmoidV(V::Mul(two, a))), V::Set1(1));
+    });
+  }
+
+  static void SigmoidDerivMul(const T* a, T* out, int64_t count) {
+    Zip(a, out, out, count, [](Vec a, Vec out) {
+      return V::Mul(out, V::Mul(a, V::Sub(V::Set1(1), a)));
+    });
+  }
+
+  static void TanHDerivMul(const T* a, T* out, int64_t count) {
+    Zip(a, out, out, count, [](Vec a, Vec out) {
+      return V::Mul(out, V::FNMAdd(a, a, V::Set1(1)));
+    });
+  }
+};
+
+// NOTE: packs an mc x kc block of op(A) into kMr row strips, each stored column by column
+// (kc x kMr), zero padding the last strip. op(A)(i, p) is a[i * row_stride + p * col_stride].
+template <int32_t kMr, typename T>
+static void PackA(
+    int32_t mc, int32_t kc, const T* a, int64_t row_stride, int64_t col_stride, T* a_pack) {
+  for (int32_t ir = 0; ir < mc; ir += kMr) {
+    const int32_t mr = KernelMin(kMr, mc - ir);
+    for (int32_t p = 0; p < kc; p++) {
+      const T* a_col = a + ir * row_stride + p * col_stride;
+      for (int32_t i = 0; i < mr; i++) { a_pack[i] = a_col[i * row_stride]; }
+      for (int32_t i = mr; i < kMr; i++) { a_pack[i] = 0; }
+      a_pack += kMr;
+    }
+  }
+}
+
+// NOTE: packs a kc x nc block of op(B) into kNr column strips, each stored row by row
+// (kc x kNr), zero padding the last strip. op(B)(p, j) is b[p * row_stride + j * col_stride].
+template <int32_t kNr, typename T>
+static void PackB(
+    int32_t kc, int32_t nc, const T* b, int64_t row_stride, int64_t col_stride, T* b_pack) {
+  for (int32_t jr = 0; jr < nc; jr += kNr) {
+    const int32_t nr = KernelMin(kNr, nc - jr);
+    for (int32_t p = 0; p < kc; p++) {
+      const T* b_row = b + p * row_stride + jr * col_stride;
+      for (int32_t j = 0; j < nr; j++) { b_pack[j] = b_row[j * col_stride]; }
+      for (int32_t j = nr; j < kNr; j++) { b_pack[j] = 0; }
+      b_pack += kNr;
+    }
+  }
+}
+
+// Goto style blocked GEMM, transposed operands are handled while packing. Kernel provides:
+//   Scalar: the element type.
+//   kMr, kNr: the register tile size.
+//   MicroKernel(kc, a_pack, b_pack, c, ldc): c (kMr x kNr) += a_pack * b_pack.
+//   Axpy(x, alpha, y, count): y += alpha * x.
+//   Dot(x, y, count): returns x . y
+// The epilogue, if any, runs on each mc x nc block of c right after its last kc pass.
+template <typename Kernel, typename T = typename Kernel::Scalar>
+static void BlockedGemm(
+    bool trans_a, bool trans_b, int32_t m, int32_t n, int32_t k,
+    const T* a, const T* b, T* c, bool accumulate, const GemmEpilogue<T>* epilogue) {
+  constexpr int32_t kMr = Kernel::kMr;
+  constexpr int32_t kNr = Kernel::kNr;
+  static_assert(kGemmMc % kMr == 0 && kGemmNc % kNr == 0);
+  if (!accumulate) {
+    for (int64_t i = 0; i < (int64_t) m * n; i++) { c[i] = 0; }
+  }
+  if (m == 0 || n == 0) { return; }
+  if (k == 0) {
+    if (epilogue != nullptr) { epilogue->fn(epilogue->context, c, m, n, n, 0); }
+    return;
+  }
+
+  const int64_t a_row_stride = trans_a ? 1 : k;
+  const int64_t a_col_stride = trans_a ? m : 1;
+  const int64_t b_row_stride = trans_b ? 1 : n;
+  const int64_t b_col_stride = trans_b ? k : 1;
+
+  // NOTE: too few rows to fill a register tile (e.g. single sample inference), packing
+  // would only add overhead, so stream rows of op(B) or dot against rows of B instead.
+  if (m < kMr) {
+    for (int32_t i = 0; i < m; i++) {
+      T* c_row = c + (int64_t) i * n;
+      if (trans_b) {
+        if (trans_a) {
+          for (int32_t j = 0; j < n; j++) {
+            const T* b_row = b + (int64_t) j * k;
+            T sum = 0;
+            for (int32_t p = 0; p < k; p++) { sum += a[p * a_col_stride + i] * b_row[p]; }
+            c_row[j] += sum;
+          }
+        } else {
+          for (int32_t j = 0; j < n; j++) {
+            c_row[j] += Kernel::Dot(a + (int64_t) i * k, b + (int64_t) j * k, k);
+          }
+        }
+      } else {
+        for (int32_t p = 0; p < k; p++) {
+          Kernel::Axpy(b + (int64_t) p * n, a[i * a_row_stride + p * a_col_stride], c_row, n);
+        }
+      }
+      if (epilogue != nullptr) { epilogue->fn(epilogue->context, c_row, 1, n, n, 0); }
+    }
+    return;
+  }
+
+  // NOTE: the workspace is sized for this problem's blocks, so small layers don't hold on to
+  // one sized for the largest.
+  const int64_t max_kc = KernelMin(k, kGemmKc);
+  const int64_t max_nc = (KernelMin(n, kGemmNc) + kNr - 1) / kNr * kNr;
+  T* a_pack = GemmWorkspace<T>(kGemmMc * max_kc + max_kc * max_nc);
+  T* b_pack = a_pack + kGemmMc * max_kc;
+  for (int32_t jc = 0; jc < n; jc += kGemmNc) {
+    const int32_t nc = KernelMin(kGemmNc, n - jc);
+    for (int32_t pc = 0; pc < k; pc += kGemmKc) {
+      const int32_t kc = KernelMin(kGemmKc, k - pc);
+      PackB<kNr>(
+          kc, nc, b + pc * b_row_stride + jc * b_col_stride, b_row_stride, b_col_stride, b_pack);
+      for (int32_t ic = 0; ic < m; ic += kGemmMc) {
+        const int32_t mc = KernelMin(kGemmMc, m - ic);
+        PackA<kMr>(
+            mc, kc, a + ic * a_row_stride + pc * a_col_stride, a_row_stride, a_col_stride, a_pack);
+        for (int32_t jr = 0; jr < nc; jr += kNr) {
+          const int32_t nr = KernelMin(kNr, nc - jr);
+          for (int32_t ir = 0; ir < mc; ir += kMr) {
+            const int32_t mr = KernelMin(kMr, mc - ir);
+            const T* a_panel = a_pack + ir * kc;
+            const T* b_panel = b_pack + jr * kc;
+            T* c_tile = c + (int64_t) (ic + ir) * n + jc + jr;
+            if (mr == kMr && nr == kNr) {
+              Kernel::MicroKernel(kc, a_panel, b_panel, c_tile, n);
+            } else {
+              // NOTE: edge tile, compute the full register tile and only keep what fits.
+              T tile[kMr * kNr] = {};
+              Kernel::MicroKernel(kc, a_panel, b_panel, tile, kNr);
+              for (int32_t i = 0; i < mr; i++) {
+                for (int32_t j = 0; j < nr; j++) { c_tile[i * n + j] += tile[i * kNr + j]; }
+              }
+            }
+          }
+        }
+        if (epilogue != nullptr && pc + kc == k) {
+          epilogue->fn(epilogue->context, c + (int64_t) ic * n + jc, mc, nc, n, jc);
+        }
+      }
+    }
+  }
+}
+
+template <typename Kernel, typename T = typename Kernel::Scalar>
+static void KernelGemm(
+    bool trans_a, bool trans_b, int32_t m, int32_t n, int32_t k,
+    const T* a, const T* b, T* c, bool accumulate) {
+  BlockedGemm<Kernel, T>(trans_a, trans_b, m, n, k, a, b, c, accumulate, nullptr);
+}
+
+template <typename Kernel, typename T = typename Kernel::Scalar>
+static void KernelGemmWithEpilogue(
+    int32_t m, int32_t n, int32_t k, const T* a, const T* b, T* c,
+    const GemmEpilogue<T>& epilogue) {
+  BlockedGemm<Kernel, T>(
+      /*trans_a=*/false, /*trans_b=*/false, m, n, k, a, b, c, /*accumulate=*/false, &epilogue);
+}
+
+// Builds the kernel table for a Kernel that provides everything BlockedGemm needs plus
+// static Add, Sub, Mul, Scale, MomentumUpdate, NesterovUpdate, RmsPropUpdate, AdamUpdate,
+// Exp, Sigmoid, TanH, SigmoidDerivMul and TanHDerivMul.
+template <typename Kernel, typename T = typename Kernel::Scalar>
+static constexpr MatrixKernels<T> MakeMatrixKernels(SimdIsa isa) {
+  return MatrixKernels<T> {
+    .isa = isa,
+    .gemm = KernelGemm<Kernel>,
+    .gemm_epilogue = KernelGemmWithEpilogue<Kernel>,
+    .add = Kernel::Add,
+    .sub = Kernel::Sub,
+    .mul = Kernel::Mul,
+    .scale = Kernel::Scale,
+    .axpy = Kernel::Axpy,
+    .momentum_update = Kernel::MomentumUpdate,
+    .nesterov_update = Kernel::NesterovUpdate,
+    .rmsprop_update = Kernel::RmsPropUpdate,
+    .adam_update = Kernel::AdamUpdate,
+    .exp = Kernel::Exp,
+    .sigmoid = Kernel::Sigmoid,
+    .tanh = Kernel::TanH,
+    .sigmoid_deriv_mul = Kernel::SigmoidDerivMul,
+    .tanh_deriv_mul = Kernel::TanHDerivMul,
+  };
+}
+
+// Packed int8 weights are split into panels of kInt8Nr columns. Each panel stores the
+// rows in groups of 4, and each group its kInt8Nr columns' 4 bytes in turn, so one 64 byte
+// load holds 4 consecutive products for each of 16 int32 lanes. Rows and columns are zero
+// padded to whole groups and panels. The panels are followed by the kInt8Nr-padded int32
+// column sums, which kernels working on unsigned activations need to undo their offset.
+constexpr int32_t kInt8Nr = 16;
+
+static inline int32_t Int8GroupCount(int32_t k) { return (k + 3) / 4; }
+
+static inline int64_t Int8PanelsSize(int32_t k, int32_t n) {
+  return (int64_t) ((n + kInt8Nr - 1) / kInt8Nr) * kInt8Nr * Int8GroupCount(k) * 4;
+}
+
+// NOTE: the 4 bytes of a group, to be broadcast to every lane.
+static inline int32_t LoadInt8Group(const int8_t* a) {
+  int32_t group;
+  std::memcpy(&group, a, sizeof(group));
+  return group;
+}
+
+// Calls Kernel::MicroKernel<kRows> for the first kRows >= rows, so that partial row tiles
+// never read past the last row of a.
+template <typename Kernel, int32_t kRows = Kernel::kMr>
+static inline void Int8MicroKernelRows(
+    int32_t rows, int32_t groups, const int8_t* a, int64_t lda, const int8_t* b_panel,
+    const int32_t* column_sums, int32_t* c, int64_t ldc, int32_t nr) {
+  if constexpr (kRows > 1) {
+    if (rows < kRows) {
+      Int8MicroKernelRows<Kernel, kRows - 1>(
+          rows, groups, a, lda, b_panel, column_sums, c, ldc, nr);
+      return;
+    }
+  }
+  Kernel::template MicroKernel<kRows>(groups, a, lda, b_panel, column_sums, c, ldc, nr);
+}
+
+// Int8 GEMM over packed weights. Each panel (kInt8Nr x 4 bytes per group, ~12KB for 784
+// rows) stays in L1 while every row tile of a streams past it. Kernel provides:
+//   kMr: the most rows of a register tile.
+//   MicroKernel<kRows>(groups, a, lda, b_panel, column_sums, c, ldc, nr): stores the first
+//     nr columns of c (kRows x kInt8Nr) = a (kRows x 4 * groups) * b_panel.
+template <typename Kernel>
+static void Int8Gemm(
+    int32_t m, int32_t n, int32_t k, const int8_t* a, int64_t lda,
+    const int8_t* b_packed, int32_t* c) {
+  const int32_t groups = Int8GroupCount(k);
+  const int32_t* column_sums =
+    reinterpret_cast<const int32_t*>(b_packed + Int8PanelsSize(k, n));
+  for (int32_t jr = 0; jr < n; jr += kInt8Nr) {
+    const int32_t nr = KernelMin(kInt8Nr, n - jr);
+    const int8_t* b_panel = b_packed + (int64_t) jr * groups * 4;
+    for (int32_t ir = 0; ir < m; ir += Kernel::kMr) {
+      Int8MicroKernelRows<Kernel>(
+          KernelMin(Kernel::kMr, m - ir), groups, a + ir * lda, lda, b_panel,
+          column_sums + jr, c + (int64_t) ir * n + jr, n, nr);
+    }
+  }
+}
+
+#endif
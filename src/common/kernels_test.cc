@@ -0,0 +1,311 @@
+#include "src/common/kernels.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "absl/log/log.h"
+
+template <typename T>
+class KernelsTest : public testing::Test {
+ protected:
+  // NOTE: tolerances are given for double and float respectively.
+  static double Tolerance(double double_tolerance, double float_tolerance) {
+    return std::is_same_v<T, float> ? float_tolerance : double_tolerance;
+  }
+};
+
+using KernelTypes = testing::Types<float, double>;
+TYPED_TEST_SUITE(KernelsTest, KernelTypes);
+
+template <typename T>
+std::vector<T> RandomElements(int64_t count, std::mt19937& gen) {
+  std::uniform_real_distribution<T> rand(-1.0, 1.0);
+  std::vector<T> elements(count);
+  for (T& element : elements) { element = rand(gen); }
+  return elements;
+}
+
+// NOTE: a is m x k (k x m if trans_a) and b is k x n (n x k if trans_b). Accumulates in
+// double regardless of T.
+template <typename T>
+std::vector<double> ReferenceGemm(
+    bool trans_a, bool trans_b, int32_t m, int32_t n, int32_t k,
+    const std::vector<T>& a, const std::vector<T>& b) {
+  std::vector<double> c(m * n);
+  for (int32_t i = 0; i < m; i++) {
+    for (int32_t p = 0; p < k; p++) {
+      for (int32_t j = 0; j < n; j++) {
+        double a_ip = trans_a ? a[p * m + i] : a[i * k + p];
+        double b_pj = trans_b ? b[j * k + p] : b[p * n + j];
+        c[i * n + j] += a_ip * b_pj;
+      }
+    }
+  }
+  return c;
+}
+
+template <typename T>
+std::vector<const MatrixKernels<T>*> SupportedKernels() {
+  std::vector<const MatrixKernels<T>*> result;
+  for (SimdIsa isa : {SimdIsa::GENERIC, SimdIsa::AVX2, SimdIsa::AVX512}) {
+    const MatrixKernels<T>* kernels = GetMatrixKernelsForIsa<T>(isa);
+    if (kernels == nullptr) {
+      LOG(INFO) << "Skipping unsupported ISA: " << SimdIsaToString(isa);
+      continue;
+    }
+    result.push_back(kernels);
+  }
+  return result;
+}
+
+TYPED_TEST(KernelsTest, GemmMatchesReference) {
+  using T = TypeParam;
+  const double tolerance = this->Tolerance(1e-9, 1e-3);
+  std::mt19937 gen(0);
+  // NOTE: sizes chosen to exercise edge tiles and multiple cache blocks.
+  const std::vector<std::array<int32_t, 3>> shapes = {
+    {1, 1, 1}, {1, 10, 784}, {3, 5, 7}, {17, 33, 9}, {100, 70, 300}, {128, 512, 784},
+  };
+  for (const MatrixKernels<T>* kernels : SupportedKernels<T>()) {
+    for (auto [m, n, k] : shapes) {
+      for (bool trans_a : {false, true}) {
+        for (bool trans_b : {false, true}) {
+          std::vector<T> a = RandomElements<T>(m * k, gen);
+          std::vector<T> b = RandomElements<T>(k * n, gen);
+          std::vector<double> expected = ReferenceGemm(trans_a, trans_b, m, n, k, a, b);
+          std::vector<T> c(m * n, 1.0);
+          kernels->gemm(trans_a, trans_b, m, n, k, a.data(), b.data(), c.data(), /*accumulate=*/false);
+          for (int32_t i = 0; i < m * n; i++) {
+            ASSERT_NEAR(c[i], expected[i], tolerance)
+              << SimdIsaToString(kernels->isa) << " " << m << "x" << n << "x" << k
+              << " trans_a: " << trans_a << " trans_b: " << trans_b;
+          }
+          kernels->gemm(trans_a, trans_b, m, n, k, a.data(), b.data(), c.data(), /*accumulate=*/true);
+          for (int32_t i = 0; i < m * n; i++) {
+            ASSERT_NEAR(c[i], 2 * expected[i], 2 * tolerance)
+              << SimdIsaToString(kernels->isa) << " " << m << "x" << n << "x" << k
+              << " trans_a: " << trans_a << " trans_b: " << trans_b;
+          }
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(KernelsTest, GemmEpilogueVisitsEachElementOnce) {
+  using T = TypeParam;
+  const double tolerance = this->Tolerance(1e-9, 1e-3);
+  std::mt19937 gen(0);
+  const std::vector<std::array<int32_t, 3>> shapes = {
+    {1, 10, 784}, {3, 5, 0}, {17, 33, 9}, {100, 2100, 300},
+  };
+  for (const MatrixKernels<T>* kernels : SupportedKernels<T>()) {
+    for (auto [m, n, k] : shapes) {
+      std::vector<T> a = RandomElements<T>(m * k, gen);
+      std::vector<T> b = RandomElements<T>(k * n, gen);
+      std::vector<T> bias = RandomElements<T>(n, gen);
+      std::vector<double> expected = ReferenceGemm(false, false, m, n, k, a, b);
+      const GemmEpilogue<T> add_bias = {
+        .fn = [](const void* context, T* c, int32_t rows, int32_t cols, int64_t ldc, int32_t col) {
+          const T* bias = static_cast<const T*>(context) + col;
+          for (int32_t i = 0; i < rows; i++) {
+            for (int32_t j = 0; j < cols; j++) { c[i * ldc + j] += bias[j]; }
+          }
+        },
+        .context = bias.data(),
+      };
+      std::vector<T> c(m * n, 1.0);
+      kernels->gemm_epilogue(m, n, k, a.data(), b.data(), c.data(), add_bias);
+      for (int32_t i = 0; i < m * n; i++) {
+        ASSERT_NEAR(c[i], expected[i] + bias[i % n], tolerance)
+          << SimdIsaToString(kernels->isa) << " " << m << "x" << n << "x" << k;
+      }
+    }
+  }
+}
+
+TYPED_TEST(KernelsTest, ElementWiseMatchesReference) {
+  using T = TypeParam;
+  const double tolerance = this->Tolerance(1e-12, 1e-6);
+  std::mt19937 gen(0);
+  for (const MatrixKernels<T>* kernels : SupportedKernels<T>()) {
+    for (int64_t count : {1, 7, 8, 9, 31, 1000}) {
+      std::vector<T> a = RandomElements<T>(count, gen);
+      std::vector<T> b = RandomElements<T>(count, gen);
+      std::vector<T> out(count);
+
+      kernels->add(a.data(), b.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) { ASSERT_EQ(out[i], T(a[i] + b[i])); }
+      kernels->sub(a.data(), b.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) { ASSERT_EQ(out[i], T(a[i] - b[i])); }
+      kernels->mul(a.data(), b.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) { ASSERT_EQ(out[i], T(a[i] * b[i])); }
+      kernels->scale(a.data(), 3.0, out.data(), count);
+      for (int64_t i = 0; i < count; i++) { ASSERT_EQ(out[i], T(a[i] * T(3.0))); }
+      out = b;
+      kernels->axpy(a.data(), -2.0, out.data(), count);
+      for (int64_t i = 0; i < count; i++) { ASSERT_NEAR(out[i], b[i] - 2.0 * a[i], tolerance); }
+    }
+  }
+}
+
+TYPED_TEST(KernelsTest, OptimizerStepsMatchReference) {
+  using T = TypeParam;
+  const double tolerance = this->Tolerance(1e-12, 1e-5);
+  const UpdateStep<T> step = {
+    .learn_rate = 0.1, .beta1 = 0.9, .beta2 = 0.99, .epsilon = 1e-3, .l2 = 0.01, .decay = 0.98,
+  };
+  std::mt19937 gen(0);
+  for (const MatrixKernels<T>* kernels : SupportedKernels<T>()) {
+    for (int64_t count : {1, 7, 8, 9, 31, 1000}) {
+      const std::vector<T> g = RandomElements<T>(count, gen);
+      const std::vector<T> w = RandomElements<T>(count, gen);
+      std::vector<T> m = RandomElements<T>(count, gen);
+      std::vector<T> v = RandomElements<T>(count, gen);
+      for (T& x : v) { x = std::abs(x); }
+      std::vector<double> gradients(count);
+      for (int64_t i = 0; i < count; i++) { gradients[i] = g[i] + double(step.l2) * w[i]; }
+
+      std::vector<T> out_m = m;
+      std::vector<T> out_w = w;
+      kernels->momentum_update(step, g.data(), out_m.data(), out_w.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        const double velocity = double(step.beta1) * m[i] - double(step.learn_rate) * gradients[i];
+        ASSERT_NEAR(out_m[i], velocity, tolerance);
+        ASSERT_NEAR(out_w[i], double(step.decay) * w[i] + velocity, tolerance);
+      }
+      out_m = m;
+      out_w = w;
+      kernels->nesterov_update(step, g.data(), out_m.data(), out_w.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        const double gradient_step = -double(step.learn_rate) * gradients[i];
+        const double velocity = double(step.beta1) * m[i] + gradient_step;
+        ASSERT_NEAR(out_m[i], velocity, tolerance);
+        ASSERT_NEAR(
+            out_w[i], double(step.decay) * w[i] + double(step.beta1) * velocity + gradient_step,
+            tolerance);
+      }
+      std::vector<T> out_v = v;
+      out_w = w;
+      kernels->rmsprop_update(step, g.data(), out_v.data(), out_w.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        const double mean_square =
+          double(step.beta2) * v[i] + (1 - double(step.beta2)) * gradients[i] * gradients[i];
+        ASSERT_NEAR(out_v[i], mean_square, tolerance);
+        ASSERT_NEAR(
+            out_w[i],
+            double(step.decay) * w[i] - double(step.learn_rate) * gradients[i] /
+              (std::sqrt(mean_square) + double(step.epsilon)),
+            tolerance * 100);
+      }
+      out_m = m;
+      out_v = v;
+      out_w = w;
+      kernels->adam_update(step, g.data(), out_m.data(), out_v.data(), out_w.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        const double mean = double(step.beta1) * m[i] + (1 - double(step.beta1)) * gradients[i];
+        const double mean_square =
+          double(step.beta2) * v[i] + (1 - double(step.beta2)) * gradients[i] * gradients[i];
+        ASSERT_NEAR(out_m[i], mean, tolerance);
+        ASSERT_NEAR(out_v[i], mean_square, tolerance);
+        ASSERT_NEAR(
+            out_w[i],
+            double(step.decay) * w[i] - double(step.learn_rate) * mean /
+              (std::sqrt(mean_square) + double(step.epsilon)),
+            tolerance * 100);
+      }
+    }
+  }
+}
+
+TYPED_TEST(KernelsTest, ActivationsMatchReference) {
+  using T = TypeParam;
+  std::mt19937 gen(0);
+  for (const MatrixKernels<T>* kernels : SupportedKernels<T>()) {
+    for (int64_t count : {1, 7, 8, 9, 31, 1000}) {
+      std::vector<T> a = RandomElements<T>(count, gen);
+      for (T& x : a) { x *= 50; }
+      std::vector<T> out(count);
+
+      kernels->exp(a.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        const double expected = std::exp((double) a[i]);
+        ASSERT_NEAR(out[i], expected, this->Tolerance(1e-14, 1e-6) * expected)
+          << SimdIsaToString(kernels->isa);
+      }
+      kernels->sigmoid(a.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        ASSERT_NEAR(out[i], 1.0 / (1.0 + std::exp(-(double) a[i])), this->Tolerance(1e-15, 3e-7))
+          << SimdIsaToString(kernels->isa);
+      }
+      kernels->tanh(a.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        ASSERT_NEAR(out[i], std::tanh((double) a[i]), this->Tolerance(1e-15, 5e-7))
+          << SimdIsaToString(kernels->isa);
+      }
+
+      std::vector<T> activated = RandomElements<T>(count, gen);
+      out = a;
+      kernels->sigmoid_deriv_mul(activated.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        ASSERT_NEAR(
+            out[i], (double) a[i] * activated[i] * (1.0 - activated[i]),
+            this->Tolerance(1e-13, 1e-5));
+      }
+      out = a;
+      kernels->tanh_deriv_mul(activated.data(), out.data(), count);
+      for (int64_t i = 0; i < count; i++) {
+        ASSERT_NEAR(
+            out[i], (double) a[i] * (1.0 - activated[i] * activated[i]),
+            this->Tolerance(1e-12, 1e-5));
+      }
+    }
+  }
+}
+
+TEST(Int8KernelsTest, GemmIsExact) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int32_t> rand(-127, 127);
+  // NOTE: sizes chosen to exercise partial groups, panels and row tiles.
+  const std::vector<std::array<int32_t, 3>> shapes = {
+    {1, 1, 1}, {1, 10, 784}, {3, 5, 7}, {9, 33, 18}, {32, 512, 784},
+  };
+  for (SimdIsa isa : {SimdIsa::GENERIC, SimdIsa::AVX2, SimdIsa::AVX512_VNNI}) {
+    const Int8Kernels* kernels = GetInt8KernelsForIsa(isa);
+    if (kernels == nullptr) {
+      LOG(INFO) << "Skipping unsupported ISA: " << SimdIsaToString(isa);
+      continue;
+    }
+    for (auto [m, n, k] : shapes) {
+      // NOTE: garbage in a's row padding, which must not affect the result.
+      const int64_t lda = (k + 3) / 4 * 4;
+      std::vector<int8_t> a(m * lda, 127);
+      std::vector<int8_t> b(k * n);
+      for (int32_t i = 0; i < m; i++) {
+        for (int32_t p = 0; p < k; p++) { a[i * lda + p] = rand(gen); }
+      }
+      for (int8_t& x : b) { x = rand(gen); }
+      // NOTE: extreme values, where saturating int16 pairs would overflow.
+      a[0] = -127;
+      b[0] = 127;
+      std::vector<int8_t> b_packed(Int8PackedWeightsSize(k, n));
+      PackInt8Weights(k, n, b.data(), b_packed.data());
+
+      std::vector<int32_t> c(m * n);
+      kernels->gemm(m, n, k, a.data(), lda, b_packed.data(), c.data());
+      for (int32_t i = 0; i < m; i++) {
+        for (int32_t j = 0; j < n; j++) {
+          int32_t expected = 0;
+          for (int32_t p = 0; p < k; p++) { expected += a[i * lda + p] * b[p * n + j]; }
+          ASSERT_EQ(c[i * n + j], expected) << SimdIsaToString(isa) << " " << m << "x" << n << "x" << k;
+        }
+      }
+    }
+  }
+}
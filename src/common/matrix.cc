@@ -1,28 +1,33 @@
 #include "src/common/matrix.h"
 
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <iostream>
+#include <memory_resource>
 #include <ostream>
 #include <random>
 #include <string>
 #include <utility>
 
 #include "absl/log/check.h"
+#include "src/common/kernels.h"
 
-Matrix Matrix::Random(int32_t row_count, int32_t col_count) {
+template <typename T>
+Matrix<T> Matrix<T>::Random(int32_t row_count, int32_t col_count) {
   std::random_device rd{};
   std::mt19937 gen{rd()};
-  std::normal_distribution rand;
-  std::vector<double> result_elements(row_count * col_count);
-  for (int32_t i = 0; i < result_elements.size(); i++) {
-    result_elements[i] = rand(gen);
+  std::normal_distribution<T> rand;
+  Matrix result(row_count, col_count);
+  for (T& element : result.elements_) {
+    element = rand(gen);
   }
-  return Matrix(row_count, col_count, std::move(result_elements));
+  return result;
 }
 
-Matrix Matrix::Transpose() const {
-  Matrix result = Matrix(col_count_, row_count_);
+template <typename T>
+Matrix<T> Matrix<T>::Transpose() const {
+  Matrix result(col_count_, row_count_, Resource());
   for (int32_t c = 0; c < col_count_; c++) {
     for (int32_t r = 0; r < row_count_; r++) {
       result.MutableElementAt(c, r) = ElementAt(r, c);
@@ -31,85 +36,147 @@ Matrix Matrix::Transpose() const {
   return result;
 }
 
-Matrix Matrix::HadamardMult(const Matrix& other) const {
+template <typename T>
+Matrix<T> Matrix<T>::HadamardMult(const Matrix& other) const {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  std::vector<double> result_elements;
-  result_elements.reserve(elements_.size());
-  for (int32_t i = 0; i < elements_.size(); i++) {
-    result_elements.push_back(elements_[i] * other.elements_[i]);
-  }
-  return Matrix(row_count_, col_count_, result_elements);
+  Matrix result(row_count_, col_count_, Resource());
+  GetMatrixKernels<T>().mul(
+      elements_.data(), other.elements_.data(), result.elements_.data(), elements_.size());
+  return result;
 }
 
-void Matrix::HadamardMultInPlace(const Matrix& other) {
+template <typename T>
+void Matrix<T>::HadamardMultInPlace(const Matrix& other) {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  for (int32_t i = 0; i < elements_.size(); i++) {
-    elements_[i] *= other.elements_[i];
-  }
+  GetMatrixKernels<T>().mul(
+      elements_.data(), other.elements_.data(), elements_.data(), elements_.size());
 }
 
-Matrix Matrix::operator*(double scalar) const {
-  Matrix result = *this;
-  for (double& element : result.elements_) { element *= scalar; }
+template <typename T>
+Matrix<T> Matrix<T>::operator*(T scalar) const {
+  Matrix result(row_count_, col_count_, Resource());
+  GetMatrixKernels<T>().scale(elements_.data(), scalar, result.elements_.data(), elements_.size());
   return result;
 }
 
-void Matrix::operator*=(double scalar) {
-  for (double& element : elements_) { element *= scalar; }
+template <typename T>
+void Matrix<T>::operator*=(T scalar) {
+  GetMatrixKernels<T>().scale(elements_.data(), scalar, elements_.data(), elements_.size());
 }
 
-Matrix Matrix::operator+(const Matrix& other) const {
+template <typename T>
+Matrix<T> Matrix<T>::operator+(const Matrix& other) const {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  std::vector<double> result_elements(row_count_ * col_count_);
-  for (int32_t i = 0; i < result_elements.size(); i++) {
-    result_elements[i] = elements_[i] + other.elements_[i];
-  }
-  return Matrix(row_count_, col_count_, std::move(result_elements));
+  Matrix result(row_count_, col_count_, Resource());
+  GetMatrixKernels<T>().add(
+      elements_.data(), other.elements_.data(), result.elements_.data(), elements_.size());
+  return result;
 }
 
-void Matrix::operator+=(const Matrix& other) {
+template <typename T>
+void Matrix<T>::operator+=(const Matrix& other) {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  for (int32_t i = 0; i < elements_.size(); i++) {
-    elements_[i] += other.elements_[i];
-  }
+  GetMatrixKernels<T>().add(
+      elements_.data(), other.elements_.data(), elements_.data(), elements_.size());
 }
 
-Matrix Matrix::operator-(const Matrix& other) const {
+template <typename T>
+Matrix<T> Matrix<T>::operator-(const Matrix& other) const {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  std::vector<double> result_elements(row_count_ * col_count_);
-  for (int32_t i = 0; i < result_elements.size(); i++) {
-    result_elements[i] = elements_[i] - other.elements_[i];
-  }
-  return Matrix(row_count_, col_count_, std::move(result_elements));
+  Matrix result(row_count_, col_count_, Resource());
+  GetMatrixKernels<T>().sub(
+      elements_.data(), other.elements_.data(), result.elements_.data(), elements_.size());
+  return result;
 }
 
-void Matrix::operator-=(const Matrix& other) {
+template <typename T>
+void Matrix<T>::operator-=(const Matrix& other) {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
-  for (int32_t i = 0; i < elements_.size(); i++) {
-    elements_[i] -= other.elements_[i];
-  }
+  GetMatrixKernels<T>().sub(
+      elements_.data(), other.elements_.data(), elements_.data(), elements_.size());
+}
+
+template <typename T>
+void Matrix<T>::AddScaled(const Matrix& other, T scalar) {
+  DCHECK(row_count_ == other.row_count_);
+  DCHECK(col_count_ == other.col_count_);
+  GetMatrixKernels<T>().axpy(other.elements_.data(), scalar, elements_.data(), elements_.size());
 }
 
-Matrix Matrix::operator*(const Matrix& other) const {
+template <typename T>
+Matrix<T> Matrix<T>::operator*(const Matrix& other) const {
   DCHECK(col_count_ == other.row_count_);
-  Matrix result(row_count_, other.col_count_);
-  for (int32_t i = 0; i < row_count_; i++) {
-    for (int32_t k = 0; k < col_count_; k++) {
-      for (int32_t j = 0; j < other.col_count_; j++) {
-        result.MutableElementAt(i, j) += ElementAt(i, k) * other.ElementAt(k, j);
-      }
-    }
+  Matrix result(row_count_, other.col_count_, Resource());
+  GetMatrixKernels<T>().gemm(
+      /*trans_a=*/false, /*trans_b=*/false, row_count_, other.col_count_, col_count_,
+      elements_.data(), other.elements_.data(), result.elements_.data(), /*accumulate=*/false);
+  return result;
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::MultWithEpilogue(const Matrix& other, const GemmEpilogue<T>& epilogue) const {
+  DCHECK(col_count_ == other.row_count_);
+  Matrix result(row_count_, other.col_count_, Resource());
+  GetMatrixKernels<T>().gemm_epilogue(
+      row_count_, other.col_count_, col_count_,
+      elements_.data(), other.elements_.data(), result.elements_.data(), epilogue);
+  return result;
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::TransposeMult(const Matrix& other) const {
+  DCHECK(row_count_ == other.row_count_);
+  Matrix result(col_count_, other.col_count_, Resource());
+  GetMatrixKernels<T>().gemm(
+      /*trans_a=*/true, /*trans_b=*/false, col_count_, other.col_count_, row_count_,
+      elements_.data(), other.elements_.data(), result.elements_.data(), /*accumulate=*/false);
+  return result;
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::MultTranspose(const Matrix& other) const {
+  DCHECK(col_count_ == other.col_count_);
+  Matrix result(row_count_, other.row_count_, Resource());
+  GetMatrixKernels<T>().gemm(
+      /*trans_a=*/false, /*trans_b=*/true, row_count_, other.row_count_, col_count_,
+      elements_.data(), other.elements_.data(), result.elements_.data(), /*accumulate=*/false);
+  return result;
+}
+
+template <typename T>
+void Matrix<T>::AddTransposeMult(const Matrix& a, const Matrix& b) {
+  DCHECK(a.row_count_ == b.row_count_);
+  DCHECK(row_count_ == a.col_count_);
+  DCHECK(col_count_ == b.col_count_);
+  GetMatrixKernels<T>().gemm(
+      /*trans_a=*/true, /*trans_b=*/false, a.col_count_, b.col_count_, a.row_count_,
+      a.elements_.data(), b.elements_.data(), elements_.data(), /*accumulate=*/true);
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::ColumnSums() const {
+  Matrix result(1, col_count_, Resource());
+  for (int32_t r = 0; r < row_count_; r++) {
+    GetMatrixKernels<T>().add(
+        result.elements_.data(), elements_.data() + r * col_count_,
+        result.elements_.data(), col_count_);
   }
   return result;
 }
 
-bool Matrix::operator==(const Matrix& other) const {
+template <typename T>
+void Matrix<T>::SetZero() {
+  std::fill(elements_.begin(), elements_.end(), T(0));
+}
+
+template <typename T>
+bool Matrix<T>::operator==(const Matrix& other) const {
   DCHECK(row_count_ == other.row_count_);
   DCHECK(col_count_ == other.col_count_);
   for (int32_t i = 0; i < elements_.size(); i++) {
@@ -120,7 +187,8 @@ bool Matrix::operator==(const Matrix& other) const {
   return true;
 }
 
-int32_t Matrix::Classify() const {
+template <typename T>
+int32_t Matrix<T>::Classify() const {
   DCHECK(row_count_ == 1);
   int32_t idx_max = 0;
   for (int32_t i = 1; i < elements_.size(); i++) {
@@ -131,25 +199,51 @@ int32_t Matrix::Classify() const {
   return idx_max;
 }
 
-int32_t Matrix::RowCount() const { return row_count_; }
+template <typename T>
+int32_t Matrix<T>::ClassifyRow(int32_t r) const {
+  DCHECK(r < row_count_);
+  int32_t idx_max = 0;
+  for (int32_t c = 1; c < col_count_; c++) {
+    if (ElementAt(r, c) > ElementAt(r, idx_max)) {
+      idx_max = c;
+    }
+  }
+  return idx_max;
+}
+
+template <typename T>
+int32_t Matrix<T>::RowCount() const { return row_count_; }
 
-int32_t Matrix::ColCount() const { return col_count_; }
+template <typename T>
+int32_t Matrix<T>::ColCount() const { return col_count_; }
 
-double Matrix::ElementAt(int32_t r, int32_t c) const {
+template <typename T>
+T Matrix<T>::ElementAt(int32_t r, int32_t c) const {
   DCHECK(r < row_count_ && c < col_count_);
   return elements_[(r * col_count_) + c];
 }
 
-double& Matrix::MutableElementAt(int32_t r, int32_t c) {
+template <typename T>
+T& Matrix<T>::MutableElementAt(int32_t r, int32_t c) {
   DCHECK(r < row_count_ && c < col_count_);
   return elements_[(r * col_count_) + c];
 }
 
-const std::vector<double>& Matrix::Elements() const {
+template <typename T>
+const typename Matrix<T>::Storage& Matrix<T>::Elements() const {
   return elements_;
 }
 
-std::string Matrix::DebugString() const {
+template <typename T>
+T* Matrix<T>::MutableData() { return elements_.data(); }
+
+template <typename T>
+std::pmr::memory_resource* Matrix<T>::Resource() const {
+  return elements_.get_allocator().resource();
+}
+
+template <typename T>
+std::string Matrix<T>::DebugString() const {
   std::string result;
   for (int32_t i = 0; i < row_count_; i++) {
     result += "| ";
@@ -161,3 +255,6 @@ std::string Matrix::DebugString() const {
   }
   return result;
 }
+
+template class Matrix<float>;
+template class Matrix<double>;
@@ -2,23 +2,70 @@
 #define SRC_COMMON_MATRIX_H_
 
 #include <array>
+#include <cstddef>
 #include <functional>
+#include <memory_resource>
 #include <random>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "absl/log/check.h"
+#include "src/common/kernels.h"
 
+// Allocates Matrix elements from a std::pmr::memory_resource, e.g. an Arena. Unlike
+// std::pmr::polymorphic_allocator, the resource moves along with the elements, so moving an
+// arena backed matrix into an existing one never reallocates. Copies are heap allocated.
+template <typename T>
+class MatrixAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  MatrixAllocator() : resource_(std::pmr::get_default_resource()) {}
+  explicit MatrixAllocator(std::pmr::memory_resource* resource) : resource_(resource) {}
+  template <typename U>
+  MatrixAllocator(const MatrixAllocator<U>& other) : resource_(other.resource()) {}
+
+  // NOTE: cache line aligned, so that rows of SIMD loads start on a boundary.
+  T* allocate(size_t count) {
+    return static_cast<T*>(resource_->allocate(count * sizeof(T), kAlignment));
+  }
+  void deallocate(T* p, size_t count) { resource_->deallocate(p, count * sizeof(T), kAlignment); }
+  MatrixAllocator select_on_container_copy_construction() const { return MatrixAllocator(); }
+  std::pmr::memory_resource* resource() const { return resource_; }
+
+  template <typename U>
+  bool operator==(const MatrixAllocator<U>& other) const {
+    return resource_ == other.resource() || resource_->is_equal(*other.resource());
+  }
+
+ private:
+  static constexpr size_t kAlignment = 64;
+  std::pmr::memory_resource* resource_;
+};
+
+// Dense, row-major matrix of float or double elements.
+// NOTE: results of operations are allocated from the same memory resource as this matrix.
+template <typename T>
 class Matrix {
  public:
+  using Scalar = T;
+  using Storage = std::vector<T, MatrixAllocator<T>>;
+
   Matrix() : Matrix(0, 0) {}
-  explicit Matrix(int32_t row_count, int32_t col_count) :
+  explicit Matrix(
+      int32_t row_count, int32_t col_count,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
     row_count_(row_count),
     col_count_(col_count),
-    elements_(std::vector<double>(row_count_ * col_count_)) {};
-  explicit Matrix(int32_t row_count, int32_t col_count, std::vector<double> elements) :
+    elements_(row_count_ * col_count_, MatrixAllocator<T>(resource)) {};
+  explicit Matrix(int32_t row_count, int32_t col_count, const std::vector<T>& elements) :
     row_count_(row_count),
     col_count_(col_count),
-    elements_(std::move(elements)) {
+    elements_(elements.begin(), elements.end()) {
       DCHECK(elements_.size() > 0);
       DCHECK(elements_.size() == row_count_ * col_count_);
     };
@@ -31,23 +78,40 @@ class Matrix {
   void operator+=(const Matrix& other);
   Matrix operator-(const Matrix& other) const;
   void operator-=(const Matrix& other);
-  Matrix operator*(double scalar) const;
-  void operator*=(double scalar);
+  void AddScaled(const Matrix& other, T scalar);
+  Matrix operator*(T scalar) const;
+  void operator*=(T scalar);
   Matrix operator*(const Matrix& other) const;
+  // this * other, running epilogue over each block of the result as soon as it's final.
+  Matrix MultWithEpilogue(const Matrix& other, const GemmEpilogue<T>& epilogue) const;
+  // this^T * other and this * other^T, without materializing the transposed operand.
+  Matrix TransposeMult(const Matrix& other) const;
+  Matrix MultTranspose(const Matrix& other) const;
+  // this += a^T * b
+  void AddTransposeMult(const Matrix& a, const Matrix& b);
+  Matrix ColumnSums() const;
+  void SetZero();
   bool operator==(const Matrix& other) const;
 
   int32_t Classify() const;
+  int32_t ClassifyRow(int32_t r) const;
   int32_t RowCount() const;
   int32_t ColCount() const;
-  double ElementAt(int32_t r, int32_t c) const;
-  double& MutableElementAt(int32_t r, int32_t c);
-  const std::vector<double>& Elements() const;
+  T ElementAt(int32_t r, int32_t c) const;
+  T& MutableElementAt(int32_t r, int32_t c);
+  const Storage& Elements() const;
+  // NOTE: raw row-major storage, for kernels that write whole matrices in place.
+  T* MutableData();
   std::string DebugString() const;
+  std::pmr::memory_resource* Resource() const;
 
  private:
   int32_t row_count_;
   int32_t col_count_;
-  std::vector<double> elements_;
+  Storage elements_;
 };
 
+extern template class Matrix<float>;
+extern template class Matrix<double>;
+
 #endif
@@ -4,46 +4,69 @@
 
 #include "absl/log/log.h"
 
-TEST(MatrixTest, AddSucceed) {
-  auto a = Matrix(2, 2, {
+template <typename T>
+class MatrixTest : public testing::Test {};
+
+using MatrixTypes = testing::Types<float, double>;
+TYPED_TEST_SUITE(MatrixTest, MatrixTypes);
+
+TYPED_TEST(MatrixTest, AddSucceed) {
+  auto a = Matrix<TypeParam>(2, 2, {
         1, 1,
         1, 1,
       });
-  auto b = Matrix(2, 2, {
+  auto b = Matrix<TypeParam>(2, 2, {
         2, 2,
         2, 2,
       });
-  auto expected = Matrix(2, 2, {
+  auto expected = Matrix<TypeParam>(2, 2, {
         3, 3,
         3, 3,
       });
   EXPECT_TRUE(a + b == expected);
 }
 
-TEST(MatrixTest, ScalarMultiplySucceed) {
-  double scalar = 2.0f;
-  auto a = Matrix(2, 3, {
+TYPED_TEST(MatrixTest, AddScaledSucceed) {
+  auto a = Matrix<TypeParam>(2, 2, {
+        1, 1,
+        1, 1,
+      });
+  auto b = Matrix<TypeParam>(2, 2, {
+        1, 2,
+        3, 4,
+      });
+  auto expected = Matrix<TypeParam>(2, 2, {
+        -1, -3,
+        -5, -7,
+      });
+  a.AddScaled(b, -2.0);
+  EXPECT_TRUE(a == expected);
+}
+
+TYPED_TEST(MatrixTest, ScalarMultiplySucceed) {
+  TypeParam scalar = 2;
+  auto a = Matrix<TypeParam>(2, 3, {
         1, 2, 3,
         4, 5, 6,
       });
-  auto expected = Matrix(2, 3, {
+  auto expected = Matrix<TypeParam>(2, 3, {
         2, 4, 6,
         8, 10, 12,
       });
   EXPECT_TRUE(a * scalar == expected);
 }
 
-TEST(MatrixTest, MatMultiplySucceed) {
-  auto a = Matrix(2, 3, {
+TYPED_TEST(MatrixTest, MatMultiplySucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
         1, 2, 3,
         4, 5, 6,
       });
-  auto b = Matrix(3, 4, {
+  auto b = Matrix<TypeParam>(3, 4, {
         7, 8, 9, 10,
         11, 12, 13, 14,
         15, 16, 17, 18,
       });
-  auto expected = Matrix(2, 4, {
+  auto expected = Matrix<TypeParam>(2, 4, {
         74, 80, 86, 92,
         173, 188, 203, 218,
       });
@@ -56,12 +79,71 @@ TEST(MatrixTest, MatMultiplySucceed) {
   EXPECT_TRUE(a * b == expected);
 }
 
-TEST(MatrixTest, TransposeSucceed) {
-  auto a = Matrix(2, 3, {
+TYPED_TEST(MatrixTest, TransposeMultSucceed) {
+  auto a = Matrix<TypeParam>(3, 2, {
+        1, 4,
+        2, 5,
+        3, 6,
+      });
+  auto b = Matrix<TypeParam>(3, 4, {
+        7, 8, 9, 10,
+        11, 12, 13, 14,
+        15, 16, 17, 18,
+      });
+  auto expected = Matrix<TypeParam>(2, 4, {
+        74, 80, 86, 92,
+        173, 188, 203, 218,
+      });
+  EXPECT_TRUE(a.TransposeMult(b) == expected);
+}
+
+TYPED_TEST(MatrixTest, MultTransposeSucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
+        1, 2, 3,
+        4, 5, 6,
+      });
+  auto b = Matrix<TypeParam>(4, 3, {
+        7, 11, 15,
+        8, 12, 16,
+        9, 13, 17,
+        10, 14, 18,
+      });
+  auto expected = Matrix<TypeParam>(2, 4, {
+        74, 80, 86, 92,
+        173, 188, 203, 218,
+      });
+  EXPECT_TRUE(a.MultTranspose(b) == expected);
+}
+
+TYPED_TEST(MatrixTest, AddTransposeMultSucceed) {
+  auto a = Matrix<TypeParam>(3, 2, {
+        1, 4,
+        2, 5,
+        3, 6,
+      });
+  auto b = Matrix<TypeParam>(3, 4, {
+        7, 8, 9, 10,
+        11, 12, 13, 14,
+        15, 16, 17, 18,
+      });
+  auto c = Matrix<TypeParam>(2, 4, {
+        1, 1, 1, 1,
+        1, 1, 1, 1,
+      });
+  auto expected = Matrix<TypeParam>(2, 4, {
+        75, 81, 87, 93,
+        174, 189, 204, 219,
+      });
+  c.AddTransposeMult(a, b);
+  EXPECT_TRUE(c == expected);
+}
+
+TYPED_TEST(MatrixTest, TransposeSucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
         1, 2, 3,
         4, 5, 6,
       });
-  auto expected = Matrix(3, 2, {
+  auto expected = Matrix<TypeParam>(3, 2, {
         1, 4,
         2, 5,
         3, 6,
@@ -69,32 +151,32 @@ TEST(MatrixTest, TransposeSucceed) {
   EXPECT_TRUE(a.Transpose() == expected);
 }
 
-TEST(MatrixTest, HadamardMultiplySucceed) {
-  auto a = Matrix(2, 3, {
+TYPED_TEST(MatrixTest, HadamardMultiplySucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
         1, 2, 3,
         4, 5, 6,
       });
-  auto b = Matrix(2, 3, {
+  auto b = Matrix<TypeParam>(2, 3, {
         7, 8, 9,
         11, 12, 13,
       });
-  auto expected = Matrix(2, 3, {
+  auto expected = Matrix<TypeParam>(2, 3, {
         7, 16, 27,
         44, 60, 78,
       });
   EXPECT_TRUE(a.HadamardMult(b) == expected);
 }
 
-TEST(MatrixTest, HadamardMultiplyInPlaceSucceed) {
-  auto a = Matrix(2, 3, {
+TYPED_TEST(MatrixTest, HadamardMultiplyInPlaceSucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
         1, 2, 3,
         4, 5, 6,
       });
-  auto b = Matrix(2, 3, {
+  auto b = Matrix<TypeParam>(2, 3, {
         7, 8, 9,
         11, 12, 13,
       });
-  auto expected = Matrix(2, 3, {
+  auto expected = Matrix<TypeParam>(2, 3, {
         7, 16, 27,
         44, 60, 78,
       });
@@ -102,7 +184,25 @@ TEST(MatrixTest, HadamardMultiplyInPlaceSucceed) {
   EXPECT_TRUE(a == expected);
 }
 
-TEST(MatrixTest, ClassifySucceed) {
-  auto x = Matrix(1, 5, {0, -1, 0, 1, 0.5 });
+TYPED_TEST(MatrixTest, ClassifySucceed) {
+  auto x = Matrix<TypeParam>(1, 5, {0, -1, 0, 1, 0.5 });
   EXPECT_TRUE(x.Classify() == 3);
 }
+
+TYPED_TEST(MatrixTest, ClassifyRowSucceed) {
+  auto x = Matrix<TypeParam>(2, 3, {
+        0, 1, 0.5,
+        2, -1, 0,
+      });
+  EXPECT_TRUE(x.ClassifyRow(0) == 1);
+  EXPECT_TRUE(x.ClassifyRow(1) == 0);
+}
+
+TYPED_TEST(MatrixTest, ColumnSumsSucceed) {
+  auto a = Matrix<TypeParam>(2, 3, {
+        1, 2, 3,
+        4, 5, 6,
+      });
+  auto expected = Matrix<TypeParam>(1, 3, {5, 7, 9});
+  EXPECT_TRUE(a.ColumnSums() == expected);
+}
@@ -0,0 +1,239 @@
+#include "src/common/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "absl/log/check.h"
+
+namespace {
+
+// NOTE: identifies the pool worker, if any, that is running on this thread.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int32_t current_worker_index = -1;
+
+// NOTE: failed attempts to find work before an idle worker goes to sleep.
+constexpr int32_t kSpinCount = 64;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) :
+  deques_(),
+  threads_(),
+  shared_queue_(),
+  shared_queue_mutex_(),
+  shared_queue_size_(0),
+  sleep_mutex_(),
+  cv_(),
+  sleeping_count_(0),
+  wake_generation_(0),
+  terminate_(false) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    deques_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+      deques_.push_back(std::make_unique<TaskDeque>());
+    }
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+      threads_.emplace_back(&ThreadPool::WorkerLoop, this, (int32_t) i);
+    }
+  }
+
+ThreadPool::~ThreadPool() {
+  {
+    std::scoped_lock lock(sleep_mutex_);
+    terminate_ = true;
+    wake_generation_++;
+  }
+  cv_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::ThreadCount() const { return threads_.size(); }
+
+bool ThreadPool::TaskDeque::Push(Task* task) {
+  const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  const int64_t top = top_.load(std::memory_order_acquire);
+  if (bottom - top >= kCapacity) { return false; }
+  tasks_[bottom % kCapacity].store(task, std::memory_order_relaxed);
+  // NOTE: publishes the task (and everything written to it) to thieves.
+  bottom_.store(bottom + 1, std::memory_order_release);
+  return true;
+}
+
+ThreadPool::Task* ThreadPool::TaskDeque::Pop() {
+  const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Task* task = tasks_[bottom % kCapacity].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // NOTE: last task, race any thieves for it.
+    if (!top_.compare_exchange_strong(
+          top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      task = nullptr;
+    }
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+ThreadPool::Task* ThreadPool::TaskDeque::Steal() {
+  int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t bottom = bottom_.load(std::memory_order_acquire);
+  if (top >= bottom) { return nullptr; }
+  Task* task = tasks_[top % kCapacity].load(std::memory_order_relaxed);
+  if (!top_.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return nullptr;
+  }
+  return task;
+}
+
+// NOTE: the task may delete itself or be released by a waiter as soon as it's done, so its
+// group is read up front.
+void ThreadPool::RunTask(Task* task) {
+  TaskGroup* group = task->group;
+  task->run(task);
+  if (group != nullptr) { group->pending_.fetch_sub(1, std::memory_order_acq_rel); }
+}
+
+void ThreadPool::RunChunks(LoopState* loop) {
+  int64_t chunk;
+  while ((chunk = loop->next_chunk.fetch_add(1, std::memory_order_relaxed)) < loop->chunk_count) {
+    const int64_t chunk_begin = loop->begin + chunk * loop->grain;
+    loop->run_chunk(loop->fn, chunk_begin, std::min(chunk_begin + loop->grain, loop->end));
+  }
+}
+
+// NOTE: rather than one task per chunk, a helper task per idle worker claims chunks until
+// there are none left, so chunks are balanced dynamically without any per-chunk overhead.
+void ThreadPool::RunLoop(LoopState* loop) {
+  const int64_t helper_count = std::min<int64_t>(
+      {loop->chunk_count - 1, (int64_t) threads_.size(), kMaxLoopHelpers});
+  TaskGroup group;
+  std::array<LoopTask, kMaxLoopHelpers> helpers;
+  group.pending_.store(helper_count, std::memory_order_relaxed);
+  for (int64_t i = 0; i < helper_count; i++) {
+    helpers[i].run = [](Task* task) { RunChunks(static_cast<LoopTask*>(task)->loop); };
+    helpers[i].group = &group;
+    helpers[i].loop = loop;
+    Submit(&helpers[i]);
+  }
+  RunChunks(loop);
+  Wait(group);
+}
+
+void ThreadPool::Wait(const TaskGroup& group) {
+  const int32_t worker_index = CurrentWorkerIndex();
+  while (!group.Done()) {
+    Task* task = (worker_index >= 0) ? FindTask(worker_index) : TakeSharedTask(group);
+    if (task != nullptr) {
+      RunTask(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ThreadPool::Submit(Task* task) {
+  const int32_t worker_index = CurrentWorkerIndex();
+  if (worker_index < 0 || !deques_[worker_index]->Push(task)) {
+    std::scoped_lock lock(shared_queue_mutex_);
+    shared_queue_.push_back(task);
+    shared_queue_size_.fetch_add(1, std::memory_order_relaxed);
+  }
+  WakeWorker();
+}
+
+ThreadPool::Task* ThreadPool::FindTask(int32_t worker_index) {
+  if (worker_index >= 0) {
+    if (Task* task = deques_[worker_index]->Pop(); task != nullptr) { return task; }
+  }
+  if (shared_queue_size_.load(std::memory_order_relaxed) > 0) {
+    std::scoped_lock lock(shared_queue_mutex_);
+    if (!shared_queue_.empty()) {
+      Task* task = shared_queue_.front();
+      shared_queue_.pop_front();
+      shared_queue_size_.fetch_sub(1, std::memory_order_relaxed);
+      return task;
+    }
+  }
+  // NOTE: start with the next sibling, so thieves spread out over the victims.
+  const int32_t deque_count = deques_.size();
+  for (int32_t i = 1; i <= deque_count; i++) {
+    const int32_t victim = (std::max(worker_index, 0) + i) % deque_count;
+    if (victim == worker_index) { continue; }
+    if (Task* task = deques_[victim]->Steal(); task != nullptr) { return task; }
+  }
+  return nullptr;
+}
+
+ThreadPool::Task* ThreadPool::TakeSharedTask(const TaskGroup& group) {
+  if (shared_queue_size_.load(std::memory_order_relaxed) == 0) { return nullptr; }
+  std::scoped_lock lock(shared_queue_mutex_);
+  auto it = std::find_if(
+      shared_queue_.begin(), shared_queue_.end(), [&](const Task* task) { return task->group == &group; });
+  if (it == shared_queue_.end()) { return nullptr; }
+  Task* task = *it;
+  shared_queue_.erase(it);
+  shared_queue_size_.fetch_sub(1, std::memory_order_relaxed);
+  return task;
+}
+
+// NOTE: the fence pairs with the one in WorkerLoop: either the submitter sees the sleeper,
+// or the sleeper sees the submitted task when it checks again before waiting.
+void ThreadPool::WakeWorker() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_count_.load(std::memory_order_relaxed) == 0) { return; }
+  {
+    std::scoped_lock lock(sleep_mutex_);
+    wake_generation_++;
+  }
+  cv_.notify_one();
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_index) {
+  current_pool = this;
+  current_worker_index = worker_index;
+  int32_t failed_attempts = 0;
+  while (true) {
+    Task* task = FindTask(worker_index);
+    if (task != nullptr) {
+      RunTask(task);
+      failed_attempts = 0;
+      continue;
+    }
+    if (++failed_attempts < kSpinCount) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (terminate_) { break; }
+    const uint64_t wake_generation = wake_generation_;
+    sleeping_count_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    task = FindTask(worker_index);
+    if (task == nullptr) {
+      cv_.wait(lock, [&]() { return terminate_ || wake_generation_ != wake_generation; });
+    }
+    sleeping_count_.fetch_sub(1, std::memory_order_relaxed);
+    lock.unlock();
+    if (task != nullptr) { RunTask(task); }
+    failed_attempts = 0;
+  }
+}
+
+int32_t ThreadPool::CurrentWorkerIndex() const {
+  return (current_pool == this) ? current_worker_index : -1;
+}
@@ -1,85 +1,171 @@
 #ifndef SRC_COMMON_WORKER_POOL_H_
 #define SRC_COMMON_WORKER_POOL_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "absl/log/check.h"
+
+// Work stealing thread pool. Each worker owns a lock-free deque it pushes to and pops from
+// (LIFO, so nested work stays cache hot), and steals from the other end of its siblings'
+// deques (FIFO, so the oldest / largest pieces of work move) when it runs out. Threads
+// outside of the pool submit through a shared, mutex guarded queue.
 class ThreadPool {
  public:
-  explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency()) :
-      threads_(),
-      work_queue_(),
-      work_queue_mutex_(),
-      cv_(),
-      terminate_(false) {
-    threads_.reserve(thread_count);
-    for (size_t i = 0; i < thread_count; i++) {
-      threads_.emplace_back(&ThreadPool::ThreadPoll, this);
-    }
-  }
+  // Counts outstanding tasks so that a caller can Wait on them.
+  class TaskGroup {
+   public:
+    bool Done() const { return pending_.load(std::memory_order_acquire) == 0; }
 
-  ~ThreadPool() {
-    {
-      std::scoped_lock lock(work_queue_mutex_);
-      terminate_ = true;
-    }
-    cv_.notify_all();
-    for (std::thread& thread : threads_) {
-      thread.join();
-    }
-  }
+   private:
+    friend class ThreadPool;
+    std::atomic<int64_t> pending_ = 0;
+  };
 
+  explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t ThreadCount() const;
+
+  // Runs fn(args...) on some worker, returning its result through a future. For coarse,
+  // independent pieces of work, see ParallelFor for fine grained loops.
   template <typename F, typename... Args>
   std::future<std::invoke_result_t<F, Args...>>
   Push(F&& fn, Args&&... args) {
     using RetType = std::invoke_result_t<F, Args...>;
-    std::future<RetType> future;
-    {
-        std::scoped_lock lock(work_queue_mutex_);
-
-        auto promise = std::make_shared<std::promise<RetType>>();
-        future = promise->get_future();
-
-        work_queue_.emplace([promise = std::move(promise),
-                             fn = std::forward<F>(fn),
-                             ... args = std::forward<Args>(args)]() {
-          if constexpr (std::is_same<RetType, void>::value) {
-              std::invoke(fn, args...);
-              promise->set_value();
-          } else {
-              promise->set_value(std::invoke(fn, args...));
-          }
-        });
-    }
-    cv_.notify_one();
+    std::promise<RetType> promise;
+    std::future<RetType> future = promise.get_future();
+    // NOTE: args are moved into the call so that they are released before the
+    // promise is fulfilled, rather than whenever the closure is destroyed.
+    auto closure = [promise = std::move(promise),
+                    fn = std::forward<F>(fn),
+                    ... args = std::forward<Args>(args)]() mutable {
+      if constexpr (std::is_same<RetType, void>::value) {
+        std::invoke(fn, std::move(args)...);
+        promise.set_value();
+      } else {
+        promise.set_value(std::invoke(fn, std::move(args)...));
+      }
+    };
+    Submit(new ClosureTask<decltype(closure)>(std::move(closure)));
     return future;
   }
 
+  // Calls fn(i) for every i in [begin, end), split into chunks of grain indices that are
+  // handed out to idle workers as they ask for them. Blocks until every call has returned,
+  // running chunks on the calling thread in the meantime. Safe to nest, a worker calling
+  // ParallelFor only offers its chunks to siblings that are idle.
+  // NOTE: allocates nothing, the per-loop state lives on the caller's stack.
+  template <typename F>
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain, const F& fn) {
+    DCHECK(grain > 0);
+    if (begin >= end) { return; }
+    LoopState loop = {
+      .run_chunk = [](const void* fn, int64_t chunk_begin, int64_t chunk_end) {
+        for (int64_t i = chunk_begin; i < chunk_end; i++) { (*static_cast<const F*>(fn))(i); }
+      },
+      .fn = &fn,
+      .begin = begin,
+      .end = end,
+      .grain = grain,
+      .chunk_count = (end - begin + grain - 1) / grain,
+    };
+    RunLoop(&loop);
+  }
+
+  // Runs queued tasks on the calling thread until every task in group has finished.
+  // NOTE: threads outside of the pool only run group's own tasks. Anything else in the shared
+  // queue may be long running, or blocked on the caller.
+  void Wait(const TaskGroup& group);
+
  private:
-  void ThreadPoll() {
-    while (true) {
-      std::function<void(void)> work;
-      {
-        std::unique_lock<std::mutex> lock(work_queue_mutex_);
-        cv_.wait(lock, [&]() { return terminate_ || !work_queue_.empty(); });
-        if (terminate_ && work_queue_.empty()) { break; }
-        work = work_queue_.front();
-        work_queue_.pop();
-      }
-      work();
+  // NOTE: intrusive and type erased, so that ParallelFor's tasks need no allocations.
+  struct Task {
+    void (*run)(Task* task);
+    TaskGroup* group;
+  };
+
+  template <typename Closure>
+  struct ClosureTask : Task {
+    explicit ClosureTask(Closure closure) : Task{&Run, nullptr}, closure(std::move(closure)) {}
+    static void Run(Task* task) {
+      auto* self = static_cast<ClosureTask*>(task);
+      self->closure();
+      delete self;
     }
-  }
+    Closure closure;
+  };
+
+  struct LoopState {
+    void (*run_chunk)(const void* fn, int64_t chunk_begin, int64_t chunk_end);
+    const void* fn;
+    int64_t begin;
+    int64_t end;
+    int64_t grain;
+    int64_t chunk_count;
+    std::atomic<int64_t> next_chunk = 0;
+  };
+
+  struct LoopTask : Task {
+    LoopState* loop;
+  };
+
+  // Chase-Lev deque of fixed capacity. Only the owning worker may Push / Pop, any thread
+  // may Steal.
+  class TaskDeque {
+   public:
+    // NOTE: returns false if the deque is full.
+    bool Push(Task* task);
+    Task* Pop();
+    Task* Steal();
+
+   private:
+    static constexpr int64_t kCapacity = 1024;
+    alignas(64) std::atomic<int64_t> top_ = 0;
+    alignas(64) std::atomic<int64_t> bottom_ = 0;
+    std::array<std::atomic<Task*>, kCapacity> tasks_ = {};
+  };
+
+  // NOTE: bounds the per-loop helper tasks, which live on the caller's stack.
+  static constexpr int32_t kMaxLoopHelpers = 64;
+
+  static void RunTask(Task* task);
+  static void RunChunks(LoopState* loop);
+  void RunLoop(LoopState* loop);
+  void Submit(Task* task);
+  // NOTE: worker_index is -1 for threads outside of the pool.
+  Task* FindTask(int32_t worker_index);
+  // Removes one of group's tasks from the shared queue, if any are still there.
+  Task* TakeSharedTask(const TaskGroup& group);
+  void WakeWorker();
+  void WorkerLoop(int32_t worker_index);
+  // Index of the calling thread in this pool, or -1.
+  int32_t CurrentWorkerIndex() const;
 
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
   std::vector<std::thread> threads_;
-  std::queue<std::function<void(void)>> work_queue_;
-  std::mutex work_queue_mutex_;
+  std::deque<Task*> shared_queue_;
+  std::mutex shared_queue_mutex_;
+  std::atomic<int64_t> shared_queue_size_;
+  // NOTE: idle workers sleep on cv_, and are only notified if there are any.
+  std::mutex sleep_mutex_;
   std::condition_variable cv_;
+  std::atomic<int32_t> sleeping_count_;
+  uint64_t wake_generation_;
   bool terminate_;
 };
 
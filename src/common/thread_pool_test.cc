@@ -0,0 +1,63 @@
+#include "src/common/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+TEST(ThreadPoolTest, PushReturnsResult) {
+  ThreadPool thread_pool(4);
+  std::vector<std::future<int32_t>> futures;
+  for (int32_t i = 0; i < 100; i++) {
+    futures.push_back(thread_pool.Push([](int32_t x) { return x * x; }, i));
+  }
+  for (int32_t i = 0; i < 100; i++) { EXPECT_EQ(futures[i].get(), i * i); }
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEachIndexOnce) {
+  ThreadPool thread_pool(4);
+  std::vector<std::atomic<int32_t>> visits(1000);
+  thread_pool.ParallelFor(0, visits.size(), /*grain=*/7, [&](int64_t i) { visits[i]++; });
+  for (const std::atomic<int32_t>& count : visits) { EXPECT_EQ(count, 1); }
+}
+
+TEST(ThreadPoolTest, NestedParallelFor) {
+  ThreadPool thread_pool(4);
+  std::atomic<int64_t> sum = 0;
+  thread_pool.ParallelFor(0, 16, /*grain=*/1, [&](int64_t i) {
+    thread_pool.ParallelFor(0, 100, /*grain=*/10, [&](int64_t j) { sum += i * j; });
+  });
+  EXPECT_EQ(sum, 120 * 4950);
+}
+
+TEST(ThreadPoolTest, ParallelForInsidePushedTask) {
+  ThreadPool thread_pool(2);
+  std::future<int64_t> future = thread_pool.Push([&thread_pool]() {
+    std::atomic<int64_t> sum = 0;
+    thread_pool.ParallelFor(0, 1000, /*grain=*/1, [&](int64_t i) { sum += i; });
+    return sum.load();
+  });
+  EXPECT_EQ(future.get(), 499500);
+}
+
+// NOTE: the first task occupies the only worker, the second stays queued ahead of the loop's
+// helper. Both wait on the loop, so the loop must finish without running them inline.
+TEST(ThreadPoolTest, OutsideParallelForOnlyRunsItsOwnTasks) {
+  ThreadPool thread_pool(1);
+  std::promise<void> loop_done;
+  std::shared_future<void> loop_done_future = loop_done.get_future().share();
+  std::vector<std::future<bool>> blocked_tasks;
+  for (int32_t i = 0; i < 2; i++) {
+    blocked_tasks.push_back(thread_pool.Push([loop_done_future]() {
+      return loop_done_future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    }));
+  }
+  std::atomic<int64_t> sum = 0;
+  thread_pool.ParallelFor(0, 1000, /*grain=*/1, [&](int64_t i) { sum += i; });
+  loop_done.set_value();
+  EXPECT_EQ(sum, 499500);
+  for (std::future<bool>& blocked_task : blocked_tasks) { EXPECT_TRUE(blocked_task.get()); }
+}
@@ -0,0 +1,150 @@
+#include "src/distributed/gradient_all_reducer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "src/common/matrix.h"
+#include "src/distributed/ring_all_reduce.h"
+
+template <typename T>
+GradientAllReducer<T>::GradientAllReducer(
+    RingAllReduce* ring, const Gradients& gradients, int64_t bucket_bytes) :
+  ring_(ring),
+  buckets_(),
+  layer_buckets_(gradients.size()),
+  buffer_(),
+  mutex_(),
+  cv_(),
+  gradients_(nullptr),
+  pending_layer_counts_(),
+  next_bucket_(0),
+  status_(absl::OkStatus()),
+  stop_(false),
+  reducer_() {
+    DCHECK(ring_ != nullptr);
+    DCHECK(!gradients.empty());
+    int64_t largest_bucket_size = 0;
+    int64_t bucket_size = 0;
+    int32_t end_layer = gradients.size();
+    for (int32_t i = gradients.size() - 1; i >= 0; i--) {
+      bucket_size += gradients[i].first.Elements().size() + gradients[i].second.Elements().size();
+      layer_buckets_[i] = buckets_.size();
+      if ((int64_t) (bucket_size * sizeof(T)) >= bucket_bytes || i == 0) {
+        buckets_.push_back(Bucket { .first_layer = i, .end_layer = end_layer });
+        largest_bucket_size = std::max(largest_bucket_size, bucket_size);
+        bucket_size = 0;
+        end_layer = i;
+      }
+    }
+    buffer_.resize(largest_bucket_size);
+    pending_layer_counts_.resize(buckets_.size());
+    reducer_ = std::thread(&GradientAllReducer::ReduceLoop, this);
+  }
+
+template <typename T>
+GradientAllReducer<T>::~GradientAllReducer() {
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  reducer_.join();
+}
+
+template <typename T>
+void GradientAllReducer<T>::Start(Gradients* gradients) {
+  DCHECK(gradients != nullptr && gradients->size() == layer_buckets_.size());
+  {
+    std::scoped_lock lock(mutex_);
+    DCHECK(gradients_ == nullptr) << "Started before the last gradients were reduced.";
+    gradients_ = gradients;
+    next_bucket_ = 0;
+    for (int32_t i = 0; i < buckets_.size(); i++) {
+      pending_layer_counts_[i] = buckets_[i].end_layer - buckets_[i].first_layer;
+    }
+  }
+  cv_.notify_all();
+}
+
+template <typename T>
+void GradientAllReducer<T>::LayerReady(int32_t layer) {
+  bool bucket_ready;
+  {
+    std::scoped_lock lock(mutex_);
+    DCHECK(gradients_ != nullptr);
+    DCHECK(pending_layer_counts_[layer_buckets_[layer]] > 0);
+    bucket_ready = (--pending_layer_counts_[layer_buckets_[layer]] == 0);
+  }
+  if (bucket_ready) { cv_.notify_all(); }
+}
+
+template <typename T>
+absl::Status GradientAllReducer<T>::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return gradients_ == nullptr; });
+  return std::exchange(status_, absl::OkStatus());
+}
+
+template <typename T>
+int32_t GradientAllReducer<T>::BucketCount() const { return buckets_.size(); }
+
+// NOTE: once a bucket fails the ring is unusable, so the remaining ones are only waited on.
+template <typename T>
+void GradientAllReducer<T>::ReduceLoop() {
+  while (true) {
+    Gradients* gradients;
+    int32_t bucket;
+    bool failed;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      // NOTE: started gradients are finished even when stopping.
+      cv_.wait(lock, [&]() {
+        return (gradients_ == nullptr) ? stop_ : pending_layer_counts_[next_bucket_] == 0;
+      });
+      if (gradients_ == nullptr) { return; }
+      gradients = gradients_;
+      bucket = next_bucket_;
+      failed = !status_.ok();
+    }
+    absl::Status status = failed ? absl::OkStatus() : ReduceBucket(buckets_[bucket], gradients);
+    if (!status.ok()) { LOG(ERROR) << "Failed to all-reduce gradients: " << status; }
+    {
+      std::scoped_lock lock(mutex_);
+      if (status_.ok()) { status_ = std::move(status); }
+      if (++next_bucket_ == buckets_.size()) { gradients_ = nullptr; }
+    }
+    cv_.notify_all();
+  }
+}
+
+template <typename T>
+absl::Status GradientAllReducer<T>::ReduceBucket(const Bucket& bucket, Gradients* gradients) {
+  T* data = buffer_.data();
+  for (int32_t i = bucket.first_layer; i < bucket.end_layer; i++) {
+    for (const Matrix* gradient : { &(*gradients)[i].first, &(*gradients)[i].second }) {
+      std::memcpy(data, gradient->Elements().data(), gradient->Elements().size() * sizeof(T));
+      data += gradient->Elements().size();
+    }
+  }
+  absl::Status status = ring_->AllReduce(buffer_.data(), data - buffer_.data());
+  if (!status.ok()) { return status; }
+  data = buffer_.data();
+  for (int32_t i = bucket.first_layer; i < bucket.end_layer; i++) {
+    for (Matrix* gradient : { &(*gradients)[i].first, &(*gradients)[i].second }) {
+      std::memcpy(gradient->MutableData(), data, gradient->Elements().size() * sizeof(T));
+      data += gradient->Elements().size();
+    }
+  }
+  return absl::OkStatus();
+}
+
+template class GradientAllReducer<float>;
+template class GradientAllReducer<double>;
@@ -0,0 +1,73 @@
+#ifndef SRC_DISTRIBUTED_GRADIENT_ALL_REDUCER_H_
+#define SRC_DISTRIBUTED_GRADIENT_ALL_REDUCER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "src/common/matrix.h"
+#include "src/distributed/ring_all_reduce.h"
+
+// Sums a model's gradients across the processes of a RingAllReduce on a background thread,
+// in buckets of consecutive layers. Back propagation finalizes layers back to front, so the
+// last layers' buckets are exchanged while the earlier layers are still being computed, and
+// small layers share a bucket so they only pay for the ring's per step latency once.
+// NOTE: buckets are always reduced back to front, so every process reduces them in the same
+// order whatever order its layers become ready in.
+template <typename T>
+class GradientAllReducer {
+ public:
+  using Matrix = ::Matrix<T>;
+  using Gradients = std::vector<std::pair<Matrix, Matrix>>;
+
+  // NOTE: gradients only gives the shapes of the layers. A bucket is closed once it holds at
+  // least bucket_bytes of gradients, 0 giving every layer its own.
+  GradientAllReducer(RingAllReduce* ring, const Gradients& gradients, int64_t bucket_bytes);
+  // NOTE: finishes reducing the last started gradients first.
+  ~GradientAllReducer();
+  GradientAllReducer(const GradientAllReducer&) = delete;
+  GradientAllReducer& operator=(const GradientAllReducer&) = delete;
+
+  // Reduces gradients in place, each bucket as soon as all of its layers are marked ready.
+  void Start(Gradients* gradients);
+  // NOTE: may be called from any thread, once the layer's gradients are final.
+  void LayerReady(int32_t layer);
+  // Blocks until every bucket has been reduced, returning the first error since the last
+  // call. Gradients aren't all reduced if it failed.
+  absl::Status Wait();
+  int32_t BucketCount() const;
+
+ private:
+  // NOTE: layers [first_layer, end_layer).
+  struct Bucket {
+    int32_t first_layer;
+    int32_t end_layer;
+  };
+
+  void ReduceLoop();
+  absl::Status ReduceBucket(const Bucket& bucket, Gradients* gradients);
+
+  RingAllReduce* ring_;
+  std::vector<Bucket> buckets_;
+  std::vector<int32_t> layer_buckets_;
+  // NOTE: a whole bucket is packed into the buffer so that it's reduced in one call.
+  std::vector<T> buffer_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  // NOTE: null while no gradients are being reduced.
+  Gradients* gradients_;
+  std::vector<int32_t> pending_layer_counts_;
+  int32_t next_bucket_;
+  absl::Status status_;
+  bool stop_;
+  std::thread reducer_;
+};
+
+extern template class GradientAllReducer<float>;
+extern template class GradientAllReducer<double>;
+
+#endif
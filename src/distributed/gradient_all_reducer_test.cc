@@ -0,0 +1,53 @@
+#include "src/distributed/gradient_all_reducer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/distributed/ring_all_reduce.h"
+#include "src/distributed/test_util.h"
+
+// NOTE: 3 layers of 2 + 1, 3 + 1 and 2 + 1 elements, every element rank + 1.
+std::vector<std::pair<Matrix<float>, Matrix<float>>> RankGradients(int32_t rank) {
+  std::vector<std::pair<Matrix<float>, Matrix<float>>> gradients;
+  for (int32_t size : {2, 3, 2}) {
+    gradients.emplace_back(
+        Matrix<float>(1, size, std::vector<float>(size, rank + 1)),
+        Matrix<float>(1, 1, std::vector<float>(1, rank + 1)));
+  }
+  return gradients;
+}
+
+TEST(GradientAllReducerTest, ReducesBucketsAsLayersBecomeReady) {
+  absl::StatusOr<LocalRing> local_ring = ListenOnLoopback(2);
+  ASSERT_TRUE(local_ring.ok()) << local_ring.status();
+  std::vector<std::thread> ranks;
+  for (int32_t rank = 0; rank < 2; rank++) {
+    ranks.emplace_back([&, rank]() {
+      absl::StatusOr<RingAllReduce> ring = RingAllReduce::Connect(
+          local_ring->peers, rank, std::move(local_ring->listeners[rank]));
+      ASSERT_TRUE(ring.ok()) << ring.status();
+      std::vector<std::pair<Matrix<float>, Matrix<float>>> gradients = RankGradients(rank);
+      // NOTE: the last two layers fill a 20 byte bucket, the first layer is left on its own.
+      GradientAllReducer<float> all_reducer(&*ring, gradients, /*bucket_bytes=*/20);
+      EXPECT_EQ(all_reducer.BucketCount(), 2);
+      for (int32_t step = 0; step < 2; step++) {
+        all_reducer.Start(&gradients);
+        for (int32_t layer = 0; layer < 3; layer++) { all_reducer.LayerReady(layer); }
+        EXPECT_TRUE(all_reducer.Wait().ok());
+      }
+      // NOTE: reduced twice, (1 + 2) * 2.
+      for (const auto& [weights, biases] : gradients) {
+        for (float weight : weights.Elements()) { EXPECT_EQ(weight, 6); }
+        EXPECT_EQ(biases.ElementAt(0, 0), 6);
+      }
+    });
+  }
+  for (std::thread& rank : ranks) { rank.join(); }
+}
@@ -0,0 +1,479 @@
+#include "src/distributed/ring_all_reduce.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Socket = RingAllReduce::Socket;
+constexpr Socket kNoSocket = -1;
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+using PollFd = WSAPOLLFD;
+// NOTE: Winsock doesn't raise SIGPIPE, so there's nothing to suppress.
+constexpr int kSendFlags = 0;
+#else
+using NativeSocket = int;
+using PollFd = pollfd;
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+NativeSocket Native(Socket socket) { return static_cast<NativeSocket>(socket); }
+
+int LastSocketError() {
+#if defined(_WIN32)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+// NOTE: whether the last call failed only for now, e.g. a non-blocking socket wasn't ready.
+bool IsTransientSocketError() {
+  const int error = LastSocketError();
+#if defined(_WIN32)
+  return error == WSAEINTR || error == WSAEWOULDBLOCK;
+#else
+  return error == EINTR || error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+absl::Status SocketError(absl::string_view what, absl::string_view peer) {
+#if defined(_WIN32)
+  return absl::UnavailableError(absl::StrCat(what, " ", peer, ": Winsock error ", LastSocketError()));
+#else
+  return absl::UnavailableError(absl::StrCat(what, " ", peer, ": ", std::strerror(LastSocketError())));
+#endif
+}
+
+// NOTE: Winsock must be started before any other call, it's left running until exit.
+absl::Status StartSockets() {
+#if defined(_WIN32)
+  static const int error = []() {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data);
+  }();
+  if (error != 0) { return absl::UnavailableError(absl::StrCat("Error starting Winsock: ", error)); }
+#endif
+  return absl::OkStatus();
+}
+
+Socket OpenSocket(int family) {
+  const NativeSocket socket_handle = socket(family, SOCK_STREAM, IPPROTO_TCP);
+#if defined(_WIN32)
+  if (socket_handle == INVALID_SOCKET) { return kNoSocket; }
+#else
+  if (socket_handle < 0) { return kNoSocket; }
+#endif
+  return socket_handle;
+}
+
+void CloseSocket(Socket socket) {
+  if (socket == kNoSocket) { return; }
+#if defined(_WIN32)
+  closesocket(Native(socket));
+#else
+  close(Native(socket));
+#endif
+}
+
+Socket AcceptSocket(Socket listen_socket) {
+  const NativeSocket socket_handle = accept(Native(listen_socket), nullptr, nullptr);
+#if defined(_WIN32)
+  if (socket_handle == INVALID_SOCKET) { return kNoSocket; }
+#else
+  if (socket_handle < 0) { return kNoSocket; }
+#endif
+  return socket_handle;
+}
+
+// NOTE: sends / receives up to size bytes, returning how many, or -1 on error.
+int64_t SendSome(Socket socket, const void* data, int64_t size) {
+#if defined(_WIN32)
+  return send(
+      Native(socket), static_cast<const char*>(data),
+      (int) std::min<int64_t>(size, INT32_MAX), kSendFlags);
+#else
+  return send(Native(socket), data, size, kSendFlags);
+#endif
+}
+
+int64_t RecvSome(Socket socket, void* data, int64_t size) {
+#if defined(_WIN32)
+  return recv(Native(socket), static_cast<char*>(data), (int) std::min<int64_t>(size, INT32_MAX), 0);
+#else
+  return recv(Native(socket), data, size, 0);
+#endif
+}
+
+int PollSockets(PollFd* poll_fds, int32_t count, int timeout_ms) {
+#if defined(_WIN32)
+  return WSAPoll(poll_fds, count, timeout_ms);
+#else
+  return poll(poll_fds, count, timeout_ms);
+#endif
+}
+
+PollFd PollFor(Socket socket, short events) {
+  PollFd poll_fd = {};
+  poll_fd.fd = Native(socket);
+  poll_fd.events = events;
+  return poll_fd;
+}
+
+absl::StatusOr<std::pair<std::string, std::string>> SplitHostPort(const std::string& peer) {
+  const size_t colon = peer.rfind(':');
+  int32_t port;
+  if (colon == std::string::npos || !absl::SimpleAtoi(peer.substr(colon + 1), &port)) {
+    return absl::InvalidArgumentError(absl::StrCat("Peer must be a host:port, got: ", peer));
+  }
+  return std::make_pair(peer.substr(0, colon), peer.substr(colon + 1));
+}
+
+// NOTE: the caller frees the result with freeaddrinfo.
+absl::StatusOr<addrinfo*> Resolve(const std::string& peer, bool passive) {
+  absl::StatusOr<std::pair<std::string, std::string>> host_port = SplitHostPort(peer);
+  if (!host_port.ok()) { return host_port.status(); }
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  addrinfo* addresses = nullptr;
+  const int error = getaddrinfo(
+      host_port->first.empty() ? nullptr : host_port->first.c_str(),
+      host_port->second.c_str(), &hints, &addresses);
+  if (error != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error resolving peer ", peer, ": ", gai_strerror(error)));
+  }
+  return addresses;
+}
+
+// NOTE: the peer may not be listening yet, so refused connections are retried.
+absl::StatusOr<Socket> ConnectWithRetry(
+    const std::string& peer, std::chrono::steady_clock::time_point deadline) {
+  absl::StatusOr<addrinfo*> addresses = Resolve(peer, /*passive=*/false);
+  if (!addresses.ok()) { return addresses.status(); }
+  while (true) {
+    Socket socket = OpenSocket((*addresses)->ai_family);
+    if (socket != kNoSocket &&
+        connect(Native(socket), (*addresses)->ai_addr, (*addresses)->ai_addrlen) == 0) {
+      freeaddrinfo(*addresses);
+      return socket;
+    }
+    absl::Status status = SocketError("Error connecting to", peer);
+    CloseSocket(socket);
+    if (std::chrono::steady_clock::now() >= deadline) {
+      freeaddrinfo(*addresses);
+      return status;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+absl::StatusOr<Socket> AcceptWithTimeout(
+    Socket listen_socket, const std::string& peer, std::chrono::steady_clock::time_point deadline) {
+  PollFd poll_fd = PollFor(listen_socket, POLLIN);
+  const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now());
+  const int ready = PollSockets(&poll_fd, 1, std::max<int64_t>(remaining.count(), 0));
+  if (ready < 0) { return SocketError("Error accepting on", peer); }
+  if (ready == 0) {
+    return absl::DeadlineExceededError(
+        absl::StrCat("Timed out waiting for the previous rank to connect to ", peer));
+  }
+  const Socket socket = AcceptSocket(listen_socket);
+  if (socket == kNoSocket) { return SocketError("Error accepting on", peer); }
+  return socket;
+}
+
+// NOTE: blocking, only used while connecting.
+absl::Status WriteAll(Socket socket, const void* data, int64_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const int64_t written = SendSome(socket, bytes, size);
+    if (written < 0 && IsTransientSocketError()) { continue; }
+    if (written <= 0) { return SocketError("Error writing to", "the next rank"); }
+    bytes += written;
+    size -= written;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadAll(Socket socket, void* data, int64_t size) {
+  char* bytes = static_cast<char*>(data);
+  while (size > 0) {
+    const int64_t read = RecvSome(socket, bytes, size);
+    if (read < 0 && IsTransientSocketError()) { continue; }
+    if (read == 0) { return absl::UnavailableError("The previous rank closed its connection."); }
+    if (read < 0) { return SocketError("Error reading from", "the previous rank"); }
+    bytes += read;
+    size -= read;
+  }
+  return absl::OkStatus();
+}
+
+void SetSocketOptions(Socket socket) {
+  const int enable = 1;
+  setsockopt(
+      Native(socket), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable),
+      sizeof(enable));
+#if defined(_WIN32)
+  u_long non_blocking = 1;
+  ioctlsocket(Native(socket), FIONBIO, &non_blocking);
+#else
+  fcntl(Native(socket), F_SETFL, fcntl(Native(socket), F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+absl::Status CheckRank(const std::vector<std::string>& peers, int32_t rank) {
+  if (rank < 0 || rank >= (int32_t) peers.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Rank ", rank, " is out of range of the ", peers.size(), " peers."));
+  }
+  return absl::OkStatus();
+}
+
+} // namespace
+
+// NOTE: SO_REUSEADDR lets a restarted rank listen again while its old connections linger
+// in TIME_WAIT. Winsock doesn't hold ports in TIME_WAIT, and its SO_REUSEADDR would let
+// another socket take the port, so it isn't set there.
+absl::StatusOr<RingAllReduce::Listener> RingAllReduce::Listener::Listen(const std::string& address) {
+  absl::Status status = StartSockets();
+  if (!status.ok()) { return status; }
+  absl::StatusOr<addrinfo*> addresses = Resolve(address, /*passive=*/true);
+  if (!addresses.ok()) { return addresses.status(); }
+  Listener listener(OpenSocket((*addresses)->ai_family));
+#if !defined(_WIN32)
+  const int enable = 1;
+  const bool reuse_address = listener.socket_ != kNoSocket &&
+    setsockopt(Native(listener.socket_), SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == 0;
+#else
+  const bool reuse_address = true;
+#endif
+  if (listener.socket_ == kNoSocket || !reuse_address ||
+      bind(Native(listener.socket_), (*addresses)->ai_addr, (*addresses)->ai_addrlen) != 0 ||
+      listen(Native(listener.socket_), 1) != 0) {
+    status = SocketError("Error listening on", address);
+    freeaddrinfo(*addresses);
+    return status;
+  }
+  freeaddrinfo(*addresses);
+  return listener;
+}
+
+RingAllReduce::Listener::~Listener() { CloseSocket(socket_); }
+
+RingAllReduce::Listener::Listener(Listener&& other) :
+  socket_(std::exchange(other.socket_, kNoSocket)) {}
+
+RingAllReduce::Listener& RingAllReduce::Listener::operator=(Listener&& other) {
+  if (this != &other) {
+    CloseSocket(socket_);
+    socket_ = std::exchange(other.socket_, kNoSocket);
+  }
+  return *this;
+}
+
+int32_t RingAllReduce::Listener::Port() const {
+  sockaddr_storage address = {};
+  socklen_t address_size = sizeof(address);
+  if (getsockname(Native(socket_), reinterpret_cast<sockaddr*>(&address), &address_size) != 0) {
+    return 0;
+  }
+  if (address.ss_family == AF_INET6) {
+    return ntohs(reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port);
+  }
+  return ntohs(reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+}
+
+absl::StatusOr<RingAllReduce> RingAllReduce::Connect(
+    const std::vector<std::string>& peers, int32_t rank,
+    std::chrono::milliseconds connect_timeout) {
+  absl::Status status = CheckRank(peers, rank);
+  if (!status.ok()) { return status; }
+  if (peers.size() == 1) { return RingAllReduce(rank, 1, kNoSocket, kNoSocket); }
+  absl::StatusOr<Listener> listener = Listener::Listen(peers[rank]);
+  if (!listener.ok()) { return listener.status(); }
+  return Connect(peers, rank, *std::move(listener), connect_timeout);
+}
+
+// NOTE: every rank listens before connecting, and the kernel completes a connection before
+// it's accepted, so the ranks can't deadlock on each other while the ring forms. Each
+// connection starts with the sender's rank, to catch misconfigured peer lists.
+absl::StatusOr<RingAllReduce> RingAllReduce::Connect(
+    const std::vector<std::string>& peers, int32_t rank, Listener listener,
+    std::chrono::milliseconds connect_timeout) {
+  absl::Status status = CheckRank(peers, rank);
+  if (!status.ok()) { return status; }
+  const int32_t size = peers.size();
+  if (size == 1) { return RingAllReduce(rank, size, kNoSocket, kNoSocket); }
+  status = StartSockets();
+  if (!status.ok()) { return status; }
+  const std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + connect_timeout;
+
+  absl::StatusOr<Socket> send_socket = ConnectWithRetry(peers[(rank + 1) % size], deadline);
+  if (!send_socket.ok()) { return send_socket.status(); }
+  absl::StatusOr<Socket> recv_socket = AcceptWithTimeout(listener.socket_, peers[rank], deadline);
+  if (!recv_socket.ok()) {
+    CloseSocket(*send_socket);
+    return recv_socket.status();
+  }
+  // NOTE: owns both sockets from here on.
+  RingAllReduce ring(rank, size, *send_socket, *recv_socket);
+
+  status = WriteAll(ring.send_socket_, &rank, sizeof(rank));
+  if (!status.ok()) { return status; }
+  int32_t previous_rank;
+  status = ReadAll(ring.recv_socket_, &previous_rank, sizeof(previous_rank));
+  if (!status.ok()) { return status; }
+  if (previous_rank != (rank + size - 1) % size) {
+    return absl::FailedPreconditionError(absl::StrCat(
+          "Rank ", rank, " was connected to by rank ", previous_rank,
+          ", peers must be listed in the same order by every rank."));
+  }
+  SetSocketOptions(ring.send_socket_);
+  SetSocketOptions(ring.recv_socket_);
+  return ring;
+}
+
+RingAllReduce::~RingAllReduce() { Close(); }
+
+RingAllReduce::RingAllReduce(RingAllReduce&& other) :
+  rank_(other.rank_),
+  size_(other.size_),
+  send_socket_(std::exchange(other.send_socket_, kNoSocket)),
+  recv_socket_(std::exchange(other.recv_socket_, kNoSocket)),
+  scratch_(std::move(other.scratch_)) {}
+
+RingAllReduce& RingAllReduce::operator=(RingAllReduce&& other) {
+  if (this != &other) {
+    Close();
+    rank_ = other.rank_;
+    size_ = other.size_;
+    send_socket_ = std::exchange(other.send_socket_, kNoSocket);
+    recv_socket_ = std::exchange(other.recv_socket_, kNoSocket);
+    scratch_ = std::move(other.scratch_);
+  }
+  return *this;
+}
+
+int32_t RingAllReduce::Rank() const { return rank_; }
+
+int32_t RingAllReduce::Size() const { return size_; }
+
+// NOTE: chunk c is elements [count * c / size, count * (c + 1) / size). In step s of the
+// reduce-scatter, each rank adds the previous rank's partial sum of chunk rank - s - 1 into
+// its own, so rank r ends up with the whole sum of chunk r + 1, which the all-gather then
+// passes around the ring.
+template <typename T>
+absl::Status RingAllReduce::AllReduce(T* data, int64_t count) {
+  if (size_ == 1 || count == 0) { return absl::OkStatus(); }
+  auto chunk_begin = [&](int32_t c) { return count * c / size_; };
+  auto chunk_size = [&](int32_t c) { return chunk_begin(c + 1) - chunk_begin(c); };
+  scratch_.resize(std::max<size_t>(scratch_.size(), (count / size_ + 1) * sizeof(T)));
+  const T* received = reinterpret_cast<const T*>(scratch_.data());
+
+  for (int32_t step = 0; step < size_ - 1; step++) {
+    const int32_t send_chunk = (rank_ - step + size_) % size_;
+    const int32_t recv_chunk = (rank_ - step - 1 + 2 * size_) % size_;
+    absl::Status status = Exchange(
+        reinterpret_cast<const std::byte*>(data + chunk_begin(send_chunk)),
+        chunk_size(send_chunk) * sizeof(T),
+        scratch_.data(), chunk_size(recv_chunk) * sizeof(T));
+    if (!status.ok()) { return status; }
+    T* sum = data + chunk_begin(recv_chunk);
+    for (int64_t i = 0; i < chunk_size(recv_chunk); i++) { sum[i] += received[i]; }
+  }
+  for (int32_t step = 0; step < size_ - 1; step++) {
+    const int32_t send_chunk = (rank_ - step + 1 + size_) % size_;
+    const int32_t recv_chunk = (rank_ - step + size_) % size_;
+    absl::Status status = Exchange(
+        reinterpret_cast<const std::byte*>(data + chunk_begin(send_chunk)),
+        chunk_size(send_chunk) * sizeof(T),
+        reinterpret_cast<std::byte*>(data + chunk_begin(recv_chunk)),
+        chunk_size(recv_chunk) * sizeof(T));
+    if (!status.ok()) { return status; }
+  }
+  return absl::OkStatus();
+}
+
+// NOTE: both directions progress together, since with both in flight a blocking send could
+// wait on a rank that's itself blocked sending to us.
+absl::Status RingAllReduce::Exchange(
+    const std::byte* send_data, int64_t send_size, std::byte* recv_data, int64_t recv_size) {
+  int64_t sent = 0;
+  int64_t received = 0;
+  while (sent < send_size || received < recv_size) {
+    PollFd poll_fds[2];
+    int32_t poll_fd_count = 0;
+    if (sent < send_size) { poll_fds[poll_fd_count++] = PollFor(send_socket_, POLLOUT); }
+    if (received < recv_size) { poll_fds[poll_fd_count++] = PollFor(recv_socket_, POLLIN); }
+    if (PollSockets(poll_fds, poll_fd_count, -1) < 0) {
+      if (IsTransientSocketError()) { continue; }
+      return SocketError("Error polling", "the ring");
+    }
+    if (sent < send_size) {
+      const int64_t written = SendSome(send_socket_, send_data + sent, send_size - sent);
+      if (written >= 0) {
+        sent += written;
+      } else if (!IsTransientSocketError()) {
+        return SocketError("Error writing to", "the next rank");
+      }
+    }
+    if (received < recv_size) {
+      const int64_t read = RecvSome(recv_socket_, recv_data + received, recv_size - received);
+      if (read > 0) {
+        received += read;
+      } else if (read == 0) {
+        return absl::UnavailableError("The previous rank closed its connection.");
+      } else if (!IsTransientSocketError()) {
+        return SocketError("Error reading from", "the previous rank");
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+void RingAllReduce::Close() {
+  CloseSocket(send_socket_);
+  CloseSocket(recv_socket_);
+  send_socket_ = kNoSocket;
+  recv_socket_ = kNoSocket;
+}
+
+template absl::Status RingAllReduce::AllReduce(float* data, int64_t count);
+template absl::Status RingAllReduce::AllReduce(double* data, int64_t count);
+template absl::Status RingAllReduce::AllReduce(int64_t* data, int64_t count);
@@ -0,0 +1,89 @@
+#ifndef SRC_DISTRIBUTED_RING_ALL_REDUCE_H_
+#define SRC_DISTRIBUTED_RING_ALL_REDUCE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// Sums arrays element wise across a ring of processes connected over TCP, e.g. the
+// gradients of data parallel trainers. Each rank only sends to the next rank and receives
+// from the previous one: a reduce-scatter then an all-gather, of size - 1 steps each, which
+// pass a size'th of the array per step. So every rank sends and receives
+// 2 * (size - 1) / size of the array, however many ranks there are.
+// NOTE: every rank must make the same sequence of calls, with the same counts. Every rank
+// ends up with bitwise identical sums. Not thread safe. Uses BSD sockets, or Winsock on
+// Windows.
+class RingAllReduce {
+ public:
+  // NOTE: a POSIX file descriptor or a Winsock SOCKET, -1 if none.
+  using Socket = int64_t;
+
+  // A rank's listening socket, which can be bound ahead of connecting the ring, e.g. to
+  // port 0 so that the OS picks a free port, which then stays taken.
+  class Listener {
+   public:
+    // NOTE: address is a host:port, an empty host listening on every interface.
+    static absl::StatusOr<Listener> Listen(const std::string& address);
+    ~Listener();
+    Listener(Listener&& other);
+    Listener& operator=(Listener&& other);
+    Listener(const Listener&) = delete;
+    Listener& operator=(const Listener&) = delete;
+
+    // NOTE: the port actually bound.
+    int32_t Port() const;
+
+   private:
+    friend class RingAllReduce;
+    explicit Listener(Socket socket) : socket_(socket) {}
+
+    Socket socket_;
+  };
+
+  // Listens on peers[rank], a host:port, and connects to peers[(rank + 1) % size], retrying
+  // until connect_timeout while the other ranks start up.
+  static absl::StatusOr<RingAllReduce> Connect(
+      const std::vector<std::string>& peers, int32_t rank,
+      std::chrono::milliseconds connect_timeout = std::chrono::seconds(60));
+  // NOTE: as above, but the previous rank is accepted on listener, which peers[rank] must
+  // name, rather than on a new socket.
+  static absl::StatusOr<RingAllReduce> Connect(
+      const std::vector<std::string>& peers, int32_t rank, Listener listener,
+      std::chrono::milliseconds connect_timeout = std::chrono::seconds(60));
+  ~RingAllReduce();
+  RingAllReduce(RingAllReduce&& other);
+  RingAllReduce& operator=(RingAllReduce&& other);
+  RingAllReduce(const RingAllReduce&) = delete;
+  RingAllReduce& operator=(const RingAllReduce&) = delete;
+
+  int32_t Rank() const;
+  int32_t Size() const;
+
+  // NOTE: defined for T = float, double and int64_t.
+  template <typename T>
+  absl::Status AllReduce(T* data, int64_t count);
+
+ protected:
+  RingAllReduce(int32_t rank, int32_t size, Socket send_socket, Socket recv_socket) :
+    rank_(rank), size_(size), send_socket_(send_socket), recv_socket_(recv_socket),
+    scratch_() {}
+
+ private:
+  // Sends send_size bytes to the next rank while receiving recv_size from the previous one.
+  absl::Status Exchange(const std::byte* send, int64_t send_size, std::byte* recv, int64_t recv_size);
+  void Close();
+
+  int32_t rank_;
+  int32_t size_;
+  Socket send_socket_;
+  Socket recv_socket_;
+  // NOTE: holds the chunk being received during the reduce-scatter, reused across calls.
+  std::vector<std::byte> scratch_;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "src/distributed/ring_all_reduce.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/distributed/test_util.h"
+
+TEST(RingAllReduceTest, SumsAcrossRanks) {
+  for (int32_t size : {1, 2, 3}) {
+    absl::StatusOr<LocalRing> local_ring = ListenOnLoopback(size);
+    ASSERT_TRUE(local_ring.ok()) << local_ring.status();
+    std::vector<std::vector<double>> data(size);
+    std::vector<int64_t> totals(size);
+    std::vector<std::thread> ranks;
+    for (int32_t rank = 0; rank < size; rank++) {
+      for (int32_t i = 0; i < 10; i++) { data[rank].push_back(rank * 100 + i); }
+      totals[rank] = rank + 1;
+      ranks.emplace_back([&, rank]() {
+        absl::StatusOr<RingAllReduce> ring = RingAllReduce::Connect(
+            local_ring->peers, rank, std::move(local_ring->listeners[rank]));
+        ASSERT_TRUE(ring.ok()) << ring.status();
+        EXPECT_EQ(ring->Size(), size);
+        EXPECT_TRUE(ring->AllReduce(data[rank].data(), data[rank].size()).ok());
+        // NOTE: fewer elements than ranks.
+        EXPECT_TRUE(ring->AllReduce(&totals[rank], 1).ok());
+      });
+    }
+    for (std::thread& rank : ranks) { rank.join(); }
+    for (int32_t rank = 0; rank < size; rank++) {
+      for (int32_t i = 0; i < 10; i++) {
+        EXPECT_EQ(data[rank][i], 100 * size * (size - 1) / 2 + size * i);
+      }
+      EXPECT_EQ(totals[rank], size * (size + 1) / 2);
+    }
+  }
+}
+
+TEST(RingAllReduceTest, ListenerReportsPickedPort) {
+  absl::StatusOr<RingAllReduce::Listener> listener =
+    RingAllReduce::Listener::Listen("127.0.0.1:0");
+  ASSERT_TRUE(listener.ok()) << listener.status();
+  EXPECT_GT(listener->Port(), 0);
+}
+
+TEST(RingAllReduceTest, RejectsInvalidPeers) {
+  EXPECT_FALSE(RingAllReduce::Connect({"127.0.0.1:1234"}, 1).ok());
+  EXPECT_FALSE(RingAllReduce::Connect({"localhost", "localhost:1234"}, 0).ok());
+}
@@ -0,0 +1,21 @@
+#include "src/distributed/test_util.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/distributed/ring_all_reduce.h"
+
+absl::StatusOr<LocalRing> ListenOnLoopback(int32_t size) {
+  LocalRing ring;
+  for (int32_t rank = 0; rank < size; rank++) {
+    absl::StatusOr<RingAllReduce::Listener> listener =
+      RingAllReduce::Listener::Listen("127.0.0.1:0");
+    if (!listener.ok()) { return listener.status(); }
+    ring.peers.push_back(absl::StrCat("127.0.0.1:", listener->Port()));
+    ring.listeners.push_back(*std::move(listener));
+  }
+  return ring;
+}
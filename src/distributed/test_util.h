@@ -0,0 +1,22 @@
+#ifndef SRC_DISTRIBUTED_TEST_UTIL_H_
+#define SRC_DISTRIBUTED_TEST_UTIL_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/distributed/ring_all_reduce.h"
+
+// The peers of a ring of processes on this host, e.g. threads of a test, and each rank's
+// listener, to be handed to RingAllReduce::Connect.
+struct LocalRing {
+  std::vector<std::string> peers;
+  std::vector<RingAllReduce::Listener> listeners;
+};
+
+// NOTE: the listeners are bound to loopback ports picked by the OS, and hold on to them
+// until the ring connects, so no other process can take them meanwhile.
+absl::StatusOr<LocalRing> ListenOnLoopback(int32_t size);
+
+#endif
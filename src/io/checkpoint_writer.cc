@@ -0,0 +1,115 @@
+#include "src/io/checkpoint_writer.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "src/io/model_checkpoint.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+CheckpointWriter::CheckpointWriter(CheckpointWriterOptions options) :
+  options_(std::move(options)),
+  mutex_(),
+  cv_(),
+  pending_(nullptr),
+  writing_(false),
+  stop_(false),
+  written_count_(0),
+  status_(absl::OkStatus()),
+  writer_() {
+    DCHECK(!options_.file_path.empty());
+    DCHECK(options_.keep_last > 0);
+    writer_ = std::thread(&CheckpointWriter::WriteLoop, this);
+  }
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  writer_.join();
+}
+
+void CheckpointWriter::Write(BuildCheckpoint build_checkpoint) {
+  {
+    std::scoped_lock lock(mutex_);
+    if (pending_ != nullptr) { LOG(WARNING) << "Skipping a checkpoint, the writer is behind."; }
+    pending_ = std::move(build_checkpoint);
+  }
+  cv_.notify_all();
+}
+
+absl::Status CheckpointWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return pending_ == nullptr && !writing_; });
+  return std::exchange(status_, absl::OkStatus());
+}
+
+int64_t CheckpointWriter::WrittenCount() const {
+  std::scoped_lock lock(mutex_);
+  return written_count_;
+}
+
+// NOTE: only exits once stopped with nothing left to write.
+void CheckpointWriter::WriteLoop() {
+  while (true) {
+    BuildCheckpoint build_checkpoint;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&]() { return pending_ != nullptr || stop_; });
+      if (pending_ == nullptr) { return; }
+      build_checkpoint = std::exchange(pending_, nullptr);
+      writing_ = true;
+    }
+    absl::Status status = WriteCheckpoint(build_checkpoint());
+    if (!status.ok()) { LOG(ERROR) << "Failed to write checkpoint: " << status; }
+    {
+      std::scoped_lock lock(mutex_);
+      writing_ = false;
+      if (status.ok()) { written_count_++; }
+      if (status_.ok()) { status_ = std::move(status); }
+    }
+    cv_.notify_all();
+  }
+}
+
+// NOTE: older checkpoints shift down one suffix, file_path.<keep_last - 1> dropping off the
+// end. file_path.1 is hard linked to the current file_path rather than renamed from it, so
+// file_path keeps existing until the new checkpoint is renamed over it.
+absl::Status CheckpointWriter::WriteCheckpoint(const protos::ModelCheckpoint& checkpoint_proto) {
+  const std::string& file_path = options_.file_path;
+  std::error_code error;
+  if (options_.keep_last > 1 && std::filesystem::exists(file_path, error)) {
+    for (int32_t i = options_.keep_last - 1; i > 1; i--) {
+      const std::string older_path = absl::StrCat(file_path, ".", i - 1);
+      if (!std::filesystem::exists(older_path, error)) { continue; }
+      std::filesystem::rename(older_path, absl::StrCat(file_path, ".", i), error);
+      if (error) {
+        return absl::InternalError(absl::StrCat(
+              "Error renaming checkpoint: ", older_path, ": ", error.message()));
+      }
+    }
+    const std::string previous_path = absl::StrCat(file_path, ".1");
+    std::filesystem::remove(previous_path, error);
+    std::filesystem::create_hard_link(file_path, previous_path, error);
+    if (error) {
+      std::filesystem::copy_file(
+          file_path, previous_path, std::filesystem::copy_options::overwrite_existing, error);
+    }
+    if (error) {
+      return absl::InternalError(absl::StrCat(
+            "Error keeping checkpoint: ", previous_path, ": ", error.message()));
+    }
+  }
+  return WriteModelCheckpoint(file_path, checkpoint_proto);
+}
@@ -0,0 +1,58 @@
+#ifndef SRC_IO_CHECKPOINT_WRITER_H_
+#define SRC_IO_CHECKPOINT_WRITER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "absl/status/status.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+struct CheckpointWriterOptions {
+  std::string file_path;
+  // NOTE: the latest checkpoint is always file_path. Up to keep_last - 1 earlier ones are
+  // kept as file_path.1 (the newest) to file_path.<keep_last - 1>.
+  int32_t keep_last = 1;
+};
+
+// Builds, serializes and writes model checkpoints on a background thread, so that training
+// only pays for snapshotting its parameters. Each checkpoint is written atomically, see
+// WriteModelCheckpoint.
+// NOTE: at most one checkpoint waits for the writer. A newer one replaces it if it hasn't
+// started yet, so a slow disk skips checkpoints rather than stalling the caller.
+class CheckpointWriter {
+ public:
+  using BuildCheckpoint = std::function<protos::ModelCheckpoint()>;
+
+  explicit CheckpointWriter(CheckpointWriterOptions options);
+  // NOTE: finishes writing the last queued checkpoint first.
+  ~CheckpointWriter();
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  // Queues the checkpoint that build_checkpoint returns, called on the writer's thread.
+  void Write(BuildCheckpoint build_checkpoint);
+  // Blocks until the last queued checkpoint is written, returning the first error since
+  // the last call.
+  absl::Status Flush();
+  int64_t WrittenCount() const;
+
+ private:
+  void WriteLoop();
+  absl::Status WriteCheckpoint(const protos::ModelCheckpoint& checkpoint_proto);
+
+  const CheckpointWriterOptions options_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  BuildCheckpoint pending_;
+  bool writing_;
+  bool stop_;
+  int64_t written_count_;
+  absl::Status status_;
+  std::thread writer_;
+};
+
+#endif
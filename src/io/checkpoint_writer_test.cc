@@ -0,0 +1,55 @@
+#include "src/io/checkpoint_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/io/model_checkpoint.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+protos::ModelCheckpoint CheckpointWithRowCount(int32_t row_count) {
+  protos::ModelCheckpoint checkpoint_proto;
+  checkpoint_proto.add_layers()->set_row_count(row_count);
+  return checkpoint_proto;
+}
+
+int32_t ReadRowCount(const std::string& file_path) {
+  absl::StatusOr<protos::ModelCheckpoint> checkpoint_proto = ReadModelCheckpoint(file_path);
+  return checkpoint_proto.ok() ? checkpoint_proto->layers(0).row_count() : -1;
+}
+
+TEST(CheckpointWriterTest, KeepsLastCheckpoints) {
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "checkpoint_writer_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  const std::string file_path = (dir / "model.pb").string();
+  {
+    CheckpointWriter writer(CheckpointWriterOptions { .file_path = file_path, .keep_last = 3 });
+    for (int32_t i = 1; i <= 4; i++) {
+      writer.Write([i]() { return CheckpointWithRowCount(i); });
+      ASSERT_TRUE(writer.Flush().ok());
+    }
+    EXPECT_EQ(writer.WrittenCount(), 4);
+    writer.Write([]() { return CheckpointWithRowCount(5); });
+  }
+  EXPECT_EQ(ReadRowCount(file_path), 5);
+  EXPECT_EQ(ReadRowCount(file_path + ".1"), 4);
+  EXPECT_EQ(ReadRowCount(file_path + ".2"), 3);
+  EXPECT_FALSE(std::filesystem::exists(file_path + ".3"));
+  EXPECT_FALSE(std::filesystem::exists(file_path + ".tmp"));
+  std::filesystem::remove_all(dir);
+}
+
+TEST(CheckpointWriterTest, FlushReturnsErrors) {
+  const std::string file_path =
+    (std::filesystem::temp_directory_path() / "checkpoint_writer_test_missing" / "model.pb").string();
+  CheckpointWriter writer(CheckpointWriterOptions { .file_path = file_path });
+  writer.Write([]() { return CheckpointWithRowCount(1); });
+  EXPECT_FALSE(writer.Flush().ok());
+  EXPECT_TRUE(writer.Flush().ok());
+  EXPECT_EQ(writer.WrittenCount(), 0);
+}
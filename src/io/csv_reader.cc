@@ -1,24 +1,56 @@
 #include "src/io/csv_reader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <iostream>
-#include <ostream>
-#include <optional>
-#include <sstream>
+#include <string>
+#include <system_error>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
-#include "src/common/matrix.h"
+#include "absl/strings/string_view.h"
+#include "src/common/thread_pool.h"
+#include "src/io/data_reader.h"
 
-absl::StatusOr<CsvReader> CsvReader::Open(std::string filename) {
-  std::ifstream file(filename);
+namespace {
+
+// NOTE: bytes read from the file at a time.
+constexpr int64_t kChunkSize = 1 << 20;
+// NOTE: lines parsed at a time, so that small batches still parse in parallel.
+constexpr int64_t kParseBlockSize = 1024;
+// NOTE: lines per ParallelFor chunk, a few 10s of KB of text for e.g. MNIST.
+constexpr int64_t kLinesPerTask = 16;
+
+// Parses "label,feature_0,...,feature_n-1" from [begin, end).
+// NOTE: from_chars doesn't allocate or consult the locale, unlike stof / stringstream.
+bool ParseLine(
+    const char* begin, const char* end, int32_t feature_count,
+    uint32_t* label, double* features) {
+  std::from_chars_result result = std::from_chars(begin, end, *label);
+  if (result.ec != std::errc()) { return false; }
+  for (int32_t i = 0; i < feature_count; i++) {
+    if (result.ptr == end || *result.ptr != ',') { return false; }
+    result = std::from_chars(result.ptr + 1, end, features[i]);
+    if (result.ec != std::errc()) { return false; }
+  }
+  return result.ptr == end;
+}
+
+}  // namespace
+
+absl::StatusOr<CsvReader> CsvReader::Open(std::string filename, ThreadPool* thread_pool) {
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
     return absl::InvalidArgumentError(
         absl::StrCat("Error opening file with path: ", filename));
   }
-  auto reader = CsvReader(std::move(file));
+  auto reader = CsvReader(std::move(file), thread_pool);
   reader.Reset();
   return reader;
 }
@@ -26,40 +58,120 @@ absl::StatusOr<CsvReader> CsvReader::Open(std::string filename) {
 void CsvReader::Reset() {
   file_.clear();
   file_.seekg(0, std::ios::beg);
-  std::string line;
-  getline(file_, line); // NOTE: eat headers
+  file_done_ = false;
+  text_.clear();
+  text_begin_ = 0;
+  line_count_ = 0;
+  next_sample_ = 0;
+  sample_count_ = 0;
+  status_ = absl::OkStatus();
+
+  // NOTE: the header names every column, so it gives the feature count up front.
+  const size_t header_size = FindLines(1);
+  if (!lines_.empty()) {
+    const char* header = text_.data() + text_begin_;
+    feature_count_ = std::count(header + lines_[0].begin, header + lines_[0].end, ',');
+  }
+  text_begin_ += header_size;
 }
 
-std::optional<std::pair<uint32_t, Matrix>>
-CsvReader::GetNextSample() {
-  std::string line;
-  if (!getline(file_, line)) {
-    return std::nullopt;
+bool CsvReader::ReadChunk() {
+  if (file_done_) { return false; }
+  text_.erase(text_.begin(), text_.begin() + text_begin_);
+  text_begin_ = 0;
+  const size_t size = text_.size();
+  text_.resize(size + kChunkSize);
+  file_.read(text_.data() + size, kChunkSize);
+  const int64_t read_size = file_.gcount();
+  text_.resize(size + read_size);
+  if (read_size < kChunkSize) { file_done_ = true; }
+  return read_size > 0;
+}
+
+size_t CsvReader::FindLines(int64_t line_count) {
+  lines_.clear();
+  size_t scan = 0;
+  while ((int64_t) lines_.size() < line_count) {
+    const char* text = text_.data() + text_begin_;
+    const size_t text_size = text_.size() - text_begin_;
+    const char* newline = (scan < text_size) ?
+      static_cast<const char*>(std::memchr(text + scan, '\n', text_size - scan)) : nullptr;
+    if (newline == nullptr && ReadChunk()) { continue; }
+
+    // NOTE: without a newline, this is the last line of the file.
+    const size_t line_end = (newline != nullptr) ? newline - text : text_size;
+    size_t end = line_end;
+    if (end > scan && text[end - 1] == '\r') { end--; }
+    line_count_++;
+    if (end > scan) { lines_.push_back(Line { .begin = scan, .end = end, .number = line_count_ }); }
+    if (newline == nullptr) { return text_size; }
+    scan = line_end + 1;
   }
-  std::stringstream stream(line);
-  std::string field;
+  return scan;
+}
 
-  uint32_t expected_class;
-  std::getline(stream, field, ',');
-  expected_class = std::stoul(field);
+void CsvReader::ParseSamples(int64_t min_samples) {
+  // NOTE: samples that haven't been returned yet are kept, at the front.
+  const int64_t kept_count = sample_count_ - next_sample_;
+  std::copy(labels_.begin() + next_sample_, labels_.begin() + sample_count_, labels_.begin());
+  std::copy(
+      features_.begin() + next_sample_ * feature_count_,
+      features_.begin() + sample_count_ * feature_count_,
+      features_.begin());
 
-  std::vector<double> input_elements;
-  while (std::getline(stream, field, ',')) {
-    input_elements.push_back(std::stof(field));
+  const size_t text_size = FindLines(min_samples - kept_count);
+  next_sample_ = 0;
+  sample_count_ = kept_count + lines_.size();
+  labels_.resize(sample_count_);
+  features_.resize(sample_count_ * feature_count_);
+
+  const char* text = text_.data() + text_begin_;
+  // NOTE: lines may be parsed out of order, so the first malformed one is the lowest.
+  std::atomic<int64_t> first_malformed = lines_.size();
+  auto parse_line = [&](int64_t i) {
+    const int64_t sample = kept_count + i;
+    if (ParseLine(
+          text + lines_[i].begin, text + lines_[i].end, feature_count_,
+          &labels_[sample], &features_[sample * feature_count_])) {
+      return;
+    }
+    int64_t malformed = first_malformed.load();
+    while (i < malformed && !first_malformed.compare_exchange_weak(malformed, i)) {}
+  };
+  if (thread_pool_ != nullptr) {
+    thread_pool_->ParallelFor(0, lines_.size(), kLinesPerTask, parse_line);
+  } else {
+    for (int64_t i = 0; i < (int64_t) lines_.size(); i++) { parse_line(i); }
   }
-  Matrix input = Matrix(1, input_elements.size(), input_elements);
+  text_begin_ += text_size;
 
-  return std::make_optional(std::make_pair(expected_class, input));
+  if (first_malformed < (int64_t) lines_.size()) {
+    const Line& line = lines_[first_malformed];
+    status_ = absl::InvalidArgumentError(absl::StrCat(
+        "Malformed CSV line ", line.number, ", expected a label and ", feature_count_,
+        " features: ", absl::string_view(text + line.begin, line.end - line.begin)));
+    sample_count_ = kept_count + first_malformed;
+    // NOTE: drops the rest of the file, so that the reader ends here.
+    file_done_ = true;
+    text_.clear();
+    text_begin_ = 0;
+  }
 }
 
-std::vector<std::pair<uint32_t, Matrix>>
-CsvReader::GetNextBatchSample(int32_t batch_size) {
-  std::vector<std::pair<uint32_t, Matrix>> batch;
-  batch.reserve(batch_size);
-  for (int32_t i = 0; i < batch_size; i++) {
-    std::optional<std::pair<uint32_t, Matrix>> sample = GetNextSample();
-    if (!sample.has_value()) { break; }
-    batch.emplace_back(*sample);
+SampleBatch CsvReader::GetNextBatch(int32_t batch_size) {
+  if (sample_count_ - next_sample_ < batch_size && status_.ok()) {
+    ParseSamples(std::max<int64_t>(batch_size, kParseBlockSize));
   }
-  return batch;
+  const SampleBatch parsed = {
+    .dtype = DatasetDtype::FLOAT64,
+    .feature_count = feature_count_,
+    .sample_count = sample_count_,
+    .labels = labels_.data(),
+    .features = reinterpret_cast<const std::byte*>(features_.data()),
+  };
+  const int64_t begin = next_sample_;
+  next_sample_ = std::min<int64_t>(next_sample_ + batch_size, sample_count_);
+  return parsed.Slice(begin, next_sample_);
 }
+
+absl::Status CsvReader::ReadStatus() const { return status_; }
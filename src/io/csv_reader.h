@@ -2,26 +2,72 @@
 #define SRC_IO_CSV_READER_H_
 
 #include <fstream>
+#include <cstddef>
 #include <cstdint>
-#include <iostream>
-#include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
-#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/io/data_reader.h"
 
-class CsvReader {
+// Reads "label,feature_0,feature_1,..." lines, after a header line, as FLOAT64 samples.
+// The file is read in large chunks, and parsed a block of lines at a time, in parallel if
+// given a thread pool.
+// NOTE: every pass re-parses the text, see BinaryDatasetReader for repeated reads. A
+// malformed line ends the data, its samples before the line still being handed out, and is
+// reported by ReadStatus.
+class CsvReader : public DataReader {
  public:
-  static absl::StatusOr<CsvReader> Open(std::string filename);
-  std::optional<std::pair<uint32_t, Matrix>> GetNextSample();
-  std::vector<std::pair<uint32_t, Matrix>> GetNextBatchSample(int32_t batch_size);
-  void Reset();
+  // NOTE: thread_pool, if any, must outlive the reader.
+  static absl::StatusOr<CsvReader> Open(std::string filename, ThreadPool* thread_pool = nullptr);
+  SampleBatch GetNextBatch(int32_t batch_size) override;
+  void Reset() override;
+  absl::Status ReadStatus() const override;
 
  protected:
-  CsvReader(std::ifstream file) : file_(std::move(file)) {}
+  CsvReader(std::ifstream file, ThreadPool* thread_pool) :
+    file_(std::move(file)), thread_pool_(thread_pool), feature_count_(0), file_done_(false),
+    text_(), text_begin_(0), line_count_(0), lines_(), labels_(), features_(),
+    next_sample_(0), sample_count_(0), status_(absl::OkStatus()) {}
 
  private:
+  // Appends the next chunk of the file to text_, first dropping the text before
+  // text_begin_. Returns false once the file is exhausted.
+  bool ReadChunk();
+  // Finds up to line_count non-empty lines from text_begin_ on, into lines_. Returns the
+  // size of the text they span.
+  size_t FindLines(int64_t line_count);
+  // Parses enough lines that at least min_samples samples are buffered, if the file
+  // holds that many. Stops at the first malformed line, setting status_.
+  void ParseSamples(int64_t min_samples);
+
+  // NOTE: [begin, end) offsets, relative to text_begin_, of a line numbered from 1.
+  struct Line {
+    size_t begin;
+    size_t end;
+    int64_t number;
+  };
+
   std::ifstream file_;
+  ThreadPool* thread_pool_;
+  int32_t feature_count_;
+  bool file_done_;
+  // NOTE: unparsed text read from the file, starting at text_begin_.
+  std::vector<char> text_;
+  size_t text_begin_;
+  // NOTE: lines found so far, empty ones and the header included.
+  int64_t line_count_;
+  // NOTE: the lines being parsed.
+  std::vector<Line> lines_;
+  // NOTE: parsed samples, of which [next_sample_, sample_count_) are yet to be returned.
+  std::vector<uint32_t> labels_;
+  std::vector<double> features_;
+  int64_t next_sample_;
+  int64_t sample_count_;
+  absl::Status status_;
 };
 
 #endif
@@ -0,0 +1,89 @@
+#include "src/io/csv_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/thread_pool.h"
+#include "src/io/data_reader.h"
+
+std::string WriteCsv(const std::string& name, const std::string& contents) {
+  const std::string file_path = (std::filesystem::temp_directory_path() / name).string();
+  std::ofstream file(file_path, std::ios::out | std::ios::binary);
+  file << contents;
+  return file_path;
+}
+
+// NOTE: reads every sample, as (label, features) rows.
+std::vector<std::vector<double>> ReadAll(CsvReader& reader, int32_t batch_size) {
+  std::vector<std::vector<double>> rows;
+  SampleBatch batch = reader.GetNextBatch(batch_size);
+  while (batch.sample_count > 0) {
+    std::vector<double> features(batch.sample_count * batch.feature_count);
+    batch.ConvertFeatures(1.0, features.data());
+    for (int64_t i = 0; i < batch.sample_count; i++) {
+      std::vector<double> row = {(double) batch.labels[i]};
+      row.insert(
+          row.end(), features.begin() + i * batch.feature_count,
+          features.begin() + (i + 1) * batch.feature_count);
+      rows.push_back(std::move(row));
+    }
+    batch = reader.GetNextBatch(batch_size);
+  }
+  return rows;
+}
+
+TEST(CsvReaderTest, ParsesLines) {
+  const std::string file_path = WriteCsv(
+      "csv_reader_test.csv", "label,a,b\r\n3,0.5,255\r\n\n1,-2,1e3");
+  absl::StatusOr<CsvReader> reader = CsvReader::Open(file_path);
+  ASSERT_TRUE(reader.ok());
+  const std::vector<std::vector<double>> expected = {{3, 0.5, 255}, {1, -2, 1000}};
+  EXPECT_EQ(ReadAll(*reader, 1), expected);
+  reader->Reset();
+  EXPECT_EQ(ReadAll(*reader, 8), expected);
+}
+
+TEST(CsvReaderTest, ParallelMatchesSerial) {
+  // NOTE: enough lines to span several parse blocks and read chunks.
+  std::string contents = "label,a,b,c\n";
+  std::vector<std::vector<double>> expected;
+  for (int32_t i = 0; i < 20000; i++) {
+    absl::StrAppend(&contents, i % 10, ",", i, ",", i * 0.25, ",", -i, "\n");
+    expected.push_back({(double) (i % 10), (double) i, i * 0.25, (double) -i});
+  }
+  const std::string file_path = WriteCsv("csv_reader_test_parallel.csv", contents);
+
+  ThreadPool thread_pool(4);
+  absl::StatusOr<CsvReader> parallel_reader = CsvReader::Open(file_path, &thread_pool);
+  absl::StatusOr<CsvReader> serial_reader = CsvReader::Open(file_path);
+  ASSERT_TRUE(parallel_reader.ok());
+  ASSERT_TRUE(serial_reader.ok());
+  EXPECT_EQ(ReadAll(*parallel_reader, 700), expected);
+  EXPECT_EQ(ReadAll(*serial_reader, 3000), expected);
+}
+
+TEST(CsvReaderTest, MalformedLineEndsTheData) {
+  std::string contents = "label,a,b\n\n";
+  for (int32_t i = 0; i < 3000; i++) { absl::StrAppend(&contents, i % 10, ",", i, ",1\n"); }
+  absl::StrAppend(&contents, "7,oops,1\n1,2,3\n");
+  const std::string file_path = WriteCsv("csv_reader_test_malformed.csv", contents);
+
+  ThreadPool thread_pool(4);
+  absl::StatusOr<CsvReader> reader = CsvReader::Open(file_path, &thread_pool);
+  ASSERT_TRUE(reader.ok());
+  EXPECT_EQ(ReadAll(*reader, 100).size(), 3000);
+  const absl::Status status = reader->ReadStatus();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_NE(status.message().find("line 3003"), std::string::npos) << status;
+
+  reader->Reset();
+  EXPECT_TRUE(reader->ReadStatus().ok());
+}
@@ -0,0 +1,24 @@
+#include "src/io/data_reader.h"
+
+#include <cstdint>
+
+#include "absl/log/check.h"
+#include "absl/strings/string_view.h"
+
+int64_t DatasetDtypeSize(DatasetDtype dtype) {
+  switch (dtype) {
+    case DatasetDtype::UINT8: return sizeof(uint8_t);
+    case DatasetDtype::FLOAT32: return sizeof(float);
+    case DatasetDtype::FLOAT64: return sizeof(double);
+    default: { CHECK(false); return 0; }
+  }
+}
+
+absl::string_view DatasetDtypeToString(DatasetDtype dtype) {
+  switch (dtype) {
+    case DatasetDtype::UINT8: return "UINT8";
+    case DatasetDtype::FLOAT32: return "FLOAT32";
+    case DatasetDtype::FLOAT64: return "FLOAT64";
+    default: { CHECK(false); return ""; }
+  }
+}
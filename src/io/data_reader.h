@@ -0,0 +1,108 @@
+#ifndef SRC_IO_DATA_READER_H_
+#define SRC_IO_DATA_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+
+// Element type of stored sample features.
+enum class DatasetDtype : uint32_t {
+  UINT8 = 0,
+  FLOAT32 = 1,
+  FLOAT64 = 2,
+};
+
+int64_t DatasetDtypeSize(DatasetDtype dtype);
+absl::string_view DatasetDtypeToString(DatasetDtype dtype);
+
+// Non-owning view of a contiguous run of samples: one label per sample, and a row-major
+// sample_count x feature_count block of features. Preprocessed batches also hold a
+// sample_count x class_count block of targets, of the same dtype, see
+// PreprocessingDataReader.
+struct SampleBatch {
+  DatasetDtype dtype;
+  int32_t feature_count;
+  int64_t sample_count;
+  const uint32_t* labels;
+  const std::byte* features;
+  // NOTE: 0 and nullptr if there are no targets.
+  int32_t class_count;
+  const std::byte* targets;
+
+  // Samples [begin, end) of this batch, viewing the same memory.
+  SampleBatch Slice(int64_t begin, int64_t end) const {
+    DCHECK(0 <= begin && begin <= end && end <= sample_count);
+    const int64_t row_size = feature_count * DatasetDtypeSize(dtype);
+    const int64_t target_row_size = class_count * DatasetDtypeSize(dtype);
+    return SampleBatch {
+      .dtype = dtype,
+      .feature_count = feature_count,
+      .sample_count = end - begin,
+      .labels = labels + begin,
+      .features = features + begin * row_size,
+      .class_count = class_count,
+      .targets = (targets != nullptr) ? targets + begin * target_row_size : nullptr,
+    };
+  }
+
+  // Converts every feature to T, multiplied by scale, into out (sample_count x feature_count).
+  template <typename T>
+  void ConvertFeatures(T scale, T* out) const {
+    Convert(features, sample_count * feature_count, scale, out);
+  }
+
+  // Converts every target to T into out (sample_count x class_count).
+  template <typename T>
+  void ConvertTargets(T* out) const {
+    DCHECK(targets != nullptr);
+    Convert(targets, sample_count * class_count, (T) 1, out);
+  }
+
+ private:
+  template <typename T>
+  void Convert(const std::byte* in, int64_t count, T scale, T* out) const {
+    switch (dtype) {
+      case DatasetDtype::UINT8: Convert(reinterpret_cast<const uint8_t*>(in), count, scale, out); break;
+      case DatasetDtype::FLOAT32: Convert(reinterpret_cast<const float*>(in), count, scale, out); break;
+      case DatasetDtype::FLOAT64: Convert(reinterpret_cast<const double*>(in), count, scale, out); break;
+    }
+  }
+
+  // NOTE: already converted data, e.g. preprocessed batches, is just copied.
+  template <typename From, typename T>
+  static void Convert(const From* in, int64_t count, T scale, T* out) {
+    if constexpr (std::is_same_v<From, T>) {
+      if (scale == (T) 1) {
+        if (count > 0) { std::memcpy(out, in, count * sizeof(T)); }
+        return;
+      }
+    }
+    for (int64_t i = 0; i < count; i++) { out[i] = (T) in[i] * scale; }
+  }
+};
+
+// Sequential reader of labeled samples, handing out batches in file order.
+class DataReader {
+ public:
+  virtual ~DataReader() = default;
+
+  // NOTE: the batch is only valid until the next call to GetNextBatch or Reset. It holds
+  // fewer than batch_size samples at the end of the data, and none once it's exhausted.
+  virtual SampleBatch GetNextBatch(int32_t batch_size) = 0;
+  // Starts again from the first sample.
+  virtual void Reset() = 0;
+  // Every sample, if they're all in memory (or mapped) for random access, e.g. to shuffle.
+  // NOTE: valid for the reader's lifetime.
+  virtual std::optional<SampleBatch> All() const { return std::nullopt; }
+  // The error that ended the data early since the last Reset, e.g. a malformed sample. The
+  // reader hands out no more batches after one, so check this once they run out.
+  virtual absl::Status ReadStatus() const { return absl::OkStatus(); }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "src/io/dataset.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/thread_pool.h"
+#include "src/io/csv_reader.h"
+#include "src/io/data_reader.h"
+#include "src/io/mapped_file.h"
+
+static constexpr uint64_t kSectionAlignment = 64;
+
+static uint64_t AlignSection(uint64_t offset) {
+  return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+absl::StatusOr<DatasetWriter> DatasetWriter::Open(
+    std::string file_path, DatasetDtype dtype, int32_t feature_count) {
+  std::ofstream file(file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file.is_open()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error opening file with path: ", file_path));
+  }
+  // NOTE: placeholder, the real header is written by Finish.
+  const std::vector<char> padding(AlignSection(sizeof(DatasetHeader)), 0);
+  file.write(padding.data(), padding.size());
+  return DatasetWriter(std::move(file), std::move(file_path), dtype, feature_count);
+}
+
+absl::Status DatasetWriter::Append(const SampleBatch& batch) {
+  if (batch.feature_count != feature_count_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Expected ", feature_count_, " features per sample, got: ", batch.feature_count));
+  }
+  // NOTE: converted through double, which represents every supported dtype exactly.
+  std::vector<double> row(feature_count_);
+  row_buffer_.resize(feature_count_ * DatasetDtypeSize(dtype_));
+  for (int64_t i = 0; i < batch.sample_count; i++) {
+    batch.Slice(i, i + 1).ConvertFeatures(1.0, row.data());
+    for (int32_t j = 0; j < feature_count_; j++) {
+      switch (dtype_) {
+        case DatasetDtype::UINT8: {
+          if (row[j] < 0 || row[j] > 255 || row[j] != std::floor(row[j])) {
+            return absl::InvalidArgumentError(absl::StrCat(
+                  "Feature ", row[j], " of sample ", labels_.size(), " can't be stored as UINT8."));
+          }
+          row_buffer_[j] = (char) (uint8_t) row[j];
+          break;
+        }
+        case DatasetDtype::FLOAT32: {
+          const float x = row[j];
+          std::memcpy(&row_buffer_[j * sizeof(float)], &x, sizeof(float));
+          break;
+        }
+        case DatasetDtype::FLOAT64: {
+          std::memcpy(&row_buffer_[j * sizeof(double)], &row[j], sizeof(double));
+          break;
+        }
+      }
+    }
+    file_.write(row_buffer_.data(), row_buffer_.size());
+    labels_.push_back(batch.labels[i]);
+  }
+  if (!file_.good()) {
+    return absl::InternalError(absl::StrCat("Error writing to file: ", file_path_));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status DatasetWriter::Finish() {
+  const uint64_t features_offset = AlignSection(sizeof(DatasetHeader));
+  const uint64_t features_end =
+    features_offset + labels_.size() * feature_count_ * DatasetDtypeSize(dtype_);
+  const uint64_t labels_offset = AlignSection(features_end);
+  const std::vector<char> padding(labels_offset - features_end, 0);
+  file_.write(padding.data(), padding.size());
+  file_.write(reinterpret_cast<const char*>(labels_.data()), labels_.size() * sizeof(uint32_t));
+
+  DatasetHeader header = {
+    .version = DatasetHeader::kVersion,
+    .dtype = dtype_,
+    .feature_count = (uint32_t) feature_count_,
+    .sample_count = labels_.size(),
+    .features_offset = features_offset,
+    .labels_offset = labels_offset,
+  };
+  std::memcpy(header.magic, DatasetHeader::kMagic, sizeof(header.magic));
+  file_.seekp(0, std::ios::beg);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.close();
+  if (file_.fail()) {
+    return absl::InternalError(absl::StrCat("Error writing to file: ", file_path_));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<BinaryDatasetReader> BinaryDatasetReader::Open(std::string file_path) {
+  absl::StatusOr<MappedFile> file = MappedFile::Open(file_path);
+  if (!file.ok()) { return file.status(); }
+
+  DatasetHeader header;
+  if (file->Size() < sizeof(header)) {
+    return absl::InvalidArgumentError(absl::StrCat("Not a dataset file: ", file_path));
+  }
+  std::memcpy(&header, file->Data(), sizeof(header));
+  if (std::memcmp(header.magic, DatasetHeader::kMagic, sizeof(header.magic)) != 0) {
+    return absl::InvalidArgumentError(absl::StrCat("Not a dataset file: ", file_path));
+  }
+  if (header.version != DatasetHeader::kVersion) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported dataset version ", header.version, " in file: ", file_path));
+  }
+  if (header.dtype != DatasetDtype::UINT8 && header.dtype != DatasetDtype::FLOAT32 &&
+      header.dtype != DatasetDtype::FLOAT64) {
+    return absl::InvalidArgumentError(absl::StrCat("Unknown dtype in file: ", file_path));
+  }
+  const uint64_t features_size =
+    header.sample_count * header.feature_count * DatasetDtypeSize(header.dtype);
+  if (header.features_offset + features_size > file->Size() ||
+      header.labels_offset + header.sample_count * sizeof(uint32_t) > file->Size()) {
+    return absl::InvalidArgumentError(absl::StrCat("Truncated dataset file: ", file_path));
+  }
+
+  const SampleBatch all = {
+    .dtype = header.dtype,
+    .feature_count = (int32_t) header.feature_count,
+    .sample_count = (int64_t) header.sample_count,
+    .labels = reinterpret_cast<const uint32_t*>(file->Data() + header.labels_offset),
+    .features = file->Data() + header.features_offset,
+  };
+  return BinaryDatasetReader(*std::move(file), all);
+}
+
+SampleBatch BinaryDatasetReader::GetNextBatch(int32_t batch_size) {
+  const int64_t begin = next_sample_;
+  next_sample_ = std::min(next_sample_ + batch_size, all_.sample_count);
+  return all_.Slice(begin, next_sample_);
+}
+
+void BinaryDatasetReader::Reset() { next_sample_ = 0; }
+
+std::optional<SampleBatch> BinaryDatasetReader::All() const { return all_; }
+
+absl::StatusOr<std::unique_ptr<DataReader>> OpenDataReader(
+    std::string file_path, ThreadPool* thread_pool) {
+  char magic[sizeof(DatasetHeader::kMagic)] = {};
+  {
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Error opening file with path: ", file_path));
+    }
+    file.read(magic, sizeof(magic));
+  }
+  if (std::memcmp(magic, DatasetHeader::kMagic, sizeof(magic)) == 0) {
+    absl::StatusOr<BinaryDatasetReader> reader = BinaryDatasetReader::Open(file_path);
+    if (!reader.ok()) { return reader.status(); }
+    return std::make_unique<BinaryDatasetReader>(*std::move(reader));
+  }
+  absl::StatusOr<CsvReader> reader = CsvReader::Open(file_path, thread_pool);
+  if (!reader.ok()) { return reader.status(); }
+  return std::make_unique<CsvReader>(*std::move(reader));
+}
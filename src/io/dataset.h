@@ -0,0 +1,88 @@
+#ifndef SRC_IO_DATASET_H_
+#define SRC_IO_DATASET_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/common/thread_pool.h"
+#include "src/io/data_reader.h"
+#include "src/io/mapped_file.h"
+
+// Binary dataset file layout, little endian:
+//   DatasetHeader
+//   features: sample_count x feature_count dtype elements, row-major, at features_offset
+//   labels: sample_count uint32 labels, at labels_offset
+// NOTE: both arrays start on a 64 byte boundary, so they can be used straight out of a
+// memory mapping.
+struct DatasetHeader {
+  static constexpr char kMagic[4] = {'N', 'N', 'D', 'S'};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[4];
+  uint32_t version;
+  DatasetDtype dtype;
+  uint32_t feature_count;
+  uint64_t sample_count;
+  uint64_t features_offset;
+  uint64_t labels_offset;
+};
+
+// Streams samples into a new binary dataset file.
+class DatasetWriter {
+ public:
+  static absl::StatusOr<DatasetWriter> Open(
+      std::string file_path, DatasetDtype dtype, int32_t feature_count);
+  // Appends every sample in batch, converted to the dataset's dtype.
+  // NOTE: UINT8 datasets only accept integral features in [0, 255].
+  absl::Status Append(const SampleBatch& batch);
+  // Writes the labels and header, the file is incomplete until this is called.
+  absl::Status Finish();
+
+ protected:
+  DatasetWriter(std::ofstream file, std::string file_path, DatasetDtype dtype, int32_t feature_count) :
+    file_(std::move(file)),
+    file_path_(std::move(file_path)),
+    dtype_(dtype),
+    feature_count_(feature_count) {}
+
+ private:
+  std::ofstream file_;
+  std::string file_path_;
+  DatasetDtype dtype_;
+  int32_t feature_count_;
+  // NOTE: labels are only written once the feature count is known, they're small.
+  std::vector<uint32_t> labels_;
+  std::vector<char> row_buffer_;
+};
+
+// Reads a binary dataset through a memory mapping, every batch is a view straight into
+// the mapped file so nothing is parsed or copied.
+class BinaryDatasetReader : public DataReader {
+ public:
+  static absl::StatusOr<BinaryDatasetReader> Open(std::string file_path);
+  SampleBatch GetNextBatch(int32_t batch_size) override;
+  void Reset() override;
+  std::optional<SampleBatch> All() const override;
+
+ protected:
+  BinaryDatasetReader(MappedFile file, SampleBatch all) :
+    file_(std::move(file)), all_(all), next_sample_(0) {}
+
+ private:
+  MappedFile file_;
+  SampleBatch all_;
+  int64_t next_sample_;
+};
+
+// Opens a binary dataset if the file starts with DatasetHeader::kMagic, or a CSV file
+// otherwise, parsed on thread_pool if given.
+absl::StatusOr<std::unique_ptr<DataReader>> OpenDataReader(
+    std::string file_path, ThreadPool* thread_pool = nullptr);
+
+#endif
@@ -0,0 +1,69 @@
+#include "src/io/dataset.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/io/data_reader.h"
+
+SampleBatch DoubleBatch(const std::vector<uint32_t>& labels, const std::vector<double>& features) {
+  return SampleBatch {
+    .dtype = DatasetDtype::FLOAT64,
+    .feature_count = (int32_t) (features.size() / labels.size()),
+    .sample_count = (int64_t) labels.size(),
+    .labels = labels.data(),
+    .features = reinterpret_cast<const std::byte*>(features.data()),
+  };
+}
+
+std::string TempFilePath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+class DatasetTest : public testing::TestWithParam<DatasetDtype> {};
+
+TEST_P(DatasetTest, RoundTrips) {
+  const std::string file_path = TempFilePath("dataset_test.nnds");
+  const std::vector<uint32_t> labels = {3, 1, 4};
+  const std::vector<double> features = {0, 1, 2, 253, 254, 255};
+  absl::StatusOr<DatasetWriter> writer = DatasetWriter::Open(file_path, GetParam(), 2);
+  ASSERT_TRUE(writer.ok());
+  ASSERT_TRUE(writer->Append(DoubleBatch(labels, features)).ok());
+  ASSERT_TRUE(writer->Finish().ok());
+
+  absl::StatusOr<std::unique_ptr<DataReader>> reader = OpenDataReader(file_path);
+  ASSERT_TRUE(reader.ok());
+  SampleBatch first = (*reader)->GetNextBatch(2);
+  SampleBatch second = (*reader)->GetNextBatch(2);
+  EXPECT_EQ(first.dtype, GetParam());
+  EXPECT_EQ(first.sample_count, 2);
+  EXPECT_EQ(second.sample_count, 1);
+  EXPECT_EQ((*reader)->GetNextBatch(2).sample_count, 0);
+  EXPECT_EQ(first.labels[1], 1);
+  EXPECT_EQ(second.labels[0], 4);
+  std::vector<double> second_features(2);
+  second.ConvertFeatures(1.0, second_features.data());
+  EXPECT_EQ(second_features, std::vector<double>({254, 255}));
+
+  (*reader)->Reset();
+  EXPECT_EQ((*reader)->GetNextBatch(8).sample_count, 3);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Dtypes, DatasetTest,
+    testing::Values(DatasetDtype::UINT8, DatasetDtype::FLOAT32, DatasetDtype::FLOAT64));
+
+TEST(DatasetWriterTest, Uint8RejectsFractionalFeatures) {
+  const std::vector<uint32_t> labels = {0};
+  const std::vector<double> features = {0.5};
+  absl::StatusOr<DatasetWriter> writer =
+    DatasetWriter::Open(TempFilePath("dataset_test_uint8.nnds"), DatasetDtype::UINT8, 1);
+  ASSERT_TRUE(writer.ok());
+  EXPECT_FALSE(writer->Append(DoubleBatch(labels, features)).ok());
+}
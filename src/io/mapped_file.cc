@@ -0,0 +1,104 @@
+#include "src/io/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// NOTE: empty files aren't mapped, since neither platform allows zero length mappings.
+absl::StatusOr<MappedFile> MappedFile::Open(std::string file_path) {
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(
+      file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error opening file with path: ", file_path));
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return absl::InternalError(absl::StrCat("Error reading size of file: ", file_path));
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return MappedFile(nullptr, 0);
+  }
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return absl::InternalError(absl::StrCat("Error mapping file: ", file_path));
+  }
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == nullptr) {
+    return absl::InternalError(absl::StrCat("Error mapping file: ", file_path));
+  }
+  return MappedFile(static_cast<const std::byte*>(data), size.QuadPart);
+#else
+  const int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error opening file with path: ", file_path));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return absl::InternalError(absl::StrCat("Error reading size of file: ", file_path));
+  }
+  if (file_stat.st_size == 0) {
+    close(fd);
+    return MappedFile(nullptr, 0);
+  }
+  void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return absl::InternalError(absl::StrCat("Error mapping file: ", file_path));
+  }
+  return MappedFile(static_cast<const std::byte*>(data), file_stat.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() { Unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other) :
+  data_(std::exchange(other.data_, nullptr)),
+  size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+  if (this != &other) {
+    Unmap();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+const std::byte* MappedFile::Data() const { return data_; }
+
+int64_t MappedFile::Size() const { return size_; }
+
+void MappedFile::Unmap() {
+  if (data_ == nullptr) { return; }
+#if defined(_WIN32)
+  UnmapViewOfFile(data_);
+#else
+  munmap(const_cast<std::byte*>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef SRC_IO_MAPPED_FILE_H_
+#define SRC_IO_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/status/statusor.h"
+
+// Read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+ public:
+  static absl::StatusOr<MappedFile> Open(std::string file_path);
+  ~MappedFile();
+  MappedFile(MappedFile&& other);
+  MappedFile& operator=(MappedFile&& other);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const std::byte* Data() const;
+  int64_t Size() const;
+
+ protected:
+  MappedFile(const std::byte* data, int64_t size) : data_(data), size_(size) {}
+
+ private:
+  void Unmap();
+
+  const std::byte* data_;
+  int64_t size_;
+};
+
+#endif
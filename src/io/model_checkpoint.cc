@@ -1,14 +1,24 @@
 #include "src/io/model_checkpoint.h"
 
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <system_error>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "src/protos/model_checkpoint.pb.h"
 
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 absl::StatusOr<protos::ModelCheckpoint> ReadModelCheckpoint(std::string file_path) {
   std::fstream stream(file_path, std::ios::in | std::ios::binary);
   if (!stream.is_open()) {
@@ -25,18 +35,51 @@ absl::StatusOr<protos::ModelCheckpoint> ReadModelCheckpoint(std::string file_pat
   return checkpoint_proto;
 }
 
-absl::Status WriteModelCheckpoint(
-    std::string file_path, const protos::ModelCheckpoint& checkpoint_proto) {
-  std::fstream stream(file_path, std::ios::out | std::ios::trunc | std::ios::binary);
-  if (!stream.is_open()) {
+// NOTE: flushes the file's data to disk before returning.
+static absl::Status WriteFileDurably(const std::string& file_path, const std::string& contents) {
+  std::FILE* file = std::fopen(file_path.c_str(), "wb");
+  if (file == nullptr) {
     return absl::InvalidArgumentError(
         absl::StrCat("Error opening file with path: ", file_path));
   }
-  bool status = checkpoint_proto.SerializeToOstream(&stream);
-  if (!status) {
+  bool ok = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  ok = ok && std::fflush(file) == 0;
+#if defined(_WIN32)
+  ok = ok && _commit(_fileno(file)) == 0;
+#else
+  ok = ok && fsync(fileno(file)) == 0;
+#endif
+  ok = (std::fclose(file) == 0) && ok;
+  if (!ok) {
+    return absl::InternalError(absl::StrCat("Error writing to file: ", file_path));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WriteModelCheckpoint(
+    std::string file_path, const protos::ModelCheckpoint& checkpoint_proto) {
+  std::string contents;
+  if (!checkpoint_proto.SerializeToString(&contents)) {
     return absl::InvalidArgumentError(
         absl::StrCat("Error writing file checkpoint to file: ", file_path));
   }
-  stream.close();
+  const std::string temp_file_path = absl::StrCat(file_path, ".tmp");
+  absl::Status status = WriteFileDurably(temp_file_path, contents);
+  if (!status.ok()) { return status; }
+  std::error_code error;
+  std::filesystem::rename(temp_file_path, file_path, error);
+  if (error) {
+    return absl::InternalError(absl::StrCat(
+          "Error renaming ", temp_file_path, " to ", file_path, ": ", error.message()));
+  }
+#if !defined(_WIN32)
+  // NOTE: syncs the directory too, so that the rename itself survives a crash.
+  const int dir_fd = open(
+      std::filesystem::absolute(file_path).parent_path().c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+#endif
   return absl::OkStatus();
 }
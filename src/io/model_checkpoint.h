@@ -7,6 +7,8 @@
 
 absl::StatusOr<protos::ModelCheckpoint> ReadModelCheckpoint(
     std::string file_path);
+// NOTE: the checkpoint is synced to a temporary file then renamed over file_path, so
+// file_path always holds a whole checkpoint, old or new, even if the process dies mid-write.
 absl::Status WriteModelCheckpoint(
     std::string file_path, const protos::ModelCheckpoint& checkpoint_proto);
 
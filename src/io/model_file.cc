@@ -0,0 +1,272 @@
+#include "src/io/model_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/io/mapped_file.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+static constexpr uint64_t kSectionAlignment = 64;
+
+static uint64_t AlignSection(uint64_t offset) {
+  return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+template <typename T, typename Repeated>
+static void CopyTensor(const std::byte* data, int64_t count, Repeated* elements) {
+  elements->Resize(count, 0);
+  std::memcpy(elements->mutable_data(), data, count * sizeof(T));
+}
+
+static uint64_t ElementSize(protos::Precision precision) {
+  return (precision == protos::Precision::FLOAT) ? sizeof(float) : sizeof(double);
+}
+
+// NOTE: writes padding up to offset, which is never behind the stream.
+static void PadTo(std::ofstream& file, uint64_t offset) {
+  const std::vector<char> padding(offset - (uint64_t) file.tellp(), 0);
+  file.write(padding.data(), padding.size());
+}
+
+template <typename Repeated>
+static void WriteTensor(std::ofstream& file, uint64_t offset, const Repeated& elements) {
+  PadTo(file, offset);
+  file.write(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(elements[0]));
+}
+
+absl::Status WriteModelFile(std::string file_path, const protos::ModelCheckpoint& checkpoint_proto) {
+  const protos::Precision precision = checkpoint_proto.precision();
+  if (precision != protos::Precision::DOUBLE && precision != protos::Precision::FLOAT) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Model files hold DOUBLE or FLOAT models, got: ", protos::Precision_Name(precision)));
+  }
+  if (checkpoint_proto.layers().empty()) {
+    return absl::InvalidArgumentError("Checkpoint has no layers.");
+  }
+  const bool is_float = (precision == protos::Precision::FLOAT);
+  std::vector<ModelFileLayer> layers;
+  uint64_t offset = sizeof(ModelFileHeader) + checkpoint_proto.layers().size() * sizeof(ModelFileLayer);
+  for (int32_t i = 0; i < checkpoint_proto.layers().size(); i++) {
+    const protos::Layer& layer_proto = checkpoint_proto.layers()[i];
+    const int64_t row_count = layer_proto.row_count();
+    const int64_t col_count = layer_proto.col_count();
+    const int64_t weight_count =
+      is_float ? layer_proto.float_weights().size() : layer_proto.weights().size();
+    const int64_t bias_count =
+      is_float ? layer_proto.float_biases().size() : layer_proto.biases().size();
+    if (row_count <= 0 || col_count <= 0 ||
+        weight_count != row_count * col_count || bias_count != col_count) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Layer: ", i, " of shape ", row_count, "x", col_count, " has ", weight_count,
+            " weights and ", bias_count, " biases."));
+    }
+    if (i > 0 && row_count != layers.back().col_count) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Invalid weight dimensions! Layer: ", i - 1,
+            " has column count: ", layers.back().col_count,
+            ", while layer: ", i, " has row count: ", row_count));
+    }
+    ModelFileLayer layer = {
+      .row_count = (uint32_t) row_count,
+      .col_count = (uint32_t) col_count,
+      .weights_offset = AlignSection(offset),
+    };
+    layer.biases_offset = AlignSection(layer.weights_offset + weight_count * ElementSize(precision));
+    offset = layer.biases_offset + bias_count * ElementSize(precision);
+    layers.push_back(layer);
+  }
+  const protos::InputTransform& transform_proto = checkpoint_proto.input_transform();
+  const int64_t standardized_count = transform_proto.feature_means().size();
+  if (transform_proto.feature_inverse_stddevs().size() != standardized_count ||
+      (standardized_count != 0 && standardized_count != layers[0].row_count)) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Input transform for ", layers[0].row_count, " features has ", standardized_count,
+          " means and ", transform_proto.feature_inverse_stddevs().size(),
+          " inverse standard deviations."));
+  }
+  const uint64_t feature_means_offset = AlignSection(offset);
+  const uint64_t feature_inverse_stddevs_offset =
+    AlignSection(feature_means_offset + standardized_count * sizeof(double));
+
+  std::ofstream file(file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file.is_open()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error opening file with path: ", file_path));
+  }
+  ModelFileHeader header = {
+    .version = ModelFileHeader::kVersion,
+    .precision = (uint32_t) precision,
+    .intermed_activation = (uint32_t) checkpoint_proto.intermed_activation(),
+    .output_activation = (uint32_t) checkpoint_proto.output_activation(),
+    .layer_count = (uint32_t) layers.size(),
+    .has_input_transform = checkpoint_proto.has_input_transform(),
+    .standardized_feature_count = (uint32_t) standardized_count,
+    .input_scale = transform_proto.scale(),
+    .input_shift = transform_proto.shift(),
+    .feature_means_offset = (standardized_count > 0) ? feature_means_offset : 0,
+    .feature_inverse_stddevs_offset = (standardized_count > 0) ? feature_inverse_stddevs_offset : 0,
+  };
+  std::memcpy(header.magic, ModelFileHeader::kMagic, sizeof(header.magic));
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(layers.data()), layers.size() * sizeof(ModelFileLayer));
+  for (int32_t i = 0; i < layers.size(); i++) {
+    const protos::Layer& layer_proto = checkpoint_proto.layers()[i];
+    if (is_float) {
+      WriteTensor(file, layers[i].weights_offset, layer_proto.float_weights());
+      WriteTensor(file, layers[i].biases_offset, layer_proto.float_biases());
+    } else {
+      WriteTensor(file, layers[i].weights_offset, layer_proto.weights());
+      WriteTensor(file, layers[i].biases_offset, layer_proto.biases());
+    }
+  }
+  if (standardized_count > 0) {
+    WriteTensor(file, feature_means_offset, transform_proto.feature_means());
+    WriteTensor(file, feature_inverse_stddevs_offset, transform_proto.feature_inverse_stddevs());
+  }
+  file.close();
+  if (file.fail()) {
+    return absl::InternalError(absl::StrCat("Error writing to file: ", file_path));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<bool> IsModelFile(std::string file_path) {
+  std::ifstream file(file_path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Error opening file with path: ", file_path));
+  }
+  char magic[sizeof(ModelFileHeader::kMagic)] = {};
+  file.read(magic, sizeof(magic));
+  return std::memcmp(magic, ModelFileHeader::kMagic, sizeof(magic)) == 0;
+}
+
+absl::StatusOr<ModelFile> ModelFile::Open(std::string file_path) {
+  absl::StatusOr<MappedFile> file = MappedFile::Open(file_path);
+  if (!file.ok()) { return file.status(); }
+
+  ModelFileHeader header;
+  if (file->Size() < sizeof(header)) {
+    return absl::InvalidArgumentError(absl::StrCat("Not a model file: ", file_path));
+  }
+  std::memcpy(&header, file->Data(), sizeof(header));
+  if (std::memcmp(header.magic, ModelFileHeader::kMagic, sizeof(header.magic)) != 0) {
+    return absl::InvalidArgumentError(absl::StrCat("Not a model file: ", file_path));
+  }
+  if (header.version != ModelFileHeader::kVersion) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported model file version ", header.version, " in file: ", file_path));
+  }
+  const protos::Precision precision = (protos::Precision) header.precision;
+  if (precision != protos::Precision::DOUBLE && precision != protos::Precision::FLOAT) {
+    return absl::InvalidArgumentError(absl::StrCat("Unknown precision in file: ", file_path));
+  }
+  if (!protos::Activation_IsValid(header.intermed_activation) ||
+      !protos::Activation_IsValid(header.output_activation)) {
+    return absl::InvalidArgumentError(absl::StrCat("Unknown activation in file: ", file_path));
+  }
+  if (header.layer_count == 0 ||
+      sizeof(header) + (uint64_t) header.layer_count * sizeof(ModelFileLayer) > file->Size()) {
+    return absl::InvalidArgumentError(absl::StrCat("Truncated model file: ", file_path));
+  }
+
+  std::vector<Layer> layers;
+  layers.reserve(header.layer_count);
+  for (uint32_t i = 0; i < header.layer_count; i++) {
+    ModelFileLayer layer;
+    std::memcpy(&layer, file->Data() + sizeof(header) + i * sizeof(ModelFileLayer), sizeof(layer));
+    if (layer.row_count == 0 || layer.col_count == 0 ||
+        layer.row_count > INT32_MAX || layer.col_count > INT32_MAX ||
+        layer.weights_offset % kSectionAlignment != 0 || layer.biases_offset % kSectionAlignment != 0 ||
+        layer.weights_offset > file->Size() || layer.biases_offset > file->Size() ||
+        (uint64_t) layer.row_count * layer.col_count >
+          (file->Size() - layer.weights_offset) / ElementSize(precision) ||
+        layer.col_count > (file->Size() - layer.biases_offset) / ElementSize(precision)) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Invalid layer: ", i, " in model file: ", file_path));
+    }
+    if (i > 0 && layer.row_count != layers.back().col_count) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Invalid weight dimensions! Layer: ", i - 1,
+            " has column count: ", layers.back().col_count,
+            ", while layer: ", i, " has row count: ", layer.row_count));
+    }
+    layers.push_back(Layer {
+      .row_count = (int32_t) layer.row_count,
+      .col_count = (int32_t) layer.col_count,
+      .weights = file->Data() + layer.weights_offset,
+      .biases = file->Data() + layer.biases_offset,
+    });
+  }
+
+  std::optional<protos::InputTransform> input_transform;
+  if (header.has_input_transform > 1 ||
+      (header.standardized_feature_count != 0 &&
+       header.standardized_feature_count != layers[0].row_count)) {
+    return absl::InvalidArgumentError(absl::StrCat("Invalid input transform in model file: ", file_path));
+  }
+  if (header.has_input_transform == 1) {
+    input_transform.emplace();
+    input_transform->set_scale(header.input_scale);
+    input_transform->set_shift(header.input_shift);
+    if (header.standardized_feature_count > 0) {
+      for (uint64_t section_offset : {header.feature_means_offset, header.feature_inverse_stddevs_offset}) {
+        if (section_offset % kSectionAlignment != 0 || section_offset > file->Size() ||
+            header.standardized_feature_count > (file->Size() - section_offset) / sizeof(double)) {
+          return absl::InvalidArgumentError(absl::StrCat(
+                "Invalid input transform in model file: ", file_path));
+        }
+      }
+      CopyTensor<double>(
+          file->Data() + header.feature_means_offset, header.standardized_feature_count,
+          input_transform->mutable_feature_means());
+      CopyTensor<double>(
+          file->Data() + header.feature_inverse_stddevs_offset, header.standardized_feature_count,
+          input_transform->mutable_feature_inverse_stddevs());
+    }
+  }
+  return ModelFile(*std::move(file), header, std::move(layers), std::move(input_transform));
+}
+
+protos::Precision ModelFile::Precision() const { return precision_; }
+
+protos::Activation ModelFile::IntermedActivation() const { return intermed_activation_; }
+
+protos::Activation ModelFile::OutputActivation() const { return output_activation_; }
+
+const std::vector<ModelFile::Layer>& ModelFile::Layers() const { return layers_; }
+
+const std::optional<protos::InputTransform>& ModelFile::InputTransform() const {
+  return input_transform_;
+}
+
+protos::ModelCheckpoint ModelFile::ToCheckpoint() const {
+  protos::ModelCheckpoint checkpoint_proto;
+  checkpoint_proto.set_precision(precision_);
+  checkpoint_proto.set_intermed_activation(intermed_activation_);
+  checkpoint_proto.set_output_activation(output_activation_);
+  for (const Layer& layer : layers_) {
+    protos::Layer& layer_proto = *checkpoint_proto.add_layers();
+    layer_proto.set_row_count(layer.row_count);
+    layer_proto.set_col_count(layer.col_count);
+    const int64_t weight_count = (int64_t) layer.row_count * layer.col_count;
+    if (precision_ == protos::Precision::FLOAT) {
+      CopyTensor<float>(layer.weights, weight_count, layer_proto.mutable_float_weights());
+      CopyTensor<float>(layer.biases, layer.col_count, layer_proto.mutable_float_biases());
+    } else {
+      CopyTensor<double>(layer.weights, weight_count, layer_proto.mutable_weights());
+      CopyTensor<double>(layer.biases, layer.col_count, layer_proto.mutable_biases());
+    }
+  }
+  if (input_transform_.has_value()) { *checkpoint_proto.mutable_input_transform() = *input_transform_; }
+  return checkpoint_proto;
+}
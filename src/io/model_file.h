@@ -0,0 +1,105 @@
+#ifndef SRC_IO_MODEL_FILE_H_
+#define SRC_IO_MODEL_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/io/mapped_file.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// Binary model file layout, little endian:
+//   ModelFileHeader
+//   ModelFileLayer x layer_count
+//   per layer: weights, row_count x col_count elements, row-major, at weights_offset
+//              biases, col_count elements, at biases_offset
+//   feature means and inverse standard deviations, standardized_feature_count doubles each,
+//   at feature_means_offset / feature_inverse_stddevs_offset
+// Elements are doubles or floats, per the header's precision. The proto checkpoint stays
+// the interchange format, this one is for loading models to serve.
+// NOTE: every tensor starts on a 64 byte boundary, so they can be used straight out of a
+// memory mapping.
+struct ModelFileHeader {
+  static constexpr char kMagic[4] = {'N', 'N', 'M', 'F'};
+  // NOTE: 2 added the input transform.
+  static constexpr uint32_t kVersion = 2;
+
+  char magic[4];
+  uint32_t version;
+  // NOTE: protos::Precision and protos::Activation values.
+  uint32_t precision;
+  uint32_t intermed_activation;
+  uint32_t output_activation;
+  uint32_t layer_count;
+  // NOTE: see protos::InputTransform, absent if has_input_transform is 0.
+  // standardized_feature_count is 0 or the first layer's row_count.
+  uint32_t has_input_transform;
+  uint32_t standardized_feature_count;
+  double input_scale;
+  double input_shift;
+  uint64_t feature_means_offset;
+  uint64_t feature_inverse_stddevs_offset;
+};
+
+struct ModelFileLayer {
+  uint32_t row_count;
+  uint32_t col_count;
+  uint64_t weights_offset;
+  uint64_t biases_offset;
+};
+
+// Writes a DOUBLE or FLOAT checkpoint as a binary model file.
+absl::Status WriteModelFile(std::string file_path, const protos::ModelCheckpoint& checkpoint_proto);
+
+// Returns whether the file starts with ModelFileHeader::kMagic.
+absl::StatusOr<bool> IsModelFile(std::string file_path);
+
+// Read-only view of a binary model file through a memory mapping. Opening only validates
+// the header and layer table, tensors are paged in from the file as they're first read.
+class ModelFile {
+ public:
+  struct Layer {
+    int32_t row_count;
+    int32_t col_count;
+    // NOTE: elements of the file's precision.
+    const std::byte* weights;
+    const std::byte* biases;
+  };
+
+  static absl::StatusOr<ModelFile> Open(std::string file_path);
+
+  protos::Precision Precision() const;
+  protos::Activation IntermedActivation() const;
+  protos::Activation OutputActivation() const;
+  const std::vector<Layer>& Layers() const;
+  // NOTE: how features are transformed before reaching the first layer, if at all.
+  const std::optional<protos::InputTransform>& InputTransform() const;
+  // Copies the model into a proto checkpoint, e.g. to train it further.
+  protos::ModelCheckpoint ToCheckpoint() const;
+
+ protected:
+  ModelFile(
+      MappedFile file, const ModelFileHeader& header, std::vector<Layer> layers,
+      std::optional<protos::InputTransform> input_transform) :
+    file_(std::move(file)),
+    precision_((protos::Precision) header.precision),
+    intermed_activation_((protos::Activation) header.intermed_activation),
+    output_activation_((protos::Activation) header.output_activation),
+    layers_(std::move(layers)),
+    input_transform_(std::move(input_transform)) {}
+
+ private:
+  MappedFile file_;
+  protos::Precision precision_;
+  protos::Activation intermed_activation_;
+  protos::Activation output_activation_;
+  std::vector<Layer> layers_;
+  std::optional<protos::InputTransform> input_transform_;
+};
+
+#endif
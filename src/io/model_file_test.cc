@@ -0,0 +1,89 @@
+#include "src/io/model_file.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+std::string TempFilePath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+protos::ModelCheckpoint TestCheckpoint(protos::Precision precision) {
+  protos::ModelCheckpoint checkpoint_proto;
+  checkpoint_proto.set_precision(precision);
+  checkpoint_proto.set_intermed_activation(protos::Activation::RELU);
+  checkpoint_proto.set_output_activation(protos::Activation::SOFTMAX);
+  for (auto [row_count, col_count] : {std::pair(3, 5), std::pair(5, 2)}) {
+    protos::Layer& layer_proto = *checkpoint_proto.add_layers();
+    layer_proto.set_row_count(row_count);
+    layer_proto.set_col_count(col_count);
+    for (int32_t i = 0; i < row_count * col_count; i++) {
+      if (precision == protos::Precision::FLOAT) {
+        layer_proto.add_float_weights(0.25f * i);
+      } else {
+        layer_proto.add_weights(-0.5 * i);
+      }
+    }
+    for (int32_t i = 0; i < col_count; i++) {
+      if (precision == protos::Precision::FLOAT) {
+        layer_proto.add_float_biases(i);
+      } else {
+        layer_proto.add_biases(-i);
+      }
+    }
+  }
+  protos::InputTransform& transform_proto = *checkpoint_proto.mutable_input_transform();
+  transform_proto.set_scale(1.0 / 255.0);
+  transform_proto.set_shift(-0.5);
+  for (double mean : {0.25, 0.5, 0.75}) { transform_proto.add_feature_means(mean); }
+  for (double inverse_stddev : {2.0, 4.0, 8.0}) {
+    transform_proto.add_feature_inverse_stddevs(inverse_stddev);
+  }
+  return checkpoint_proto;
+}
+
+class ModelFileTest : public testing::TestWithParam<protos::Precision> {};
+
+TEST_P(ModelFileTest, RoundTripsCheckpoints) {
+  const std::string file_path = TempFilePath("model_file_test.nnmf");
+  const protos::ModelCheckpoint checkpoint_proto = TestCheckpoint(GetParam());
+  ASSERT_TRUE(WriteModelFile(file_path, checkpoint_proto).ok());
+  ASSERT_TRUE(*IsModelFile(file_path));
+
+  absl::StatusOr<ModelFile> model_file = ModelFile::Open(file_path);
+  ASSERT_TRUE(model_file.ok());
+  EXPECT_EQ(model_file->Precision(), GetParam());
+  ASSERT_EQ(model_file->Layers().size(), 2);
+  for (const ModelFile::Layer& layer : model_file->Layers()) {
+    EXPECT_EQ((uintptr_t) layer.weights % 64, 0);
+    EXPECT_EQ((uintptr_t) layer.biases % 64, 0);
+  }
+  EXPECT_EQ(model_file->ToCheckpoint().SerializeAsString(), checkpoint_proto.SerializeAsString());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Precisions, ModelFileTest,
+    testing::Values(protos::Precision::DOUBLE, protos::Precision::FLOAT));
+
+TEST(ModelFileTest, RejectsInvalidFiles) {
+  const std::string file_path = TempFilePath("model_file_test.nnmf");
+  ASSERT_TRUE(WriteModelFile(file_path, TestCheckpoint(protos::Precision::DOUBLE)).ok());
+  std::filesystem::resize_file(file_path, std::filesystem::file_size(file_path) - 8);
+  EXPECT_FALSE(ModelFile::Open(file_path).ok());
+
+  protos::ModelCheckpoint checkpoint_proto = TestCheckpoint(protos::Precision::DOUBLE);
+  checkpoint_proto.mutable_layers(1)->set_row_count(4);
+  EXPECT_FALSE(WriteModelFile(file_path, checkpoint_proto).ok());
+  checkpoint_proto.set_precision(protos::Precision::INT8);
+  EXPECT_FALSE(WriteModelFile(file_path, checkpoint_proto).ok());
+
+  checkpoint_proto = TestCheckpoint(protos::Precision::DOUBLE);
+  checkpoint_proto.mutable_input_transform()->add_feature_means(1.0);
+  EXPECT_FALSE(WriteModelFile(file_path, checkpoint_proto).ok());
+}
@@ -0,0 +1,131 @@
+#include "src/io/prefetching_data_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+PrefetchingDataReader::PrefetchingDataReader(
+    std::unique_ptr<DataReader> reader, int32_t batch_size, int32_t depth) :
+  reader_(std::move(reader)),
+  batch_size_(batch_size),
+  depth_(depth),
+  buffers_(depth + 1),
+  mutex_(),
+  cv_(),
+  loaded_count_(0),
+  consumed_count_(0),
+  exhausted_(false),
+  status_(absl::OkStatus()),
+  stop_(false),
+  loader_() {
+    DCHECK(reader_ != nullptr);
+    DCHECK(batch_size_ > 0);
+    DCHECK(depth_ > 0);
+    StartLoading();
+  }
+
+PrefetchingDataReader::~PrefetchingDataReader() { StopLoading(); }
+
+SampleBatch PrefetchingDataReader::GetNextBatch(int32_t batch_size) {
+  DCHECK(batch_size == batch_size_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return loaded_count_ > consumed_count_ || exhausted_; });
+  if (loaded_count_ == consumed_count_) { return SampleBatch {}; }
+  const Buffer& buffer = buffers_[consumed_count_ % buffers_.size()];
+  consumed_count_++;
+  lock.unlock();
+  // NOTE: frees up the previously handed out buffer for the loader.
+  cv_.notify_all();
+  return buffer.batch;
+}
+
+void PrefetchingDataReader::Reset() {
+  {
+    std::scoped_lock lock(mutex_);
+    // NOTE: nothing read yet, the loader is already at the start.
+    if (consumed_count_ == 0) { return; }
+  }
+  StopLoading();
+  reader_->Reset();
+  loaded_count_ = 0;
+  consumed_count_ = 0;
+  exhausted_ = false;
+  status_ = absl::OkStatus();
+  stop_ = false;
+  StartLoading();
+}
+
+void PrefetchingDataReader::StartLoading() {
+  loader_ = std::thread(&PrefetchingDataReader::LoadLoop, this);
+}
+
+void PrefetchingDataReader::StopLoading() {
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (loader_.joinable()) { loader_.join(); }
+}
+
+// NOTE: the buffer last handed out is consumed_count_ - 1, so staying within depth_ batches
+// ahead of consumed_count_ never overwrites it.
+void PrefetchingDataReader::LoadLoop() {
+  while (true) {
+    int64_t batch_index;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&]() { return stop_ || loaded_count_ < consumed_count_ + depth_; });
+      if (stop_) { return; }
+      batch_index = loaded_count_;
+    }
+
+    Buffer& buffer = buffers_[batch_index % buffers_.size()];
+    const SampleBatch batch = reader_->GetNextBatch(batch_size_);
+    const absl::Status status =
+      (batch.sample_count == 0) ? reader_->ReadStatus() : absl::OkStatus();
+    const int64_t features_size =
+      batch.sample_count * batch.feature_count * DatasetDtypeSize(batch.dtype);
+    const int64_t targets_size = (batch.targets != nullptr) ?
+      batch.sample_count * batch.class_count * DatasetDtypeSize(batch.dtype) : 0;
+    buffer.labels.assign(batch.labels, batch.labels + batch.sample_count);
+    buffer.features.resize(features_size);
+    if (features_size > 0) { std::memcpy(buffer.features.data(), batch.features, features_size); }
+    buffer.targets.resize(targets_size);
+    if (targets_size > 0) { std::memcpy(buffer.targets.data(), batch.targets, targets_size); }
+    buffer.batch = SampleBatch {
+      .dtype = batch.dtype,
+      .feature_count = batch.feature_count,
+      .sample_count = batch.sample_count,
+      .labels = buffer.labels.data(),
+      .features = buffer.features.data(),
+      .class_count = batch.class_count,
+      .targets = (batch.targets != nullptr) ? buffer.targets.data() : nullptr,
+    };
+
+    {
+      std::scoped_lock lock(mutex_);
+      if (batch.sample_count == 0) {
+        exhausted_ = true;
+        status_ = status;
+      } else {
+        loaded_count_++;
+      }
+    }
+    cv_.notify_all();
+    if (batch.sample_count == 0) { return; }
+  }
+}
+
+absl::Status PrefetchingDataReader::ReadStatus() const {
+  std::scoped_lock lock(mutex_);
+  return status_;
+}
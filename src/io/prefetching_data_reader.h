@@ -0,0 +1,61 @@
+#ifndef SRC_IO_PREFETCHING_DATA_READER_H_
+#define SRC_IO_PREFETCHING_DATA_READER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+// Reads and decodes the next depth batches of another DataReader on a background thread,
+// so that loading overlaps with whatever the caller does with the current batch. Batches
+// are copied into a ring of depth + 1 reusable buffers: the one last handed out, which
+// stays valid until the next call as usual, plus up to depth prefetched ones.
+// NOTE: every batch has the size given on construction.
+class PrefetchingDataReader : public DataReader {
+ public:
+  explicit PrefetchingDataReader(
+      std::unique_ptr<DataReader> reader, int32_t batch_size, int32_t depth);
+  ~PrefetchingDataReader() override;
+  PrefetchingDataReader(const PrefetchingDataReader&) = delete;
+  PrefetchingDataReader& operator=(const PrefetchingDataReader&) = delete;
+
+  SampleBatch GetNextBatch(int32_t batch_size) override;
+  void Reset() override;
+  // NOTE: the wrapped reader's, as of when it ran out.
+  absl::Status ReadStatus() const override;
+
+ private:
+  struct Buffer {
+    std::vector<uint32_t> labels;
+    std::vector<std::byte> features;
+    std::vector<std::byte> targets;
+    SampleBatch batch;
+  };
+
+  void StartLoading();
+  void StopLoading();
+  void LoadLoop();
+
+  std::unique_ptr<DataReader> reader_;
+  const int32_t batch_size_;
+  const int32_t depth_;
+  std::vector<Buffer> buffers_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  // NOTE: batches loaded / handed out since the last reset, buffer i % buffers_.size()
+  // holds batch i.
+  int64_t loaded_count_;
+  int64_t consumed_count_;
+  bool exhausted_;
+  absl::Status status_;
+  bool stop_;
+  std::thread loader_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "src/io/prefetching_data_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/io/data_reader.h"
+
+// NOTE: sample i has label i and a single UINT8 feature i, reused buffers like CsvReader.
+class CountingReader : public DataReader {
+ public:
+  explicit CountingReader(int32_t sample_count) : sample_count_(sample_count), next_(0) {}
+
+  SampleBatch GetNextBatch(int32_t batch_size) override {
+    labels_.clear();
+    features_.clear();
+    for (; next_ < sample_count_ && labels_.size() < batch_size; next_++) {
+      labels_.push_back(next_);
+      features_.push_back((std::byte) next_);
+    }
+    return SampleBatch {
+      .dtype = DatasetDtype::UINT8,
+      .feature_count = 1,
+      .sample_count = (int64_t) labels_.size(),
+      .labels = labels_.data(),
+      .features = features_.data(),
+    };
+  }
+  void Reset() override { next_ = 0; }
+
+ private:
+  int32_t sample_count_;
+  int32_t next_;
+  std::vector<uint32_t> labels_;
+  std::vector<std::byte> features_;
+};
+
+std::vector<uint32_t> ReadAll(DataReader& reader, int32_t batch_size) {
+  std::vector<uint32_t> labels;
+  SampleBatch batch = reader.GetNextBatch(batch_size);
+  while (batch.sample_count > 0) {
+    for (int64_t i = 0; i < batch.sample_count; i++) {
+      EXPECT_EQ((uint32_t) batch.features[i], batch.labels[i]);
+      labels.push_back(batch.labels[i]);
+    }
+    batch = reader.GetNextBatch(batch_size);
+  }
+  return labels;
+}
+
+TEST(PrefetchingDataReaderTest, MatchesUnderlyingReaderAcrossResets) {
+  CountingReader expected_reader(100);
+  const std::vector<uint32_t> expected = ReadAll(expected_reader, 7);
+  PrefetchingDataReader reader(std::make_unique<CountingReader>(100), 7, /*depth=*/2);
+  EXPECT_EQ(ReadAll(reader, 7), expected);
+  EXPECT_EQ(reader.GetNextBatch(7).sample_count, 0);
+  reader.Reset();
+  EXPECT_EQ(ReadAll(reader, 7), expected);
+}
+
+TEST(PrefetchingDataReaderTest, ResetMidway) {
+  PrefetchingDataReader reader(std::make_unique<CountingReader>(100), 10, /*depth=*/3);
+  EXPECT_EQ(reader.GetNextBatch(10).labels[0], 0);
+  EXPECT_EQ(reader.GetNextBatch(10).labels[0], 10);
+  reader.Reset();
+  EXPECT_EQ(reader.GetNextBatch(10).labels[0], 0);
+}
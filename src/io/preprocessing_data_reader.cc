@@ -0,0 +1,158 @@
+#include "src/io/preprocessing_data_reader.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+namespace {
+
+constexpr int32_t kStatisticsBatchSize = 1024;
+
+template <typename From, typename T>
+void TransformFeatures(
+    const From* in, int64_t sample_count, int32_t feature_count,
+    const double* scales, const double* shifts, T* out) {
+  for (int64_t i = 0; i < sample_count; i++) {
+    for (int32_t j = 0; j < feature_count; j++) {
+      out[j] = (T) (in[j] * scales[j] + shifts[j]);
+    }
+    in += feature_count;
+    out += feature_count;
+  }
+}
+
+}  // namespace
+
+absl::Status ComputeFeatureStatistics(DataReader& reader, PreprocessOptions* options) {
+  std::vector<double> sums;
+  std::vector<double> squared_sums;
+  std::vector<double> features;
+  int64_t sample_count = 0;
+  reader.Reset();
+  SampleBatch batch = reader.GetNextBatch(kStatisticsBatchSize);
+  while (batch.sample_count > 0) {
+    sums.resize(batch.feature_count);
+    squared_sums.resize(batch.feature_count);
+    features.resize(batch.sample_count * batch.feature_count);
+    batch.ConvertFeatures(1.0, features.data());
+    for (int64_t i = 0; i < batch.sample_count; i++) {
+      for (int32_t j = 0; j < batch.feature_count; j++) {
+        const double x = features[i * batch.feature_count + j] * options->scale + options->shift;
+        sums[j] += x;
+        squared_sums[j] += x * x;
+      }
+    }
+    sample_count += batch.sample_count;
+    batch = reader.GetNextBatch(kStatisticsBatchSize);
+  }
+  const absl::Status status = reader.ReadStatus();
+  reader.Reset();
+  if (!status.ok()) { return status; }
+
+  options->feature_means.assign(sums.size(), 0.0);
+  options->feature_stddevs.assign(sums.size(), 1.0);
+  for (size_t j = 0; j < sums.size(); j++) {
+    const double mean = sums[j] / sample_count;
+    const double variance = squared_sums[j] / sample_count - mean * mean;
+    options->feature_means[j] = mean;
+    if (variance > 1e-12) { options->feature_stddevs[j] = std::sqrt(variance); }
+  }
+  return absl::OkStatus();
+}
+
+PreprocessingDataReader::PreprocessingDataReader(
+    std::unique_ptr<DataReader> reader, PreprocessOptions options) :
+  reader_(std::move(reader)),
+  options_(std::move(options)),
+  feature_scales_(),
+  feature_shifts_(),
+  features_(),
+  targets_() {
+    DCHECK(reader_ != nullptr);
+    CHECK(options_.dtype == DatasetDtype::FLOAT32 || options_.dtype == DatasetDtype::FLOAT64)
+      << "Preprocessed features must be FLOAT32 or FLOAT64.";
+    CHECK(options_.feature_means.size() == options_.feature_stddevs.size());
+  }
+
+SampleBatch PreprocessingDataReader::GetNextBatch(int32_t batch_size) {
+  const SampleBatch batch = reader_->GetNextBatch(batch_size);
+  if (batch.sample_count == 0) { return SampleBatch {}; }
+  FoldFeatureTransform(batch.feature_count);
+  switch (options_.dtype) {
+    case DatasetDtype::FLOAT32: return Preprocess<float>(batch);
+    case DatasetDtype::FLOAT64: return Preprocess<double>(batch);
+    default: { CHECK(false); return SampleBatch {}; }
+  }
+}
+
+void PreprocessingDataReader::Reset() { reader_->Reset(); }
+
+absl::Status PreprocessingDataReader::ReadStatus() const { return reader_->ReadStatus(); }
+
+void PreprocessingDataReader::FoldFeatureTransform(int32_t feature_count) {
+  if (feature_scales_.size() == feature_count) { return; }
+  CHECK(feature_scales_.empty()) << "Feature count changed between batches.";
+  CHECK(options_.feature_means.empty() || options_.feature_means.size() == feature_count)
+    << "Expected statistics for " << feature_count << " features, got "
+    << options_.feature_means.size() << ".";
+  feature_scales_.assign(feature_count, options_.scale);
+  feature_shifts_.assign(feature_count, options_.shift);
+  for (size_t i = 0; i < options_.feature_means.size(); i++) {
+    feature_scales_[i] = options_.scale / options_.feature_stddevs[i];
+    feature_shifts_[i] =
+      (options_.shift - options_.feature_means[i]) / options_.feature_stddevs[i];
+  }
+}
+
+template <typename T>
+SampleBatch PreprocessingDataReader::Preprocess(const SampleBatch& batch) {
+  features_.resize(batch.sample_count * batch.feature_count * sizeof(T));
+  T* features = reinterpret_cast<T*>(features_.data());
+  switch (batch.dtype) {
+    case DatasetDtype::UINT8:
+      TransformFeatures(
+          reinterpret_cast<const uint8_t*>(batch.features), batch.sample_count,
+          batch.feature_count, feature_scales_.data(), feature_shifts_.data(), features);
+      break;
+    case DatasetDtype::FLOAT32:
+      TransformFeatures(
+          reinterpret_cast<const float*>(batch.features), batch.sample_count,
+          batch.feature_count, feature_scales_.data(), feature_shifts_.data(), features);
+      break;
+    case DatasetDtype::FLOAT64:
+      TransformFeatures(
+          reinterpret_cast<const double*>(batch.features), batch.sample_count,
+          batch.feature_count, feature_scales_.data(), feature_shifts_.data(), features);
+      break;
+  }
+
+  const int32_t class_count = options_.class_count;
+  targets_.resize(batch.sample_count * class_count * sizeof(T));
+  if (class_count > 0) {
+    std::memset(targets_.data(), 0, targets_.size());
+    T* targets = reinterpret_cast<T*>(targets_.data());
+    for (int64_t i = 0; i < batch.sample_count; i++) {
+      CHECK(batch.labels[i] < class_count)
+        << "Label " << batch.labels[i] << " out of range of " << class_count << " classes.";
+      targets[i * class_count + batch.labels[i]] = (T) 1;
+    }
+  }
+
+  return SampleBatch {
+    .dtype = options_.dtype,
+    .feature_count = batch.feature_count,
+    .sample_count = batch.sample_count,
+    .labels = batch.labels,
+    .features = features_.data(),
+    .class_count = class_count,
+    .targets = (class_count > 0) ? targets_.data() : nullptr,
+  };
+}
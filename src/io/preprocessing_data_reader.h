@@ -0,0 +1,60 @@
+#ifndef SRC_IO_PREPROCESSING_DATA_READER_H_
+#define SRC_IO_PREPROCESSING_DATA_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+struct PreprocessOptions {
+  // NOTE: FLOAT32 or FLOAT64, the element type of the preprocessed features and targets.
+  DatasetDtype dtype;
+  // NOTE: feature i becomes (x * scale + shift - feature_means[i]) / feature_stddevs[i],
+  // the means and standard deviations being optional (empty).
+  double scale = 1.0;
+  double shift = 0.0;
+  std::vector<double> feature_means;
+  std::vector<double> feature_stddevs;
+  // NOTE: labels are one-hot encoded into class_count targets, if > 0.
+  int32_t class_count = 0;
+};
+
+// Computes the per-feature mean and standard deviation of (x * scale + shift) over every
+// sample in reader into options, and resets reader.
+// NOTE: constant features get a standard deviation of 1, so they're only centered. Fails
+// if reader does, see DataReader::ReadStatus.
+absl::Status ComputeFeatureStatistics(DataReader& reader, PreprocessOptions* options);
+
+// Normalizes the features of another DataReader's batches, and one-hot encodes their
+// labels into targets, so that consumers get batches ready to be copied into a model. The
+// normalization is folded into a single per-feature multiply-add, fused with the decoding
+// of the stored dtype.
+class PreprocessingDataReader : public DataReader {
+ public:
+  explicit PreprocessingDataReader(std::unique_ptr<DataReader> reader, PreprocessOptions options);
+
+  SampleBatch GetNextBatch(int32_t batch_size) override;
+  void Reset() override;
+  absl::Status ReadStatus() const override;
+
+ private:
+  // NOTE: sets feature_scales_ / feature_shifts_ up on the first batch, once the feature
+  // count is known.
+  void FoldFeatureTransform(int32_t feature_count);
+  template <typename T>
+  SampleBatch Preprocess(const SampleBatch& batch);
+
+  std::unique_ptr<DataReader> reader_;
+  PreprocessOptions options_;
+  // NOTE: feature i becomes x * feature_scales_[i] + feature_shifts_[i].
+  std::vector<double> feature_scales_;
+  std::vector<double> feature_shifts_;
+  // NOTE: backs the last returned batch, reused across batches.
+  std::vector<std::byte> features_;
+  std::vector<std::byte> targets_;
+};
+
+#endif
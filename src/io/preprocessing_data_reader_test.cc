@@ -0,0 +1,79 @@
+#include "src/io/preprocessing_data_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "src/io/data_reader.h"
+
+// NOTE: hands out fixed UINT8 samples, in order.
+class FixedReader : public DataReader {
+ public:
+  FixedReader(std::vector<uint32_t> labels, std::vector<uint8_t> features) :
+    labels_(std::move(labels)), features_(std::move(features)), next_(0) {}
+
+  SampleBatch GetNextBatch(int32_t batch_size) override {
+    const SampleBatch all = {
+      .dtype = DatasetDtype::UINT8,
+      .feature_count = (int32_t) (features_.size() / labels_.size()),
+      .sample_count = (int64_t) labels_.size(),
+      .labels = labels_.data(),
+      .features = reinterpret_cast<const std::byte*>(features_.data()),
+    };
+    const int64_t begin = next_;
+    next_ = std::min<int64_t>(next_ + batch_size, all.sample_count);
+    return all.Slice(begin, next_);
+  }
+  void Reset() override { next_ = 0; }
+
+ private:
+  std::vector<uint32_t> labels_;
+  std::vector<uint8_t> features_;
+  int64_t next_;
+};
+
+TEST(PreprocessingDataReaderTest, ScalesAndEncodes) {
+  PreprocessingDataReader reader(
+      std::make_unique<FixedReader>(std::vector<uint32_t>({2, 0}), std::vector<uint8_t>({0, 10, 20, 30})),
+      PreprocessOptions { .dtype = DatasetDtype::FLOAT32, .scale = 0.5, .shift = 1.0, .class_count = 3 });
+  SampleBatch batch = reader.GetNextBatch(2);
+  ASSERT_EQ(batch.sample_count, 2);
+  EXPECT_EQ(batch.dtype, DatasetDtype::FLOAT32);
+  std::vector<float> features(4);
+  std::vector<float> targets(6);
+  batch.ConvertFeatures(1.0f, features.data());
+  batch.ConvertTargets(targets.data());
+  EXPECT_EQ(features, std::vector<float>({1, 6, 11, 16}));
+  EXPECT_EQ(targets, std::vector<float>({0, 0, 1, 1, 0, 0}));
+  EXPECT_EQ(batch.Slice(1, 2).targets, batch.targets + 3 * sizeof(float));
+  EXPECT_EQ(reader.GetNextBatch(2).sample_count, 0);
+}
+
+TEST(PreprocessingDataReaderTest, Standardizes) {
+  auto make_reader = []() {
+    return std::make_unique<FixedReader>(
+        std::vector<uint32_t>({0, 0, 0}), std::vector<uint8_t>({1, 7, 2, 7, 3, 7}));
+  };
+  PreprocessOptions options = { .dtype = DatasetDtype::FLOAT64, .scale = 2.0 };
+  std::unique_ptr<DataReader> raw_reader = make_reader();
+  ASSERT_TRUE(ComputeFeatureStatistics(*raw_reader, &options).ok());
+  EXPECT_EQ(options.feature_means, std::vector<double>({4, 14}));
+  // NOTE: the constant feature is only centered.
+  EXPECT_NEAR(options.feature_stddevs[0], std::sqrt(8.0 / 3.0), 1e-12);
+  EXPECT_EQ(options.feature_stddevs[1], 1.0);
+
+  PreprocessingDataReader reader(make_reader(), options);
+  SampleBatch batch = reader.GetNextBatch(8);
+  ASSERT_EQ(batch.sample_count, 3);
+  EXPECT_EQ(batch.targets, nullptr);
+  std::vector<double> features(6);
+  batch.ConvertFeatures(1.0, features.data());
+  EXPECT_NEAR(features[0] + features[2] + features[4], 0.0, 1e-12);
+  EXPECT_NEAR(features[4], 2.0 / std::sqrt(8.0 / 3.0), 1e-12);
+  EXPECT_EQ(features[1], 0.0);
+}
@@ -0,0 +1,127 @@
+#include "src/io/shuffled_data_reader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+namespace {
+
+constexpr int32_t kReadBatchSize = 1024;
+
+}  // namespace
+
+ShuffledDataReader::ShuffledDataReader(std::unique_ptr<DataReader> reader, ShuffleOptions options) :
+  reader_(std::move(reader)),
+  options_(options),
+  all_(),
+  all_labels_(),
+  all_features_(),
+  status_(absl::OkStatus()),
+  epoch_(0),
+  order_(),
+  next_(0),
+  labels_(),
+  features_() {
+    DCHECK(reader_ != nullptr);
+    CHECK(options_.num_shards > 0 &&
+          0 <= options_.shard_index && options_.shard_index < options_.num_shards)
+      << "Invalid shard " << options_.shard_index << " of " << options_.num_shards << ".";
+    std::optional<SampleBatch> all = reader_->All();
+    if (all.has_value()) {
+      all_ = *all;
+    } else {
+      ReadAll();
+    }
+    StartEpoch();
+  }
+
+void ShuffledDataReader::ReadAll() {
+  reader_->Reset();
+  SampleBatch batch = reader_->GetNextBatch(kReadBatchSize);
+  all_.dtype = batch.dtype;
+  all_.feature_count = batch.feature_count;
+  while (batch.sample_count > 0) {
+    const int64_t features_size =
+      batch.sample_count * batch.feature_count * DatasetDtypeSize(batch.dtype);
+    all_labels_.insert(all_labels_.end(), batch.labels, batch.labels + batch.sample_count);
+    all_features_.insert(all_features_.end(), batch.features, batch.features + features_size);
+    batch = reader_->GetNextBatch(kReadBatchSize);
+  }
+  status_ = reader_->ReadStatus();
+  if (!status_.ok()) {
+    all_labels_.clear();
+    all_features_.clear();
+  }
+  all_.sample_count = all_labels_.size();
+  all_.labels = all_labels_.data();
+  all_.features = all_features_.data();
+}
+
+// NOTE: the Fisher-Yates shuffle is spelled out, and seeded through seed_seq, as both are
+// specified exactly by the standard, unlike std::shuffle or the distributions. So orders
+// are the same across platforms / standard libraries.
+void ShuffledDataReader::StartEpoch() {
+  std::vector<int64_t> permutation(all_.sample_count);
+  for (int64_t i = 0; i < all_.sample_count; i++) { permutation[i] = i; }
+  if (options_.shuffle) {
+    std::seed_seq seed_seq = {
+      (uint32_t) options_.seed, (uint32_t) (options_.seed >> 32),
+      (uint32_t) epoch_, (uint32_t) (epoch_ >> 32),
+    };
+    std::mt19937_64 generator(seed_seq);
+    for (int64_t i = all_.sample_count - 1; i > 0; i--) {
+      std::swap(permutation[i], permutation[generator() % (i + 1)]);
+    }
+  }
+
+  order_.clear();
+  for (int64_t i = options_.shard_index; i < all_.sample_count; i += options_.num_shards) {
+    order_.push_back(permutation[i]);
+  }
+  next_ = 0;
+}
+
+SampleBatch ShuffledDataReader::GetNextBatch(int32_t batch_size) {
+  const int64_t begin = next_;
+  next_ = std::min<int64_t>(next_ + batch_size, order_.size());
+  const int64_t sample_count = next_ - begin;
+
+  // NOTE: in file order, the samples are already contiguous.
+  if (!options_.shuffle && options_.num_shards == 1) { return all_.Slice(begin, next_); }
+
+  const int64_t row_size = all_.feature_count * DatasetDtypeSize(all_.dtype);
+  labels_.resize(sample_count);
+  features_.resize(sample_count * row_size);
+  for (int64_t i = 0; i < sample_count; i++) {
+    const int64_t sample = order_[begin + i];
+    labels_[i] = all_.labels[sample];
+    std::memcpy(features_.data() + i * row_size, all_.features + sample * row_size, row_size);
+  }
+  return SampleBatch {
+    .dtype = all_.dtype,
+    .feature_count = all_.feature_count,
+    .sample_count = sample_count,
+    .labels = labels_.data(),
+    .features = features_.data(),
+  };
+}
+
+void ShuffledDataReader::Reset() {
+  if (next_ == 0) { return; }
+  epoch_++;
+  StartEpoch();
+}
+
+absl::Status ShuffledDataReader::ReadStatus() const { return status_; }
+
+int64_t ShuffledDataReader::Epoch() const { return epoch_; }
@@ -0,0 +1,64 @@
+#ifndef SRC_IO_SHUFFLED_DATA_READER_H_
+#define SRC_IO_SHUFFLED_DATA_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "src/io/data_reader.h"
+
+struct ShuffleOptions {
+  // NOTE: without shuffling, every epoch visits the shard in file order.
+  bool shuffle = true;
+  // NOTE: each epoch's order only depends on (seed, epoch), so runs are reproducible, and
+  // processes sharing a seed agree on it.
+  uint64_t seed = 0;
+  // NOTE: each epoch's order is dealt out round robin over num_shards, the reader only
+  // visiting the samples dealt to shard_index. So shards are disjoint, and within one of
+  // each other in size.
+  int32_t shard_index = 0;
+  int32_t num_shards = 1;
+};
+
+// Visits the samples of another DataReader in a new seeded random order every epoch,
+// optionally restricted to one shard of them. Readers with random access (see
+// DataReader::All), e.g. mapped binary datasets, are used in place. Any other reader, e.g.
+// CSV, is read into memory once, on construction.
+class ShuffledDataReader : public DataReader {
+ public:
+  explicit ShuffledDataReader(std::unique_ptr<DataReader> reader, ShuffleOptions options);
+
+  SampleBatch GetNextBatch(int32_t batch_size) override;
+  // Starts the next epoch, in its own order.
+  // NOTE: a no-op if nothing has been read since the current epoch started, so that
+  // resetting before every epoch doesn't skip the first one's order.
+  void Reset() override;
+
+  // NOTE: a reader read into memory that failed hands out no samples at all.
+  absl::Status ReadStatus() const override;
+
+  int64_t Epoch() const;
+
+ private:
+  void ReadAll();
+  void StartEpoch();
+
+  std::unique_ptr<DataReader> reader_;
+  ShuffleOptions options_;
+  SampleBatch all_;
+  // NOTE: backs all_ if reader_ has no random access.
+  std::vector<uint32_t> all_labels_;
+  std::vector<std::byte> all_features_;
+  absl::Status status_;
+  int64_t epoch_;
+  // NOTE: indices into all_ of this shard's samples, in this epoch's order.
+  std::vector<int64_t> order_;
+  int64_t next_;
+  // NOTE: backs the last returned batch, reused across batches.
+  std::vector<uint32_t> labels_;
+  std::vector<std::byte> features_;
+};
+
+#endif
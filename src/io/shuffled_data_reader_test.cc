@@ -0,0 +1,108 @@
+#include "src/io/shuffled_data_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "src/io/data_reader.h"
+
+// NOTE: sample i has label i and a single UINT8 feature i, with random access if asked.
+class CountingReader : public DataReader {
+ public:
+  CountingReader(int32_t sample_count, bool random_access) :
+    labels_(sample_count), features_(sample_count), random_access_(random_access), next_(0) {
+      for (int32_t i = 0; i < sample_count; i++) {
+        labels_[i] = i;
+        features_[i] = (std::byte) i;
+      }
+    }
+
+  SampleBatch GetNextBatch(int32_t batch_size) override {
+    const int64_t begin = next_;
+    next_ = std::min<int64_t>(next_ + batch_size, labels_.size());
+    return Whole().Slice(begin, next_);
+  }
+  void Reset() override { next_ = 0; }
+  std::optional<SampleBatch> All() const override {
+    if (!random_access_) { return std::nullopt; }
+    return Whole();
+  }
+
+ private:
+  SampleBatch Whole() const {
+    return SampleBatch {
+      .dtype = DatasetDtype::UINT8,
+      .feature_count = 1,
+      .sample_count = (int64_t) labels_.size(),
+      .labels = labels_.data(),
+      .features = features_.data(),
+    };
+  }
+
+  std::vector<uint32_t> labels_;
+  std::vector<std::byte> features_;
+  bool random_access_;
+  int64_t next_;
+};
+
+std::vector<uint32_t> ReadEpoch(DataReader& reader) {
+  reader.Reset();
+  std::vector<uint32_t> labels;
+  SampleBatch batch = reader.GetNextBatch(7);
+  while (batch.sample_count > 0) {
+    for (int64_t i = 0; i < batch.sample_count; i++) {
+      EXPECT_EQ((uint32_t) batch.features[i], batch.labels[i]);
+      labels.push_back(batch.labels[i]);
+    }
+    batch = reader.GetNextBatch(7);
+  }
+  return labels;
+}
+
+class ShuffledDataReaderTest : public testing::TestWithParam<bool> {};
+
+TEST_P(ShuffledDataReaderTest, ShardsAreDisjointAndReproducible) {
+  const ShuffleOptions options = { .seed = 42, .num_shards = 3 };
+  std::vector<ShuffledDataReader> shards;
+  std::vector<uint32_t> first_epoch;
+  std::vector<uint32_t> second_epoch;
+  for (int32_t i = 0; i < 3; i++) {
+    ShuffleOptions shard_options = options;
+    shard_options.shard_index = i;
+    ShuffledDataReader reader(std::make_unique<CountingReader>(100, GetParam()), shard_options);
+    const std::vector<uint32_t> epoch = ReadEpoch(reader);
+    EXPECT_GE(epoch.size(), 33);
+    first_epoch.insert(first_epoch.end(), epoch.begin(), epoch.end());
+    const std::vector<uint32_t> next_epoch = ReadEpoch(reader);
+    EXPECT_NE(epoch, next_epoch);
+    second_epoch.insert(second_epoch.end(), next_epoch.begin(), next_epoch.end());
+
+    ShuffledDataReader same_seed(std::make_unique<CountingReader>(100, !GetParam()), shard_options);
+    EXPECT_EQ(ReadEpoch(same_seed), epoch);
+  }
+
+  std::vector<uint32_t> expected(100);
+  for (int32_t i = 0; i < 100; i++) { expected[i] = i; }
+  EXPECT_NE(first_epoch, expected);
+  std::sort(first_epoch.begin(), first_epoch.end());
+  std::sort(second_epoch.begin(), second_epoch.end());
+  EXPECT_EQ(first_epoch, expected);
+  EXPECT_EQ(second_epoch, expected);
+}
+
+TEST_P(ShuffledDataReaderTest, KeepsFileOrderWithoutShuffling) {
+  ShuffledDataReader reader(
+      std::make_unique<CountingReader>(10, GetParam()), ShuffleOptions { .shuffle = false });
+  std::vector<uint32_t> expected(10);
+  for (int32_t i = 0; i < 10; i++) { expected[i] = i; }
+  EXPECT_EQ(ReadEpoch(reader), expected);
+  EXPECT_EQ(ReadEpoch(reader), expected);
+  EXPECT_EQ(reader.Epoch(), 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(RandomAccess, ShuffledDataReaderTest, testing::Bool());
@@ -13,19 +13,20 @@
 #include "absl/log/initialize.h"
 #include "absl/log/log.h"
 #include "src/common/matrix.h"
-#include "src/io/csv_reader.h"
 #include "src/io/model_checkpoint.h"
 #include "src/neural_network/params.h"
 #include "src/neural_network/neural_network.h"
+#include "src/neural_network/learn_rate_schedule.h"
+#include "src/neural_network/optimizer.h"
 #include "src/neural_network/trainer.h"
 
 // Input and output data file paths
 ABSL_FLAG(
     std::string, train_data_file_path, "",
-    "Path to the training dataset.");
+    "Path to the training dataset, CSV or binary (see src/tools:csv_to_dataset).");
 ABSL_FLAG(
     std::string, test_data_file_path, "",
-    "Path to the test dataset.");
+    "Path to the test dataset, CSV or binary (see src/tools:csv_to_dataset).");
 ABSL_FLAG(
     std::string, out_model_checkpoint_file_path, "",
     "Path to where to write the final, trained model checkpoint.");
@@ -48,17 +49,50 @@ ABSL_FLAG(
     std::string(ActivationToString(protos::Activation::SOFTMAX)),
     "Output layer activation function.");
 
+// Model precision
+ABSL_FLAG(
+    std::string, precision,
+    protos::Precision_Name(protos::Precision::DOUBLE),
+    "Element type of the model's parameters and math, one of { DOUBLE, FLOAT }.");
+
 // Training parameters
 ABSL_FLAG(
     std::string, cost,
     std::string(CostToString(Cost::MEAN_SQUARED)),
     "Cost function.");
+ABSL_FLAG(
+    std::string, optimizer,
+    protos::Optimizer_Name(protos::Optimizer::SGD),
+    "Update rule, one of { SGD, NESTEROV, RMSPROP, ADAM, ADAMW }. Resuming from a checkpoint "
+    "written with the same one also resumes its state.");
 ABSL_FLAG(
     double, learn_rate, 0.05,
     "Learn rate, the initial step size for gradient descent.");
+ABSL_FLAG(
+    std::string, learn_rate_schedule,
+    std::string(LearnRateScheduleToString(LearnRateSchedule::CONSTANT)),
+    "How the learn rate decays after warming up, one of { CONSTANT, STEP, COSINE }.");
+ABSL_FLAG(
+    uint32_t, warmup_steps, 0,
+    "The number of batches over which the learn rate ramps up linearly.");
+ABSL_FLAG(
+    uint32_t, decay_steps, 0,
+    "STEP: the number of batches between decays. COSINE: the number of batches to anneal over.");
+ABSL_FLAG(
+    double, decay_rate, 0.1,
+    "STEP: the learn rate's factor per decay. COSINE: the final learn rate's factor.");
 ABSL_FLAG(
     double, momentum, 0.5,
-    "Momentum, influences the gradient descent step size / resistance.");
+    "Momentum, influences the gradient descent step size / resistance. SGD / NESTEROV only.");
+ABSL_FLAG(
+    double, beta1, 0.9,
+    "Decay rate of the running average of gradients. ADAM / ADAMW only.");
+ABSL_FLAG(
+    double, beta2, 0.999,
+    "Decay rate of the running average of squared gradients. RMSPROP / ADAM / ADAMW only.");
+ABSL_FLAG(
+    double, epsilon, 1e-8,
+    "Added to the root mean squared gradients before dividing by them. RMSPROP / ADAM / ADAMW only.");
 ABSL_FLAG(
     double, regularization, 0.0,
     "Regularization, helps combat overfitting");
@@ -74,6 +108,158 @@ ABSL_FLAG(
 ABSL_FLAG(
     uint32_t, num_epochs, 1,
     "The number of times the training data will be iterated through");
+ABSL_FLAG(
+    uint32_t, prefetch_depth, 2,
+    "The number of batches to read ahead of training / testing, 0 to read synchronously.");
+
+// Input preprocessing
+ABSL_FLAG(
+    double, input_scale, 1.0 / 255.0,
+    "Multiplier applied to every input feature, by default mapping pixels to [0, 1].");
+ABSL_FLAG(
+    double, input_shift, 0.0,
+    "Offset added to every input feature, after --input_scale.");
+ABSL_FLAG(
+    bool, standardize_features, false,
+    "Whether to standardize every input feature to zero mean / unit variance over the "
+    "training data, after --input_scale and --input_shift.");
+
+// Training data order
+ABSL_FLAG(
+    bool, shuffle, false,
+    "Whether to visit the training data in a new random order every epoch, rather than in "
+    "file order. CSV training data is read into memory to do so, binary datasets are "
+    "shuffled in place.");
+ABSL_FLAG(
+    uint64_t, shuffle_seed, 0,
+    "Seed of the training data order, runs with the same seed see the same order.");
+ABSL_FLAG(
+    uint32_t, shard_index, 0,
+    "Which of the --num_shards disjoint shards of the training data to train on.");
+ABSL_FLAG(
+    uint32_t, num_shards, 1,
+    "The number of shards the training data is split into, e.g. one per process. Each "
+    "process should use the same --shuffle_seed.");
+
+// Pipelining / asynchronous training
+ABSL_FLAG(
+    uint32_t, max_staleness, 0,
+    "0 trains bulk synchronously. Otherwise each batch's update is applied in the background "
+    "while the next batches train, on parameters missing at most this many of the latest "
+    "updates.");
+ABSL_FLAG(
+    bool, hogwild, false,
+    "Whether every worker should train on batches of its own, applying its updates to the "
+    "shared model without locks, rather than combining their gradients every batch.");
+ABSL_FLAG(
+    uint32_t, eval_every_seconds, 0,
+    "With --hogwild, also test a snapshot of the model every this many seconds while "
+    "training, 0 only tests it at epoch ends.");
+
+// Data parallelism
+ABSL_FLAG(
+    std::vector<std::string>, peers, {},
+    "Comma separated host:port of every process to train data parallel with, one per shard in "
+    "--shard_index order, listed the same by every process. Empty trains in this process alone.");
+ABSL_FLAG(
+    uint32_t, allreduce_bucket_bytes, 1 << 18,
+    "With --peers, gradients are exchanged in buckets of consecutive layers of at least this "
+    "many bytes, starting with the last layers while the earlier ones are back propagated.");
+
+// Checkpointing
+ABSL_FLAG(
+    uint32_t, checkpoint_every_batches, 0,
+    "Also write a checkpoint every this many batches, 0 only writes them at epoch ends.");
+ABSL_FLAG(
+    uint32_t, checkpoint_every_seconds, 0,
+    "Also write a checkpoint every this many seconds, 0 only writes them at epoch ends.");
+ABSL_FLAG(
+    uint32_t, checkpoint_keep_last, 1,
+    "The number of latest checkpoints to keep, earlier ones are suffixed .1, .2, ...");
+
+// NOTE: starting_checkpoint is set to the checkpoint the model was loaded from, if any.
+template <typename T>
+absl::StatusOr<NeuralNetwork<T>> LoadNeuralNetwork(protos::ModelCheckpoint* starting_checkpoint) {
+  if (!absl::GetFlag(FLAGS_in_model_checkpoint_file_path).empty()) {
+    LOG(INFO) << "Using model checkpoint path: "
+      << absl::GetFlag(FLAGS_in_model_checkpoint_file_path);
+
+    absl::StatusOr<protos::ModelCheckpoint> checkpoint =
+      ReadModelCheckpoint(absl::GetFlag(FLAGS_in_model_checkpoint_file_path));
+    CHECK_OK(checkpoint);
+    *starting_checkpoint = *std::move(checkpoint);
+    absl::StatusOr<NeuralNetwork<T>> neural_network =
+      NeuralNetwork<T>::FromCheckpoint(*starting_checkpoint);
+    return neural_network;
+
+  } else if (!absl::GetFlag(FLAGS_layer_sizes).empty()) {
+    LOG(INFO) << "Generating new model with: { "
+      << "dimensions: [ " << absl::StrJoin(absl::GetFlag(FLAGS_layer_sizes), ", ") << " ]"
+      << ", intermed_activation: " << absl::GetFlag(FLAGS_intermediate_activation)
+      << ", output_activation: " << absl::GetFlag(FLAGS_output_activation)
+      << " }.";
+    std::vector<int32_t> layer_sizes;
+    layer_sizes.reserve(absl::GetFlag(FLAGS_layer_sizes).size());
+    for (const std::string& layer_size_str : absl::GetFlag(FLAGS_layer_sizes)) {
+      int32_t layer_size;
+      if (!absl::SimpleAtoi(layer_size_str, &layer_size)) {
+        return absl::InvalidArgumentError( absl::StrCat("Unable to parse layer size: ", layer_size_str));
+      }
+      layer_sizes.push_back(layer_size);
+    }
+    absl::StatusOr<protos::Activation> intermed_activation =
+      ActivationFromString(absl::GetFlag(FLAGS_intermediate_activation));
+    absl::StatusOr<protos::Activation> output_activation =
+      ActivationFromString(absl::GetFlag(FLAGS_output_activation));
+    CHECK_OK(intermed_activation);
+    CHECK_OK(output_activation);
+
+    return NeuralNetwork<T>::Random(std::move(layer_sizes), *intermed_activation, *output_activation);
+
+  }
+
+  return absl::InvalidArgumentError(
+      "Must provide one of "
+      "{ --in_model_checkpoint_file_path } or "
+      "{ --layer_sizes, --intermediate_activation, --output_activation }.");
+}
+
+// NOTE: the starting checkpoint's optimizer state is only resumed if it was written with the
+// same optimizer, e.g. fine tuning with another one starts it from scratch.
+template <typename T>
+absl::StatusOr<Optimizer<T>> LoadOptimizer(
+    const TrainParameters& train_params, const NeuralNetwork<T>& neural_network,
+    const protos::ModelCheckpoint& starting_checkpoint) {
+  if (!starting_checkpoint.has_optimizer_state()) {
+    return Optimizer<T>(train_params, neural_network);
+  }
+  const protos::OptimizerState& optimizer_state = starting_checkpoint.optimizer_state();
+  if (optimizer_state.optimizer() != train_params.optimizer) {
+    LOG(WARNING) << "Checkpoint has " << protos::Optimizer_Name(optimizer_state.optimizer())
+      << " optimizer state, starting " << protos::Optimizer_Name(train_params.optimizer)
+      << " from scratch.";
+    return Optimizer<T>(train_params, neural_network);
+  }
+  LOG(INFO) << "Resuming " << protos::Optimizer_Name(optimizer_state.optimizer())
+    << " optimizer state at step: " << optimizer_state.step();
+  return Optimizer<T>::FromCheckpoint(train_params, neural_network, starting_checkpoint);
+}
+
+template <typename T>
+absl::Status LoadAndTrain(const TrainParameters& train_params) {
+  protos::ModelCheckpoint starting_checkpoint;
+  absl::StatusOr<NeuralNetwork<T>> neural_network = LoadNeuralNetwork<T>(&starting_checkpoint);
+  if (!neural_network.ok()) { return neural_network.status(); }
+  absl::StatusOr<Optimizer<T>> optimizer =
+    LoadOptimizer(train_params, *neural_network, starting_checkpoint);
+  if (!optimizer.ok()) { return optimizer.status(); }
+  return Train(
+      *neural_network, *optimizer, train_params,
+      absl::GetFlag(FLAGS_train_data_file_path),
+      absl::GetFlag(FLAGS_test_data_file_path),
+      absl::GetFlag(FLAGS_out_model_checkpoint_file_path),
+      absl::GetFlag(FLAGS_peers));
+}
 
 int main(int argc, char* argv[]) {
   absl::InitializeLog();
@@ -85,70 +271,70 @@ int main(int argc, char* argv[]) {
     << "Must provide --test_data_file_path.";
   CHECK(!absl::GetFlag(FLAGS_out_model_checkpoint_file_path).empty())
     << "Must provide --out_model_checkpoint_file_path.";
-
-  auto neural_network = [&]() -> absl::StatusOr<NeuralNetwork> {
-    if (!absl::GetFlag(FLAGS_in_model_checkpoint_file_path).empty()) {
-      LOG(INFO) << "Using model checkpoint path: "
-        << absl::GetFlag(FLAGS_in_model_checkpoint_file_path);
-
-      absl::StatusOr<protos::ModelCheckpoint> starting_checkpoint =
-        ReadModelCheckpoint(absl::GetFlag(FLAGS_in_model_checkpoint_file_path));
-      CHECK_OK(starting_checkpoint);
-      absl::StatusOr<NeuralNetwork> neural_network =
-        NeuralNetwork::FromCheckpoint(*starting_checkpoint);
-      return neural_network;
-
-    } else if (!absl::GetFlag(FLAGS_layer_sizes).empty()) {
-      LOG(INFO) << "Generating new model with: { "
-        << "dimensions: [ " << absl::StrJoin(absl::GetFlag(FLAGS_layer_sizes), ", ") << " ]"
-        << ", intermed_activation: " << absl::GetFlag(FLAGS_intermediate_activation)
-        << ", output_activation: " << absl::GetFlag(FLAGS_output_activation)
-        << " }.";
-      std::vector<int32_t> layer_sizes;
-      layer_sizes.reserve(absl::GetFlag(FLAGS_layer_sizes).size());
-      for (const std::string& layer_size_str : absl::GetFlag(FLAGS_layer_sizes)) {
-        int32_t layer_size;
-        if (!absl::SimpleAtoi(layer_size_str, &layer_size)) {
-          return absl::InvalidArgumentError( absl::StrCat("Unable to parse layer size: ", layer_size_str));
-        }
-        layer_sizes.push_back(layer_size);
-      }
-      absl::StatusOr<protos::Activation> intermed_activation =
-        ActivationFromString(absl::GetFlag(FLAGS_intermediate_activation));
-      absl::StatusOr<protos::Activation> output_activation =
-        ActivationFromString(absl::GetFlag(FLAGS_output_activation));
-      CHECK_OK(intermed_activation);
-      CHECK_OK(output_activation);
-
-      return NeuralNetwork::Random(std::move(layer_sizes), *intermed_activation, *output_activation);
-
-    }
-
-    return absl::InvalidArgumentError(
-        "Must provide one of "
-        "{ --in_model_checkpoint_file_path } or "
-        "{ --layer_sizes, --intermediate_activation, --output_activation }.");
-  }();
-  CHECK_OK(neural_network);
+  CHECK(absl::GetFlag(FLAGS_shard_index) < absl::GetFlag(FLAGS_num_shards))
+    << "--shard_index must be less than --num_shards.";
+  CHECK(!absl::GetFlag(FLAGS_hogwild) || absl::GetFlag(FLAGS_max_staleness) == 0)
+    << "--hogwild can't be combined with --max_staleness.";
+  CHECK(absl::GetFlag(FLAGS_peers).empty() ||
+        absl::GetFlag(FLAGS_peers).size() == absl::GetFlag(FLAGS_num_shards))
+    << "--peers must list one process per --num_shards.";
+  CHECK(absl::GetFlag(FLAGS_peers).empty() || !absl::GetFlag(FLAGS_hogwild))
+    << "--hogwild can't be combined with --peers.";
+  CHECK(absl::GetFlag(FLAGS_checkpoint_keep_last) > 0) << "--checkpoint_keep_last must be positive.";
 
   absl::StatusOr<Cost> cost =
     CostFromString(absl::GetFlag(FLAGS_cost));
   CHECK_OK(cost);
+  protos::Optimizer optimizer;
+  CHECK(protos::Optimizer_Parse(absl::GetFlag(FLAGS_optimizer), &optimizer))
+    << "Unknown --optimizer: " << absl::GetFlag(FLAGS_optimizer);
+  absl::StatusOr<LearnRateSchedule> learn_rate_schedule =
+    LearnRateScheduleFromString(absl::GetFlag(FLAGS_learn_rate_schedule));
+  CHECK_OK(learn_rate_schedule);
   TrainParameters train_params = {
     .cost = *cost,
+    .optimizer = optimizer,
     .learn_rate = absl::GetFlag(FLAGS_learn_rate),
+    .learn_rate_schedule = *learn_rate_schedule,
+    .warmup_steps = absl::GetFlag(FLAGS_warmup_steps),
+    .decay_steps = absl::GetFlag(FLAGS_decay_steps),
+    .decay_rate = absl::GetFlag(FLAGS_decay_rate),
     .momentum = absl::GetFlag(FLAGS_momentum),
+    .beta1 = absl::GetFlag(FLAGS_beta1),
+    .beta2 = absl::GetFlag(FLAGS_beta2),
+    .epsilon = absl::GetFlag(FLAGS_epsilon),
     .regularization = absl::GetFlag(FLAGS_regularization),
     .num_threads = absl::GetFlag(FLAGS_num_threads),
     .num_epochs = absl::GetFlag(FLAGS_num_epochs),
     .train_batch_size = absl::GetFlag(FLAGS_train_batch_size),
     .test_batch_size = absl::GetFlag(FLAGS_test_batch_size),
+    .prefetch_depth = absl::GetFlag(FLAGS_prefetch_depth),
+    .input_scale = absl::GetFlag(FLAGS_input_scale),
+    .input_shift = absl::GetFlag(FLAGS_input_shift),
+    .standardize_features = absl::GetFlag(FLAGS_standardize_features),
+    .shuffle = absl::GetFlag(FLAGS_shuffle),
+    .shuffle_seed = absl::GetFlag(FLAGS_shuffle_seed),
+    .shard_index = absl::GetFlag(FLAGS_shard_index),
+    .num_shards = absl::GetFlag(FLAGS_num_shards),
+    .max_staleness = absl::GetFlag(FLAGS_max_staleness),
+    .hogwild = absl::GetFlag(FLAGS_hogwild),
+    .eval_every_seconds = absl::GetFlag(FLAGS_eval_every_seconds),
+    .allreduce_bucket_bytes = absl::GetFlag(FLAGS_allreduce_bucket_bytes),
+    .checkpoint_every_batches = absl::GetFlag(FLAGS_checkpoint_every_batches),
+    .checkpoint_every_seconds = absl::GetFlag(FLAGS_checkpoint_every_seconds),
+    .checkpoint_keep_last = absl::GetFlag(FLAGS_checkpoint_keep_last),
   };
-  CHECK_OK(Train(
-      *neural_network, train_params,
-      absl::GetFlag(FLAGS_train_data_file_path),
-      absl::GetFlag(FLAGS_test_data_file_path),
-      absl::GetFlag(FLAGS_out_model_checkpoint_file_path)));
+
+  protos::Precision precision;
+  CHECK(protos::Precision_Parse(absl::GetFlag(FLAGS_precision), &precision))
+    << "Unknown --precision: " << absl::GetFlag(FLAGS_precision);
+  CHECK(precision != protos::Precision::INT8)
+    << "INT8 models can't be trained, quantize a trained model with src/tools:quantize_model.";
+  LOG(INFO) << "Using precision: " << protos::Precision_Name(precision);
+  switch (precision) {
+    case protos::Precision::FLOAT: CHECK_OK(LoadAndTrain<float>(train_params)); break;
+    default: CHECK_OK(LoadAndTrain<double>(train_params)); break;
+  }
 
   return 0;
 }
@@ -1,15 +1,90 @@
 #ifndef SRC_ACTIVATION_H_
 #define SRC_ACTIVATION_H_
 
-#include <functional>
+#include <algorithm>
+#include <cstdint>
 
+#include "absl/log/check.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
-#include "src/common/matrix.h"
+#include "src/common/kernels.h"
 #include "src/protos/model_checkpoint.pb.h"
 
-std::function<Matrix(const Matrix&)> GetActivation(protos::Activation activation);
-std::function<Matrix(const Matrix&)> GetActivationDeriv(protos::Activation activation);
+// Compile time activation policies, for float or double elements:
+//   kElementWise: whether Apply works on any run of elements, or needs whole rows.
+//   Apply(x, count): turns weighted inputs into activated outputs, in place.
+//   DerivMult(a, pd, count): pd *= d activated / d weighted input, computed from the
+//     activated values a alone.
+// Layers pick a policy once per call through DispatchActivation, everything below that is
+// resolved at compile time, so e.g. bias add + activation fuses into the GEMM epilogue.
+
+struct SigmoidActivation {
+  static constexpr bool kElementWise = true;
+  template <typename T>
+  static void Apply(T* x, int64_t count) {
+    GetMatrixKernels<T>().sigmoid(x, x, count);
+  }
+  // NOTE: s' = s * (1 - s)
+  template <typename T>
+  static void DerivMult(const T* a, T* pd, int64_t count) {
+    GetMatrixKernels<T>().sigmoid_deriv_mul(a, pd, count);
+  }
+};
+
+// TODO: usually don't see upper bounds clamping, could investigate
+struct ReLUActivation {
+  static constexpr bool kElementWise = true;
+  template <typename T>
+  static void Apply(T* x, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { x[i] = std::min(std::max(x[i], T(0)), T(1)); }
+  }
+  // NOTE: the slope is 1 strictly inside the clamped range, which is exactly where the
+  // activated value is strictly between 0 and 1.
+  template <typename T>
+  static void DerivMult(const T* a, T* pd, int64_t count) {
+    for (int64_t i = 0; i < count; i++) { pd[i] = (a[i] > 0 && a[i] < 1) ? pd[i] : T(0); }
+  }
+};
+
+struct TanHActivation {
+  static constexpr bool kElementWise = true;
+  template <typename T>
+  static void Apply(T* x, int64_t count) {
+    GetMatrixKernels<T>().tanh(x, x, count);
+  }
+  // NOTE: t' = 1 - t^2
+  template <typename T>
+  static void DerivMult(const T* a, T* pd, int64_t count) {
+    GetMatrixKernels<T>().tanh_deriv_mul(a, pd, count);
+  }
+};
+
+// NOTE: softmax is normalized per row, each row being an independent sample, so Apply
+// must be given exactly one row.
+struct SoftmaxActivation {
+  static constexpr bool kElementWise = false;
+  // NOTE: defined for float and double.
+  template <typename T>
+  static void Apply(T* row, int64_t count);
+  // NOTE: only the diagonal of the softmax jacobian, s_i * (1 - s_i), same as sigmoid.
+  template <typename T>
+  static void DerivMult(const T* a, T* pd, int64_t count) {
+    GetMatrixKernels<T>().sigmoid_deriv_mul(a, pd, count);
+  }
+};
+
+// Calls fn with a default constructed instance of the policy matching activation.
+template <typename Fn>
+decltype(auto) DispatchActivation(protos::Activation activation, Fn&& fn) {
+  switch (activation) {
+    case protos::Activation::SIGMOID: { return fn(SigmoidActivation()); }
+    case protos::Activation::RELU: { return fn(ReLUActivation()); }
+    case protos::Activation::TANH: { return fn(TanHActivation()); }
+    case protos::Activation::SOFTMAX: { return fn(SoftmaxActivation()); }
+    default: { CHECK(false); return fn(SigmoidActivation()); }
+  }
+}
+
 absl::string_view ActivationToString(protos::Activation activation);
 absl::StatusOr<protos::Activation> ActivationFromString(std::string activation_str);
 
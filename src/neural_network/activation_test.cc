@@ -0,0 +1,20 @@
+#include "src/neural_network/activation.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+TEST(ActivationTest, ReLUClampsToUnitRange) {
+  std::vector<double> x = {-2.0, 0.0, 0.25, 1.0, 3.0};
+  ReLUActivation::Apply(x.data(), x.size());
+  EXPECT_EQ(x, std::vector<double>({0.0, 0.0, 0.25, 1.0, 1.0}));
+}
+
+// NOTE: the derivative used to be 1 everywhere, which kept training clamped units.
+TEST(ActivationTest, ReLUDerivativeIsZeroWhereClamped) {
+  const std::vector<double> activated = {0.0, 0.25, 0.75, 1.0};
+  std::vector<double> pd = {2.0, 2.0, 2.0, 2.0};
+  ReLUActivation::DerivMult(activated.data(), pd.data(), pd.size());
+  EXPECT_EQ(pd, std::vector<double>({0.0, 2.0, 2.0, 0.0}));
+}
@@ -1,7 +1,6 @@
 #include "src/neural_network/cost.h"
 
-#include <cmath>
-#include <functional>
+#include <cstdint>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -9,31 +8,6 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
-#include "src/common/matrix.h"
-
-Matrix MeanSquaredError(const Matrix& actual, const Matrix& expected) {
-  return (actual - expected) * 0.5;
-}
-
-Matrix MeanSquaredErrorDeriv(const Matrix& actual, const Matrix& expected) {
-  return (actual - expected);
-}
-
-std::function<Matrix(const Matrix&, const Matrix&)> GetCost(Cost cost) {
-  using enum Cost;
-  switch (cost) {
-    case MEAN_SQUARED: { return MeanSquaredError; }
-    default: { CHECK(false); return MeanSquaredError; }
-  }
-}
-
-std::function<Matrix(const Matrix&, const Matrix&)> GetCostDeriv(Cost cost) {
-  using enum Cost;
-  switch (cost) {
-    case MEAN_SQUARED: { return MeanSquaredErrorDeriv; }
-    default: { CHECK(false); return MeanSquaredErrorDeriv; }
-  }
-}
 
 absl::string_view CostToString(Cost activation) {
   return kCostStr[static_cast<int32_t>(activation)];
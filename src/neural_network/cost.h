@@ -1,11 +1,13 @@
 #ifndef SRC_COST_H_
 #define SRC_COST_H_
 
-#include <functional>
+#include <cstdint>
+#include <vector>
 
+#include "absl/log/check.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
-#include "src/common/matrix.h"
+#include "src/common/kernels.h"
 
 enum class Cost {
   MEAN_SQUARED,
@@ -15,8 +17,25 @@ static const std::vector<absl::string_view> kCostStr {
   "MEAN_SQUARED",
 };
 
-std::function<Matrix(const Matrix&, const Matrix&)> GetCost(Cost cost);
-std::function<Matrix(const Matrix&, const Matrix&)> GetCostDeriv(Cost cost);
+// Compile time cost policies, see activation.h:
+//   Deriv(actual, expected, out, count): out = d cost / d actual.
+
+struct MeanSquaredCost {
+  template <typename T>
+  static void Deriv(const T* actual, const T* expected, T* out, int64_t count) {
+    GetMatrixKernels<T>().sub(actual, expected, out, count);
+  }
+};
+
+// Calls fn with a default constructed instance of the policy matching cost.
+template <typename Fn>
+decltype(auto) DispatchCost(Cost cost, Fn&& fn) {
+  switch (cost) {
+    case Cost::MEAN_SQUARED: { return fn(MeanSquaredCost()); }
+    default: { CHECK(false); return fn(MeanSquaredCost()); }
+  }
+}
+
 absl::string_view CostToString(Cost activation);
 absl::StatusOr<Cost> CostFromString(std::string activation_str);
 
@@ -0,0 +1,151 @@
+#include "src/neural_network/inference_engine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/io/model_file.h"
+#include "src/neural_network/input_transform.h"
+#include "src/neural_network/layer.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// NOTE: a mapped model file, and a copy of its first layer if an input transform is folded
+// into it.
+template <typename T>
+struct MappedParameters {
+  explicit MappedParameters(ModelFile file) : file(std::move(file)) {}
+
+  ModelFile file;
+  Matrix<T> first_weights;
+  Matrix<T> first_biases;
+};
+
+template <typename T>
+InferenceEngine<T>::InferenceEngine(
+    std::vector<LayerParameters> layers, std::shared_ptr<const void> parameters) :
+  layers_(std::move(layers)),
+  parameters_(std::move(parameters)),
+  max_hidden_size_(0) {
+    CHECK(!layers_.empty());
+    for (int32_t i = 0; i < (int32_t) layers_.size() - 1; i++) {
+      DCHECK(layers_[i].output_size == layers_[i + 1].input_size);
+      max_hidden_size_ = std::max(max_hidden_size_, layers_[i].output_size);
+    }
+  }
+
+template <typename T>
+InferenceEngine<T> InferenceEngine<T>::FromNeuralNetwork(const NeuralNetwork<T>& neural_network) {
+  // NOTE: weights and biases of layer i are matrices 2i and 2i + 1, reserved up front so
+  // they don't move once borrowed.
+  std::shared_ptr<std::vector<Matrix>> matrices = std::make_shared<std::vector<Matrix>>();
+  matrices->reserve(2 * neural_network.LayersCount());
+  std::vector<LayerParameters> layers;
+  layers.reserve(neural_network.LayersCount());
+  for (int32_t i = 0; i < neural_network.LayersCount(); i++) {
+    const Layer<T>& layer = neural_network.GetLayer(i);
+    const Matrix& weights = matrices->emplace_back(layer.Weights());
+    const Matrix& biases = matrices->emplace_back(layer.Biases());
+    layers.push_back(LayerParameters {
+      .weights = weights.Elements().data(),
+      .biases = biases.Elements().data(),
+      .input_size = weights.RowCount(),
+      .output_size = weights.ColCount(),
+      .activation = layer.Activation(),
+    });
+  }
+  return InferenceEngine(std::move(layers), std::move(matrices));
+}
+
+template <typename T>
+absl::StatusOr<InferenceEngine<T>> InferenceEngine<T>::FromCheckpoint(
+    const protos::ModelCheckpoint& checkpoint_proto) {
+  if (checkpoint_proto.has_input_transform()) {
+    protos::ModelCheckpoint folded_proto = checkpoint_proto;
+    absl::Status status = FoldInputTransform(&folded_proto);
+    if (!status.ok()) { return status; }
+    return FromCheckpoint(folded_proto);
+  }
+  absl::StatusOr<NeuralNetwork<T>> neural_network = NeuralNetwork<T>::FromCheckpoint(checkpoint_proto);
+  if (!neural_network.ok()) { return neural_network.status(); }
+  return FromNeuralNetwork(*neural_network);
+}
+
+template <typename T>
+absl::StatusOr<InferenceEngine<T>> InferenceEngine<T>::FromModelFile(ModelFile model_file) {
+  constexpr protos::Precision kPrecision =
+    std::is_same_v<T, float> ? protos::Precision::FLOAT : protos::Precision::DOUBLE;
+  if (model_file.Precision() != kPrecision) { return FromCheckpoint(model_file.ToCheckpoint()); }
+
+  std::shared_ptr<MappedParameters<T>> parameters =
+    std::make_shared<MappedParameters<T>>(std::move(model_file));
+  const std::vector<ModelFile::Layer>& file_layers = parameters->file.Layers();
+  std::vector<LayerParameters> layers;
+  layers.reserve(file_layers.size());
+  for (int32_t i = 0; i < file_layers.size(); i++) {
+    layers.push_back(LayerParameters {
+      .weights = reinterpret_cast<const T*>(file_layers[i].weights),
+      .biases = reinterpret_cast<const T*>(file_layers[i].biases),
+      .input_size = file_layers[i].row_count,
+      .output_size = file_layers[i].col_count,
+      .activation = (i == file_layers.size() - 1) ?
+        parameters->file.OutputActivation() : parameters->file.IntermedActivation(),
+    });
+  }
+  if (parameters->file.InputTransform().has_value()) {
+    absl::StatusOr<FeatureAffine> affine =
+      ResolveInputTransform(*parameters->file.InputTransform(), layers[0].input_size);
+    if (!affine.ok()) { return affine.status(); }
+    LayerParameters& first_layer = layers[0];
+    parameters->first_weights = Matrix(first_layer.input_size, first_layer.output_size);
+    parameters->first_biases = Matrix(1, first_layer.output_size);
+    std::copy_n(
+        first_layer.weights, parameters->first_weights.Elements().size(),
+        parameters->first_weights.MutableData());
+    std::copy_n(first_layer.biases, first_layer.output_size, parameters->first_biases.MutableData());
+    FoldFeatureAffine(
+        *affine, first_layer.output_size, parameters->first_weights.MutableData(),
+        parameters->first_biases.MutableData());
+    first_layer.weights = parameters->first_weights.Elements().data();
+    first_layer.biases = parameters->first_biases.Elements().data();
+  }
+  return InferenceEngine(std::move(layers), std::move(parameters));
+}
+
+template <typename T>
+int32_t InferenceEngine<T>::InputSize() const { return layers_.front().input_size; }
+
+template <typename T>
+int32_t InferenceEngine<T>::OutputSize() const { return layers_.back().output_size; }
+
+template <typename T>
+typename InferenceEngine<T>::Workspace InferenceEngine<T>::NewWorkspace(int32_t max_batch_size) const {
+  DCHECK(max_batch_size > 0);
+  return Workspace(max_batch_size, max_hidden_size_);
+}
+
+// NOTE: layer i writes buffer i % 2 while reading layer i - 1's output out of the other.
+template <typename T>
+void InferenceEngine<T>::Infer(const T* input, int32_t batch_size, Workspace* workspace, T* output) const {
+  DCHECK(workspace != nullptr);
+  DCHECK(0 < batch_size && batch_size <= workspace->MaxBatchSize());
+  const T* layer_input = input;
+  for (int32_t i = 0; i < layers_.size(); i++) {
+    const LayerParameters& layer = layers_[i];
+    T* layer_output = (i == layers_.size() - 1) ? output : workspace->buffers_[i % 2].MutableData();
+    FeedForwardInto(
+        layer.activation, layer.weights, layer.biases, layer.input_size, layer.output_size,
+        layer_input, batch_size, layer_output);
+    layer_input = layer_output;
+  }
+}
+
+template class InferenceEngine<float>;
+template class InferenceEngine<double>;
@@ -0,0 +1,86 @@
+#ifndef SRC_NEURAL_NETWORK_INFERENCE_ENGINE_H_
+#define SRC_NEURAL_NETWORK_INFERENCE_ENGINE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/io/model_file.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// Forward only runner of a trained model, for serving. Parameters are copied out of the
+// model once, or read in place from a mapped model file, and layer shapes are fixed up
+// front. Intermediate activations ping-pong between the two buffers of a caller owned
+// Workspace, and the last layer writes straight into the caller's output, so a forward pass
+// allocates nothing.
+// NOTE: the engine is immutable, any number of threads may Infer at once, each with its
+// own Workspace. Copies share one set of parameters. GEMM packing buffers are thread local,
+// allocated on a thread's first pass.
+// T is float or double.
+template <typename T>
+class InferenceEngine {
+ public:
+  using Matrix = ::Matrix<T>;
+
+  // Preallocated intermediate activations for batches of up to MaxBatchSize samples.
+  class Workspace {
+   public:
+    int32_t MaxBatchSize() const { return max_batch_size_; }
+
+   private:
+    friend class InferenceEngine;
+    Workspace(int32_t max_batch_size, int32_t max_hidden_size) :
+      max_batch_size_(max_batch_size),
+      buffers_({Matrix(max_batch_size, max_hidden_size), Matrix(max_batch_size, max_hidden_size)}) {}
+
+    int32_t max_batch_size_;
+    std::array<Matrix, 2> buffers_;
+  };
+
+  static InferenceEngine FromNeuralNetwork(const NeuralNetwork<T>& neural_network);
+  // NOTE: checkpoints of either precision can be loaded, they're converted to T. Their input
+  // transform is folded into the first layer, see FoldInputTransform, so the engine is fed
+  // raw features.
+  static absl::StatusOr<InferenceEngine> FromCheckpoint(
+      const protos::ModelCheckpoint& checkpoint_proto);
+  // NOTE: a model file of precision T is served straight out of its mapping, which the engine
+  // keeps open, so loading doesn't read the weights, bar the first layer's when an input
+  // transform is folded into a copy of them. Others are converted to T.
+  static absl::StatusOr<InferenceEngine> FromModelFile(ModelFile model_file);
+
+  int32_t InputSize() const;
+  int32_t OutputSize() const;
+  Workspace NewWorkspace(int32_t max_batch_size) const;
+
+  // Runs batch_size x InputSize() inputs into batch_size x OutputSize() outputs, one sample
+  // per row, for batch_size up to the workspace's MaxBatchSize.
+  void Infer(const T* input, int32_t batch_size, Workspace* workspace, T* output) const;
+
+ private:
+  // NOTE: row-major input_size x output_size weights and output_size biases, borrowed from
+  // parameters_.
+  struct LayerParameters {
+    const T* weights;
+    const T* biases;
+    int32_t input_size;
+    int32_t output_size;
+    protos::Activation activation;
+  };
+
+  explicit InferenceEngine(std::vector<LayerParameters> layers, std::shared_ptr<const void> parameters);
+
+  std::vector<LayerParameters> layers_;
+  // NOTE: owns the memory layers_ point into, copied matrices or a ModelFile.
+  std::shared_ptr<const void> parameters_;
+  // NOTE: the widest intermediate activation, sizing workspace buffers.
+  int32_t max_hidden_size_;
+};
+
+extern template class InferenceEngine<float>;
+extern template class InferenceEngine<double>;
+
+#endif
@@ -0,0 +1,120 @@
+#include "src/neural_network/inference_engine.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/io/model_file.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+template <typename T>
+class InferenceEngineTest : public testing::Test {};
+
+using ElementTypes = testing::Types<float, double>;
+TYPED_TEST_SUITE(InferenceEngineTest, ElementTypes);
+
+TYPED_TEST(InferenceEngineTest, MatchesNeuralNetwork) {
+  using T = TypeParam;
+  const NeuralNetwork<T> neural_network = NeuralNetwork<T>::Random(
+      {12, 9, 16, 5}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const InferenceEngine<T> engine = InferenceEngine<T>::FromNeuralNetwork(neural_network);
+  ASSERT_EQ(engine.InputSize(), 12);
+  ASSERT_EQ(engine.OutputSize(), 5);
+
+  typename InferenceEngine<T>::Workspace workspace = engine.NewWorkspace(8);
+  for (int32_t batch_size : {1, 3, 8}) {
+    const Matrix<T> input = Matrix<T>::Random(batch_size, 12);
+    const Matrix<T> expected = neural_network.Infer(input);
+    std::vector<T> output(batch_size * 5);
+    engine.Infer(input.Elements().data(), batch_size, &workspace, output.data());
+    for (int32_t i = 0; i < output.size(); i++) {
+      EXPECT_NEAR(output[i], expected.Elements()[i], 1e-5) << "batch_size: " << batch_size;
+    }
+  }
+}
+
+TYPED_TEST(InferenceEngineTest, LoadsCheckpoints) {
+  using T = TypeParam;
+  const NeuralNetwork<double> neural_network = NeuralNetwork<double>::Random(
+      {4, 3}, protos::Activation::SIGMOID, protos::Activation::SIGMOID);
+  absl::StatusOr<InferenceEngine<T>> engine =
+    InferenceEngine<T>::FromCheckpoint(neural_network.ToCheckpoint());
+  ASSERT_TRUE(engine.ok());
+
+  const Matrix<double> input = Matrix<double>::Random(1, 4);
+  const Matrix<double> expected = neural_network.Infer(input);
+  const std::vector<T> engine_input(input.Elements().begin(), input.Elements().end());
+  std::vector<T> output(3);
+  typename InferenceEngine<T>::Workspace workspace = engine->NewWorkspace(1);
+  engine->Infer(engine_input.data(), 1, &workspace, output.data());
+  for (int32_t i = 0; i < 3; i++) { EXPECT_NEAR(output[i], expected.Elements()[i], 1e-5); }
+}
+
+TYPED_TEST(InferenceEngineTest, LoadsModelFiles) {
+  using T = TypeParam;
+  const std::string file_path =
+    (std::filesystem::temp_directory_path() / "inference_engine_test.nnmf").string();
+  const NeuralNetwork<T> neural_network = NeuralNetwork<T>::Random(
+      {6, 7, 3}, protos::Activation::TANH, protos::Activation::SOFTMAX);
+  ASSERT_TRUE(WriteModelFile(file_path, neural_network.ToCheckpoint()).ok());
+  absl::StatusOr<ModelFile> model_file = ModelFile::Open(file_path);
+  ASSERT_TRUE(model_file.ok());
+  absl::StatusOr<InferenceEngine<T>> engine = InferenceEngine<T>::FromModelFile(*std::move(model_file));
+  ASSERT_TRUE(engine.ok());
+
+  const Matrix<T> input = Matrix<T>::Random(2, 6);
+  const Matrix<T> expected = neural_network.Infer(input);
+  std::vector<T> output(2 * 3);
+  typename InferenceEngine<T>::Workspace workspace = engine->NewWorkspace(2);
+  engine->Infer(input.Elements().data(), 2, &workspace, output.data());
+  for (int32_t i = 0; i < output.size(); i++) { EXPECT_NEAR(output[i], expected.Elements()[i], 1e-5); }
+}
+
+TYPED_TEST(InferenceEngineTest, AppliesInputTransforms) {
+  using T = TypeParam;
+  const NeuralNetwork<T> neural_network = NeuralNetwork<T>::Random(
+      {4, 5, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  protos::ModelCheckpoint checkpoint_proto = neural_network.ToCheckpoint();
+  protos::InputTransform& transform_proto = *checkpoint_proto.mutable_input_transform();
+  transform_proto.set_scale(0.5);
+  transform_proto.set_shift(0.25);
+  for (double mean : {1.0, -2.0, 0.0, 3.0}) { transform_proto.add_feature_means(mean); }
+  for (double inverse_stddev : {2.0, 0.5, 1.0, 4.0}) {
+    transform_proto.add_feature_inverse_stddevs(inverse_stddev);
+  }
+  const std::string file_path =
+    (std::filesystem::temp_directory_path() / "inference_engine_test.nnmf").string();
+  ASSERT_TRUE(WriteModelFile(file_path, checkpoint_proto).ok());
+  absl::StatusOr<ModelFile> model_file = ModelFile::Open(file_path);
+  ASSERT_TRUE(model_file.ok());
+
+  const Matrix<T> input = Matrix<T>::Random(2, 4);
+  Matrix<T> transformed_input = input;
+  for (int32_t i = 0; i < 2; i++) {
+    for (int32_t j = 0; j < 4; j++) {
+      transformed_input.MutableElementAt(i, j) = (T) (
+          (input.ElementAt(i, j) * 0.5 + 0.25 - transform_proto.feature_means(j)) *
+          transform_proto.feature_inverse_stddevs(j));
+    }
+  }
+  const Matrix<T> expected = neural_network.Infer(transformed_input);
+  for (absl::StatusOr<InferenceEngine<T>> engine : {
+      InferenceEngine<T>::FromCheckpoint(checkpoint_proto),
+      InferenceEngine<T>::FromModelFile(*std::move(model_file))}) {
+    ASSERT_TRUE(engine.ok()) << engine.status();
+    std::vector<T> output(2 * 3);
+    typename InferenceEngine<T>::Workspace workspace = engine->NewWorkspace(2);
+    engine->Infer(input.Elements().data(), 2, &workspace, output.data());
+    for (int32_t i = 0; i < output.size(); i++) { EXPECT_NEAR(output[i], expected.Elements()[i], 1e-5); }
+  }
+
+  transform_proto.mutable_feature_means()->RemoveLast();
+  EXPECT_FALSE(InferenceEngine<T>::FromCheckpoint(checkpoint_proto).ok());
+}
@@ -0,0 +1,89 @@
+#include "src/neural_network/input_transform.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+absl::StatusOr<FeatureAffine> ResolveInputTransform(
+    const protos::InputTransform& transform_proto, int32_t feature_count) {
+  const int32_t standardized_count = transform_proto.feature_means().size();
+  if (transform_proto.feature_inverse_stddevs().size() != standardized_count ||
+      (standardized_count != 0 && standardized_count != feature_count)) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Input transform for ", feature_count, " features has ", standardized_count,
+          " means and ", transform_proto.feature_inverse_stddevs().size(),
+          " inverse standard deviations."));
+  }
+  FeatureAffine affine = {
+    .scales = std::vector<double>(feature_count, transform_proto.scale()),
+    .shifts = std::vector<double>(feature_count, transform_proto.shift()),
+  };
+  for (int32_t i = 0; i < standardized_count; i++) {
+    const double inverse_stddev = transform_proto.feature_inverse_stddevs(i);
+    affine.scales[i] *= inverse_stddev;
+    affine.shifts[i] = (affine.shifts[i] - transform_proto.feature_means(i)) * inverse_stddev;
+  }
+  return affine;
+}
+
+// NOTE: the biases take their shifts with the unscaled weights, before the rows are scaled.
+template <typename T>
+void FoldFeatureAffine(const FeatureAffine& affine, int32_t output_size, T* weights, T* biases) {
+  std::vector<double> bias_shifts(output_size, 0.0);
+  for (int32_t i = 0; i < affine.scales.size(); i++) {
+    T* row = weights + (int64_t) i * output_size;
+    for (int32_t j = 0; j < output_size; j++) {
+      bias_shifts[j] += affine.shifts[i] * row[j];
+      row[j] = (T) (affine.scales[i] * row[j]);
+    }
+  }
+  for (int32_t j = 0; j < output_size; j++) { biases[j] = (T) (biases[j] + bias_shifts[j]); }
+}
+
+template void FoldFeatureAffine(const FeatureAffine&, int32_t, float*, float*);
+template void FoldFeatureAffine(const FeatureAffine&, int32_t, double*, double*);
+
+absl::Status FoldInputTransform(protos::ModelCheckpoint* checkpoint_proto) {
+  if (!checkpoint_proto->has_input_transform()) { return absl::OkStatus(); }
+  const protos::Precision precision = checkpoint_proto->precision();
+  if (precision != protos::Precision::DOUBLE && precision != protos::Precision::FLOAT) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Can't fold an input transform into a ", protos::Precision_Name(precision), " model."));
+  }
+  if (checkpoint_proto->layers().empty()) {
+    return absl::InvalidArgumentError("Checkpoint has no layers.");
+  }
+  protos::Layer& layer_proto = *checkpoint_proto->mutable_layers(0);
+  const int64_t row_count = layer_proto.row_count();
+  const int64_t col_count = layer_proto.col_count();
+  const bool is_float = (precision == protos::Precision::FLOAT);
+  const int64_t weight_count =
+    is_float ? layer_proto.float_weights().size() : layer_proto.weights().size();
+  const int64_t bias_count =
+    is_float ? layer_proto.float_biases().size() : layer_proto.biases().size();
+  if (row_count <= 0 || col_count <= 0 ||
+      weight_count != row_count * col_count || bias_count != col_count) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Layer: 0 of shape ", row_count, "x", col_count, " has ", weight_count,
+          " weights and ", bias_count, " biases."));
+  }
+
+  absl::StatusOr<FeatureAffine> affine =
+    ResolveInputTransform(checkpoint_proto->input_transform(), row_count);
+  if (!affine.ok()) { return affine.status(); }
+  if (is_float) {
+    FoldFeatureAffine(
+        *affine, col_count, layer_proto.mutable_float_weights()->mutable_data(),
+        layer_proto.mutable_float_biases()->mutable_data());
+  } else {
+    FoldFeatureAffine(
+        *affine, col_count, layer_proto.mutable_weights()->mutable_data(),
+        layer_proto.mutable_biases()->mutable_data());
+  }
+  checkpoint_proto->clear_input_transform();
+  return absl::OkStatus();
+}
@@ -0,0 +1,35 @@
+#ifndef SRC_NEURAL_NETWORK_INPUT_TRANSFORM_H_
+#define SRC_NEURAL_NETWORK_INPUT_TRANSFORM_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// A protos::InputTransform resolved for a number of features: feature i becomes
+// x * scales[i] + shifts[i].
+struct FeatureAffine {
+  std::vector<double> scales;
+  std::vector<double> shifts;
+};
+
+// Fails if transform_proto's means / inverse standard deviations aren't either empty or one
+// per feature.
+absl::StatusOr<FeatureAffine> ResolveInputTransform(
+    const protos::InputTransform& transform_proto, int32_t feature_count);
+
+// Folds affine into a row-major affine.scales.size() x output_size layer, in place, so that
+// it takes raw features: weights row i is scaled by scales[i], and biases gain
+// sum_i shifts[i] * weights row i.
+// NOTE: inference then costs nothing more than on transformed features.
+template <typename T>
+void FoldFeatureAffine(const FeatureAffine& affine, int32_t output_size, T* weights, T* biases);
+
+// Folds checkpoint_proto's input transform, if any, into its first layer and clears it, so
+// that the model is fed raw features. Fails for INT8 checkpoints carrying a transform, which
+// quantization folds before quantizing.
+absl::Status FoldInputTransform(protos::ModelCheckpoint* checkpoint_proto);
+
+#endif
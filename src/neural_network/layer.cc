@@ -1,75 +1,152 @@
 #include "src/neural_network/layer.h"
 
+#include <cstdint>
 #include <optional>
 
 #include "absl/log/check.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
 #include "src/neural_network/activation.h"
 #include "src/neural_network/cost.h"
 #include "src/neural_network/params.h"
 
-int32_t Layer::InputSize() const { return weights_.RowCount(); }
+template <typename T>
+int32_t Layer<T>::InputSize() const { return weights_.RowCount(); }
 
-int32_t Layer::OutputSize() const { return weights_.ColCount(); }
+template <typename T>
+int32_t Layer<T>::OutputSize() const { return weights_.ColCount(); }
 
-const Matrix& Layer::Weights() const { return weights_; }
+template <typename T>
+const Matrix<T>& Layer<T>::Weights() const { return weights_; }
 
-const Matrix& Layer::Biases() const { return biases_; }
+template <typename T>
+const Matrix<T>& Layer<T>::Biases() const { return biases_; }
 
-Matrix Layer::Infer(const Matrix& input) const {
-  return GetActivation(activation_)(input * weights_);
+template <typename T>
+Matrix<T>& Layer<T>::MutableWeights() { return weights_; }
+
+template <typename T>
+Matrix<T>& Layer<T>::MutableBiases() { return biases_; }
+
+template <typename T>
+protos::Activation Layer<T>::Activation() const { return activation_; }
+
+// NOTE: adds biases and activates a block of weighted inputs while it's still in cache.
+// Activations that need whole rows (softmax) can't rely on a block spanning a full row,
+// so they're applied once the GEMM is done instead.
+template <typename Activation, typename T>
+void BiasActivationEpilogue(
+    const void* context, T* c, int32_t rows, int32_t cols, int64_t ldc, int32_t col) {
+  const T* biases = static_cast<const T*>(context) + col;
+  const MatrixKernels<T>& kernels = GetMatrixKernels<T>();
+  for (int32_t r = 0; r < rows; r++) {
+    T* row = c + r * ldc;
+    kernels.add(row, biases, row, cols);
+    if constexpr (Activation::kElementWise) { Activation::Apply(row, cols); }
+  }
+}
+
+template <typename Activation, typename T>
+void FeedForwardFused(
+    const T* weights, const T* biases, int32_t input_size, int32_t output_size,
+    const T* input, int32_t row_count, T* output) {
+  const GemmEpilogue<T> epilogue = {
+    .fn = BiasActivationEpilogue<Activation, T>,
+    .context = biases,
+  };
+  GetMatrixKernels<T>().gemm_epilogue(
+      row_count, output_size, input_size, input, weights, output, epilogue);
+  if constexpr (!Activation::kElementWise) {
+    for (int32_t r = 0; r < row_count; r++) {
+      Activation::Apply(output + (int64_t) r * output_size, output_size);
+    }
+  }
+}
+
+template <typename T>
+void FeedForwardInto(
+    protos::Activation activation, const T* weights, const T* biases,
+    int32_t input_size, int32_t output_size, const T* input, int32_t row_count, T* output) {
+  DispatchActivation(activation, [&](auto activation) {
+    FeedForwardFused<decltype(activation)>(
+        weights, biases, input_size, output_size, input, row_count, output);
+  });
 }
 
-Matrix Layer::FeedForward(const Matrix& input, LayerLearnCache* cache) const {
-  const Matrix w_input = (input * weights_);
-  const Matrix activated = GetActivation(activation_)(w_input);
+template void FeedForwardInto(
+    protos::Activation activation, const float* weights, const float* biases,
+    int32_t input_size, int32_t output_size, const float* input, int32_t row_count, float* output);
+template void FeedForwardInto(
+    protos::Activation activation, const double* weights, const double* biases,
+    int32_t input_size, int32_t output_size, const double* input, int32_t row_count, double* output);
+
+template <typename T>
+Matrix<T> Layer<T>::Infer(const Matrix& input) const {
+  DCHECK(input.ColCount() == weights_.RowCount());
+  Matrix activated(input.RowCount(), weights_.ColCount(), input.Resource());
+  FeedForwardInto(
+      activation_, weights_.Elements().data(), biases_.Elements().data(),
+      weights_.RowCount(), weights_.ColCount(),
+      input.Elements().data(), input.RowCount(), activated.MutableData());
+  return activated;
+}
+
+template <typename T>
+const Matrix<T>& Layer<T>::FeedForward(const Matrix& input, LayerLearnCache* cache) const {
   *cache = LayerLearnCache {
     .layer = this,
-    .input = input,
-    .w_input = w_input,
-    .activated = activated,
+    .input = &input,
+    .activated = Infer(input),
     .pd_cost_weighted_input = std::nullopt,
   };
-  return activated;
+  return cache->activated;
 }
 
-void Layer::CalcPDCostWeightedInputOutput(
+template <typename T>
+void Layer<T>::CalcPDCostWeightedInputOutput(
     const TrainParameters& train_params, LayerLearnCache* cache, const Matrix& expected_output) const {
-  const Matrix pd_cost_activation = GetCostDeriv(train_params.cost)(cache->activated, expected_output);
-  Matrix pd_activation_weighted_input = GetActivationDeriv(activation_)(cache->w_input);
-  pd_activation_weighted_input.HadamardMultInPlace(pd_cost_activation);
-  cache->pd_cost_weighted_input = std::move(pd_activation_weighted_input);
+  DCHECK(expected_output.RowCount() == cache->activated.RowCount());
+  DCHECK(expected_output.ColCount() == cache->activated.ColCount());
+  Matrix pd(cache->activated.RowCount(), cache->activated.ColCount(), cache->activated.Resource());
+  const T* activated = cache->activated.Elements().data();
+  const int64_t count = cache->activated.Elements().size();
+  DispatchActivation(activation_, [&](auto activation) {
+    DispatchCost(train_params.cost, [&](auto cost) {
+      decltype(cost)::Deriv(activated, expected_output.Elements().data(), pd.MutableData(), count);
+      decltype(activation)::DerivMult(activated, pd.MutableData(), count);
+    });
+  });
+  cache->pd_cost_weighted_input = std::move(pd);
 }
 
-void Layer::CalcPDCostWeightedInputIntermed(LayerLearnCache* cache, LayerLearnCache* next_cache) const {
+template <typename T>
+void Layer<T>::CalcPDCostWeightedInputIntermed(LayerLearnCache* cache, LayerLearnCache* next_cache) const {
   DCHECK(next_cache->pd_cost_weighted_input.has_value());
-  // SPEEDUP: Matrix.MultTranspose
   cache->pd_cost_weighted_input =
-    *next_cache->pd_cost_weighted_input * next_cache->layer->weights_.Transpose();
-  cache->pd_cost_weighted_input->HadamardMultInPlace(GetActivationDeriv(activation_)(cache->w_input));
+    next_cache->pd_cost_weighted_input->MultTranspose(next_cache->layer->weights_);
+  DispatchActivation(activation_, [&](auto activation) {
+    decltype(activation)::DerivMult(
+        cache->activated.Elements().data(), cache->pd_cost_weighted_input->MutableData(),
+        cache->activated.Elements().size());
+  });
 }
 
-std::pair<Matrix, Matrix> Layer::FinishBackPropagate(LayerLearnCache* cache) const {
+template <typename T>
+void Layer<T>::FinishBackPropagate(LayerLearnCache* cache, std::pair<Matrix, Matrix>* gradients) const {
   DCHECK(cache->pd_cost_weighted_input.has_value());
-  // SPEEDUP: Matrix.TransposeMult
-  Matrix cost_gradient_weights =
-    cache->input.Transpose() * *cache->pd_cost_weighted_input;
-  Matrix& cost_gradient_biases =
-    *cache->pd_cost_weighted_input /* * 1.0 */;
-  return std::make_pair(cost_gradient_weights, cost_gradient_biases);
+  DCHECK(gradients != nullptr);
+  // NOTE: input^T * delta sums the per-sample weight gradients over the whole batch.
+  gradients->first.AddTransposeMult(*cache->input, *cache->pd_cost_weighted_input);
+  gradients->second += cache->pd_cost_weighted_input->ColumnSums() /* * 1.0 */;
 }
 
-void Layer::ApplyGradients(const TrainParameters& train_params, std::pair<Matrix, Matrix> gradients) {
-  Matrix cost_gradient_weights = std::move(gradients.first);
-  double weight_decay = (1.0 - train_params.regularization * train_params.learn_rate);
-  cost_gradient_weights *= train_params.learn_rate;
-  weight_velocities_ *= train_params.momentum;
-  weight_velocities_ -= cost_gradient_weights;
-  weights_ *= weight_decay;
-  weights_ += weight_velocities_;
-
-  Matrix cost_gradient_biases = std::move(gradients.second);
-  cost_gradient_biases *= train_params.learn_rate;
-  bias_velocities_ *= train_params.momentum;
-  bias_velocities_ -= cost_gradient_biases;
-  biases_ += bias_velocities_;
+template <typename T>
+void Layer<T>::CopyParametersFrom(const Layer& other) {
+  DCHECK(weights_.RowCount() == other.weights_.RowCount());
+  DCHECK(weights_.ColCount() == other.weights_.ColCount());
+  weights_ = other.weights_;
+  biases_ = other.biases_;
 }
+
+template class Layer<float>;
+template class Layer<double>;
@@ -1,7 +1,7 @@
 #ifndef SRC_LAYER_H_
 #define SRC_LAYER_H_
 
-#include <functional>
+#include <cstdint>
 #include <optional>
 #include <utility>
 
@@ -12,15 +12,28 @@
 #include "src/neural_network/params.h"
 #include "src/protos/model_checkpoint.pb.h"
 
+// Runs row_count x input_size inputs through a layer with the given parameters, input_size x
+// output_size weights and output_size biases, into row_count x output_size outputs, without
+// allocating. Rows are contiguous.
+// NOTE: defined for T = float and double. Parameters are borrowed, e.g. from a Matrix or
+// straight out of a mapped model file.
+template <typename T>
+void FeedForwardInto(
+    protos::Activation activation, const T* weights, const T* biases,
+    int32_t input_size, int32_t output_size, const T* input, int32_t row_count, T* output);
+
+// NOTE: T is the element type of the parameters and all intermediate values, float or
+// double. Learn parameters stay double and are narrowed once per update.
+template <typename T>
 class Layer {
  public:
+  using Matrix = ::Matrix<T>;
+
   explicit Layer(
       Matrix weights, Matrix biases,
       protos::Activation activation) :
     weights_(std::move(weights)),
     biases_(std::move(biases)),
-    weight_velocities_(Matrix(weights_.RowCount(), weights_.ColCount())),
-    bias_velocities_(Matrix(biases_.RowCount(), biases_.ColCount())),
     activation_(activation) {
       DCHECK(weights_.ColCount() == biases_.ColCount());
       DCHECK(biases_.RowCount() == 1);
@@ -30,29 +43,40 @@ class Layer {
   int32_t OutputSize() const;
   const Matrix& Weights() const;
   const Matrix& Biases() const;
+  // NOTE: for optimizers, which step the parameters in place, see Optimizer.
+  Matrix& MutableWeights();
+  Matrix& MutableBiases();
+  protos::Activation Activation() const;
 
   Matrix Infer(const Matrix& input) const;
 
+  // NOTE: inputs are BxN blocks, one sample per row, so a whole batch is learned in one pass.
+  // The input is borrowed (the previous layer's activated output, or the network input)
+  // and must outlive back propagation. Weighted inputs aren't kept, activation derivatives
+  // are computed from the activated values. Everything the cache owns is allocated from the
+  // input's memory resource.
   struct LayerLearnCache {
     const Layer* layer;
-    Matrix input;
-    Matrix w_input;
+    const Matrix* input;
     Matrix activated;
     std::optional<Matrix> pd_cost_weighted_input;
   };
-  Matrix FeedForward(const Matrix& input, LayerLearnCache* cache) const;
+  // Returns the activated output, owned by the cache.
+  const Matrix& FeedForward(const Matrix& input, LayerLearnCache* cache) const;
   void CalcPDCostWeightedInputOutput(
       const TrainParameters& train_params, LayerLearnCache* cache, const Matrix& expected_output) const;
   void CalcPDCostWeightedInputIntermed(LayerLearnCache* cache, LayerLearnCache* next_cache) const;
-  std::pair<Matrix, Matrix> FinishBackPropagate(LayerLearnCache* cache) const;
-  void ApplyGradients(const TrainParameters& train_params, std::pair<Matrix, Matrix> gradients);
+  void FinishBackPropagate(LayerLearnCache* cache, std::pair<Matrix, Matrix>* gradients) const;
+  // NOTE: copies other's weights and biases into this layer's, of the same shape, in place.
+  void CopyParametersFrom(const Layer& other);
 
  private:
   Matrix weights_;
   Matrix biases_;
-  Matrix weight_velocities_;
-  Matrix bias_velocities_;
   protos::Activation activation_;
 };
 
+extern template class Layer<float>;
+extern template class Layer<double>;
+
 #endif
@@ -0,0 +1,48 @@
+#include "src/neural_network/learn_rate_schedule.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+
+double ScheduleLearnRate(
+    LearnRateSchedule schedule, double learn_rate, int64_t step,
+    int64_t warmup_steps, int64_t decay_steps, double decay_rate) {
+  DCHECK(step >= 0);
+  if (step < warmup_steps) { return learn_rate * (step + 1) / warmup_steps; }
+  const int64_t decay_step = step - warmup_steps;
+  if (decay_steps == 0) { return learn_rate; }
+  switch (schedule) {
+    case LearnRateSchedule::STEP: {
+      return learn_rate * std::pow(decay_rate, decay_step / decay_steps);
+    }
+    case LearnRateSchedule::COSINE: {
+      const double progress = (double) std::min(decay_step, decay_steps) / decay_steps;
+      return learn_rate *
+        (decay_rate + (1 - decay_rate) * 0.5 * (1 + std::cos(std::numbers::pi * progress)));
+    }
+    default: { return learn_rate; }
+  }
+}
+
+absl::string_view LearnRateScheduleToString(LearnRateSchedule schedule) {
+  return kLearnRateScheduleStr[static_cast<int32_t>(schedule)];
+}
+
+absl::StatusOr<LearnRateSchedule> LearnRateScheduleFromString(std::string schedule_str) {
+  for (int32_t i = 0; i < kLearnRateScheduleStr.size(); i++) {
+    if (schedule_str == kLearnRateScheduleStr[i]) {
+      return static_cast<LearnRateSchedule>(i);
+    }
+  }
+  return absl::InvalidArgumentError(absl::StrCat(
+        "Unrecognized learn rate schedule: ", schedule_str,
+        ". Available types: ", absl::StrJoin(kLearnRateScheduleStr, ", ")));
+}
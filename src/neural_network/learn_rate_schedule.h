@@ -0,0 +1,38 @@
+#ifndef SRC_NEURAL_NETWORK_LEARN_RATE_SCHEDULE_H_
+#define SRC_NEURAL_NETWORK_LEARN_RATE_SCHEDULE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+// How the learn rate decays once warmed up:
+//   CONSTANT: it doesn't.
+//   STEP: it's multiplied by decay_rate every decay_steps steps.
+//   COSINE: it's annealed along a half cosine down to learn_rate * decay_rate over
+//     decay_steps steps, then held there, see: https://arxiv.org/abs/1608.03983
+enum class LearnRateSchedule {
+  CONSTANT,
+  STEP,
+  COSINE,
+};
+
+static const std::vector<absl::string_view> kLearnRateScheduleStr {
+  "CONSTANT",
+  "STEP",
+  "COSINE",
+};
+
+// Returns the learn rate of the step'th step (from 0). It ramps up linearly to learn_rate
+// over the first warmup_steps steps, then decays as scheduled from there. decay_steps 0
+// disables decay.
+double ScheduleLearnRate(
+    LearnRateSchedule schedule, double learn_rate, int64_t step,
+    int64_t warmup_steps, int64_t decay_steps, double decay_rate);
+
+absl::string_view LearnRateScheduleToString(LearnRateSchedule schedule);
+absl::StatusOr<LearnRateSchedule> LearnRateScheduleFromString(std::string schedule_str);
+
+#endif
@@ -0,0 +1,124 @@
+#include "src/neural_network/model_snapshot.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
+
+template <typename T>
+ModelSnapshot<T>::ModelSnapshot(
+    NeuralNetwork* neural_network, uint32_t max_staleness, ThreadPool* thread_pool) :
+  neural_network_(neural_network),
+  shared_(neural_network, [](const NeuralNetwork*) {}),
+  max_staleness_(max_staleness),
+  thread_pool_(thread_pool),
+  replicas_(),
+  mutex_(),
+  cv_(),
+  updates_(),
+  version_(0),
+  stop_(false),
+  updater_() {
+    DCHECK(neural_network_ != nullptr);
+    if (max_staleness_ == 0) { return; }
+    // NOTE: views borrow a version no more than max_staleness behind the last queued update,
+    // and the updater only publishes up to it, so it never overwrites a borrowed replica.
+    for (uint32_t i = 0; i <= max_staleness_; i++) {
+      replicas_.push_back(std::make_shared<NeuralNetwork>(*neural_network_));
+    }
+    updater_ = std::thread(&ModelSnapshot::UpdateLoop, this);
+  }
+
+template <typename T>
+ModelSnapshot<T>::~ModelSnapshot() {
+  if (!updater_.joinable()) { return; }
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  updater_.join();
+}
+
+template <typename T>
+typename ModelSnapshot<T>::View ModelSnapshot<T>::Borrow() const {
+  if (max_staleness_ == 0) { return View(shared_, version_); }
+  std::scoped_lock lock(mutex_);
+  return View(replicas_[version_ % replicas_.size()], version_);
+}
+
+template <typename T>
+uint64_t ModelSnapshot<T>::Version() const {
+  std::scoped_lock lock(mutex_);
+  return version_;
+}
+
+template <typename T>
+const NeuralNetwork<T>& ModelSnapshot<T>::Current() const { return *neural_network_; }
+
+template <typename T>
+void ModelSnapshot<T>::ApplyGradients(
+    Optimizer<T>* optimizer, const std::vector<std::pair<Matrix, Matrix>>& gradients) {
+  if (max_staleness_ == 0) {
+    DCHECK(shared_.use_count() == 1) << "Model updated while views are still borrowed.";
+    optimizer->ApplyGradients(neural_network_, gradients, thread_pool_);
+    version_++;
+    return;
+  }
+  // NOTE: the step is begun when queued, so the optimizer's step count includes queued updates.
+  const UpdateStep<T> step = optimizer->BeginStep();
+  std::unique_lock<std::mutex> lock(mutex_);
+  updates_.push_back(Update { .optimizer = optimizer, .step = step, .gradients = &gradients });
+  cv_.notify_all();
+  cv_.wait(lock, [&]() { return updates_.size() <= max_staleness_; });
+}
+
+template <typename T>
+void ModelSnapshot<T>::Flush() {
+  if (max_staleness_ == 0) { return; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return updates_.empty(); });
+}
+
+// NOTE: an update stays at the front of the queue until it's published, so that the queue
+// length is the number of outstanding updates. Layers are updated back to front, the order
+// their gradients are computed in.
+template <typename T>
+void ModelSnapshot<T>::UpdateLoop() {
+  while (true) {
+    Update update;
+    uint64_t next_version;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&]() { return !updates_.empty() || stop_; });
+      if (updates_.empty()) { return; }
+      update = updates_.front();
+      next_version = version_ + 1;
+    }
+    const std::shared_ptr<NeuralNetwork>& replica = replicas_[next_version % replicas_.size()];
+    DCHECK(replica.use_count() == 1) << "Replica updated while views are still borrowed.";
+    for (int32_t i = neural_network_->LayersCount() - 1; i >= 0; i--) {
+      update.optimizer->ApplyLayerGradients(
+          update.step, neural_network_, i, (*update.gradients)[i], thread_pool_);
+      replica->CopyLayerParametersFrom(*neural_network_, i);
+    }
+    {
+      std::scoped_lock lock(mutex_);
+      updates_.pop_front();
+      version_ = next_version;
+    }
+    cv_.notify_all();
+  }
+}
+
+template class ModelSnapshot<float>;
+template class ModelSnapshot<double>;
@@ -0,0 +1,101 @@
+#ifndef SRC_NEURAL_NETWORK_MODEL_SNAPSHOT_H_
+#define SRC_NEURAL_NETWORK_MODEL_SNAPSHOT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
+
+// Shares a read-only, versioned view of a NeuralNetwork across worker threads without
+// copying its parameters. Workers borrow a View for the duration of a batch, and the
+// parameters may only be updated once every borrowed View has been released.
+//
+// With a max_staleness above 0, updates are pipelined instead: ApplyGradients queues the
+// gradients for a background thread, which applies them to the model layer by layer, back
+// to front, and publishes each updated layer into a replica of the parameters. Views borrow
+// the latest published replica, so the next batch trains while the last one's update is
+// still being applied, on parameters missing at most max_staleness of the latest updates.
+// NOTE: pipelining keeps max_staleness + 1 replicas of the model. Updates are split across
+// thread_pool, if any, see Optimizer::ApplyGradients.
+template <typename T>
+class ModelSnapshot {
+ public:
+  using Matrix = ::Matrix<T>;
+  using NeuralNetwork = ::NeuralNetwork<T>;
+
+  class View {
+   public:
+    const NeuralNetwork& operator*() const { return *neural_network_; }
+    const NeuralNetwork* operator->() const { return neural_network_.get(); }
+    uint64_t Version() const { return version_; }
+
+   private:
+    friend class ModelSnapshot;
+    View(std::shared_ptr<const NeuralNetwork> neural_network, uint64_t version) :
+      neural_network_(std::move(neural_network)),
+      version_(version) {}
+
+    std::shared_ptr<const NeuralNetwork> neural_network_;
+    uint64_t version_;
+  };
+
+  explicit ModelSnapshot(
+      NeuralNetwork* neural_network, uint32_t max_staleness = 0,
+      ThreadPool* thread_pool = nullptr);
+  // NOTE: finishes applying queued gradients first.
+  ~ModelSnapshot();
+  ModelSnapshot(const ModelSnapshot&) = delete;
+  ModelSnapshot& operator=(const ModelSnapshot&) = delete;
+
+  View Borrow() const;
+  // NOTE: the number of updates applied to the latest borrowable parameters.
+  uint64_t Version() const;
+  // NOTE: only for use by the thread that applies gradients, after Flush when pipelined.
+  const NeuralNetwork& Current() const;
+  // Steps the model with optimizer.
+  // NOTE: when pipelined, gradients must stay untouched until max_staleness more calls have
+  // returned, or Flush has. Blocks until at most max_staleness updates are outstanding. The
+  // optimizer is only used by the updater until then too.
+  void ApplyGradients(
+      Optimizer<T>* optimizer, const std::vector<std::pair<Matrix, Matrix>>& gradients);
+  // Blocks until every queued update has been applied and published.
+  void Flush();
+
+ private:
+  struct Update {
+    Optimizer<T>* optimizer;
+    UpdateStep<T> step;
+    const std::vector<std::pair<Matrix, Matrix>>* gradients;
+  };
+
+  void UpdateLoop();
+
+  NeuralNetwork* neural_network_;
+  // NOTE: non-owning, only used to reference count outstanding views.
+  std::shared_ptr<const NeuralNetwork> shared_;
+  const uint32_t max_staleness_;
+  ThreadPool* thread_pool_;
+  // NOTE: when pipelined, version v is published into replicas_[v % replicas_.size()].
+  std::vector<std::shared_ptr<NeuralNetwork>> replicas_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Update> updates_;
+  uint64_t version_;
+  bool stop_;
+  std::thread updater_;
+};
+
+extern template class ModelSnapshot<float>;
+extern template class ModelSnapshot<double>;
+
+#endif
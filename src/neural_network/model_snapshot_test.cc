@@ -0,0 +1,75 @@
+#include "src/neural_network/model_snapshot.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "src/common/thread_pool.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
+#include "src/neural_network/params.h"
+#include "src/neural_network/test_util.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+TEST(ModelSnapshotTest, PipelinedUpdatesMatchSynchronousOnes) {
+  const NeuralNetwork<double> initial = NeuralNetwork<double>::Random(
+      {5, 4, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const auto all_gradients = RandomGradients(initial, 8);
+  const TrainParameters train_params = TestTrainParameters(protos::Optimizer::SGD);
+
+  NeuralNetwork<double> expected = initial;
+  Optimizer<double> expected_optimizer(train_params, expected);
+  for (const auto& gradients : all_gradients) {
+    expected_optimizer.ApplyGradients(&expected, gradients);
+  }
+
+  for (uint32_t max_staleness : {1, 2}) {
+    NeuralNetwork<double> neural_network = initial;
+    Optimizer<double> optimizer(train_params, neural_network);
+    {
+      ModelSnapshot<double> model(&neural_network, max_staleness);
+      for (int32_t i = 0; i < all_gradients.size(); i++) {
+        {
+          const ModelSnapshot<double>::View view = model.Borrow();
+          EXPECT_GE(view.Version() + max_staleness, i);
+        }
+        model.ApplyGradients(&optimizer, all_gradients[i]);
+      }
+      model.Flush();
+      EXPECT_EQ(model.Version(), all_gradients.size());
+      EXPECT_EQ(model.Borrow()->ToCheckpoint().SerializeAsString(),
+                expected.ToCheckpoint().SerializeAsString());
+    }
+    EXPECT_EQ(neural_network.ToCheckpoint().SerializeAsString(),
+              expected.ToCheckpoint().SerializeAsString());
+  }
+}
+
+TEST(ModelSnapshotTest, ParallelUpdatesMatchSerialOnes) {
+  // NOTE: wide enough layers that they're split into several row blocks each.
+  const NeuralNetwork<double> initial = NeuralNetwork<double>::Random(
+      {300, 200, 10}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const auto all_gradients = RandomGradients(initial, 4);
+  ThreadPool thread_pool(3);
+  for (protos::Optimizer optimizer_type : {protos::Optimizer::SGD, protos::Optimizer::ADAM}) {
+    const TrainParameters train_params = TestTrainParameters(optimizer_type);
+
+    NeuralNetwork<double> expected = initial;
+    Optimizer<double> expected_optimizer(train_params, expected);
+    for (const auto& gradients : all_gradients) {
+      expected_optimizer.ApplyGradients(&expected, gradients);
+    }
+
+    for (uint32_t max_staleness : {0, 1}) {
+      NeuralNetwork<double> neural_network = initial;
+      Optimizer<double> optimizer(train_params, neural_network);
+      {
+        ModelSnapshot<double> model(&neural_network, max_staleness, &thread_pool);
+        for (const auto& gradients : all_gradients) { model.ApplyGradients(&optimizer, gradients); }
+        model.Flush();
+      }
+      EXPECT_EQ(neural_network.ToCheckpoint().SerializeAsString(),
+                expected.ToCheckpoint().SerializeAsString());
+    }
+  }
+}
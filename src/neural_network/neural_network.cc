@@ -1,7 +1,10 @@
 #include "src/neural_network/neural_network.h"
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <ostream>
+#include <type_traits>
 #include <vector>
 
 #include "absl/log/check.h"
@@ -10,7 +13,8 @@
 #include "src/common/matrix.h"
 #include "src/protos/model_checkpoint.pb.h"
 
-NeuralNetwork::NeuralNetwork(
+template <typename T>
+NeuralNetwork<T>::NeuralNetwork(
     std::vector<Matrix> weights, std::vector<Matrix> biases,
     protos::Activation intermed_activation,
     protos::Activation output_activation) {
@@ -22,7 +26,8 @@ NeuralNetwork::NeuralNetwork(
   }
 }
 
-NeuralNetwork NeuralNetwork::Random(
+template <typename T>
+NeuralNetwork<T> NeuralNetwork<T>::Random(
     const std::vector<int32_t> layer_sizes,
     protos::Activation intermed_activation,
     protos::Activation output_activation) {
@@ -39,7 +44,15 @@ NeuralNetwork NeuralNetwork::Random(
   return NeuralNetwork(std::move(weights), std::move(biases), intermed_activation, output_activation);
 }
 
-absl::StatusOr<NeuralNetwork> NeuralNetwork::FromCheckpoint(const protos::ModelCheckpoint& checkpoint_proto) {
+// NOTE: a layer's weights / biases are read from whichever precision the checkpoint was
+// written in.
+template <typename T>
+absl::StatusOr<NeuralNetwork<T>> NeuralNetwork<T>::FromCheckpoint(const protos::ModelCheckpoint& checkpoint_proto) {
+  if (checkpoint_proto.precision() == protos::Precision::INT8) {
+    return absl::InvalidArgumentError(
+        "INT8 checkpoints can only be served, by a QuantizedInferenceEngine.");
+  }
+  const bool is_float = (checkpoint_proto.precision() == protos::Precision::FLOAT);
   std::vector<Matrix> weights;
   std::vector<Matrix> biases;
   weights.reserve(checkpoint_proto.layers().size() - 1);
@@ -60,77 +73,159 @@ absl::StatusOr<NeuralNetwork> NeuralNetwork::FromCheckpoint(const protos::ModelC
               " has row count: ", next_layer->row_count()));
       }
     }
-    weights.emplace_back(Matrix(
-        curr_layer->row_count(), curr_layer->col_count(),
-        {curr_layer->weights().begin(), curr_layer->weights().end()}));
-    biases.emplace_back(Matrix(
-        1, curr_layer->col_count(),
-        {curr_layer->biases().begin(), curr_layer->biases().end()}));
+    if (is_float) {
+      weights.emplace_back(Matrix(
+          curr_layer->row_count(), curr_layer->col_count(),
+          {curr_layer->float_weights().begin(), curr_layer->float_weights().end()}));
+      biases.emplace_back(Matrix(
+          1, curr_layer->col_count(),
+          {curr_layer->float_biases().begin(), curr_layer->float_biases().end()}));
+    } else {
+      weights.emplace_back(Matrix(
+          curr_layer->row_count(), curr_layer->col_count(),
+          {curr_layer->weights().begin(), curr_layer->weights().end()}));
+      biases.emplace_back(Matrix(
+          1, curr_layer->col_count(),
+          {curr_layer->biases().begin(), curr_layer->biases().end()}));
+    }
   }
   return NeuralNetwork(std::move(weights), std::move(biases),
       checkpoint_proto.intermed_activation(), checkpoint_proto.output_activation());
 }
 
-protos::ModelCheckpoint NeuralNetwork::ToCheckpoint() const {
+template <typename T>
+static protos::ModelCheckpoint NewCheckpoint(
+    protos::Activation intermed_activation, protos::Activation output_activation) {
   protos::ModelCheckpoint checkpoint_proto;
+  checkpoint_proto.set_precision(
+      std::is_same_v<T, float> ? protos::Precision::FLOAT : protos::Precision::DOUBLE);
+  checkpoint_proto.set_intermed_activation(intermed_activation);
+  checkpoint_proto.set_output_activation(output_activation);
+  return checkpoint_proto;
+}
+
+template <typename T>
+static void AddLayerToCheckpoint(
+    const Matrix<T>& weights, const Matrix<T>& biases, protos::ModelCheckpoint* checkpoint_proto) {
+  protos::Layer& layer_proto = *checkpoint_proto->add_layers();
+  layer_proto.set_row_count(weights.RowCount());
+  layer_proto.set_col_count(weights.ColCount());
+  if constexpr (std::is_same_v<T, float>) {
+    *layer_proto.mutable_float_weights() = {weights.Elements().begin(), weights.Elements().end()};
+    *layer_proto.mutable_float_biases() = {biases.Elements().begin(), biases.Elements().end()};
+  } else {
+    *layer_proto.mutable_weights() = {weights.Elements().begin(), weights.Elements().end()};
+    *layer_proto.mutable_biases() = {biases.Elements().begin(), biases.Elements().end()};
+  }
+}
+
+template <typename T>
+protos::ModelCheckpoint NeuralNetwork<T>::ToCheckpoint() const {
+  // NOTE: with a single layer, both are its activation.
+  protos::ModelCheckpoint checkpoint_proto =
+    NewCheckpoint<T>(layers_.front().Activation(), layers_.back().Activation());
   for (const Layer& layer : layers_) {
-    protos::Layer& layer_proto = *checkpoint_proto.add_layers();;
-    layer_proto.set_row_count(layer.Weights().RowCount());
-    layer_proto.set_col_count(layer.Weights().ColCount());
-    *layer_proto.mutable_weights() =
-      {layer.Weights().Elements().begin(), layer.Weights().Elements().end()};
-    *layer_proto.mutable_biases() =
-      {layer.Biases().Elements().begin(), layer.Biases().Elements().end()};
+    AddLayerToCheckpoint(layer.Weights(), layer.Biases(), &checkpoint_proto);
   }
   return checkpoint_proto;
 }
 
-int32_t NeuralNetwork::LayersCount() const { return layers_.size(); }
+// NOTE: copy assigning a matrix of the same shape reuses its storage.
+template <typename T>
+void NeuralNetwork<T>::SnapshotParameters(ParameterSnapshot<T>* snapshot) const {
+  snapshot->intermed_activation = layers_.front().Activation();
+  snapshot->output_activation = layers_.back().Activation();
+  snapshot->parameters.resize(layers_.size());
+  for (int32_t i = 0; i < layers_.size(); i++) {
+    snapshot->parameters[i].first = layers_[i].Weights();
+    snapshot->parameters[i].second = layers_[i].Biases();
+  }
+}
 
-const Layer& NeuralNetwork::GetLayer(int32_t i) const { return layers_[i]; }
+template <typename T>
+protos::ModelCheckpoint ParameterSnapshot<T>::ToCheckpoint() const {
+  protos::ModelCheckpoint checkpoint_proto = NewCheckpoint<T>(intermed_activation, output_activation);
+  for (const auto& [weights, biases] : parameters) {
+    AddLayerToCheckpoint(weights, biases, &checkpoint_proto);
+  }
+  return checkpoint_proto;
+}
 
-Matrix NeuralNetwork::Infer(const Matrix& input) const {
-  Matrix layer_value = input;
-  for (int32_t i = 0; i < layers_.size(); i++) {
+template <typename T>
+int32_t NeuralNetwork<T>::LayersCount() const { return layers_.size(); }
+
+template <typename T>
+const Layer<T>& NeuralNetwork<T>::GetLayer(int32_t i) const { return layers_[i]; }
+
+template <typename T>
+Layer<T>& NeuralNetwork<T>::MutableLayer(int32_t i) { return layers_[i]; }
+
+template <typename T>
+Matrix<T> NeuralNetwork<T>::Infer(const Matrix& input) const {
+  DCHECK(!layers_.empty());
+  Matrix layer_value = layers_[0].Infer(input);
+  for (int32_t i = 1; i < layers_.size(); i++) {
     layer_value = layers_[i].Infer(layer_value);
   }
   return layer_value;
 }
 
-Matrix NeuralNetwork::FeedForward(const Matrix& input, NetworkLearnCache* cache) const {
-  *cache = NetworkLearnCache {
-    .layer_caches = std::vector<Layer::LayerLearnCache>(layers_.size()),
-  };
-  Matrix layer_value = input;
+// NOTE: each layer reads the previous layer's output straight out of its cache, so nothing
+// is copied between layers. The returned output is owned by the cache.
+template <typename T>
+const Matrix<T>& NeuralNetwork<T>::FeedForward(const Matrix& input, NetworkLearnCache* cache) const {
+  DCHECK(!layers_.empty());
+  cache->layer_caches.clear();
+  cache->layer_caches.resize(layers_.size());
+  const Matrix* layer_value = &input;
   for (int32_t i = 0; i < layers_.size(); i++) {
-    layer_value = layers_[i].FeedForward(layer_value, &cache->layer_caches[i]);
+    layer_value = &layers_[i].FeedForward(*layer_value, &cache->layer_caches[i]);
   }
-  return layer_value;
+  return *layer_value;
 }
 
-std::vector<std::pair<Matrix, Matrix>> NeuralNetwork::BackPropagate(
+template <typename T>
+std::vector<std::pair<Matrix<T>, Matrix<T>>> NeuralNetwork<T>::ZeroGradients() const {
+  std::vector<std::pair<Matrix, Matrix>> gradients;
+  gradients.reserve(layers_.size());
+  for (const Layer& layer : layers_) {
+    gradients.emplace_back(std::make_pair(
+          Matrix(layer.InputSize(), layer.OutputSize()),
+          Matrix(1, layer.OutputSize())));
+  }
+  return gradients;
+}
+
+// NOTE: gradients are accumulated into, rather than overwriting, the given buffers.
+template <typename T>
+void NeuralNetwork<T>::BackPropagate(
     const TrainParameters& train_params, NetworkLearnCache* cache,
-    const Matrix& actual_output, const Matrix& expected_output) const {
+    const Matrix& actual_output, const Matrix& expected_output,
+    std::vector<std::pair<Matrix, Matrix>>* gradients,
+    const std::function<void(int32_t)>& on_layer_gradients) const {
   DCHECK(cache != nullptr);
-  std::vector<std::pair<Matrix, Matrix>> gradients(layers_.size());
+  DCHECK(gradients != nullptr && gradients->size() == layers_.size());
   int32_t output_idx = layers_.size() - 1;
   layers_[output_idx].CalcPDCostWeightedInputOutput(
       train_params, &cache->layer_caches[output_idx], expected_output);
-  gradients[output_idx] = layers_[output_idx].FinishBackPropagate(
-      &cache->layer_caches[cache->layer_caches.size() - 1]);
+  layers_[output_idx].FinishBackPropagate(
+      &cache->layer_caches[output_idx], &(*gradients)[output_idx]);
+  if (on_layer_gradients) { on_layer_gradients(output_idx); }
   for (int32_t i = layers_.size() - 2; i >= 0; i--) {
     layers_[i].CalcPDCostWeightedInputIntermed(
         &cache->layer_caches[i], &cache->layer_caches[i + 1]);
-    gradients[i] = layers_[i].FinishBackPropagate(&cache->layer_caches[i]);
+    layers_[i].FinishBackPropagate(&cache->layer_caches[i], &(*gradients)[i]);
+    if (on_layer_gradients) { on_layer_gradients(i); }
   }
-  return gradients;
 }
 
-void NeuralNetwork::ApplyGradients(
-    const TrainParameters& train_params,
-    std::vector<std::pair<Matrix, Matrix>> gradients) {
-  DCHECK(gradients.size() == layers_.size());
-  for (int32_t i = 0; i < gradients.size(); i++) {
-    layers_[i].ApplyGradients(train_params, std::move(gradients[i]));
-  }
+template <typename T>
+void NeuralNetwork<T>::CopyLayerParametersFrom(const NeuralNetwork& other, int32_t i) {
+  DCHECK(other.layers_.size() == layers_.size());
+  layers_[i].CopyParametersFrom(other.layers_[i]);
 }
+
+template struct ParameterSnapshot<float>;
+template struct ParameterSnapshot<double>;
+template class NeuralNetwork<float>;
+template class NeuralNetwork<double>;
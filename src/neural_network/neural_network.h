@@ -1,15 +1,36 @@
 #ifndef SRC_NEURAL_NETWORK_H_
 #define SRC_NEURAL_NETWORK_H_
 
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 
+#include "absl/status/statusor.h"
 #include "src/common/matrix.h"
 #include "src/neural_network/layer.h"
 #include "src/neural_network/params.h"
 #include "src/protos/model_checkpoint.pb.h"
 
+// Copies of a model's weights and biases, one pair per layer, taken between updates so that
+// they can be checkpointed on another thread while training goes on.
+template <typename T>
+struct ParameterSnapshot {
+  protos::Activation intermed_activation;
+  protos::Activation output_activation;
+  std::vector<std::pair<Matrix<T>, Matrix<T>>> parameters;
+
+  protos::ModelCheckpoint ToCheckpoint() const;
+};
+
+// NOTE: T is the element type of the whole model, float or double, see Layer.
+template <typename T>
 class NeuralNetwork {
  public:
+  using Matrix = ::Matrix<T>;
+  using Layer = ::Layer<T>;
+
   static NeuralNetwork Random(
       const std::vector<int32_t> layer_sizes,
       protos::Activation intermed_activation,
@@ -19,22 +40,34 @@ class NeuralNetwork {
 
   Matrix Infer(const Matrix& input) const;
 
+  // NOTE: layer caches are allocated from the cache's memory resource, and each layer's
+  // values from the input's memory resource.
   struct NetworkLearnCache {
-    std::vector<Layer::LayerLearnCache> layer_caches;
+    std::pmr::vector<typename Layer::LayerLearnCache> layer_caches;
   };
-  Matrix FeedForward(
+  const Matrix& FeedForward(
       const Matrix& input, NetworkLearnCache* cache) const;
-  std::vector<std::pair<Matrix, Matrix>> BackPropagate(
+  std::vector<std::pair<Matrix, Matrix>> ZeroGradients() const;
+  // NOTE: on_layer_gradients, if any, is called with each layer's index as soon as its
+  // gradients are final, back to front.
+  void BackPropagate(
       const TrainParameters& train_params, NetworkLearnCache* cache,
-      const Matrix& actual_output, const Matrix& expected_output) const;
-  void ApplyGradients(
-      const TrainParameters& train_params,
-      std::vector<std::pair<Matrix, Matrix>> gradients);
+      const Matrix& actual_output, const Matrix& expected_output,
+      std::vector<std::pair<Matrix, Matrix>>* gradients,
+      const std::function<void(int32_t)>& on_layer_gradients = nullptr) const;
+  // NOTE: for updates that are pipelined layer by layer.
+  void CopyLayerParametersFrom(const NeuralNetwork& other, int32_t i);
 
   int32_t LayersCount() const;
   const Layer& GetLayer(int32_t i) const;
+  // NOTE: parameters are stepped by an Optimizer, which keeps its own state per layer.
+  Layer& MutableLayer(int32_t i);
 
+  // NOTE: checkpoints of either precision can be loaded, they're converted to T.
   protos::ModelCheckpoint ToCheckpoint() const;
+  // NOTE: only copies the parameters, cheap next to building a checkpoint out of them, and
+  // cheaper still into a previous snapshot's buffers.
+  void SnapshotParameters(ParameterSnapshot<T>* snapshot) const;
 
  protected:
   explicit NeuralNetwork(
@@ -46,4 +79,9 @@ class NeuralNetwork {
   std::vector<Layer> layers_;
 };
 
+extern template struct ParameterSnapshot<float>;
+extern template struct ParameterSnapshot<double>;
+extern template class NeuralNetwork<float>;
+extern template class NeuralNetwork<double>;
+
 #endif
@@ -0,0 +1,320 @@
+#include "src/neural_network/optimizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/learn_rate_schedule.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/params.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+template <typename T>
+static void AddMomentsToCheckpoint(
+    const std::pair<Matrix<T>, Matrix<T>>& moments, protos::Layer* moments_proto) {
+  const auto& [weights, biases] = moments;
+  moments_proto->set_row_count(weights.RowCount());
+  moments_proto->set_col_count(weights.ColCount());
+  if constexpr (std::is_same_v<T, float>) {
+    *moments_proto->mutable_float_weights() = {weights.Elements().begin(), weights.Elements().end()};
+    *moments_proto->mutable_float_biases() = {biases.Elements().begin(), biases.Elements().end()};
+  } else {
+    *moments_proto->mutable_weights() = {weights.Elements().begin(), weights.Elements().end()};
+    *moments_proto->mutable_biases() = {biases.Elements().begin(), biases.Elements().end()};
+  }
+}
+
+// NOTE: moments are read from whichever precision the checkpoint was written in.
+template <typename T>
+static absl::StatusOr<std::vector<std::pair<Matrix<T>, Matrix<T>>>> MomentsFromCheckpoint(
+    const google::protobuf::RepeatedPtrField<protos::Layer>& moments_protos, bool is_float,
+    const NeuralNetwork<T>& neural_network) {
+  if (moments_protos.size() != neural_network.LayersCount()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Optimizer state has moments for ", moments_protos.size(),
+          " layers, the model has: ", neural_network.LayersCount()));
+  }
+  std::vector<std::pair<Matrix<T>, Matrix<T>>> moments;
+  moments.reserve(moments_protos.size());
+  for (int32_t i = 0; i < moments_protos.size(); i++) {
+    const protos::Layer& moments_proto = moments_protos[i];
+    const Layer<T>& layer = neural_network.GetLayer(i);
+    const int64_t weight_count = is_float ?
+      moments_proto.float_weights().size() : moments_proto.weights().size();
+    const int64_t bias_count = is_float ?
+      moments_proto.float_biases().size() : moments_proto.biases().size();
+    if (moments_proto.row_count() != layer.InputSize() ||
+        moments_proto.col_count() != layer.OutputSize() ||
+        weight_count != (int64_t) layer.InputSize() * layer.OutputSize() ||
+        bias_count != layer.OutputSize()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Optimizer state doesn't match the shape of layer: ", i));
+    }
+    if (is_float) {
+      moments.emplace_back(
+          Matrix<T>(layer.InputSize(), layer.OutputSize(),
+                    {moments_proto.float_weights().begin(), moments_proto.float_weights().end()}),
+          Matrix<T>(1, layer.OutputSize(),
+                    {moments_proto.float_biases().begin(), moments_proto.float_biases().end()}));
+    } else {
+      moments.emplace_back(
+          Matrix<T>(layer.InputSize(), layer.OutputSize(),
+                    {moments_proto.weights().begin(), moments_proto.weights().end()}),
+          Matrix<T>(1, layer.OutputSize(),
+                    {moments_proto.biases().begin(), moments_proto.biases().end()}));
+    }
+  }
+  return moments;
+}
+
+template <typename T>
+void OptimizerSnapshot<T>::AddToCheckpoint(protos::ModelCheckpoint* checkpoint_proto) const {
+  protos::OptimizerState& state_proto = *checkpoint_proto->mutable_optimizer_state();
+  state_proto.set_optimizer(optimizer);
+  state_proto.set_step(step);
+  for (const auto& moments : first_moments) {
+    AddMomentsToCheckpoint(moments, state_proto.add_first_moments());
+  }
+  for (const auto& moments : second_moments) {
+    AddMomentsToCheckpoint(moments, state_proto.add_second_moments());
+  }
+}
+
+static bool HasSecondMoments(protos::Optimizer optimizer) {
+  return optimizer == protos::Optimizer::ADAM || optimizer == protos::Optimizer::ADAMW;
+}
+
+template <typename T>
+Optimizer<T>::Optimizer(const TrainParameters& train_params, const NeuralNetwork& neural_network) :
+  Optimizer(
+      train_params, neural_network.ZeroGradients(),
+      HasSecondMoments(train_params.optimizer) ? neural_network.ZeroGradients() : Gradients(),
+      /*step=*/0) {}
+
+template <typename T>
+Optimizer<T>::Optimizer(
+    const TrainParameters& train_params, Gradients first_moments, Gradients second_moments,
+    int64_t step) :
+  train_params_(train_params),
+  first_moments_(std::move(first_moments)),
+  second_moments_(std::move(second_moments)),
+  step_(step) {}
+
+template <typename T>
+Optimizer<T>::Optimizer(Optimizer&& other) :
+  train_params_(other.train_params_),
+  first_moments_(std::move(other.first_moments_)),
+  second_moments_(std::move(other.second_moments_)),
+  step_(other.step_.load()) {}
+
+template <typename T>
+absl::StatusOr<Optimizer<T>> Optimizer<T>::FromCheckpoint(
+    const TrainParameters& train_params, const NeuralNetwork& neural_network,
+    const protos::ModelCheckpoint& checkpoint_proto) {
+  if (!checkpoint_proto.has_optimizer_state()) { return Optimizer(train_params, neural_network); }
+  const protos::OptimizerState& state_proto = checkpoint_proto.optimizer_state();
+  if (state_proto.optimizer() != train_params.optimizer) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Checkpoint has ", protos::Optimizer_Name(state_proto.optimizer()),
+          " optimizer state, can't resume it with: ", protos::Optimizer_Name(train_params.optimizer)));
+  }
+  const bool is_float = (checkpoint_proto.precision() == protos::Precision::FLOAT);
+  absl::StatusOr<Gradients> first_moments =
+    MomentsFromCheckpoint(state_proto.first_moments(), is_float, neural_network);
+  if (!first_moments.ok()) { return first_moments.status(); }
+  Gradients second_moments;
+  if (HasSecondMoments(train_params.optimizer)) {
+    absl::StatusOr<Gradients> moments =
+      MomentsFromCheckpoint(state_proto.second_moments(), is_float, neural_network);
+    if (!moments.ok()) { return moments.status(); }
+    second_moments = *std::move(moments);
+  }
+  return Optimizer(
+      train_params, *std::move(first_moments), std::move(second_moments), state_proto.step());
+}
+
+template <typename T>
+int64_t Optimizer<T>::StepCount() const { return step_.load(std::memory_order_relaxed); }
+
+template <typename T>
+double Optimizer<T>::LearnRate() const {
+  return ScheduleLearnRate(
+      train_params_.learn_rate_schedule, train_params_.learn_rate, StepCount(),
+      train_params_.warmup_steps, train_params_.decay_steps, train_params_.decay_rate);
+}
+
+// NOTE: Adam's moments start at 0, biasing them towards 0 for the first steps. Rather than
+// correcting them, the correction is folded into the step's learn rate and epsilon, see:
+// https://arxiv.org/abs/1412.6980 section 2.
+template <typename T>
+UpdateStep<T> Optimizer<T>::BeginStep() {
+  const int64_t step = step_.fetch_add(1, std::memory_order_relaxed);
+  const double learn_rate = ScheduleLearnRate(
+      train_params_.learn_rate_schedule, train_params_.learn_rate, step,
+      train_params_.warmup_steps, train_params_.decay_steps, train_params_.decay_rate);
+  const double regularization = train_params_.regularization;
+  switch (train_params_.optimizer) {
+    case protos::Optimizer::NESTEROV:
+    case protos::Optimizer::SGD: {
+      return UpdateStep<T> {
+        .learn_rate = (T) learn_rate, .beta1 = (T) train_params_.momentum,
+        .l2 = 0, .decay = (T) (1.0 - regularization * learn_rate),
+      };
+    }
+    case protos::Optimizer::RMSPROP: {
+      return UpdateStep<T> {
+        .learn_rate = (T) learn_rate, .beta2 = (T) train_params_.beta2,
+        .epsilon = (T) train_params_.epsilon, .l2 = (T) regularization, .decay = 1,
+      };
+    }
+    case protos::Optimizer::ADAM:
+    case protos::Optimizer::ADAMW: {
+      const bool decoupled = (train_params_.optimizer == protos::Optimizer::ADAMW);
+      const double first_correction = 1 - std::pow(train_params_.beta1, step + 1);
+      const double second_correction = std::sqrt(1 - std::pow(train_params_.beta2, step + 1));
+      return UpdateStep<T> {
+        .learn_rate = (T) (learn_rate * second_correction / first_correction),
+        .beta1 = (T) train_params_.beta1,
+        .beta2 = (T) train_params_.beta2,
+        .epsilon = (T) (train_params_.epsilon * second_correction),
+        .l2 = (T) (decoupled ? 0.0 : regularization),
+        .decay = (T) (decoupled ? 1.0 - regularization * learn_rate : 1.0),
+      };
+    }
+    default: { CHECK(false) << "Unknown optimizer: " << train_params_.optimizer; return {}; }
+  }
+}
+
+template <typename T>
+void Optimizer<T>::ApplyGradients(
+    NeuralNetwork* neural_network, const Gradients& gradients, ThreadPool* thread_pool) {
+  DCHECK(gradients.size() == neural_network->LayersCount());
+  ApplyGradientsToLayers(
+      BeginStep(), neural_network, 0, neural_network->LayersCount(), gradients.data(), thread_pool);
+}
+
+template <typename T>
+void Optimizer<T>::ApplyLayerGradients(
+    const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t i,
+    const std::pair<Matrix, Matrix>& gradients, ThreadPool* thread_pool) {
+  ApplyGradientsToLayers(step, neural_network, i, i + 1, &gradients, thread_pool);
+}
+
+// NOTE: about this many elements of weights per block, e.g. 32 rows of a 784x512 layer, big
+// enough to amortize handing the block out, small enough to balance the threads.
+constexpr int64_t kApplyBlockElements = 1 << 14;
+
+template <typename T>
+static int32_t ApplyBlockRows(const Layer<T>& layer) {
+  return std::max<int64_t>(1, kApplyBlockElements / std::max(1, layer.OutputSize()));
+}
+
+template <typename T>
+static int64_t ApplyBlockCount(const Layer<T>& layer) {
+  const int32_t block_rows = ApplyBlockRows(layer);
+  return std::max(1, (layer.InputSize() + block_rows - 1) / block_rows);
+}
+
+// NOTE: the blocks of every layer are handed out together, so small layers don't leave
+// threads idle waiting for the next layer's.
+template <typename T>
+void Optimizer<T>::ApplyGradientsToLayers(
+    const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t begin_layer,
+    int32_t end_layer, const std::pair<Matrix, Matrix>* gradients, ThreadPool* thread_pool) {
+  DCHECK(0 <= begin_layer && begin_layer <= end_layer && end_layer <= neural_network->LayersCount());
+  if (thread_pool == nullptr) {
+    for (int32_t i = begin_layer; i < end_layer; i++) {
+      ApplyGradientRows(
+          step, neural_network, i, gradients[i - begin_layer],
+          0, neural_network->GetLayer(i).InputSize());
+    }
+    return;
+  }
+  int64_t block_count = 0;
+  for (int32_t i = begin_layer; i < end_layer; i++) {
+    block_count += ApplyBlockCount(neural_network->GetLayer(i));
+  }
+  thread_pool->ParallelFor(0, block_count, /*grain=*/1, [&](int64_t block) {
+    int32_t i = begin_layer;
+    while (block >= ApplyBlockCount(neural_network->GetLayer(i))) {
+      block -= ApplyBlockCount(neural_network->GetLayer(i++));
+    }
+    const Layer<T>& layer = neural_network->GetLayer(i);
+    const int32_t begin_row = block * ApplyBlockRows(layer);
+    const int32_t end_row = std::min(layer.InputSize(), begin_row + ApplyBlockRows(layer));
+    ApplyGradientRows(step, neural_network, i, gradients[i - begin_layer], begin_row, end_row);
+  });
+}
+
+template <typename T>
+static void ApplyUpdate(
+    protos::Optimizer optimizer, const UpdateStep<T>& step, const T* g, T* m, T* v, T* w,
+    int64_t count) {
+  const MatrixKernels<T>& kernels = GetMatrixKernels<T>();
+  switch (optimizer) {
+    case protos::Optimizer::SGD: { kernels.momentum_update(step, g, m, w, count); break; }
+    case protos::Optimizer::NESTEROV: { kernels.nesterov_update(step, g, m, w, count); break; }
+    case protos::Optimizer::RMSPROP: { kernels.rmsprop_update(step, g, m, w, count); break; }
+    case protos::Optimizer::ADAM:
+    case protos::Optimizer::ADAMW: { kernels.adam_update(step, g, m, v, w, count); break; }
+    default: { CHECK(false) << "Unknown optimizer: " << optimizer; }
+  }
+}
+
+template <typename T>
+void Optimizer<T>::ApplyGradientRows(
+    const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t i,
+    const std::pair<Matrix, Matrix>& gradients, int32_t begin_row, int32_t end_row) {
+  Layer<T>& layer = neural_network->MutableLayer(i);
+  DCHECK(0 <= begin_row && begin_row <= end_row && end_row <= layer.InputSize());
+  const bool has_second_moments = !second_moments_.empty();
+  const int64_t begin = (int64_t) begin_row * layer.OutputSize();
+  ApplyUpdate(
+      train_params_.optimizer, step, gradients.first.Elements().data() + begin,
+      first_moments_[i].first.MutableData() + begin,
+      has_second_moments ? second_moments_[i].first.MutableData() + begin : nullptr,
+      layer.MutableWeights().MutableData() + begin,
+      (int64_t) (end_row - begin_row) * layer.OutputSize());
+  if (end_row == layer.InputSize()) {
+    UpdateStep<T> bias_step = step;
+    bias_step.l2 = 0;
+    bias_step.decay = 1;
+    ApplyUpdate(
+        train_params_.optimizer, bias_step, gradients.second.Elements().data(),
+        first_moments_[i].second.MutableData(),
+        has_second_moments ? second_moments_[i].second.MutableData() : nullptr,
+        layer.MutableBiases().MutableData(), layer.OutputSize());
+  }
+}
+
+template <typename T>
+void Optimizer<T>::Snapshot(OptimizerSnapshot<T>* snapshot) const {
+  snapshot->optimizer = train_params_.optimizer;
+  snapshot->step = StepCount();
+  snapshot->first_moments.resize(first_moments_.size());
+  for (int32_t i = 0; i < first_moments_.size(); i++) {
+    snapshot->first_moments[i].first = first_moments_[i].first;
+    snapshot->first_moments[i].second = first_moments_[i].second;
+  }
+  snapshot->second_moments.resize(second_moments_.size());
+  for (int32_t i = 0; i < second_moments_.size(); i++) {
+    snapshot->second_moments[i].first = second_moments_[i].first;
+    snapshot->second_moments[i].second = second_moments_[i].second;
+  }
+}
+
+template struct OptimizerSnapshot<float>;
+template struct OptimizerSnapshot<double>;
+template class Optimizer<float>;
+template class Optimizer<double>;
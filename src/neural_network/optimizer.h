@@ -0,0 +1,106 @@
+#ifndef SRC_NEURAL_NETWORK_OPTIMIZER_H_
+#define SRC_NEURAL_NETWORK_OPTIMIZER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/params.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// Copies of an optimizer's state, taken between updates alongside a ParameterSnapshot so
+// that they can be checkpointed on another thread.
+template <typename T>
+struct OptimizerSnapshot {
+  protos::Optimizer optimizer;
+  int64_t step;
+  std::vector<std::pair<Matrix<T>, Matrix<T>>> first_moments;
+  std::vector<std::pair<Matrix<T>, Matrix<T>>> second_moments;
+
+  // NOTE: sets the checkpoint's optimizer_state, in the checkpoint's precision.
+  void AddToCheckpoint(protos::ModelCheckpoint* checkpoint_proto) const;
+};
+
+// Steps a NeuralNetwork's parameters along their gradients. The optimizer owns the moments
+// its update rule keeps per parameter between steps, apart from the model, and schedules
+// the learn rate by the number of steps taken:
+//   SGD: momentum velocities.
+//   NESTEROV: momentum velocities, stepping from the look-ahead weights.
+//   RMSPROP: running averages of squared gradients, scaling each parameter's step.
+//   ADAM / ADAMW: running averages of gradients and squared gradients, bias corrected.
+// regularization is L2 regularization of the gradients for RMSPROP and ADAM, and decoupled
+// weight decay for SGD, NESTEROV (where the two are equivalent) and ADAMW. Biases aren't
+// regularized. Each layer is updated in a single fused pass over its gradients, moments and
+// weights, see MatrixKernels.
+// NOTE: steps may be taken concurrently, e.g. by Hogwild workers, their updates of the
+// moments then racing just like their updates of the parameters do.
+template <typename T>
+class Optimizer {
+ public:
+  using Matrix = ::Matrix<T>;
+  using NeuralNetwork = ::NeuralNetwork<T>;
+  using Gradients = std::vector<std::pair<Matrix, Matrix>>;
+
+  // NOTE: starts from step 0 with zeroed moments, shaped like neural_network's parameters.
+  Optimizer(const TrainParameters& train_params, const NeuralNetwork& neural_network);
+  // Resumes from the optimizer state of a checkpoint of neural_network, which must have
+  // been written by train_params' optimizer. Starts from scratch if it has none.
+  static absl::StatusOr<Optimizer> FromCheckpoint(
+      const TrainParameters& train_params, const NeuralNetwork& neural_network,
+      const protos::ModelCheckpoint& checkpoint_proto);
+  Optimizer(Optimizer&& other);
+  Optimizer(const Optimizer&) = delete;
+  Optimizer& operator=(const Optimizer&) = delete;
+
+  // Takes a step. With a thread_pool, layers are split into blocks of weight rows that are
+  // updated in parallel.
+  void ApplyGradients(
+      NeuralNetwork* neural_network, const Gradients& gradients,
+      ThreadPool* thread_pool = nullptr);
+  // NOTE: layer by layer variant, for updates that are pipelined layer by layer. Every layer
+  // must be updated with the step BeginStep returns before the next one begins.
+  UpdateStep<T> BeginStep();
+  void ApplyLayerGradients(
+      const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t i,
+      const std::pair<Matrix, Matrix>& gradients, ThreadPool* thread_pool = nullptr);
+
+  int64_t StepCount() const;
+  // NOTE: the scheduled learn rate of the next step.
+  double LearnRate() const;
+  // NOTE: copy assigning a matrix of the same shape reuses its storage.
+  void Snapshot(OptimizerSnapshot<T>* snapshot) const;
+
+ private:
+  Optimizer(
+      const TrainParameters& train_params, Gradients first_moments, Gradients second_moments,
+      int64_t step);
+
+  // NOTE: gradients[j] is layer begin_layer + j's.
+  void ApplyGradientsToLayers(
+      const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t begin_layer,
+      int32_t end_layer, const std::pair<Matrix, Matrix>* gradients, ThreadPool* thread_pool);
+  // NOTE: only updates weight rows [begin_row, end_row) of layer i, and its biases along
+  // with the last row, so that disjoint row ranges can be updated concurrently.
+  void ApplyGradientRows(
+      const UpdateStep<T>& step, NeuralNetwork* neural_network, int32_t i,
+      const std::pair<Matrix, Matrix>& gradients, int32_t begin_row, int32_t end_row);
+
+  const TrainParameters train_params_;
+  // NOTE: per layer (weights, biases) moments, second_moments_ being empty unless ADAM(W).
+  Gradients first_moments_;
+  Gradients second_moments_;
+  std::atomic<int64_t> step_;
+};
+
+extern template struct OptimizerSnapshot<float>;
+extern template struct OptimizerSnapshot<double>;
+extern template class Optimizer<float>;
+extern template class Optimizer<double>;
+
+#endif
@@ -0,0 +1,122 @@
+#include "src/neural_network/optimizer.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/neural_network/learn_rate_schedule.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/params.h"
+#include "src/neural_network/test_util.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+protos::ModelCheckpoint Checkpoint(
+    const NeuralNetwork<double>& neural_network, const Optimizer<double>& optimizer) {
+  protos::ModelCheckpoint checkpoint_proto = neural_network.ToCheckpoint();
+  OptimizerSnapshot<double> snapshot;
+  optimizer.Snapshot(&snapshot);
+  snapshot.AddToCheckpoint(&checkpoint_proto);
+  return checkpoint_proto;
+}
+
+TEST(OptimizerTest, SchedulesLearnRate) {
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::CONSTANT, 0.1, 7, 0, 4, 0.5), 0.1);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::CONSTANT, 0.1, 0, 4, 0, 0.5), 0.025);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::CONSTANT, 0.1, 3, 4, 0, 0.5), 0.1);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::STEP, 0.1, 3, 0, 4, 0.5), 0.1);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::STEP, 0.1, 9, 0, 4, 0.5), 0.025);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::STEP, 0.1, 9, 2, 0, 0.5), 0.1);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::COSINE, 0.1, 2, 2, 4, 0.5), 0.1);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::COSINE, 0.1, 4, 2, 4, 0.5), 0.075);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::COSINE, 0.1, 6, 2, 4, 0.5), 0.05);
+  EXPECT_DOUBLE_EQ(ScheduleLearnRate(LearnRateSchedule::COSINE, 0.1, 60, 2, 4, 0.5), 0.05);
+}
+
+TEST(OptimizerTest, AdamFirstStepIsLearnRateSized) {
+  TrainParameters train_params = TestTrainParameters(protos::Optimizer::ADAM);
+  train_params.regularization = 0;
+  const NeuralNetwork<double> initial = NeuralNetwork<double>::Random(
+      {5, 4, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const TestGradients gradients = RandomGradients(initial, 1)[0];
+
+  NeuralNetwork<double> neural_network = initial;
+  Optimizer<double> optimizer(train_params, neural_network);
+  optimizer.ApplyGradients(&neural_network, gradients);
+  EXPECT_EQ(optimizer.StepCount(), 1);
+
+  const protos::ModelCheckpoint before = initial.ToCheckpoint();
+  const protos::ModelCheckpoint after = neural_network.ToCheckpoint();
+  for (int32_t i = 0; i < gradients.size(); i++) {
+    const Matrix<double>::Storage& g = gradients[i].first.Elements();
+    for (int32_t j = 0; j < g.size(); j++) {
+      EXPECT_NEAR(after.layers(i).weights(j) - before.layers(i).weights(j),
+                  -std::copysign(train_params.learn_rate, g[j]), 1e-6);
+    }
+  }
+}
+
+TEST(OptimizerTest, ResumingFromCheckpointMatchesUninterruptedTraining) {
+  const NeuralNetwork<double> initial = NeuralNetwork<double>::Random(
+      {5, 4, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const std::vector<TestGradients> all_gradients = RandomGradients(initial, 6);
+
+  for (protos::Optimizer optimizer_type : {
+      protos::Optimizer::SGD, protos::Optimizer::NESTEROV, protos::Optimizer::RMSPROP,
+      protos::Optimizer::ADAM, protos::Optimizer::ADAMW}) {
+    // NOTE: resumes mid warmup, so the schedule must resume too.
+    TrainParameters train_params = TestTrainParameters(optimizer_type);
+    train_params.learn_rate_schedule = LearnRateSchedule::COSINE;
+    train_params.warmup_steps = 4;
+    train_params.decay_steps = 4;
+    train_params.decay_rate = 0.1;
+
+    NeuralNetwork<double> expected = initial;
+    Optimizer<double> expected_optimizer(train_params, expected);
+    for (const auto& gradients : all_gradients) {
+      expected_optimizer.ApplyGradients(&expected, gradients);
+    }
+
+    NeuralNetwork<double> interrupted = initial;
+    Optimizer<double> interrupted_optimizer(train_params, interrupted);
+    for (int32_t i = 0; i < 3; i++) {
+      interrupted_optimizer.ApplyGradients(&interrupted, all_gradients[i]);
+    }
+    const protos::ModelCheckpoint checkpoint_proto =
+      Checkpoint(interrupted, interrupted_optimizer);
+    ASSERT_EQ(checkpoint_proto.optimizer_state().optimizer(), optimizer_type);
+    ASSERT_EQ(checkpoint_proto.optimizer_state().step(), 3);
+
+    absl::StatusOr<NeuralNetwork<double>> resumed =
+      NeuralNetwork<double>::FromCheckpoint(checkpoint_proto);
+    ASSERT_TRUE(resumed.ok()) << resumed.status();
+    absl::StatusOr<Optimizer<double>> resumed_optimizer =
+      Optimizer<double>::FromCheckpoint(train_params, *resumed, checkpoint_proto);
+    ASSERT_TRUE(resumed_optimizer.ok()) << resumed_optimizer.status();
+    EXPECT_EQ(resumed_optimizer->StepCount(), 3);
+    EXPECT_DOUBLE_EQ(resumed_optimizer->LearnRate(), interrupted_optimizer.LearnRate());
+    for (int32_t i = 3; i < all_gradients.size(); i++) {
+      resumed_optimizer->ApplyGradients(&*resumed, all_gradients[i]);
+    }
+
+    EXPECT_EQ(Checkpoint(*resumed, *resumed_optimizer).SerializeAsString(),
+              Checkpoint(expected, expected_optimizer).SerializeAsString())
+      << protos::Optimizer_Name(optimizer_type);
+  }
+}
+
+TEST(OptimizerTest, RejectsAnotherOptimizersState) {
+  const NeuralNetwork<double> neural_network = NeuralNetwork<double>::Random(
+      {5, 4, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  const Optimizer<double> optimizer(
+      TestTrainParameters(protos::Optimizer::ADAM), neural_network);
+  const protos::ModelCheckpoint checkpoint_proto = Checkpoint(neural_network, optimizer);
+
+  EXPECT_FALSE(Optimizer<double>::FromCheckpoint(
+      TestTrainParameters(protos::Optimizer::RMSPROP), neural_network, checkpoint_proto).ok());
+  EXPECT_TRUE(Optimizer<double>::FromCheckpoint(
+      TestTrainParameters(protos::Optimizer::ADAM), neural_network, checkpoint_proto).ok());
+}
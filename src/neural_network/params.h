@@ -3,29 +3,98 @@
 
 #include "absl/strings/str_cat.h"
 #include "src/neural_network/cost.h"
+#include "src/neural_network/learn_rate_schedule.h"
+#include "src/protos/model_checkpoint.pb.h"
 
 struct TrainParameters {
   std::string ToString() const {
     return absl::StrCat(
         "{ cost: ", CostToString(cost),
+        ", optimizer: ", protos::Optimizer_Name(optimizer),
         ", learn_rate: ", learn_rate,
+        ", learn_rate_schedule: ", LearnRateScheduleToString(learn_rate_schedule),
+        ", warmup_steps: ", warmup_steps,
+        ", decay_steps: ", decay_steps,
+        ", decay_rate: ", decay_rate,
         ", momentum: ", momentum,
+        ", beta1: ", beta1,
+        ", beta2: ", beta2,
+        ", epsilon: ", epsilon,
         ", regularization: ", regularization,
         ", num_threads: ", num_threads,
         ", num_epochs: ", num_epochs,
         ", train_batch_size: ", train_batch_size,
         ", test_batch_size: ", test_batch_size,
+        ", prefetch_depth: ", prefetch_depth,
+        ", input_scale: ", input_scale,
+        ", input_shift: ", input_shift,
+        ", standardize_features: ", (standardize_features ? "true" : "false"),
+        ", shuffle: ", (shuffle ? "true" : "false"),
+        ", shuffle_seed: ", shuffle_seed,
+        ", shard: ", shard_index, " / ", num_shards,
+        ", max_staleness: ", max_staleness,
+        ", hogwild: ", (hogwild ? "true" : "false"),
+        ", eval_every_seconds: ", eval_every_seconds,
+        ", allreduce_bucket_bytes: ", allreduce_bucket_bytes,
+        ", checkpoint_every_batches: ", checkpoint_every_batches,
+        ", checkpoint_every_seconds: ", checkpoint_every_seconds,
+        ", checkpoint_keep_last: ", checkpoint_keep_last,
         " }");
   }
 
   Cost cost;
+  // NOTE: see Optimizer for how each optimizer uses the parameters below.
+  protos::Optimizer optimizer;
   double learn_rate;
+  // NOTE: the learn rate warms up over warmup_steps steps, then decays as scheduled, see
+  // ScheduleLearnRate.
+  LearnRateSchedule learn_rate_schedule;
+  uint32_t warmup_steps;
+  uint32_t decay_steps;
+  double decay_rate;
+  // NOTE: momentum is SGD / NESTEROV's. beta1 and beta2 are the decay rates of the running
+  // averages of gradients and squared gradients (the latter's alone for RMSPROP), and epsilon
+  // is added to the square root of the latter.
   double momentum;
+  double beta1;
+  double beta2;
+  double epsilon;
   double regularization;
   uint32_t num_threads;
   uint32_t num_epochs;
   uint32_t train_batch_size;
   uint32_t test_batch_size;
+  // NOTE: batches read ahead on a background thread, 0 reads synchronously.
+  uint32_t prefetch_depth;
+  // NOTE: every input feature x is fed to the model as x * input_scale + input_shift, then
+  // standardized per feature over the training data if standardize_features.
+  double input_scale;
+  double input_shift;
+  bool standardize_features;
+  // NOTE: the training data is visited in a new seeded order every epoch if shuffle, and
+  // only the shard_index'th of num_shards disjoint shards of it is trained on.
+  bool shuffle;
+  uint64_t shuffle_seed;
+  uint32_t shard_index;
+  uint32_t num_shards;
+  // NOTE: 0 trains bulk synchronously. Otherwise each batch's update is applied in the
+  // background while the next batches train on parameters missing at most max_staleness
+  // of the latest updates, see ModelSnapshot.
+  uint32_t max_staleness;
+  // NOTE: if hogwild, every worker trains on batches of its own and applies its updates
+  // straight to the shared model without locks, and a snapshot of the model is tested every
+  // eval_every_seconds while training, 0 only testing at epoch ends.
+  bool hogwild;
+  uint32_t eval_every_seconds;
+  // NOTE: when training data parallel, gradients are all-reduced in buckets of consecutive
+  // layers holding at least this many bytes, see GradientAllReducer.
+  uint32_t allreduce_bucket_bytes;
+  // NOTE: a checkpoint is written at the end of every epoch, and also once
+  // checkpoint_every_batches batches or checkpoint_every_seconds seconds have passed since
+  // the last one, 0 disabling either. Only the last checkpoint_keep_last are kept.
+  uint32_t checkpoint_every_batches;
+  uint32_t checkpoint_every_seconds;
+  uint32_t checkpoint_keep_last;
 };
 
 #endif
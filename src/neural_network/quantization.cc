@@ -0,0 +1,225 @@
+#include "src/neural_network/quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/neural_network/activation.h"
+#include "src/neural_network/input_transform.h"
+#include "src/neural_network/layer.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+namespace {
+
+// NOTE: the step that maps [-max_abs, max_abs] onto [-127, 127].
+float QuantizationScale(float max_abs) { return (max_abs > 0.0f) ? (max_abs / 127.0f) : 1.0f; }
+
+// NOTE: rounds half away from zero, branch free so activations quantize at a steady rate.
+int8_t Quantize(float x, float inv_scale) {
+  const float scaled = std::min(std::max(x * inv_scale, -127.0f), 127.0f);
+  return (int8_t) (scaled + std::copysign(0.5f, scaled));
+}
+
+// NOTE: rows of out are out_stride apart, the padding past col_count is left as is.
+void QuantizeRows(
+    const float* x, int32_t row_count, int32_t col_count, float inv_scale,
+    int8_t* out, int32_t out_stride) {
+  for (int32_t i = 0; i < row_count; i++) {
+    const float* x_row = x + (int64_t) i * col_count;
+    int8_t* out_row = out + (int64_t) i * out_stride;
+    for (int32_t j = 0; j < col_count; j++) { out_row[j] = Quantize(x_row[j], inv_scale); }
+  }
+}
+
+void QuantizeWeights(const Matrix<float>& weights, protos::Layer* layer_proto) {
+  const int32_t row_count = weights.RowCount();
+  const int32_t col_count = weights.ColCount();
+  std::vector<float> inv_scales(col_count);
+  for (int32_t j = 0; j < col_count; j++) {
+    float max_abs = 0.0f;
+    for (int32_t i = 0; i < row_count; i++) {
+      max_abs = std::max(max_abs, std::abs(weights.ElementAt(i, j)));
+    }
+    const float scale = QuantizationScale(max_abs);
+    layer_proto->add_weight_scales(scale);
+    inv_scales[j] = 1.0f / scale;
+  }
+  std::string* int8_weights = layer_proto->mutable_int8_weights();
+  int8_weights->resize((int64_t) row_count * col_count);
+  for (int32_t i = 0; i < row_count; i++) {
+    for (int32_t j = 0; j < col_count; j++) {
+      (*int8_weights)[(int64_t) i * col_count + j] =
+        Quantize(weights.ElementAt(i, j), inv_scales[j]);
+    }
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<protos::ModelCheckpoint> QuantizeCheckpoint(
+    const protos::ModelCheckpoint& checkpoint_proto, const Matrix<float>& calibration_inputs) {
+  // NOTE: the input transform is folded into the float model first, so the INT8 one takes
+  // raw features too.
+  protos::ModelCheckpoint folded_proto = checkpoint_proto;
+  absl::Status status = FoldInputTransform(&folded_proto);
+  if (!status.ok()) { return status; }
+  absl::StatusOr<NeuralNetwork<float>> neural_network =
+    NeuralNetwork<float>::FromCheckpoint(folded_proto);
+  if (!neural_network.ok()) { return neural_network.status(); }
+  if (calibration_inputs.RowCount() == 0 ||
+      calibration_inputs.ColCount() != neural_network->GetLayer(0).InputSize()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Expected calibration inputs of ", neural_network->GetLayer(0).InputSize(),
+          " features, got: ", calibration_inputs.RowCount(), "x", calibration_inputs.ColCount()));
+  }
+
+  protos::ModelCheckpoint quantized_proto;
+  quantized_proto.set_precision(protos::Precision::INT8);
+  quantized_proto.set_intermed_activation(checkpoint_proto.intermed_activation());
+  quantized_proto.set_output_activation(checkpoint_proto.output_activation());
+  Matrix<float> layer_input = calibration_inputs;
+  for (int32_t i = 0; i < neural_network->LayersCount(); i++) {
+    const Layer<float>& layer = neural_network->GetLayer(i);
+    protos::Layer& layer_proto = *quantized_proto.add_layers();
+    layer_proto.set_row_count(layer.Weights().RowCount());
+    layer_proto.set_col_count(layer.Weights().ColCount());
+    QuantizeWeights(layer.Weights(), &layer_proto);
+    *layer_proto.mutable_float_biases() =
+      {layer.Biases().Elements().begin(), layer.Biases().Elements().end()};
+
+    float max_abs = 0.0f;
+    for (float x : layer_input.Elements()) { max_abs = std::max(max_abs, std::abs(x)); }
+    layer_proto.set_input_scale(QuantizationScale(max_abs));
+    if (i < neural_network->LayersCount() - 1) { layer_input = layer.Infer(layer_input); }
+  }
+  return quantized_proto;
+}
+
+QuantizedInferenceEngine::QuantizedInferenceEngine(std::vector<LayerParameters> layers) :
+  layers_(std::move(layers)),
+  max_input_stride_(0),
+  max_output_size_(0) {
+    CHECK(!layers_.empty());
+    for (const LayerParameters& layer : layers_) {
+      max_input_stride_ = std::max(max_input_stride_, layer.input_stride);
+      max_output_size_ = std::max(max_output_size_, layer.output_size);
+    }
+  }
+
+absl::StatusOr<QuantizedInferenceEngine> QuantizedInferenceEngine::FromCheckpoint(
+    const protos::ModelCheckpoint& checkpoint_proto) {
+  if (checkpoint_proto.precision() != protos::Precision::INT8) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "Expected an INT8 checkpoint, got: ", protos::Precision_Name(checkpoint_proto.precision())));
+  }
+  if (checkpoint_proto.layers().empty()) {
+    return absl::InvalidArgumentError("Checkpoint has no layers.");
+  }
+  if (checkpoint_proto.has_input_transform()) {
+    return absl::InvalidArgumentError(
+        "INT8 checkpoints fold their input transform into their weights, see QuantizeCheckpoint.");
+  }
+  std::vector<LayerParameters> layers;
+  layers.reserve(checkpoint_proto.layers().size());
+  for (int32_t i = 0; i < checkpoint_proto.layers().size(); i++) {
+    const protos::Layer& layer_proto = checkpoint_proto.layers()[i];
+    const int32_t row_count = layer_proto.row_count();
+    const int32_t col_count = layer_proto.col_count();
+    if (i > 0 && row_count != checkpoint_proto.layers()[i - 1].col_count()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Invalid weight dimensions! Layer: ", i - 1,
+            " has column count: ", checkpoint_proto.layers()[i - 1].col_count(),
+            ", while layer: ", i, " has row count: ", row_count));
+    }
+    if (layer_proto.int8_weights().size() != (int64_t) row_count * col_count ||
+        layer_proto.weight_scales().size() != col_count ||
+        layer_proto.float_biases().size() != col_count ||
+        layer_proto.input_scale() <= 0.0f) {
+      return absl::InvalidArgumentError(absl::StrCat("Layer: ", i, " is not fully quantized."));
+    }
+
+    LayerParameters layer = {
+      .input_size = row_count,
+      .output_size = col_count,
+      .input_stride = (row_count + 3) / 4 * 4,
+      .inv_input_scale = 1.0f / layer_proto.input_scale(),
+      .packed_weights = Int8Buffer(Int8PackedWeightsSize(row_count, col_count)),
+      .output_scales = std::vector<float>(col_count),
+      .biases = {layer_proto.float_biases().begin(), layer_proto.float_biases().end()},
+      .activation = (i == checkpoint_proto.layers().size() - 1) ?
+        checkpoint_proto.output_activation() : checkpoint_proto.intermed_activation(),
+    };
+    PackInt8Weights(
+        row_count, col_count, reinterpret_cast<const int8_t*>(layer_proto.int8_weights().data()),
+        layer.packed_weights.data());
+    for (int32_t j = 0; j < col_count; j++) {
+      layer.output_scales[j] = layer_proto.input_scale() * layer_proto.weight_scales(j);
+    }
+    layers.push_back(std::move(layer));
+  }
+  return QuantizedInferenceEngine(std::move(layers));
+}
+
+int32_t QuantizedInferenceEngine::InputSize() const { return layers_.front().input_size; }
+
+int32_t QuantizedInferenceEngine::OutputSize() const { return layers_.back().output_size; }
+
+QuantizedInferenceEngine::Workspace QuantizedInferenceEngine::NewWorkspace(int32_t max_batch_size) const {
+  DCHECK(max_batch_size > 0);
+  return Workspace(max_batch_size, max_input_stride_, max_output_size_);
+}
+
+// NOTE: each layer's float outputs are quantized straight back into the workspace's int8
+// inputs for the next one, only the last layer's are kept, in output.
+void QuantizedInferenceEngine::Infer(
+    const float* input, int32_t batch_size, Workspace* workspace, float* output) const {
+  DCHECK(workspace != nullptr);
+  DCHECK(0 < batch_size && batch_size <= workspace->MaxBatchSize());
+  const Int8Kernels& kernels = GetInt8Kernels();
+  int8_t* quantized_inputs = workspace->quantized_inputs_.data();
+  int32_t* accumulators = workspace->accumulators_.data();
+  QuantizeRows(
+      input, batch_size, layers_.front().input_size, layers_.front().inv_input_scale,
+      quantized_inputs, layers_.front().input_stride);
+  for (int32_t i = 0; i < layers_.size(); i++) {
+    const LayerParameters& layer = layers_[i];
+    const int32_t n = layer.output_size;
+    kernels.gemm(
+        batch_size, n, layer.input_size, quantized_inputs, layer.input_stride,
+        layer.packed_weights.data(), accumulators);
+
+    float* layer_output = (i == layers_.size() - 1) ? output : workspace->activations_.MutableData();
+    for (int32_t r = 0; r < batch_size; r++) {
+      const int32_t* acc_row = accumulators + (int64_t) r * n;
+      float* out_row = layer_output + (int64_t) r * n;
+      for (int32_t j = 0; j < n; j++) {
+        out_row[j] = (float) acc_row[j] * layer.output_scales[j] + layer.biases[j];
+      }
+    }
+    DispatchActivation(layer.activation, [&](auto activation) {
+      using Activation = decltype(activation);
+      if constexpr (Activation::kElementWise) {
+        Activation::Apply(layer_output, (int64_t) batch_size * n);
+      } else {
+        for (int32_t r = 0; r < batch_size; r++) { Activation::Apply(layer_output + (int64_t) r * n, n); }
+      }
+    });
+
+    if (i < layers_.size() - 1) {
+      const LayerParameters& next_layer = layers_[i + 1];
+      QuantizeRows(
+          layer_output, batch_size, n, next_layer.inv_input_scale,
+          quantized_inputs, next_layer.input_stride);
+    }
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef SRC_NEURAL_NETWORK_QUANTIZATION_H_
+#define SRC_NEURAL_NETWORK_QUANTIZATION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// Post-training int8 quantization of a DOUBLE or FLOAT checkpoint into an INT8 one.
+// Weights are quantized symmetrically per output column, in steps of the column's largest
+// |weight| / 127. Each layer's inputs are quantized the same way per tensor, in steps of the
+// largest |input| seen running calibration_inputs (raw features, one sample per row) through
+// the float model. Biases stay float.
+// NOTE: the checkpoint's input transform is folded into the first layer, see
+// FoldInputTransform, so the INT8 model is fed raw features as well.
+absl::StatusOr<protos::ModelCheckpoint> QuantizeCheckpoint(
+    const protos::ModelCheckpoint& checkpoint_proto, const Matrix<float>& calibration_inputs);
+
+// Forward only runner of an INT8 checkpoint, the quantized counterpart of
+// InferenceEngine<float>. Each layer quantizes its inputs, multiplies them by its packed int8
+// weights exactly in int32 (see Int8Kernels), then scales the sums back to float to add
+// biases and activate. Weights take a quarter of the memory of float ones, and a quarter of
+// the bandwidth to stream through per pass.
+// NOTE: the engine is immutable, any number of threads may Infer at once, each with its
+// own Workspace.
+class QuantizedInferenceEngine {
+ public:
+  using Int8Buffer = std::vector<int8_t, MatrixAllocator<int8_t>>;
+
+  // Preallocated intermediate values for batches of up to MaxBatchSize samples.
+  class Workspace {
+   public:
+    int32_t MaxBatchSize() const { return max_batch_size_; }
+
+   private:
+    friend class QuantizedInferenceEngine;
+    Workspace(int32_t max_batch_size, int32_t max_input_stride, int32_t max_output_size) :
+      max_batch_size_(max_batch_size),
+      quantized_inputs_((int64_t) max_batch_size * max_input_stride),
+      accumulators_((int64_t) max_batch_size * max_output_size),
+      activations_(max_batch_size, max_output_size) {}
+
+    int32_t max_batch_size_;
+    Int8Buffer quantized_inputs_;
+    std::vector<int32_t, MatrixAllocator<int32_t>> accumulators_;
+    Matrix<float> activations_;
+  };
+
+  static absl::StatusOr<QuantizedInferenceEngine> FromCheckpoint(
+      const protos::ModelCheckpoint& checkpoint_proto);
+
+  int32_t InputSize() const;
+  int32_t OutputSize() const;
+  Workspace NewWorkspace(int32_t max_batch_size) const;
+
+  // Runs batch_size x InputSize() inputs into batch_size x OutputSize() outputs, one sample
+  // per row, for batch_size up to the workspace's MaxBatchSize.
+  void Infer(const float* input, int32_t batch_size, Workspace* workspace, float* output) const;
+
+ private:
+  struct LayerParameters {
+    int32_t input_size;
+    int32_t output_size;
+    // NOTE: rows of quantized inputs are padded to the int8 kernels' groups of 4.
+    int32_t input_stride;
+    float inv_input_scale;
+    Int8Buffer packed_weights;
+    // NOTE: input scale * weight scale per column, turning int32 sums back into float.
+    std::vector<float> output_scales;
+    std::vector<float> biases;
+    protos::Activation activation;
+  };
+
+  explicit QuantizedInferenceEngine(std::vector<LayerParameters> layers);
+
+  std::vector<LayerParameters> layers_;
+  int32_t max_input_stride_;
+  int32_t max_output_size_;
+};
+
+#endif
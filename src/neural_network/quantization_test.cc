@@ -0,0 +1,75 @@
+#include "src/neural_network/quantization.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+TEST(QuantizationTest, QuantizedEngineMatchesFloatModel) {
+  const NeuralNetwork<float> neural_network = NeuralNetwork<float>::Random(
+      {12, 9, 16, 5}, protos::Activation::SIGMOID, protos::Activation::SOFTMAX);
+  absl::StatusOr<protos::ModelCheckpoint> quantized_proto =
+    QuantizeCheckpoint(neural_network.ToCheckpoint(), Matrix<float>::Random(64, 12));
+  ASSERT_TRUE(quantized_proto.ok()) << quantized_proto.status();
+  ASSERT_EQ(quantized_proto->precision(), protos::Precision::INT8);
+  ASSERT_EQ(quantized_proto->layers(0).int8_weights().size(), 12 * 9);
+  absl::StatusOr<QuantizedInferenceEngine> engine =
+    QuantizedInferenceEngine::FromCheckpoint(*quantized_proto);
+  ASSERT_TRUE(engine.ok()) << engine.status();
+  ASSERT_EQ(engine->InputSize(), 12);
+  ASSERT_EQ(engine->OutputSize(), 5);
+
+  QuantizedInferenceEngine::Workspace workspace = engine->NewWorkspace(8);
+  for (int32_t batch_size : {1, 3, 8}) {
+    const Matrix<float> input = Matrix<float>::Random(batch_size, 12);
+    const Matrix<float> expected = neural_network.Infer(input);
+    std::vector<float> output(batch_size * 5);
+    engine->Infer(input.Elements().data(), batch_size, &workspace, output.data());
+    for (int32_t i = 0; i < output.size(); i++) {
+      EXPECT_NEAR(output[i], expected.Elements()[i], 0.02) << "batch_size: " << batch_size;
+    }
+  }
+}
+
+TEST(QuantizationTest, PrecisionsAreNotInterchangeable) {
+  const NeuralNetwork<double> neural_network = NeuralNetwork<double>::Random(
+      {4, 3}, protos::Activation::SIGMOID, protos::Activation::SIGMOID);
+  EXPECT_FALSE(QuantizedInferenceEngine::FromCheckpoint(neural_network.ToCheckpoint()).ok());
+  absl::StatusOr<protos::ModelCheckpoint> quantized_proto =
+    QuantizeCheckpoint(neural_network.ToCheckpoint(), Matrix<float>::Random(1, 4));
+  ASSERT_TRUE(quantized_proto.ok()) << quantized_proto.status();
+  EXPECT_FALSE(NeuralNetwork<double>::FromCheckpoint(*quantized_proto).ok());
+  EXPECT_FALSE(QuantizeCheckpoint(*quantized_proto, Matrix<float>::Random(1, 4)).ok());
+  EXPECT_FALSE(QuantizeCheckpoint(neural_network.ToCheckpoint(), Matrix<float>::Random(1, 5)).ok());
+}
+
+TEST(QuantizationTest, FoldsInputTransforms) {
+  const NeuralNetwork<float> neural_network = NeuralNetwork<float>::Random(
+      {4, 3}, protos::Activation::SIGMOID, protos::Activation::SIGMOID);
+  protos::ModelCheckpoint checkpoint_proto = neural_network.ToCheckpoint();
+  checkpoint_proto.mutable_input_transform()->set_scale(0.5);
+  checkpoint_proto.mutable_input_transform()->set_shift(0.25);
+  // NOTE: calibrates on the inputs compared on, so none of them saturates.
+  const Matrix<float> input = Matrix<float>::Random(16, 4);
+  absl::StatusOr<protos::ModelCheckpoint> quantized_proto = QuantizeCheckpoint(checkpoint_proto, input);
+  ASSERT_TRUE(quantized_proto.ok()) << quantized_proto.status();
+  EXPECT_FALSE(quantized_proto->has_input_transform());
+  absl::StatusOr<QuantizedInferenceEngine> engine =
+    QuantizedInferenceEngine::FromCheckpoint(*quantized_proto);
+  ASSERT_TRUE(engine.ok()) << engine.status();
+
+  Matrix<float> transformed_input = input;
+  for (int32_t i = 0; i < transformed_input.Elements().size(); i++) {
+    transformed_input.MutableData()[i] = input.Elements()[i] * 0.5f + 0.25f;
+  }
+  const Matrix<float> expected = neural_network.Infer(transformed_input);
+  QuantizedInferenceEngine::Workspace workspace = engine->NewWorkspace(16);
+  std::vector<float> output(16 * 3);
+  engine->Infer(input.Elements().data(), 16, &workspace, output.data());
+  for (int32_t i = 0; i < output.size(); i++) { EXPECT_NEAR(output[i], expected.Elements()[i], 0.02); }
+}
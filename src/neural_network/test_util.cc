@@ -0,0 +1,38 @@
+#include "src/neural_network/test_util.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "src/common/matrix.h"
+#include "src/neural_network/learn_rate_schedule.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/params.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+TrainParameters TestTrainParameters(protos::Optimizer optimizer) {
+  return TrainParameters {
+    .optimizer = optimizer,
+    .learn_rate = 0.01,
+    .learn_rate_schedule = LearnRateSchedule::CONSTANT,
+    .momentum = 0.5,
+    .beta1 = 0.9,
+    .beta2 = 0.999,
+    .epsilon = 1e-8,
+    .regularization = 0.01,
+  };
+}
+
+std::vector<TestGradients> RandomGradients(
+    const NeuralNetwork<double>& neural_network, int32_t count) {
+  std::vector<TestGradients> all_gradients;
+  for (int32_t i = 0; i < count; i++) {
+    TestGradients gradients = neural_network.ZeroGradients();
+    for (auto& [weights, biases] : gradients) {
+      weights = Matrix<double>::Random(weights.RowCount(), weights.ColCount());
+      biases = Matrix<double>::Random(biases.RowCount(), biases.ColCount());
+    }
+    all_gradients.push_back(std::move(gradients));
+  }
+  return all_gradients;
+}
@@ -0,0 +1,25 @@
+#ifndef SRC_NEURAL_NETWORK_TEST_UTIL_H_
+#define SRC_NEURAL_NETWORK_TEST_UTIL_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "src/common/matrix.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/params.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+// Shared fixtures of the training tests.
+
+using TestGradients = std::vector<std::pair<Matrix<double>, Matrix<double>>>;
+
+// NOTE: a constant learn rate, with every optimizer's hyper parameters and regularization
+// set, so that every term of the update is exercised.
+TrainParameters TestTrainParameters(protos::Optimizer optimizer);
+
+// count sets of gradients shaped like neural_network's parameters, uniformly random.
+std::vector<TestGradients> RandomGradients(
+    const NeuralNetwork<double>& neural_network, int32_t count);
+
+#endif
@@ -1,12 +1,20 @@
 #include "src/neural_network/trainer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cmath>
+#include <functional>
 #include <future>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <sstream>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -14,11 +22,21 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "src/common/arena.h"
 #include "src/common/matrix.h"
 #include "src/common/thread_pool.h"
-#include "src/io/csv_reader.h"
-#include "src/io/model_checkpoint.h"
+#include "src/distributed/gradient_all_reducer.h"
+#include "src/distributed/ring_all_reduce.h"
+#include "src/io/checkpoint_writer.h"
+#include "src/io/data_reader.h"
+#include "src/io/dataset.h"
+#include "src/io/prefetching_data_reader.h"
+#include "src/io/preprocessing_data_reader.h"
+#include "src/io/shuffled_data_reader.h"
+#include "src/neural_network/model_snapshot.h"
 #include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
+#include "src/protos/model_checkpoint.pb.h"
 
 struct Stats {
   Stats() : total_correct_inferences_(0), total_inferences_(0), num_batches_(0) {}
@@ -35,150 +53,360 @@ struct Stats {
   int32_t num_batches_;
 };
 
-struct WorkerOutput {
+// NOTE: copies the preprocessed samples into a single BxN block, one sample per row,
+// allocated from the given memory resource.
+template <typename T>
+Matrix<T> BuildInputMatrix(
+    const SampleBatch& samples,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+  DCHECK(samples.sample_count > 0);
+  Matrix<T> input = Matrix<T>(samples.sample_count, samples.feature_count, resource);
+  samples.ConvertFeatures((T) 1, input.MutableData());
+  return input;
+}
+
+template <typename T>
+Matrix<T> BuildExpectedOutputMatrix(
+    const SampleBatch& samples,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+  DCHECK(samples.sample_count > 0);
+  Matrix<T> expected_output = Matrix<T>(samples.sample_count, samples.class_count, resource);
+  samples.ConvertTargets(expected_output.MutableData());
+  return expected_output;
+}
+
+// NOTE: the batch is split into one contiguous view per worker, which stay valid until the
+// next batch is read.
+std::vector<SampleBatch> PartitionBatch(const SampleBatch& batch, int32_t num_threads) {
+  const int64_t ideal_partition_size = (batch.sample_count + num_threads - 1) / num_threads;
+  std::vector<SampleBatch> partitions;
+  partitions.reserve(num_threads);
+  for (int64_t begin = 0; begin < batch.sample_count; begin += ideal_partition_size) {
+    partitions.push_back(batch.Slice(begin, std::min(begin + ideal_partition_size, batch.sample_count)));
+  }
+  return partitions;
+}
+
+// NOTE: gradients and arena are preallocated, per-worker buffers that are reused for every
+// batch. Every intermediate value is allocated from the arena, so once it has grown to fit
+// a partition the steady state training loop does no heap allocations.
+template <typename T>
+Stats LearnSamples(
+    const TrainParameters& params, const NeuralNetwork<T>& neural_network,
+    const Matrix<T>& input, const Matrix<T>& expected_output, const uint32_t* labels,
+    std::vector<std::pair<Matrix<T>, Matrix<T>>>* gradients,
+    Arena* arena, const std::function<void(int32_t)>& on_layer_gradients = nullptr) {
   Stats stats;
-  std::vector<std::vector<std::pair<Matrix, Matrix>>> gradients;
+  typename NeuralNetwork<T>::NetworkLearnCache cache = {
+    .layer_caches = std::pmr::vector<typename Layer<T>::LayerLearnCache>(arena),
+  };
+  const Matrix<T>& model_output = neural_network.FeedForward(input, &cache);
+  for (int32_t i = 0; i < input.RowCount(); i++) {
+    stats.total_correct_inferences_ +=
+      (model_output.ClassifyRow(i) == labels[i]);
+    stats.total_inferences_++;
+  }
+  for (std::pair<Matrix<T>, Matrix<T>>& gradient : *gradients) {
+    gradient.first.SetZero();
+    gradient.second.SetZero();
+  }
+  neural_network.BackPropagate(
+      params, &cache, model_output, expected_output, gradients, on_layer_gradients);
+  return stats;
+}
+
+// NOTE: when data parallel, sums each layer's gradients over the workers on the last worker
+// to back propagate it, then hands them to the all-reducer, so that they're exchanged with
+// the other processes while the workers are still back propagating the earlier layers.
+template <typename T>
+class LayerReduction {
+ public:
+  LayerReduction(int32_t layer_count, GradientAllReducer<T>* all_reducer) :
+    all_reducer_(all_reducer),
+    worker_gradients_(nullptr),
+    worker_count_(0),
+    pending_worker_counts_(layer_count) {}
+
+  void Start(
+      std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>* worker_gradients,
+      int32_t worker_count) {
+    worker_gradients_ = worker_gradients;
+    worker_count_ = worker_count;
+    for (std::atomic<int32_t>& pending_worker_count : pending_worker_counts_) {
+      pending_worker_count.store(worker_count, std::memory_order_relaxed);
+    }
+    all_reducer_->Start(&(*worker_gradients)[0]);
+  }
+
+  // NOTE: called by every worker, once its gradients of the layer are final.
+  void OnLayerGradients(int32_t layer) {
+    // NOTE: acq_rel, so that the last worker sees every other worker's gradients.
+    if (pending_worker_counts_[layer].fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+    std::pair<Matrix<T>, Matrix<T>>& gradients = (*worker_gradients_)[0][layer];
+    for (int32_t i = 1; i < worker_count_; i++) {
+      gradients.first += (*worker_gradients_)[i][layer].first;
+      gradients.second += (*worker_gradients_)[i][layer].second;
+    }
+    all_reducer_->LayerReady(layer);
+  }
+
+  absl::Status Wait() { return all_reducer_->Wait(); }
+
+ private:
+  GradientAllReducer<T>* all_reducer_;
+  std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>* worker_gradients_;
+  int32_t worker_count_;
+  std::vector<std::atomic<int32_t>> pending_worker_counts_;
 };
 
-WorkerOutput TrainPartition(
+template <typename T>
+Stats TrainPartition(
     const TrainParameters& params,
-    const NeuralNetwork& neural_network,
-    std::vector<std::pair<uint32_t, Matrix>> samples) {
-  WorkerOutput worker_output;
-  worker_output.gradients.reserve(neural_network.LayersCount());
-  for (int32_t i = 0; i < samples.size(); i++) {
-    uint32_t expected_class = samples[i].first;
-    Matrix& input = samples[i].second;
-
-    // TODO/SPEEDUP: apply this directly to file data, this is specific to the MNIST data set.
-    for (int32_t r = 0; r < input.RowCount(); r++) {
-      for (int32_t c = 0; c < input.ColCount(); c++) {
-        double& x = input.MutableElementAt(r, c);
-        x /= 255.0;
-      }
+    typename ModelSnapshot<T>::View neural_network,
+    SampleBatch samples,
+    std::vector<std::pair<Matrix<T>, Matrix<T>>>* gradients,
+    Arena* arena, LayerReduction<T>* layer_reduction) {
+  // NOTE: nothing allocated from the arena outlives the previous partition.
+  arena->Reset();
+  Matrix<T> input = BuildInputMatrix<T>(samples, arena);
+  Matrix<T> expected_output = BuildExpectedOutputMatrix<T>(samples, arena);
+  std::function<void(int32_t)> on_layer_gradients;
+  if (layer_reduction != nullptr) {
+    on_layer_gradients = [layer_reduction](int32_t layer) { layer_reduction->OnLayerGradients(layer); };
+  }
+  return LearnSamples<T>(
+      params, *neural_network, input, expected_output, samples.labels, gradients, arena,
+      on_layer_gradients);
+}
+
+// NOTE: Hogwild style, workers read parameters while others update them, and update them
+// without locks. These races are benign by design: every update is small, so one computed
+// from a partially updated model, or partially overwritten, still descends.
+template <typename T>
+Stats HogwildWorker(
+    const TrainParameters& params, NeuralNetwork<T>* neural_network, Optimizer<T>* optimizer,
+    DataReader* train_data, std::mutex* train_data_mutex,
+    std::vector<std::pair<Matrix<T>, Matrix<T>>>* gradients,
+    Arena* arena, std::atomic<int64_t>* batch_count) {
+  Stats stats;
+  while (true) {
+    // NOTE: nothing allocated from the arena outlives the previous batch.
+    arena->Reset();
+    std::optional<Matrix<T>> input;
+    std::optional<Matrix<T>> expected_output;
+    std::optional<std::pmr::vector<uint32_t>> labels;
+    {
+      // NOTE: a batch is only valid until the next one is read, so it's copied out first.
+      std::scoped_lock lock(*train_data_mutex);
+      SampleBatch batch = train_data->GetNextBatch(params.train_batch_size);
+      if (batch.sample_count == 0) { break; } // NOTE: no more file data
+      input.emplace(BuildInputMatrix<T>(batch, arena));
+      expected_output.emplace(BuildExpectedOutputMatrix<T>(batch, arena));
+      labels.emplace(batch.labels, batch.labels + batch.sample_count, arena);
     }
-    Matrix expected_output = Matrix(1, 10);
-    expected_output.MutableElementAt(0, expected_class) = 1.0f;
+    Stats batch_stats = LearnSamples<T>(
+        params, *neural_network, *input, *expected_output, labels->data(), gradients, arena);
+    optimizer->ApplyGradients(neural_network, *gradients);
+    stats.total_correct_inferences_ += batch_stats.total_correct_inferences_;
+    stats.total_inferences_ += batch_stats.total_inferences_;
+    stats.num_batches_++;
+    batch_count->fetch_add(1, std::memory_order_relaxed);
+  }
+  return stats;
+}
 
-    NeuralNetwork::NetworkLearnCache cache = {};
-    Matrix model_output = neural_network.FeedForward(input, &cache);
-    worker_output.stats.total_correct_inferences_ +=
-      (model_output.Classify() == expected_output.Classify());
-    worker_output.stats.total_inferences_++;
-    worker_output.gradients.emplace_back(neural_network.BackPropagate(
-          params, &cache, model_output, expected_output));
+// NOTE: pairwise tree reduction of every worker's gradients into worker_gradients[0].
+// Each level reduces all (worker pair, layer) combinations in parallel.
+template <typename T>
+void ReduceGradients(
+    std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>& worker_gradients,
+    int32_t worker_count, ThreadPool& thread_pool) {
+  DCHECK(worker_count <= worker_gradients.size());
+  const int32_t layer_count = worker_gradients[0].size();
+  for (int32_t stride = 1; stride < worker_count; stride *= 2) {
+    const int32_t pair_count = (worker_count - stride + 2 * stride - 1) / (2 * stride);
+    thread_pool.ParallelFor(0, pair_count * layer_count, /*grain=*/1, [&](int64_t pair_layer) {
+      const int32_t i = (pair_layer / layer_count) * 2 * stride;
+      const int32_t j = pair_layer % layer_count;
+      worker_gradients[i][j].first += worker_gradients[i + stride][j].first;
+      worker_gradients[i][j].second += worker_gradients[i + stride][j].second;
+    });
   }
-  return worker_output;
 }
 
-Stats TrainEpoch(
-    const TrainParameters& params, NeuralNetwork& neural_network,
-    CsvReader& train_data, ThreadPool& thread_pool) {
-  Stats stats;
+// A checkpoint's parameters and optimizer state, copied together between updates.
+template <typename T>
+struct TrainingSnapshot {
+  ParameterSnapshot<T> parameters;
+  OptimizerSnapshot<T> optimizer;
+};
 
-  int32_t ideal_partition_size = std::ceil(((double) params.train_batch_size) / params.num_threads);
-  DCHECK(ideal_partition_size > 0);
+// Queues checkpoints of the model and its optimizer's state on a CheckpointWriter at the end
+// of every epoch, and between batches as often as params ask for. Only copying the state
+// happens on the training thread, the checkpoint is built and written on the writer's.
+// NOTE: no checkpoints are written without a writer.
+template <typename T>
+class Checkpointer {
+ public:
+  Checkpointer(
+      const TrainParameters& params, CheckpointWriter* writer, const Optimizer<T>* optimizer,
+      protos::InputTransform input_transform) :
+    every_batches_(params.checkpoint_every_batches),
+    every_(std::chrono::seconds(params.checkpoint_every_seconds)),
+    writer_(writer),
+    optimizer_(optimizer),
+    input_transform_(std::make_shared<const protos::InputTransform>(std::move(input_transform))),
+    batches_since_last_(0),
+    last_(std::chrono::steady_clock::now()),
+    snapshot_(nullptr) {}
 
-  std::vector<std::pair<uint32_t, Matrix>> batch = train_data.GetNextBatchSample(params.train_batch_size);
-  while (batch.size() > 0) { // NOTE: while there is still file data
+  // NOTE: the last snapshot's buffers are reused once the writer is done with them, which
+  // skips faulting in fresh pages for every checkpoint. The optimizer must not be stepping
+  // neural_network's layers meanwhile, or the checkpoint may not resume exactly.
+  void Checkpoint(const NeuralNetwork<T>& neural_network) {
+    if (writer_ == nullptr) { return; }
+    if (snapshot_ == nullptr || snapshot_.use_count() > 1) {
+      snapshot_ = std::make_shared<TrainingSnapshot<T>>();
+    }
+    // NOTE: pairs with the writer releasing its reference, after it's done reading.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    neural_network.SnapshotParameters(&snapshot_->parameters);
+    optimizer_->Snapshot(&snapshot_->optimizer);
+    writer_->Write([snapshot = std::shared_ptr<const TrainingSnapshot<T>>(snapshot_),
+                    input_transform = input_transform_]() {
+      protos::ModelCheckpoint checkpoint_proto = snapshot->parameters.ToCheckpoint();
+      snapshot->optimizer.AddToCheckpoint(&checkpoint_proto);
+      *checkpoint_proto.mutable_input_transform() = *input_transform;
+      return checkpoint_proto;
+    });
+    batches_since_last_ = 0;
+    last_ = std::chrono::steady_clock::now();
+  }
 
-    // NOTE: enqueue batch work
-    std::vector<std::future<WorkerOutput>> worker_output_futures;
-    worker_output_futures.reserve(params.num_threads);
-    while (batch.size() > 0) {
-      std::vector<std::pair<uint32_t, Matrix>> sample_partition;
-      int32_t sample_partition_size = std::min(ideal_partition_size, (int32_t) batch.size());
-      sample_partition.reserve(std::min(sample_partition_size, (int32_t) batch.size()));
-      for (int32_t i = 0; i < sample_partition_size; i++) {
-        sample_partition.push_back(std::move(batch.back()));
-        batch.pop_back();
-      }
+  // Returns whether a checkpoint is due, once batch_count more batches' gradients have been
+  // applied.
+  bool Due(uint32_t batch_count = 1) {
+    if (writer_ == nullptr) { return false; }
+    batches_since_last_ += batch_count;
+    return (every_batches_ > 0 && batches_since_last_ >= every_batches_) ||
+      (every_.count() > 0 && std::chrono::steady_clock::now() - last_ >= every_);
+  }
+
+ private:
+  const uint32_t every_batches_;
+  const std::chrono::seconds every_;
+  CheckpointWriter* writer_;
+  const Optimizer<T>* optimizer_;
+  // NOTE: how the model's features were preprocessed, for serving to do the same.
+  std::shared_ptr<const protos::InputTransform> input_transform_;
+  uint32_t batches_since_last_;
+  std::chrono::steady_clock::time_point last_;
+  std::shared_ptr<TrainingSnapshot<T>> snapshot_;
+};
 
-      std::future<WorkerOutput> future = thread_pool.Push(
-          TrainPartition, params, neural_network, std::move(sample_partition));
-      worker_output_futures.push_back(std::move(future));
+// NOTE: data parallel processes must all take the same steps, so they only go on while
+// every one of them has a batch left. Shards may differ by a batch, which is then skipped.
+absl::StatusOr<bool> EveryProcessHasBatch(const SampleBatch& batch, RingAllReduce* ring) {
+  if (ring == nullptr) { return batch.sample_count > 0; }
+  int64_t process_count = (batch.sample_count > 0);
+  absl::Status status = ring->AllReduce(&process_count, 1);
+  if (!status.ok()) { return status; }
+  return process_count == ring->Size();
+}
+
+// NOTE: ring and layer_reduction are null unless training data parallel.
+template <typename T>
+absl::StatusOr<Stats> TrainEpoch(
+    const TrainParameters& params, ModelSnapshot<T>& model, Optimizer<T>& optimizer,
+    DataReader& train_data, ThreadPool& thread_pool,
+    std::vector<std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>>& worker_gradient_sets,
+    std::vector<Arena>& worker_arenas, Checkpointer<T>& checkpointer,
+    RingAllReduce* ring, LayerReduction<T>* layer_reduction) {
+  Stats stats;
+
+  SampleBatch batch = train_data.GetNextBatch(params.train_batch_size);
+  while (true) {
+    absl::StatusOr<bool> has_batch = EveryProcessHasBatch(batch, ring);
+    if (!has_batch.ok()) { return has_batch.status(); }
+    if (!*has_batch) { break; } // NOTE: while there is still file data
+    // NOTE: when pipelined, the gradients of the last max_staleness batches may still be
+    // waiting to be applied, so batches cycle through max_staleness + 1 sets.
+    std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>& worker_gradients =
+      worker_gradient_sets[stats.num_batches_ % worker_gradient_sets.size()];
+
+    // NOTE: enqueue batch work
+    const std::vector<SampleBatch> sample_partitions = PartitionBatch(batch, params.num_threads);
+    if (layer_reduction != nullptr) { layer_reduction->Start(&worker_gradients, sample_partitions.size()); }
+    std::vector<std::future<Stats>> all_worker_stats;
+    all_worker_stats.reserve(params.num_threads);
+    for (const SampleBatch& sample_partition : sample_partitions) {
+      DCHECK(all_worker_stats.size() < worker_gradients.size());
+      std::future<Stats> future = thread_pool.Push(
+          TrainPartition<T>, params, model.Borrow(), sample_partition,
+          &worker_gradients[all_worker_stats.size()], &worker_arenas[all_worker_stats.size()],
+          layer_reduction);
+      all_worker_stats.push_back(std::move(future));
     }
 
-    std::vector<std::pair<Matrix, Matrix>> gradients_accum;
-    gradients_accum.reserve(neural_network.LayersCount());
-    for (int32_t i = 0; i < neural_network.LayersCount(); i++) {
-      const Layer& layer = neural_network.GetLayer(i);
-      gradients_accum.emplace_back(std::make_pair(
-            Matrix(layer.InputSize(), layer.OutputSize()),
-            Matrix(1, layer.OutputSize())));
+    // NOTE: read work output
+    for (std::future<Stats>& worker_stats_future : all_worker_stats) {
+      worker_stats_future.wait();
+      Stats worker_stats = worker_stats_future.get();
+      stats.total_correct_inferences_ += worker_stats.total_correct_inferences_;
+      stats.total_inferences_ += worker_stats.total_inferences_;
     }
-    for (std::future<WorkerOutput>& worker_output_future : worker_output_futures) {
-      worker_output_future.wait();
-      WorkerOutput worker_output = worker_output_future.get();
-      stats.total_correct_inferences_ += worker_output.stats.total_correct_inferences_;
-      stats.total_inferences_ += worker_output.stats.total_inferences_;
-      for (std::vector<std::pair<Matrix, Matrix>>& gradients : worker_output.gradients) {
-        for (int32_t j = 0; j < gradients.size(); j++) {
-          gradients_accum[j].first += gradients[j].first;
-          gradients_accum[j].second += gradients[j].second;
-        }
-      }
+    if (layer_reduction == nullptr) {
+      ReduceGradients(worker_gradients, all_worker_stats.size(), thread_pool);
+    } else {
+      absl::Status status = layer_reduction->Wait();
+      if (!status.ok()) { return status; }
+    }
+    model.ApplyGradients(&optimizer, worker_gradients[0]);
+    if (checkpointer.Due()) {
+      // NOTE: when pipelined, the optimizer's state is only consistent with the model's once
+      // every queued update has been applied.
+      model.Flush();
+      checkpointer.Checkpoint(model.Current());
     }
-    neural_network.ApplyGradients(params, std::move(gradients_accum));
 
     stats.num_batches_++;
-    batch = train_data.GetNextBatchSample(params.train_batch_size);
+    batch = train_data.GetNextBatch(params.train_batch_size);
     LOG_EVERY_N_SEC(INFO, 15) << "Epoch progress: " << stats.ToString();
   }
 
+  model.Flush();
   return stats;
 }
 
+template <typename T>
 Stats TestPartition(
-    const NeuralNetwork& neural_network,
-    std::vector<std::pair<uint32_t, Matrix>> samples) {
+    typename ModelSnapshot<T>::View neural_network,
+    SampleBatch samples) {
   Stats stats;
-  for (int32_t i = 0; i < samples.size(); i++) {
-    uint32_t expected_class = samples[i].first;
-    Matrix& input = samples[i].second;
-
-    // TODO/SPEEDUP: apply this directly to file data, this is specific to the MNIST data set.
-    for (int32_t r = 0; r < input.RowCount(); r++) {
-      for (int32_t c = 0; c < input.ColCount(); c++) {
-        double& x = input.MutableElementAt(r, c);
-        x /= 255.0;
-      }
-    }
-    Matrix expected_output = Matrix(1, 10);
-    expected_output.MutableElementAt(0, expected_class) = 1.0f;
-    Matrix model_output = neural_network.Infer(input);
-
+  Matrix<T> input = BuildInputMatrix<T>(samples);
+  Matrix<T> model_output = neural_network->Infer(input);
+  for (int32_t i = 0; i < samples.sample_count; i++) {
     stats.total_correct_inferences_ +=
-      (model_output.Classify() == expected_output.Classify());
+      (model_output.ClassifyRow(i) == samples.labels[i]);
     stats.total_inferences_++;
   }
   return stats;
 }
 
+template <typename T>
 Stats Test(
-    const TrainParameters& params, const NeuralNetwork& neural_network,
-    CsvReader& test_data, ThreadPool& thread_pool) {
+    const TrainParameters& params, const ModelSnapshot<T>& model,
+    DataReader& test_data, ThreadPool& thread_pool) {
   Stats stats;
 
-  int32_t ideal_partition_size = std::ceil(((double) params.test_batch_size) / params.num_threads);
-  DCHECK(ideal_partition_size > 0);
-
-  std::vector<std::pair<uint32_t, Matrix>> batch = test_data.GetNextBatchSample(params.test_batch_size);
-  while (batch.size() > 0) { // NOTE: while there is still file data
+  SampleBatch batch = test_data.GetNextBatch(params.test_batch_size);
+  while (batch.sample_count > 0) { // NOTE: while there is still file data
     // NOTE: enqueue batch work
     std::vector<std::future<Stats>> all_worker_stats;
     all_worker_stats.reserve(params.num_threads);
-    while (batch.size() > 0) {
-      std::vector<std::pair<uint32_t, Matrix>> sample_partition;
-      int32_t sample_partition_size = std::min(ideal_partition_size, (int32_t) batch.size());
-      sample_partition.reserve(std::min(sample_partition_size, (int32_t) batch.size()));
-      for (int32_t i = 0; i < sample_partition_size; i++) {
-        sample_partition.push_back(std::move(batch.back()));
-        batch.pop_back();
-      }
-
+    for (const SampleBatch& sample_partition : PartitionBatch(batch, params.num_threads)) {
       std::future<Stats> future = thread_pool.Push(
-          TestPartition, neural_network, std::move(sample_partition));
+          TestPartition<T>, model.Borrow(), sample_partition);
       all_worker_stats.push_back(std::move(future));
     }
 
@@ -191,38 +419,252 @@ Stats Test(
     }
 
     stats.num_batches_++;
-    batch = test_data.GetNextBatchSample(params.test_batch_size);
+    batch = test_data.GetNextBatch(params.test_batch_size);
   }
 
   return stats;
 }
 
+template <typename T>
+Stats TestOnCallingThread(
+    const TrainParameters& params, const ModelSnapshot<T>& model, DataReader& test_data) {
+  Stats stats;
+  SampleBatch batch = test_data.GetNextBatch(params.test_batch_size);
+  while (batch.sample_count > 0) { // NOTE: while there is still file data
+    Stats batch_stats = TestPartition<T>(model.Borrow(), batch);
+    stats.total_correct_inferences_ += batch_stats.total_correct_inferences_;
+    stats.total_inferences_ += batch_stats.total_inferences_;
+    stats.num_batches_++;
+    batch = test_data.GetNextBatch(params.test_batch_size);
+  }
+  return stats;
+}
+
+// NOTE: the workers train until the data runs out, while this thread checkpoints and tests
+// snapshots of the model on its own, as every worker is busy. Workers get threads of their
+// own rather than the pool's: they block on the training data, which may be parsed on the
+// pool, so a pool thread running one could end up waiting on itself.
+template <typename T>
+Stats TrainEpochHogwild(
+    const TrainParameters& params, NeuralNetwork<T>& neural_network, Optimizer<T>& optimizer,
+    DataReader& train_data, DataReader& test_data,
+    std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>& worker_gradients,
+    std::vector<Arena>& worker_arenas, Checkpointer<T>& checkpointer) {
+  constexpr std::chrono::milliseconds kPollInterval(100);
+  std::mutex train_data_mutex;
+  std::atomic<int64_t> batch_count = 0;
+  std::vector<std::future<Stats>> all_worker_stats;
+  all_worker_stats.reserve(params.num_threads);
+  for (int32_t i = 0; i < params.num_threads; i++) {
+    std::future<Stats> future = std::async(
+        std::launch::async, HogwildWorker<T>, params, &neural_network, &optimizer, &train_data,
+        &train_data_mutex, &worker_gradients[i], &worker_arenas[i], &batch_count);
+    all_worker_stats.push_back(std::move(future));
+  }
+
+  Stats stats;
+  int64_t checkpointed_batch_count = 0;
+  std::chrono::steady_clock::time_point last_eval = std::chrono::steady_clock::now();
+  for (std::future<Stats>& worker_stats_future : all_worker_stats) {
+    while (worker_stats_future.wait_for(kPollInterval) != std::future_status::ready) {
+      const int64_t current_batch_count = batch_count.load(std::memory_order_relaxed);
+      if (checkpointer.Due(current_batch_count - checkpointed_batch_count)) {
+        checkpointer.Checkpoint(neural_network);
+      }
+      checkpointed_batch_count = current_batch_count;
+      if (params.eval_every_seconds == 0 ||
+          std::chrono::steady_clock::now() - last_eval < std::chrono::seconds(params.eval_every_seconds)) {
+        continue;
+      }
+      // NOTE: tests a copy, so that every sample sees the same parameters.
+      NeuralNetwork<T> snapshot = neural_network;
+      test_data.Reset();
+      Stats test_stats = TestOnCallingThread(params, ModelSnapshot<T>(&snapshot), test_data);
+      LOG(INFO) << "Snapshot after " << current_batch_count << " batches: Test score : "
+        << test_stats.ToString();
+      last_eval = std::chrono::steady_clock::now();
+    }
+    Stats worker_stats = worker_stats_future.get();
+    stats.total_correct_inferences_ += worker_stats.total_correct_inferences_;
+    stats.total_inferences_ += worker_stats.total_inferences_;
+    stats.num_batches_ += worker_stats.num_batches_;
+  }
+
+  return stats;
+}
+
+// NOTE: every process starts from the first one's parameters, summed with everyone else's
+// zeros, so that they stay identical as they apply the same all-reduced gradients. Optimizer
+// state isn't broadcast, every process starts it from scratch or from the same checkpoint.
+template <typename T>
+absl::Status BroadcastParameters(RingAllReduce& ring, NeuralNetwork<T>& neural_network) {
+  ParameterSnapshot<T> snapshot;
+  neural_network.SnapshotParameters(&snapshot);
+  for (auto& [weights, biases] : snapshot.parameters) {
+    for (Matrix<T>* parameters : { &weights, &biases }) {
+      if (ring.Rank() != 0) { parameters->SetZero(); }
+      absl::Status status = ring.AllReduce(parameters->MutableData(), parameters->Elements().size());
+      if (!status.ok()) { return status; }
+    }
+  }
+  absl::StatusOr<NeuralNetwork<T>> broadcast = NeuralNetwork<T>::FromCheckpoint(snapshot.ToCheckpoint());
+  if (!broadcast.ok()) { return broadcast.status(); }
+  neural_network = *std::move(broadcast);
+  return absl::OkStatus();
+}
+
+// NOTE: the model's element type, with one-hot targets for each of its outputs.
+template <typename T>
+PreprocessOptions BuildPreprocessOptions(
+    const NeuralNetwork<T>& neural_network, const TrainParameters& params) {
+  return PreprocessOptions {
+    .dtype = std::is_same_v<T, float> ? DatasetDtype::FLOAT32 : DatasetDtype::FLOAT64,
+    .scale = params.input_scale,
+    .shift = params.input_shift,
+    .class_count = neural_network.GetLayer(neural_network.LayersCount() - 1).OutputSize(),
+  };
+}
+
+// NOTE: what checkpoints record of options, see protos::InputTransform.
+protos::InputTransform ToInputTransform(const PreprocessOptions& options) {
+  protos::InputTransform transform_proto;
+  transform_proto.set_scale(options.scale);
+  transform_proto.set_shift(options.shift);
+  for (int32_t i = 0; i < options.feature_means.size(); i++) {
+    transform_proto.add_feature_means(options.feature_means[i]);
+    transform_proto.add_feature_inverse_stddevs(1.0 / options.feature_stddevs[i]);
+  }
+  return transform_proto;
+}
+
+// NOTE: the next batches are read and preprocessed while the current one is being trained
+// on / tested. Samples are visited in file order, unless given shuffle_options.
+absl::StatusOr<std::unique_ptr<DataReader>> OpenPrefetchedDataReader(
+    std::string file_path, std::optional<ShuffleOptions> shuffle_options,
+    const PreprocessOptions& preprocess_options,
+    int32_t batch_size, int32_t prefetch_depth, ThreadPool& thread_pool) {
+  absl::StatusOr<std::unique_ptr<DataReader>> reader = OpenDataReader(file_path, &thread_pool);
+  if (!reader.ok()) { return reader; }
+  if (shuffle_options.has_value()) {
+    *reader = std::make_unique<ShuffledDataReader>(*std::move(reader), *shuffle_options);
+  }
+  auto preprocessed = std::make_unique<PreprocessingDataReader>(*std::move(reader), preprocess_options);
+  if (prefetch_depth == 0) { return preprocessed; }
+  return std::make_unique<PrefetchingDataReader>(std::move(preprocessed), batch_size, prefetch_depth);
+}
+
+template <typename T>
 absl::Status Train(
-    NeuralNetwork& neural_network, const TrainParameters& params,
+    NeuralNetwork<T>& neural_network, Optimizer<T>& optimizer, const TrainParameters& params,
     std::string train_data_file_path, std::string test_data_file_path,
-    std::string out_model_checkpoint_file_path) {
-  absl::StatusOr<CsvReader> train_data = CsvReader::Open(train_data_file_path);
+    std::string out_model_checkpoint_file_path, const std::vector<std::string>& peers) {
+  // NOTE: declared before the readers, which may parse on it.
+  auto thread_pool = ThreadPool(params.num_threads);
+  PreprocessOptions preprocess_options = BuildPreprocessOptions(neural_network, params);
+  if (params.standardize_features) {
+    // NOTE: the test data is standardized with the training data's statistics.
+    LOG(INFO) << "Computing feature statistics of the training data...";
+    absl::StatusOr<std::unique_ptr<DataReader>> raw_train_data =
+      OpenDataReader(train_data_file_path, &thread_pool);
+    if (!raw_train_data.ok()) { return raw_train_data.status(); }
+    absl::Status status = ComputeFeatureStatistics(**raw_train_data, &preprocess_options);
+    if (!status.ok()) { return status; }
+  }
+  std::optional<ShuffleOptions> train_shuffle_options;
+  if (params.shuffle || params.num_shards > 1) {
+    train_shuffle_options = ShuffleOptions {
+      .shuffle = params.shuffle,
+      .seed = params.shuffle_seed,
+      .shard_index = (int32_t) params.shard_index,
+      .num_shards = (int32_t) params.num_shards,
+    };
+  }
+  absl::StatusOr<std::unique_ptr<DataReader>> train_data = OpenPrefetchedDataReader(
+      train_data_file_path, train_shuffle_options, preprocess_options,
+      params.train_batch_size, params.prefetch_depth, thread_pool);
   if (!train_data.ok()) { return train_data.status(); }
-  absl::StatusOr<CsvReader> test_data = CsvReader::Open(test_data_file_path);
+  absl::StatusOr<std::unique_ptr<DataReader>> test_data = OpenPrefetchedDataReader(
+      test_data_file_path, std::nullopt, preprocess_options,
+      params.test_batch_size, params.prefetch_depth, thread_pool);
   if (!test_data.ok()) { return test_data.status(); }
 
   LOG(INFO) << "Using training params: " << params.ToString();
-  auto thread_pool = ThreadPool(params.num_threads);
+  std::optional<RingAllReduce> ring;
+  if (!peers.empty()) {
+    if (peers.size() != params.num_shards) {
+      return absl::InvalidArgumentError("Data parallel training needs one peer per shard.");
+    }
+    LOG(INFO) << "Connecting to " << peers.size() << " data parallel processes...";
+    absl::StatusOr<RingAllReduce> connected = RingAllReduce::Connect(peers, params.shard_index);
+    if (!connected.ok()) { return connected.status(); }
+    ring.emplace(*std::move(connected));
+    absl::Status status = BroadcastParameters(*ring, neural_network);
+    if (!status.ok()) { return status; }
+  }
+  ModelSnapshot<T> model(&neural_network, params.max_staleness, &thread_pool);
+  std::vector<std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>> worker_gradient_sets(
+      params.max_staleness + 1,
+      std::vector<std::vector<std::pair<Matrix<T>, Matrix<T>>>>(
+        params.num_threads, neural_network.ZeroGradients()));
+  std::vector<Arena> worker_arenas(params.num_threads);
+  std::optional<GradientAllReducer<T>> all_reducer;
+  std::optional<LayerReduction<T>> layer_reduction;
+  if (ring.has_value()) {
+    all_reducer.emplace(&*ring, worker_gradient_sets[0][0], params.allreduce_bucket_bytes);
+    layer_reduction.emplace(neural_network.LayersCount(), &*all_reducer);
+    LOG(INFO) << "Gradient all-reduce buckets: " << all_reducer->BucketCount();
+  }
+  CheckpointWriter checkpoint_writer(CheckpointWriterOptions {
+    .file_path = out_model_checkpoint_file_path,
+    .keep_last = (int32_t) params.checkpoint_keep_last,
+  });
+  // NOTE: data parallel processes all hold the same parameters, only the first one saves them.
+  Checkpointer<T> checkpointer(
+      params, (!ring.has_value() || ring->Rank() == 0) ? &checkpoint_writer : nullptr, &optimizer,
+      ToInputTransform(preprocess_options));
   for (int32_t i = 0; i < params.num_epochs; i++) {
-    LOG(INFO) << "Epoch " << (i + 1) << " of " << params.num_epochs << ": Starting training...";
-    train_data->Reset();
-    Stats train_stats = TrainEpoch(params, neural_network, *train_data, thread_pool);
-    LOG(INFO) << "Epoch " << (i + 1) << " of " << params.num_epochs << ": Train score: " << train_stats.ToString();
+    LOG(INFO) << "Epoch " << (i + 1) << " of " << params.num_epochs << ": Starting training, learn rate: "
+      << optimizer.LearnRate() << "...";
+    (*train_data)->Reset();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    absl::StatusOr<Stats> train_stats = params.hogwild ?
+      TrainEpochHogwild(
+          params, neural_network, optimizer, **train_data, **test_data,
+          worker_gradient_sets[0], worker_arenas, checkpointer) :
+      TrainEpoch(
+          params, model, optimizer, **train_data, thread_pool, worker_gradient_sets, worker_arenas, checkpointer,
+          ring.has_value() ? &*ring : nullptr, layer_reduction.has_value() ? &*layer_reduction : nullptr);
+    if (!train_stats.ok()) { return train_stats.status(); }
+    // NOTE: bad data ends an epoch early, rather than training on what was read before it.
+    absl::Status train_data_status = (*train_data)->ReadStatus();
+    if (!train_data_status.ok()) { return train_data_status; }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "Epoch " << (i + 1) << " of " << params.num_epochs << ": Train score: " << train_stats->ToString()
+      << " in " << seconds << "s, " << (train_stats->total_inferences_ / seconds) << " samples/s";
 
-    test_data->Reset();
-    Stats test_stats = Test(params, neural_network, *test_data, thread_pool);
+    (*test_data)->Reset();
+    Stats test_stats = Test(params, model, **test_data, thread_pool);
+    absl::Status test_data_status = (*test_data)->ReadStatus();
+    if (!test_data_status.ok()) { return test_data_status; }
     LOG(INFO) << "Epoch " << (i + 1) << " of " << params.num_epochs << ": Test score : " << test_stats.ToString();
 
-    LOG(INFO) << "Saving model checkpoint to: " << out_model_checkpoint_file_path << ".";
-    absl::Status checkpoint_status = WriteModelCheckpoint(
-        out_model_checkpoint_file_path, neural_network.ToCheckpoint());
-    if (!checkpoint_status.ok()) { return checkpoint_status; }
+    if (!ring.has_value() || ring->Rank() == 0) {
+      LOG(INFO) << "Saving model checkpoint to: " << out_model_checkpoint_file_path << ".";
+    }
+    checkpointer.Checkpoint(neural_network);
   }
 
-  return absl::OkStatus();
+  // NOTE: waits for the final checkpoint, failing if any checkpoint couldn't be written.
+  absl::Status checkpoint_status = checkpoint_writer.Flush();
+  LOG(INFO) << "Wrote " << checkpoint_writer.WrittenCount() << " model checkpoints.";
+  return checkpoint_status;
 }
+
+template absl::Status Train(
+    NeuralNetwork<float>& neural_network, Optimizer<float>& optimizer, const TrainParameters& params,
+    std::string train_data_file_path, std::string test_data_file_path,
+    std::string out_model_checkpoint_file_path, const std::vector<std::string>& peers);
+template absl::Status Train(
+    NeuralNetwork<double>& neural_network, Optimizer<double>& optimizer, const TrainParameters& params,
+    std::string train_data_file_path, std::string test_data_file_path,
+    std::string out_model_checkpoint_file_path, const std::vector<std::string>& peers);
@@ -2,15 +2,23 @@
 #define SRC_NEURAL_NETWORK_TRAINER_H_
 
 #include <cstdint>
+#include <string>
 #include <utility>
+#include <vector>
 
-#include "src/io/csv_reader.h"
+#include "absl/status/status.h"
 #include "src/neural_network/params.h"
 #include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
 
+// NOTE: defined for T = float and double. Data files may be CSV or binary datasets. To train
+// data parallel, every process passes the same peers, one host:port per shard, and trains
+// its own shard, see RingAllReduce. Empty peers trains in this process alone. optimizer
+// steps the model, and its state is checkpointed along with it.
+template <typename T>
 absl::Status Train(
-    struct NeuralNetwork& neural_network, const TrainParameters& params,
+    NeuralNetwork<T>& neural_network, Optimizer<T>& optimizer, const TrainParameters& params,
     std::string train_data_file_path, std::string score_data_file_path,
-    std::string out_model_checkpoint_file_path);
+    std::string out_model_checkpoint_file_path, const std::vector<std::string>& peers);
 
 #endif
@@ -0,0 +1,149 @@
+#include "src/neural_network/trainer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/common/matrix.h"
+#include "src/io/data_reader.h"
+#include "src/io/dataset.h"
+#include "src/io/model_checkpoint.h"
+#include "src/neural_network/neural_network.h"
+#include "src/neural_network/optimizer.h"
+#include "src/neural_network/params.h"
+#include "src/neural_network/test_util.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+constexpr int32_t kFeatureCount = 12;
+constexpr int32_t kClassCount = 3;
+
+std::string TempFilePath(const std::string& name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// NOTE: feature j is around 1 for samples of class j % kClassCount, around 0 otherwise.
+void WriteCsv(const std::string& file_path, int32_t sample_count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int32_t> label_distribution(0, kClassCount - 1);
+  std::uniform_real_distribution<double> noise(-0.3, 0.3);
+  std::ofstream file(file_path, std::ios::out | std::ios::trunc);
+  file << "label";
+  for (int32_t j = 0; j < kFeatureCount; j++) { file << ",f" << j; }
+  file << "\n";
+  for (int32_t i = 0; i < sample_count; i++) {
+    const int32_t label = label_distribution(rng);
+    file << label;
+    for (int32_t j = 0; j < kFeatureCount; j++) {
+      file << "," << ((j % kClassCount == label) ? 1.0 : 0.0) + noise(rng);
+    }
+    file << "\n";
+  }
+}
+
+absl::Status CsvToDataset(const std::string& in_file_path, const std::string& out_file_path) {
+  absl::StatusOr<std::unique_ptr<DataReader>> reader = OpenDataReader(in_file_path);
+  if (!reader.ok()) { return reader.status(); }
+  absl::StatusOr<DatasetWriter> writer =
+    DatasetWriter::Open(out_file_path, DatasetDtype::FLOAT32, kFeatureCount);
+  if (!writer.ok()) { return writer.status(); }
+  for (SampleBatch batch = (*reader)->GetNextBatch(256); batch.sample_count > 0;
+       batch = (*reader)->GetNextBatch(256)) {
+    absl::Status status = writer->Append(batch);
+    if (!status.ok()) { return status; }
+  }
+  return writer->Finish();
+}
+
+double Accuracy(const NeuralNetwork<double>& neural_network, const std::string& file_path) {
+  absl::StatusOr<std::unique_ptr<DataReader>> reader = OpenDataReader(file_path);
+  CHECK_OK(reader);
+  const SampleBatch batch = (*reader)->GetNextBatch(1 << 20);
+  Matrix<double> input(batch.sample_count, batch.feature_count);
+  batch.ConvertFeatures(1.0, input.MutableData());
+  const Matrix<double> output = neural_network.Infer(input);
+  int64_t correct_count = 0;
+  for (int32_t i = 0; i < batch.sample_count; i++) {
+    correct_count += (output.ClassifyRow(i) == batch.labels[i]);
+  }
+  return (double) correct_count / batch.sample_count;
+}
+
+class HogwildTrainTest : public testing::TestWithParam<bool> {};
+
+// NOTE: trains for several epochs off a prefetched reader, which parses CSV files on the
+// same thread pool the trainer uses.
+TEST_P(HogwildTrainTest, TrainsForEveryEpoch) {
+  constexpr int32_t kTrainSampleCount = 2000;
+  constexpr int32_t kEpochCount = 3;
+  const bool binary = GetParam();
+  std::string train_file_path = TempFilePath("trainer_test_train.csv");
+  const std::string test_file_path = TempFilePath("trainer_test_test.csv");
+  const std::string checkpoint_file_path = TempFilePath("trainer_test.pb");
+  WriteCsv(train_file_path, kTrainSampleCount, /*seed=*/1);
+  WriteCsv(test_file_path, 500, /*seed=*/2);
+  if (binary) {
+    const std::string dataset_file_path = TempFilePath("trainer_test_train.nnds");
+    ASSERT_TRUE(CsvToDataset(train_file_path, dataset_file_path).ok());
+    train_file_path = dataset_file_path;
+  }
+
+  TrainParameters params = TestTrainParameters(protos::Optimizer::SGD);
+  params.cost = Cost::MEAN_SQUARED;
+  params.learn_rate = 0.5;
+  params.regularization = 0.0;
+  params.num_threads = 4;
+  params.num_epochs = kEpochCount;
+  params.train_batch_size = 16;
+  params.test_batch_size = 64;
+  params.prefetch_depth = 2;
+  params.input_scale = 1.0;
+  params.num_shards = 1;
+  params.hogwild = true;
+  params.checkpoint_every_batches = 10;
+  params.checkpoint_keep_last = 1;
+  NeuralNetwork<double> neural_network = NeuralNetwork<double>::Random(
+      {kFeatureCount, 16, kClassCount}, protos::Activation::SIGMOID, protos::Activation::SOFTMAX);
+  const double initial_accuracy = Accuracy(neural_network, test_file_path);
+  Optimizer<double> optimizer(params, neural_network);
+
+  // NOTE: a deadlocked Train can't be joined, it's left behind to fail the test rather than
+  // hang it.
+  std::promise<absl::Status> train_status;
+  std::future<absl::Status> train_future = train_status.get_future();
+  std::thread([&, train_status = std::move(train_status)]() mutable {
+    train_status.set_value(Train(
+          neural_network, optimizer, params, train_file_path, test_file_path,
+          checkpoint_file_path, /*peers=*/{}));
+  }).detach();
+  ASSERT_EQ(train_future.wait_for(std::chrono::seconds(60)), std::future_status::ready)
+    << "Hogwild training didn't finish.";
+  ASSERT_TRUE(train_future.get().ok());
+
+  // NOTE: every batch read is applied as one optimizer step.
+  absl::StatusOr<protos::ModelCheckpoint> checkpoint_proto = ReadModelCheckpoint(checkpoint_file_path);
+  ASSERT_TRUE(checkpoint_proto.ok()) << checkpoint_proto.status();
+  const int64_t batches_per_epoch =
+    (kTrainSampleCount + params.train_batch_size - 1) / params.train_batch_size;
+  EXPECT_EQ(checkpoint_proto->optimizer_state().step(), kEpochCount * batches_per_epoch);
+  absl::StatusOr<NeuralNetwork<double>> trained = NeuralNetwork<double>::FromCheckpoint(*checkpoint_proto);
+  ASSERT_TRUE(trained.ok()) << trained.status();
+  const double accuracy = Accuracy(*trained, test_file_path);
+  EXPECT_GT(accuracy, initial_accuracy);
+  EXPECT_GT(accuracy, 0.9);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    DataFormats, HogwildTrainTest, testing::Bool(),
+    [](const testing::TestParamInfo<bool>& info) { return info.param ? "Binary" : "Csv"; });
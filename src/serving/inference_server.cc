@@ -0,0 +1,216 @@
+#include "src/serving/inference_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/inference_engine.h"
+
+// NOTE: latencies under kSubBucketCount us get a bucket each, larger ones are bucketed by
+// their top 4 bits: the power of two, then 3 bits into it.
+int32_t LatencyHistogram::BucketIndex(int64_t latency) {
+  if (latency < kSubBucketCount) { return std::max<int64_t>(latency, 0); }
+  const int32_t exponent = std::bit_width((uint64_t) latency) - 1;
+  const int32_t sub_bucket = (latency >> (exponent - 3)) & (kSubBucketCount - 1);
+  return std::min((exponent - 2) * kSubBucketCount + sub_bucket, kBucketCount - 1);
+}
+
+int64_t LatencyHistogram::BucketUpperBound(int32_t index) {
+  if (index < kSubBucketCount) { return index; }
+  const int32_t exponent = index / kSubBucketCount + 2;
+  const int32_t sub_bucket = index % kSubBucketCount;
+  return ((int64_t) (kSubBucketCount + sub_bucket + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::Record(std::chrono::microseconds latency) {
+  const int64_t count = latency.count();
+  counts_[BucketIndex(count)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  int64_t max = max_.load(std::memory_order_relaxed);
+  while (count > max && !max_.compare_exchange_weak(max, count, std::memory_order_relaxed)) {}
+}
+
+int64_t LatencyHistogram::Count() const { return count_.load(std::memory_order_relaxed); }
+
+std::chrono::microseconds LatencyHistogram::Percentile(double p) const {
+  const int64_t count = Count();
+  if (count == 0) { return std::chrono::microseconds(0); }
+  const int64_t rank = std::max<int64_t>(1, std::ceil(p * count));
+  int64_t seen = 0;
+  for (int32_t i = 0; i < kBucketCount; i++) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) { return std::chrono::microseconds(std::min(BucketUpperBound(i), Max().count())); }
+  }
+  return Max();
+}
+
+std::chrono::microseconds LatencyHistogram::Max() const {
+  return std::chrono::microseconds(max_.load(std::memory_order_relaxed));
+}
+
+std::string InferenceServerStats::ToString() const {
+  return absl::StrCat(
+      "{ request_count: ", request_count,
+      ", batch_count: ", batch_count,
+      ", mean_batch_size: ", mean_batch_size,
+      ", p50_latency_us: ", p50_latency.count(),
+      ", p90_latency_us: ", p90_latency.count(),
+      ", p99_latency_us: ", p99_latency.count(),
+      ", max_latency_us: ", max_latency.count(),
+      " }");
+}
+
+template <typename T>
+InferenceServer<T>::InferenceServer(
+    InferenceEngine<T> engine, InferenceServerOptions options, ThreadPool* thread_pool) :
+  engine_(std::move(engine)),
+  options_(options),
+  thread_pool_(thread_pool),
+  slots_(),
+  mutex_(),
+  cv_(),
+  queue_(),
+  free_slots_(),
+  stop_(false),
+  latencies_(),
+  batch_count_(0),
+  batcher_() {
+    DCHECK(thread_pool_ != nullptr);
+    CHECK(options_.max_batch_size > 0);
+    const int32_t max_batch_size = options_.max_batch_size;
+    for (size_t i = 0; i < thread_pool_->ThreadCount(); i++) {
+      slots_.push_back(std::make_unique<BatchSlot>(BatchSlot {
+        .workspace = engine_.NewWorkspace(max_batch_size),
+        .input = Matrix(max_batch_size, engine_.InputSize()),
+        .output = Matrix(max_batch_size, engine_.OutputSize()),
+        .requests = {},
+      }));
+      slots_.back()->requests.reserve(max_batch_size);
+      free_slots_.push_back(slots_.back().get());
+    }
+    batcher_ = std::thread(&InferenceServer::BatchLoop, this);
+  }
+
+template <typename T>
+InferenceServer<T>::~InferenceServer() {
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  batcher_.join();
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return free_slots_.size() == slots_.size(); });
+}
+
+template <typename T>
+int32_t InferenceServer<T>::InputSize() const { return engine_.InputSize(); }
+
+template <typename T>
+int32_t InferenceServer<T>::OutputSize() const { return engine_.OutputSize(); }
+
+template <typename T>
+std::future<std::vector<T>> InferenceServer<T>::Infer(std::vector<T> input) {
+  CHECK(input.size() == InputSize())
+    << "Expected " << InputSize() << " features, got " << input.size() << ".";
+  Request request = {
+    .input = std::move(input),
+    .output = std::promise<std::vector<T>>(),
+    .queued_time = Clock::now(),
+  };
+  std::future<std::vector<T>> future = request.output.get_future();
+  {
+    std::scoped_lock lock(mutex_);
+    DCHECK(!stop_);
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_all();
+  return future;
+}
+
+template <typename T>
+InferenceServerStats InferenceServer<T>::Stats() const {
+  const int64_t request_count = latencies_.Count();
+  const int64_t batch_count = batch_count_.load(std::memory_order_relaxed);
+  return InferenceServerStats {
+    .request_count = request_count,
+    .batch_count = batch_count,
+    .mean_batch_size = (batch_count > 0) ? ((double) request_count / batch_count) : 0.0,
+    .p50_latency = latencies_.Percentile(0.5),
+    .p90_latency = latencies_.Percentile(0.9),
+    .p99_latency = latencies_.Percentile(0.99),
+    .max_latency = latencies_.Max(),
+  };
+}
+
+// NOTE: a batch is only taken off the queue once a slot is free to run it in, so requests
+// arriving while every thread is busy still join it.
+template <typename T>
+void InferenceServer<T>::BatchLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) { break; }
+    const Clock::time_point deadline = queue_.front().queued_time + options_.max_batch_delay;
+    cv_.wait_until(lock, deadline, [&]() {
+      return stop_ || queue_.size() >= options_.max_batch_size;
+    });
+    cv_.wait(lock, [&]() { return !free_slots_.empty(); });
+
+    BatchSlot* slot = free_slots_.back();
+    free_slots_.pop_back();
+    const int64_t batch_size = std::min<int64_t>(queue_.size(), options_.max_batch_size);
+    for (int64_t i = 0; i < batch_size; i++) {
+      slot->requests.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    lock.unlock();
+    thread_pool_->Push([this, slot]() { RunBatch(slot); });
+    lock.lock();
+  }
+}
+
+template <typename T>
+void InferenceServer<T>::RunBatch(BatchSlot* slot) {
+  const int32_t batch_size = slot->requests.size();
+  const int32_t input_size = engine_.InputSize();
+  const int32_t output_size = engine_.OutputSize();
+  for (int32_t i = 0; i < batch_size; i++) {
+    std::memcpy(
+        slot->input.MutableData() + (int64_t) i * input_size,
+        slot->requests[i].input.data(), input_size * sizeof(T));
+  }
+  engine_.Infer(slot->input.Elements().data(), batch_size, &slot->workspace, slot->output.MutableData());
+
+  // NOTE: stats are recorded before results are set, so they include every resolved request.
+  const Clock::time_point now = Clock::now();
+  batch_count_.fetch_add(1, std::memory_order_relaxed);
+  for (int32_t i = 0; i < batch_size; i++) {
+    const T* output = slot->output.Elements().data() + (int64_t) i * output_size;
+    latencies_.Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - slot->requests[i].queued_time));
+    slot->requests[i].output.set_value(std::vector<T>(output, output + output_size));
+  }
+  slot->requests.clear();
+  // NOTE: notified under the lock, as the destructor may return as soon as it's released.
+  std::scoped_lock lock(mutex_);
+  free_slots_.push_back(slot);
+  cv_.notify_all();
+}
+
+template class InferenceServer<float>;
+template class InferenceServer<double>;
@@ -0,0 +1,125 @@
+#ifndef SRC_SERVING_INFERENCE_SERVER_H_
+#define SRC_SERVING_INFERENCE_SERVER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/inference_engine.h"
+
+// Lock free histogram of latencies in microseconds, with 8 log-linear buckets per power of
+// two, so percentiles are accurate to within ~12%.
+class LatencyHistogram {
+ public:
+  void Record(std::chrono::microseconds latency);
+  int64_t Count() const;
+  // Upper bound of the bucket holding the fraction p in [0, 1] of recorded latencies.
+  std::chrono::microseconds Percentile(double p) const;
+  std::chrono::microseconds Max() const;
+
+ private:
+  static constexpr int32_t kSubBucketCount = 8;
+  static constexpr int32_t kBucketCount = 64 * kSubBucketCount;
+
+  static int32_t BucketIndex(int64_t latency);
+  static int64_t BucketUpperBound(int32_t index);
+
+  std::array<std::atomic<int64_t>, kBucketCount> counts_ = {};
+  std::atomic<int64_t> count_ = 0;
+  std::atomic<int64_t> max_ = 0;
+};
+
+// NOTE: latencies span from a request being queued to its result being set.
+struct InferenceServerStats {
+  std::string ToString() const;
+
+  int64_t request_count;
+  int64_t batch_count;
+  double mean_batch_size;
+  std::chrono::microseconds p50_latency;
+  std::chrono::microseconds p90_latency;
+  std::chrono::microseconds p99_latency;
+  std::chrono::microseconds max_latency;
+};
+
+struct InferenceServerOptions {
+  int32_t max_batch_size = 32;
+  // NOTE: the longest the oldest queued request waits for others to fill its batch, so the
+  // most latency batching adds when the server is idle.
+  std::chrono::microseconds max_batch_delay = std::chrono::microseconds(500);
+};
+
+// Serves single sample requests through an InferenceEngine, coalescing concurrent requests
+// into batches of up to max_batch_size. A batch is dispatched once it's full, or once its
+// oldest request has waited max_batch_delay. Batches run on a ThreadPool, at most one per
+// pool thread at a time, each in preallocated buffers. While every thread is busy, requests
+// keep queueing into the next batch.
+// NOTE: T is float or double.
+template <typename T>
+class InferenceServer {
+ public:
+  // NOTE: thread_pool must outlive the server.
+  InferenceServer(InferenceEngine<T> engine, InferenceServerOptions options, ThreadPool* thread_pool);
+  // NOTE: every queued request is still served.
+  ~InferenceServer();
+  InferenceServer(const InferenceServer&) = delete;
+  InferenceServer& operator=(const InferenceServer&) = delete;
+
+  int32_t InputSize() const;
+  int32_t OutputSize() const;
+
+  // Queues one sample of InputSize() raw features, resolved with its OutputSize() outputs.
+  std::future<std::vector<T>> Infer(std::vector<T> input);
+
+  InferenceServerStats Stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using Matrix = ::Matrix<T>;
+
+  struct Request {
+    std::vector<T> input;
+    std::promise<std::vector<T>> output;
+    Clock::time_point queued_time;
+  };
+
+  // NOTE: the buffers of one in flight batch.
+  struct BatchSlot {
+    typename InferenceEngine<T>::Workspace workspace;
+    Matrix input;
+    Matrix output;
+    std::vector<Request> requests;
+  };
+
+  void BatchLoop();
+  void RunBatch(BatchSlot* slot);
+
+  const InferenceEngine<T> engine_;
+  const InferenceServerOptions options_;
+  ThreadPool* thread_pool_;
+  std::vector<std::unique_ptr<BatchSlot>> slots_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  std::vector<BatchSlot*> free_slots_;
+  bool stop_;
+  LatencyHistogram latencies_;
+  std::atomic<int64_t> batch_count_;
+  std::thread batcher_;
+};
+
+extern template class InferenceServer<float>;
+extern template class InferenceServer<double>;
+
+#endif
@@ -0,0 +1,60 @@
+#include "src/serving/inference_server.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/neural_network/inference_engine.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  for (int64_t i = 1; i <= 1000; i++) { histogram.Record(std::chrono::microseconds(i)); }
+  EXPECT_EQ(histogram.Count(), 1000);
+  EXPECT_EQ(histogram.Max(), std::chrono::microseconds(1000));
+  EXPECT_EQ(histogram.Percentile(0.0), std::chrono::microseconds(1));
+  // NOTE: within a bucket's width, at most 1/8th above.
+  EXPECT_GE(histogram.Percentile(0.5).count(), 500);
+  EXPECT_LE(histogram.Percentile(0.5).count(), 500 * 9 / 8);
+  EXPECT_GE(histogram.Percentile(0.99).count(), 990);
+  EXPECT_LE(histogram.Percentile(0.99).count(), 1000);
+}
+
+TEST(InferenceServerTest, BatchesConcurrentRequests) {
+  const NeuralNetwork<float> neural_network = NeuralNetwork<float>::Random(
+      {6, 4, 3}, protos::Activation::RELU, protos::Activation::SOFTMAX);
+  ThreadPool thread_pool(2);
+  std::vector<Matrix<float>> inputs;
+  std::vector<std::future<std::vector<float>>> outputs;
+  {
+    // NOTE: a long batch window, so the requests are coalesced into full batches.
+    InferenceServer<float> server(
+        InferenceEngine<float>::FromNeuralNetwork(neural_network),
+        InferenceServerOptions { .max_batch_size = 4, .max_batch_delay = std::chrono::seconds(10) },
+        &thread_pool);
+    for (int32_t i = 0; i < 8; i++) {
+      inputs.push_back(Matrix<float>::Random(1, 6));
+      outputs.push_back(server.Infer(std::vector<float>(
+              inputs.back().Elements().begin(), inputs.back().Elements().end())));
+    }
+    for (int32_t i = 0; i < 8; i++) {
+      const Matrix<float> expected = neural_network.Infer(inputs[i]);
+      const std::vector<float> output = outputs[i].get();
+      ASSERT_EQ(output.size(), 3);
+      for (int32_t j = 0; j < 3; j++) { EXPECT_NEAR(output[j], expected.Elements()[j], 1e-5); }
+    }
+    const InferenceServerStats stats = server.Stats();
+    EXPECT_EQ(stats.request_count, 8);
+    EXPECT_EQ(stats.batch_count, 2);
+
+    // NOTE: partial batches are served on shutdown, rather than after the window.
+    outputs[0] = server.Infer(std::vector<float>(6, 0.0f));
+  }
+  EXPECT_EQ(outputs[0].get().size(), 3);
+}
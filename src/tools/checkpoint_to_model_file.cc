@@ -0,0 +1,49 @@
+// Converts a DOUBLE or FLOAT model checkpoint into the binary model file format, which
+// inference engines serve straight out of a memory mapping, e.g.:
+//   bazel run src/tools:checkpoint_to_model_file -- --in_model_checkpoint_file_path=model.pb
+//     --out_model_file_path=model.nnmf
+
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/io/model_checkpoint.h"
+#include "src/io/model_file.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+ABSL_FLAG(
+    std::string, in_model_checkpoint_file_path, "",
+    "Path to the model checkpoint to convert.");
+ABSL_FLAG(
+    std::string, out_model_file_path, "",
+    "Path to where to write the binary model file.");
+
+absl::Status Convert(const std::string& in_file_path, const std::string& out_file_path) {
+  absl::StatusOr<protos::ModelCheckpoint> checkpoint = ReadModelCheckpoint(in_file_path);
+  if (!checkpoint.ok()) { return checkpoint.status(); }
+  absl::Status status = WriteModelFile(out_file_path, *checkpoint);
+  if (!status.ok()) { return status; }
+  LOG(INFO) << "Converted " << checkpoint->layers().size() << " "
+    << protos::Precision_Name(checkpoint->precision()) << " layers.";
+  return absl::OkStatus();
+}
+
+int main(int argc, char* argv[]) {
+  absl::InitializeLog();
+  absl::ParseCommandLine(argc, argv);
+
+  CHECK(!absl::GetFlag(FLAGS_in_model_checkpoint_file_path).empty())
+    << "Must provide --in_model_checkpoint_file_path.";
+  CHECK(!absl::GetFlag(FLAGS_out_model_file_path).empty())
+    << "Must provide --out_model_file_path.";
+
+  CHECK_OK(Convert(
+        absl::GetFlag(FLAGS_in_model_checkpoint_file_path),
+        absl::GetFlag(FLAGS_out_model_file_path)));
+  return 0;
+}
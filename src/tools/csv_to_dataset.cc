@@ -0,0 +1,82 @@
+// Converts a CSV dataset ("label,feature_0,feature_1,..." lines after a header line) into
+// the binary dataset format read by BinaryDatasetReader, e.g.:
+//   bazel run src/tools:csv_to_dataset -- --in_csv_file_path=train.csv
+//     --out_dataset_file_path=train.dataset --dtype=UINT8
+
+#include <optional>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "src/common/thread_pool.h"
+#include "src/io/csv_reader.h"
+#include "src/io/data_reader.h"
+#include "src/io/dataset.h"
+
+ABSL_FLAG(
+    std::string, in_csv_file_path, "",
+    "Path to the CSV dataset to convert.");
+ABSL_FLAG(
+    std::string, out_dataset_file_path, "",
+    "Path to where to write the binary dataset.");
+ABSL_FLAG(
+    std::string, dtype, std::string(DatasetDtypeToString(DatasetDtype::UINT8)),
+    "Stored feature type, one of { UINT8, FLOAT32, FLOAT64 }. UINT8 requires integral "
+    "features in [0, 255], e.g. pixels.");
+
+constexpr int32_t kBatchSize = 1024;
+
+std::optional<DatasetDtype> DatasetDtypeFromString(const std::string& dtype) {
+  for (DatasetDtype candidate : {DatasetDtype::UINT8, DatasetDtype::FLOAT32, DatasetDtype::FLOAT64}) {
+    if (dtype == DatasetDtypeToString(candidate)) { return candidate; }
+  }
+  return std::nullopt;
+}
+
+absl::Status Convert(const std::string& in_file_path, const std::string& out_file_path, DatasetDtype dtype) {
+  ThreadPool thread_pool;
+  absl::StatusOr<CsvReader> reader = CsvReader::Open(in_file_path, &thread_pool);
+  if (!reader.ok()) { return reader.status(); }
+
+  SampleBatch batch = reader->GetNextBatch(kBatchSize);
+  if (!reader->ReadStatus().ok()) { return reader->ReadStatus(); }
+  if (batch.sample_count == 0) {
+    return absl::InvalidArgumentError(absl::StrCat("No samples in file: ", in_file_path));
+  }
+  absl::StatusOr<DatasetWriter> writer = DatasetWriter::Open(out_file_path, dtype, batch.feature_count);
+  if (!writer.ok()) { return writer.status(); }
+  int64_t sample_count = 0;
+  while (batch.sample_count > 0) {
+    absl::Status status = writer->Append(batch);
+    if (!status.ok()) { return status; }
+    sample_count += batch.sample_count;
+    batch = reader->GetNextBatch(kBatchSize);
+  }
+  // NOTE: the dataset written so far isn't finished, so it can't be opened.
+  if (!reader->ReadStatus().ok()) { return reader->ReadStatus(); }
+  LOG(INFO) << "Converted " << sample_count << " samples.";
+  return writer->Finish();
+}
+
+int main(int argc, char* argv[]) {
+  absl::InitializeLog();
+  absl::ParseCommandLine(argc, argv);
+
+  CHECK(!absl::GetFlag(FLAGS_in_csv_file_path).empty())
+    << "Must provide --in_csv_file_path.";
+  CHECK(!absl::GetFlag(FLAGS_out_dataset_file_path).empty())
+    << "Must provide --out_dataset_file_path.";
+  std::optional<DatasetDtype> dtype = DatasetDtypeFromString(absl::GetFlag(FLAGS_dtype));
+  CHECK(dtype.has_value()) << "Unknown --dtype: " << absl::GetFlag(FLAGS_dtype);
+
+  CHECK_OK(Convert(
+        absl::GetFlag(FLAGS_in_csv_file_path),
+        absl::GetFlag(FLAGS_out_dataset_file_path),
+        *dtype));
+  return 0;
+}
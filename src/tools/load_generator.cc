@@ -0,0 +1,169 @@
+// Drives an in-process InferenceServer with concurrent single sample requests and reports
+// its throughput and latency, to tune the batch window against a latency target, e.g.:
+//   bazel run -c opt src/tools:load_generator -- --concurrency=64
+//     --max_batch_size=32 --max_batch_delay_us=500
+// Clients send their next request as soon as the previous one is answered (closed loop),
+// or, given --target_qps, on a fixed schedule regardless of answers (open loop).
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/io/model_checkpoint.h"
+#include "src/io/model_file.h"
+#include "src/neural_network/inference_engine.h"
+#include "src/neural_network/neural_network.h"
+#include "src/protos/model_checkpoint.pb.h"
+#include "src/serving/inference_server.h"
+
+ABSL_FLAG(
+    std::string, in_model_checkpoint_file_path, "",
+    "Path to the model checkpoint or binary model file to serve, a random --layer_sizes "
+    "model if empty.");
+ABSL_FLAG(
+    std::vector<std::string>, layer_sizes, std::vector<std::string>({"784", "512", "512", "10"}),
+    "Layer sizes of the random model served without --in_model_checkpoint_file_path.");
+ABSL_FLAG(
+    std::string, precision,
+    protos::Precision_Name(protos::Precision::FLOAT),
+    "Element type of the served model, one of { DOUBLE, FLOAT }.");
+ABSL_FLAG(
+    uint32_t, num_threads, std::thread::hardware_concurrency(),
+    "The number of threads running batches.");
+ABSL_FLAG(
+    int32_t, max_batch_size, 32,
+    "The most requests coalesced into one batch.");
+ABSL_FLAG(
+    int64_t, max_batch_delay_us, 500,
+    "The longest a request waits for others to fill its batch, in microseconds.");
+ABSL_FLAG(
+    int32_t, concurrency, 32,
+    "The number of client threads sending requests.");
+ABSL_FLAG(
+    int64_t, num_requests, 100000,
+    "The total number of requests sent.");
+ABSL_FLAG(
+    double, target_qps, 0.0,
+    "Requests per second sent over all clients on a fixed schedule, or 0 for closed loop.");
+
+template <typename T>
+absl::StatusOr<InferenceEngine<T>> LoadInferenceEngine(const std::string& file_path) {
+  absl::StatusOr<bool> is_model_file = IsModelFile(file_path);
+  if (!is_model_file.ok()) { return is_model_file.status(); }
+  if (*is_model_file) {
+    absl::StatusOr<ModelFile> model_file = ModelFile::Open(file_path);
+    if (!model_file.ok()) { return model_file.status(); }
+    return InferenceEngine<T>::FromModelFile(*std::move(model_file));
+  }
+  absl::StatusOr<protos::ModelCheckpoint> checkpoint = ReadModelCheckpoint(file_path);
+  if (!checkpoint.ok()) { return checkpoint.status(); }
+  return InferenceEngine<T>::FromCheckpoint(*checkpoint);
+}
+
+template <typename T>
+absl::StatusOr<InferenceEngine<T>> LoadInferenceEngine() {
+  if (!absl::GetFlag(FLAGS_in_model_checkpoint_file_path).empty()) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    absl::StatusOr<InferenceEngine<T>> engine =
+      LoadInferenceEngine<T>(absl::GetFlag(FLAGS_in_model_checkpoint_file_path));
+    LOG(INFO) << "Loaded the model in " << std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count() << "us.";
+    return engine;
+  }
+  std::vector<int32_t> layer_sizes;
+  for (const std::string& layer_size_str : absl::GetFlag(FLAGS_layer_sizes)) {
+    int32_t layer_size;
+    if (!absl::SimpleAtoi(layer_size_str, &layer_size)) {
+      return absl::InvalidArgumentError(absl::StrCat("Unable to parse layer size: ", layer_size_str));
+    }
+    layer_sizes.push_back(layer_size);
+  }
+  return InferenceEngine<T>::FromNeuralNetwork(NeuralNetwork<T>::Random(
+        std::move(layer_sizes), protos::Activation::RELU, protos::Activation::SOFTMAX));
+}
+
+// NOTE: every client sends the same random sample, the model's cost doesn't depend on it.
+template <typename T>
+void RunClient(InferenceServer<T>& server, int64_t request_count, std::chrono::nanoseconds interval) {
+  const Matrix<T> sample = Matrix<T>::Random(1, server.InputSize());
+  const std::vector<T> input(sample.Elements().begin(), sample.Elements().end());
+  if (interval.count() == 0) {
+    for (int64_t i = 0; i < request_count; i++) { server.Infer(input).wait(); }
+    return;
+  }
+  std::vector<std::future<std::vector<T>>> outputs;
+  outputs.reserve(request_count);
+  std::chrono::steady_clock::time_point next_send = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < request_count; i++) {
+    std::this_thread::sleep_until(next_send);
+    outputs.push_back(server.Infer(input));
+    next_send += interval;
+  }
+  for (std::future<std::vector<T>>& output : outputs) { output.wait(); }
+}
+
+template <typename T>
+absl::Status GenerateLoad() {
+  absl::StatusOr<InferenceEngine<T>> engine = LoadInferenceEngine<T>();
+  if (!engine.ok()) { return engine.status(); }
+  ThreadPool thread_pool(absl::GetFlag(FLAGS_num_threads));
+  InferenceServer<T> server(
+      *std::move(engine),
+      InferenceServerOptions {
+        .max_batch_size = absl::GetFlag(FLAGS_max_batch_size),
+        .max_batch_delay = std::chrono::microseconds(absl::GetFlag(FLAGS_max_batch_delay_us)),
+      },
+      &thread_pool);
+
+  const int32_t concurrency = absl::GetFlag(FLAGS_concurrency);
+  const int64_t request_count = absl::GetFlag(FLAGS_num_requests);
+  const double target_qps = absl::GetFlag(FLAGS_target_qps);
+  const std::chrono::nanoseconds interval((target_qps > 0.0) ? (int64_t) (1e9 * concurrency / target_qps) : 0);
+  LOG(INFO) << "Sending " << request_count << " requests from " << concurrency << " clients"
+    << ((target_qps > 0.0) ? absl::StrCat(" at ", target_qps, " qps") : " in a closed loop") << "...";
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> clients;
+  for (int32_t i = 0; i < concurrency; i++) {
+    const int64_t client_request_count = request_count / concurrency + (i < request_count % concurrency);
+    clients.emplace_back(RunClient<T>, std::ref(server), client_request_count, interval);
+  }
+  for (std::thread& client : clients) { client.join(); }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  LOG(INFO) << "Throughput: " << (request_count / seconds) << " requests / s";
+  LOG(INFO) << "Server stats: " << server.Stats().ToString();
+  return absl::OkStatus();
+}
+
+int main(int argc, char* argv[]) {
+  absl::InitializeLog();
+  absl::ParseCommandLine(argc, argv);
+
+  CHECK(absl::GetFlag(FLAGS_concurrency) > 0) << "--concurrency must be positive.";
+  protos::Precision precision;
+  CHECK(protos::Precision_Parse(absl::GetFlag(FLAGS_precision), &precision))
+    << "Unknown --precision: " << absl::GetFlag(FLAGS_precision);
+  CHECK(precision != protos::Precision::INT8) << "INT8 models can't be served yet.";
+  switch (precision) {
+    case protos::Precision::DOUBLE: CHECK_OK(GenerateLoad<double>()); break;
+    default: CHECK_OK(GenerateLoad<float>()); break;
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+// Quantizes a trained DOUBLE or FLOAT model checkpoint into an INT8 one for serving, then
+// reports its accuracy and speed against the original model in double, e.g.:
+//   bazel run -c opt src/tools:quantize_model -- --in_model_checkpoint_file_path=model.pb
+//     --out_model_checkpoint_file_path=model_int8.pb --calibration_file_path=test.csv
+// Both models are fed raw features, the checkpoint's input transform being folded into their
+// first layer. Checkpoints that don't record one get --input_scale and --input_shift.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "src/common/kernels.h"
+#include "src/common/matrix.h"
+#include "src/common/thread_pool.h"
+#include "src/io/data_reader.h"
+#include "src/io/dataset.h"
+#include "src/io/model_checkpoint.h"
+#include "src/neural_network/inference_engine.h"
+#include "src/neural_network/quantization.h"
+#include "src/protos/model_checkpoint.pb.h"
+
+ABSL_FLAG(
+    std::string, in_model_checkpoint_file_path, "",
+    "Path to the trained model checkpoint to quantize.");
+ABSL_FLAG(
+    std::string, out_model_checkpoint_file_path, "",
+    "Path to where to write the INT8 model checkpoint.");
+ABSL_FLAG(
+    std::string, calibration_file_path, "",
+    "Path to the dataset (CSV or binary) whose first samples calibrate activation scales.");
+ABSL_FLAG(
+    int32_t, num_calibration_samples, 1000,
+    "The number of samples run through the model to calibrate activation scales.");
+ABSL_FLAG(
+    std::string, test_file_path, "",
+    "Path to the dataset (CSV or binary) to compare the models on, skipped if empty.");
+ABSL_FLAG(
+    double, input_scale, 1.0 / 255.0,
+    "Features are multiplied by this, as in training, if the checkpoint doesn't record its "
+    "input transform.");
+ABSL_FLAG(
+    double, input_shift, 0.0,
+    "Added to features after scaling, as in training, if the checkpoint doesn't record its "
+    "input transform.");
+ABSL_FLAG(
+    int32_t, batch_size, 32,
+    "The number of test samples run per forward pass.");
+
+absl::StatusOr<Matrix<float>> ReadCalibrationInputs(ThreadPool& thread_pool) {
+  absl::StatusOr<std::unique_ptr<DataReader>> reader =
+    OpenDataReader(absl::GetFlag(FLAGS_calibration_file_path), &thread_pool);
+  if (!reader.ok()) { return reader.status(); }
+  const SampleBatch batch = (*reader)->GetNextBatch(absl::GetFlag(FLAGS_num_calibration_samples));
+  absl::Status status = (*reader)->ReadStatus();
+  if (!status.ok()) { return status; }
+  if (batch.sample_count == 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "No samples in file: ", absl::GetFlag(FLAGS_calibration_file_path)));
+  }
+  Matrix<float> inputs(batch.sample_count, batch.feature_count);
+  batch.ConvertFeatures<float>(1.0f, inputs.MutableData());
+  return inputs;
+}
+
+struct ModelStats {
+  int64_t correct_count = 0;
+  std::chrono::nanoseconds infer_time = std::chrono::nanoseconds(0);
+};
+
+template <typename T>
+int32_t ClassifyRow(const T* row, int32_t col_count) {
+  return std::max_element(row, row + col_count) - row;
+}
+
+// NOTE: both models run single threaded, in batches of --batch_size.
+absl::Status CompareModels(
+    const InferenceEngine<double>& reference_engine, const QuantizedInferenceEngine& engine,
+    ThreadPool& thread_pool) {
+  absl::StatusOr<std::unique_ptr<DataReader>> reader =
+    OpenDataReader(absl::GetFlag(FLAGS_test_file_path), &thread_pool);
+  if (!reader.ok()) { return reader.status(); }
+  const int32_t batch_size = absl::GetFlag(FLAGS_batch_size);
+  const int32_t output_size = engine.OutputSize();
+  InferenceEngine<double>::Workspace reference_workspace = reference_engine.NewWorkspace(batch_size);
+  QuantizedInferenceEngine::Workspace workspace = engine.NewWorkspace(batch_size);
+  std::vector<double> reference_input((int64_t) batch_size * engine.InputSize());
+  std::vector<double> reference_output((int64_t) batch_size * output_size);
+  std::vector<float> input((int64_t) batch_size * engine.InputSize());
+  std::vector<float> output((int64_t) batch_size * output_size);
+
+  ModelStats reference_stats;
+  ModelStats stats;
+  int64_t sample_count = 0;
+  int64_t agreement_count = 0;
+  double max_output_diff = 0.0;
+  for (SampleBatch batch = (*reader)->GetNextBatch(batch_size); batch.sample_count > 0;
+       batch = (*reader)->GetNextBatch(batch_size)) {
+    if (batch.feature_count != engine.InputSize()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+            "Expected ", engine.InputSize(), " features, got: ", batch.feature_count));
+    }
+    batch.ConvertFeatures<double>(1.0, reference_input.data());
+    batch.ConvertFeatures<float>(1.0f, input.data());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    reference_engine.Infer(
+        reference_input.data(), batch.sample_count, &reference_workspace, reference_output.data());
+    reference_stats.infer_time += std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    engine.Infer(input.data(), batch.sample_count, &workspace, output.data());
+    stats.infer_time += std::chrono::steady_clock::now() - start;
+
+    for (int32_t i = 0; i < batch.sample_count; i++) {
+      const double* reference_row = reference_output.data() + (int64_t) i * output_size;
+      const float* row = output.data() + (int64_t) i * output_size;
+      const int32_t reference_class = ClassifyRow(reference_row, output_size);
+      const int32_t predicted_class = ClassifyRow(row, output_size);
+      reference_stats.correct_count += (reference_class == batch.labels[i]);
+      stats.correct_count += (predicted_class == batch.labels[i]);
+      agreement_count += (reference_class == predicted_class);
+      for (int32_t j = 0; j < output_size; j++) {
+        max_output_diff = std::max(max_output_diff, std::abs(row[j] - reference_row[j]));
+      }
+    }
+    sample_count += batch.sample_count;
+  }
+  absl::Status status = (*reader)->ReadStatus();
+  if (!status.ok()) { return status; }
+  if (sample_count == 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+          "No samples in file: ", absl::GetFlag(FLAGS_test_file_path)));
+  }
+
+  const double reference_accuracy = (double) reference_stats.correct_count / sample_count;
+  const double accuracy = (double) stats.correct_count / sample_count;
+  LOG(INFO) << "Compared on " << sample_count << " samples:";
+  LOG(INFO) << "  Accuracy: DOUBLE: " << reference_accuracy << ", INT8: " << accuracy
+    << " (delta: " << (accuracy - reference_accuracy) << ")";
+  LOG(INFO) << "  Predictions agreeing: " << ((double) agreement_count / sample_count)
+    << ", max output difference: " << max_output_diff;
+  LOG(INFO) << "  Inference time: DOUBLE: "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(reference_stats.infer_time).count()
+    << "ms, INT8 (" << SimdIsaToString(GetInt8Kernels().isa) << "): "
+    << std::chrono::duration_cast<std::chrono::milliseconds>(stats.infer_time).count() << "ms";
+  return absl::OkStatus();
+}
+
+absl::Status Quantize() {
+  absl::StatusOr<protos::ModelCheckpoint> checkpoint =
+    ReadModelCheckpoint(absl::GetFlag(FLAGS_in_model_checkpoint_file_path));
+  if (!checkpoint.ok()) { return checkpoint.status(); }
+  if (!checkpoint->has_input_transform()) {
+    checkpoint->mutable_input_transform()->set_scale(absl::GetFlag(FLAGS_input_scale));
+    checkpoint->mutable_input_transform()->set_shift(absl::GetFlag(FLAGS_input_shift));
+  }
+  ThreadPool thread_pool;
+  absl::StatusOr<Matrix<float>> calibration_inputs = ReadCalibrationInputs(thread_pool);
+  if (!calibration_inputs.ok()) { return calibration_inputs.status(); }
+
+  absl::StatusOr<protos::ModelCheckpoint> quantized_checkpoint =
+    QuantizeCheckpoint(*checkpoint, *calibration_inputs);
+  if (!quantized_checkpoint.ok()) { return quantized_checkpoint.status(); }
+  LOG(INFO) << "Calibrated on " << calibration_inputs->RowCount() << " samples, checkpoint size: "
+    << protos::Precision_Name(checkpoint->precision()) << ": " << checkpoint->ByteSizeLong()
+    << " bytes, INT8: " << quantized_checkpoint->ByteSizeLong() << " bytes.";
+  absl::Status status = WriteModelCheckpoint(
+      absl::GetFlag(FLAGS_out_model_checkpoint_file_path), *quantized_checkpoint);
+  if (!status.ok()) { return status; }
+
+  if (absl::GetFlag(FLAGS_test_file_path).empty()) { return absl::OkStatus(); }
+  absl::StatusOr<InferenceEngine<double>> reference_engine =
+    InferenceEngine<double>::FromCheckpoint(*checkpoint);
+  if (!reference_engine.ok()) { return reference_engine.status(); }
+  absl::StatusOr<QuantizedInferenceEngine> engine =
+    QuantizedInferenceEngine::FromCheckpoint(*quantized_checkpoint);
+  if (!engine.ok()) { return engine.status(); }
+  return CompareModels(*reference_engine, *engine, thread_pool);
+}
+
+int main(int argc, char* argv[]) {
+  absl::InitializeLog();
+  absl::ParseCommandLine(argc, argv);
+
+  CHECK(!absl::GetFlag(FLAGS_in_model_checkpoint_file_path).empty())
+    << "--in_model_checkpoint_file_path is required.";
+  CHECK(!absl::GetFlag(FLAGS_out_model_checkpoint_file_path).empty())
+    << "--out_model_checkpoint_file_path is required.";
+  CHECK(!absl::GetFlag(FLAGS_calibration_file_path).empty())
+    << "--calibration_file_path is required.";
+  CHECK(absl::GetFlag(FLAGS_batch_size) > 0) << "--batch_size must be positive.";
+  CHECK_OK(Quantize());
+  return 0;
+}